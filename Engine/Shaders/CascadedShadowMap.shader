@@ -1,38 +1,24 @@
+@IndirectDraw on
+
+// only MATRIX_M is uploaded for shadow casters
+#define PER_DRAW_MODEL_MATRIX_ONLY
 #include <ShaderVariables.inc>
 #include <CG.inc>
 //#include <ShadowCommon.inc>
 //#include <CascadedShadowMapCommon.inc>
 
-struct VS_OUT {
-	vec3 normal;	// in world space
-};
-
 @vertex
 {
 	layout (location = PositionIndex) 	in vec3 InputPositon;
 	layout (location = NormalIndex)		in vec3 InputNormal;
 
-	out VS_OUT vs_out;
+#ifdef _INDIRECT_DRAW
+	layout (location = DrawIDIndex)		in uint InputDrawID;
+#endif
 
-	void main()
-	{
-		vec4 position = vec4(InputPositon, 1);
-		vec3 normal = InputNormal;
-		//gl_Position = ObjectToWorld * ObjectPosition;
-		//position = UnityClipSpaceShadowCasterPos2(position, normal);
-		//position = UnityApplyLinearShadowBias(position);
-		gl_Position = position;
-		vs_out.normal = normalize(normal);
-	}
-}
+	// one draw per cascade (layer of the shadow map), only with the casters of the cascade
+	uniform float CascadeIndex;
 
-@geometry
-{
-	layout(triangles, invocations = 4) in;
-	layout(triangle_strip, max_vertices = 3) out;
-
-	in VS_OUT vs_out[];
-	
 	float4 ClipSpaceShadowCasterPos(float4 vertex, float3 normal, float biasScale)
 	{
 		float4 wPos = mul(MATRIX_M, vertex);
@@ -78,25 +64,20 @@ struct VS_OUT {
 
 	void main()
 	{
-		for (int i = 0; i < gl_in.length(); ++i)
-		{
-		#ifdef SHOWMAP_NO_BIAS
-			vec4 position = LightMatrix[gl_InvocationID] * MATRIX_M * gl_in[i].gl_Position;
-			gl_Position = position;
-		#else
-			float4x4 matrixVP = LightMatrix[gl_InvocationID];
-			//float biasScale = matrixVP[2][2];
-			//biasScale = abs(biasScale);
-			float4 oPosition = gl_in[i].gl_Position;
-			float3 oNormal = normalize(vs_out[i].normal);
-			float4 wPos = ClipSpaceShadowCasterPos(oPosition, oNormal, 0.01);
-			float4 cPos = matrixVP * wPos;
-			gl_Position = ApplyLinearShadowBias(cPos, 0.1);
-		#endif
-			gl_Layer = gl_InvocationID;
-			EmitVertex();
-		}
-		EndPrimitive();
+#ifdef _INDIRECT_DRAW
+		int DrawID = int(InputDrawID);
+		LoadPerDrawUniforms(DrawID);
+#endif
+		float4x4 matrixVP = LightMatrix[int(CascadeIndex)];
+	#ifdef SHOWMAP_NO_BIAS
+		gl_Position = matrixVP * MATRIX_M * vec4(InputPositon, 1);
+	#else
+		//float biasScale = matrixVP[2][2];
+		//biasScale = abs(biasScale);
+		float4 wPos = ClipSpaceShadowCasterPos(vec4(InputPositon, 1), normalize(InputNormal), 0.01);
+		float4 cPos = matrixVP * wPos;
+		gl_Position = ApplyLinearShadowBias(cPos, 0.1);
+	#endif
 	}
 }
 
@@ -105,4 +86,4 @@ struct VS_OUT {
 	void main()
 	{
 	}
-}
\ No newline at end of file
+}
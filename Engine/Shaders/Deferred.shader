@@ -5,6 +5,7 @@
 #include <ShadingModels.inc>
 //#include <ShadowCommon.inc>
 #include <CG.inc>
+#include <ClusteredLighting.inc>
 
 struct V2F
 {
@@ -58,6 +59,15 @@ struct V2F
 
 		Color.rgb = PI * LightColor.rgb * NoL * StandardShading(DiffuseColor, SpecularColor, vec3(GBuffer.Roughness), vec3(1), L, V, N);
 
+		// point and spot lights
+		uvec2 LightRange = GetClusterLightRange(gl_FragCoord.xy, WorldPosition);
+		for (uint i = LightRange.x; i < LightRange.x + LightRange.y; ++i)
+		{
+			LocalLight Light = GetLocalLight(i, WorldPosition);
+			float LocalNoL = saturate( dot(N, Light.L) );
+			Color.rgb += PI * Light.Radiance * LocalNoL * StandardShading(DiffuseColor, SpecularColor, vec3(GBuffer.Roughness), vec3(1), Light.L, V, N);
+		}
+
 		return Color;
 	}
 
@@ -0,0 +1,35 @@
+// Gizmos recorded in a frame: world space lines and triangles, and instances of unit primitives (circle, box, ...)
+// placed by the affine matrix InstanceRow0~2 (identity for lines and triangles).
+
+@cull off
+
+uniform mat4 MATRIX_VP;
+
+@vertex
+{
+	layout(location = 0)	in vec3 InputPositon;
+	layout(location = 1)	in vec4 InputColor;
+	layout(location = 2)	in vec4 InstanceRow0;
+	layout(location = 3)	in vec4 InstanceRow1;
+	layout(location = 4)	in vec4 InstanceRow2;
+
+	out vec4 Color;
+
+	void main()
+	{
+		vec4 p = vec4(InputPositon, 1);
+		vec3 worldPosition = vec3(dot(InstanceRow0, p), dot(InstanceRow1, p), dot(InstanceRow2, p));
+		gl_Position = MATRIX_VP * vec4(worldPosition, 1);
+		Color = InputColor;
+	}
+}
+
+@fragment
+{
+	in vec4 Color;
+	out vec4 fragColor;
+	void main()
+	{
+		fragColor = Color;
+	}
+}
@@ -5,7 +5,7 @@
 	layout (location = PositionIndex)	in vec3 InputPositon;
 	layout (location = NormalIndex)		in vec3 InputNormal;
 	layout (location = TangentIndex)	in vec3 InputTangent;
-	layout (location = BoneIndexIndex)	in ivec4 boneIndex;
+	layout (location = BoneIndexIndex)	in uvec4 boneIndex;
 	layout (location = BoneWeightIndex)	in vec4 boneWeight;
 
 	// #define MAX_BONE_SIZE 128
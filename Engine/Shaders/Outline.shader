@@ -1,4 +1,5 @@
 @Cull Front
+@IndirectDraw on
 
 struct VS_OUT
 {
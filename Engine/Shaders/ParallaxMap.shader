@@ -1,3 +1,5 @@
+@IndirectDraw on
+
 uniform sampler2D diffuseMap;
 uniform sampler2D normalMap;
 uniform sampler2D depthMap;
@@ -39,6 +41,8 @@ struct VS_OUT
 
 @fragment
 {
+	#include <CG.inc>
+
 	in  VS_OUT vs_out;
 	out vec4 fragColor;
 
@@ -103,8 +107,7 @@ struct VS_OUT
 			discard;
 
 		vec3 diffuse = texture(diffuseMap, uv).rgb;
-		vec3 N = texture(normalMap, uv).xyz;
-		N = normalize(N * 2.0 - 1.0);
+		vec3 N = normalize(UnpackNormalMap(texture(normalMap, uv)));
 		float NDotL = dot(N, vs_out.lightDirInTangent);
 		NDotL = clamp(NDotL, 0.0, 1.0);
 		fragColor = vec4( diffuse * NDotL, 1.0);
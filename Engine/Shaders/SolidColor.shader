@@ -1,3 +1,5 @@
+@IndirectDraw on
+
 @vertex
 {
 	#define USE_DEFAULT_VS
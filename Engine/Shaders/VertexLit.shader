@@ -1,3 +1,5 @@
+@IndirectDraw on
+
 struct VS_OUT
 {
 	vec3 color;
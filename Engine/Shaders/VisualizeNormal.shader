@@ -1,3 +1,5 @@
+@IndirectDraw on
+
 @vertex
 {
 	#include <AppData.inc>
@@ -0,0 +1,153 @@
+#include "AssetImportScheduler.hpp"
+
+#include <thread>
+
+#include <Application.hpp>
+#include <Debug.hpp>
+#include <JobSystem.hpp>
+#include <Resources.hpp>
+#include <Texture.hpp>
+#include <Timer.hpp>
+
+#include "AssetDataBase.hpp"
+#include "AssetImporter.hpp"
+#include "TextureImporter.hpp"
+
+using namespace FishEngine;
+
+namespace
+{
+	// assets in a stage only depend on assets of previous stages
+	enum ImportStage
+	{
+		ImportStage_Independent = 0,	// texture, shader, audio
+		ImportStage_Material,			// references textures and shaders
+		ImportStage_Model,				// references materials and textures
+		ImportStage_Count,
+	};
+
+	ImportStage StageOf(AssetType type)
+	{
+		if (type == AssetType::Material)
+			return ImportStage_Material;
+		if (type == AssetType::Model)
+			return ImportStage_Model;
+		return ImportStage_Independent;
+	}
+
+	struct TextureImportJob
+	{
+		Path												m_path;
+		std::shared_ptr<FishEditor::TextureImporter>		m_importer;
+		FishEditor::TextureImporter::DecodedImage			m_image;
+	};
+}
+
+namespace FishEditor
+{
+	int AssetImportScheduler::s_mainThreadBatchSize = 8;
+
+	void AssetImportScheduler::ImportAll(std::vector<Path> const & paths, ProgressCallback const & onProgress)
+	{
+		Assert(JobSystem::IsMainThread());
+		Timer timer("Import assets");
+
+		std::vector<Path> stages[ImportStage_Count];
+		for (auto const & p : paths)
+		{
+			auto type = Resources::GetAssetType(p.extension());
+			stages[StageOf(type)].push_back(p);
+		}
+
+		const int total = static_cast<int>(paths.size());
+		int imported = 0;
+		auto reportProgress = [&imported, total, &onProgress]()
+		{
+			imported++;
+			if (onProgress)
+				onProgress(imported, total);
+			if (imported % 64 == 0 || imported == total)
+				LogInfo(Format("Importing assets: %1%/%2%", imported, total));
+		};
+
+		auto rootDir = Application::dataPath().parent_path();
+		auto importOnMainThread = [&rootDir, &reportProgress](Path const & p)
+		{
+			AssetDatabase::LoadAssetAtPath(boost::filesystem::relative(p, rootDir));
+			reportProgress();
+		};
+
+		// stage 0: decode textures on workers; meanwhile the main thread imports shaders, dds and audio,
+		// which need GL or are cheap, and finishes the decoded textures in batches.
+		std::vector<Path> mainThreadAssets;
+		std::vector<TextureImportJob> textureJobs;
+		for (auto const & p : stages[ImportStage_Independent])
+		{
+			auto ext = p.extension();
+			if (Resources::GetAssetType(ext) == AssetType::Texture && ext != ".dds")
+			{
+				Path path = p;
+				path.make_preferred();
+				if (AssetImporter::s_pathToImpoter.find(path) != AssetImporter::s_pathToImpoter.end())
+				{
+					reportProgress();
+					continue;
+				}
+				TextureImportJob job;
+				job.m_path = path;
+				job.m_importer = AssetImporter::GetAssetImporter<TextureImporter>(path);	// reads .meta
+				textureJobs.push_back(std::move(job));
+			}
+			else
+			{
+				mainThreadAssets.push_back(p);
+			}
+		}
+
+		auto counter = std::make_shared<JobCounter>();
+		for (auto & job : textureJobs)
+		{
+			auto pJob = &job;	// textureJobs is not resized any more
+			JobSystem::Schedule([pJob, &reportProgress]()
+			{
+				pJob->m_importer->Decode(pJob->m_image);
+				JobSystem::RunOnMainThread([pJob, &reportProgress]()
+				{
+					auto texture = pJob->m_importer->Import(pJob->m_path, pJob->m_image);
+					texture->setName(pJob->m_path.stem().string());
+					AssetImporter::s_objectInstanceIDToPath[texture->GetInstanceID()] = pJob->m_path;
+					AssetImporter::RegisterImporter(pJob->m_path, pJob->m_importer);
+					reportProgress();
+				});
+			}, counter, "AssetImport.Decode");
+		}
+
+		std::size_t next = 0;
+		while (!counter->IsDone() || next < mainThreadAssets.size())
+		{
+			int finished = JobSystem::ExecuteMainThreadJobs(s_mainThreadBatchSize);
+			if (next < mainThreadAssets.size())
+			{
+				importOnMainThread(mainThreadAssets[next]);
+				next++;
+			}
+			else if (finished == 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+		JobSystem::ExecuteMainThreadJobs();
+
+		// stage 1 & 2: material and model importers resolve references through the asset database,
+		// which is not thread safe, so they stay on the main thread.
+		for (int stage = ImportStage_Material; stage < ImportStage_Count; ++stage)
+		{
+			for (auto const & p : stages[stage])
+			{
+				importOnMainThread(p);
+			}
+		}
+
+		timer.StopAndPrint();
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+
+#include <FishEngine.hpp>
+#include <ReflectClass.hpp>
+#include <Path.hpp>
+
+namespace FishEditor
+{
+	// Bulk import of assets (project open, reimport all).
+	// Assets are imported in dependency order: textures/shaders/audio -> materials -> models.
+	// CPU stages (image decoding) run on the JobSystem workers, everything that touches
+	// GL, Qt or the asset database is finished on the main thread in batches.
+	class Meta(NonSerializable) AssetImportScheduler
+	{
+	public:
+		AssetImportScheduler() = delete;
+
+		// imported, total
+		typedef std::function<void(int, int)> ProgressCallback;
+
+		// paths: absolute paths of the asset files. Must be called from the main thread.
+		static void ImportAll(std::vector<FishEngine::Path> const & paths, ProgressCallback const & onProgress = nullptr);
+
+		// max number of finished CPU jobs the main thread handles before doing other work.
+		static int mainThreadBatchSize() { return s_mainThreadBatchSize; }
+		static void setMainThreadBatchSize(int size) { s_mainThreadBatchSize = size; }
+
+	private:
+		static int s_mainThreadBatchSize;
+	};
+}
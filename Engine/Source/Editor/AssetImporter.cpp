@@ -187,24 +187,31 @@ namespace FishEditor
 			ret = importer;
 		}
 
-		// TODO: move to ...
 		if (ret != nullptr)
 		{
-			s_importerGUIDToObject[ret->GetGUID()] = ret->asset();
-			s_pathToImpoter[path] = ret;
+			RegisterImporter(path, ret);
 		}
 
-		if (ret != nullptr && ret->m_assetTimeStamp == 0)	// if the .meta file is newly created
+		return ret;
+	}
+
+	void AssetImporter::RegisterImporter(FishEngine::Path const & path, AssetImporterPtr const & importer)
+	{
+		s_importerGUIDToObject[importer->GetGUID()] = importer->asset();
+		s_pathToImpoter[path] = importer;
+
+		if (importer->m_assetTimeStamp == 0)	// if the .meta file is newly created
 		{
 			uint32_t time_created = static_cast<uint32_t>(time(NULL));
-			ret->m_assetTimeStamp = time_created;
+			importer->m_assetTimeStamp = time_created;
 			auto meta_path = path.string() + ".meta";
 			std::ofstream fout(meta_path);
 			AssetOutputArchive archive(fout);
-			archive.SerializeAssetImporter(ret);
+			archive.SerializeAssetImporter(importer);
 		}
-
-		return ret;
 	}
+
+	// used by AssetImportScheduler
+	template std::shared_ptr<TextureImporter> AssetImporter::GetAssetImporter<TextureImporter>(FishEngine::Path const & assetPath);
 }
 
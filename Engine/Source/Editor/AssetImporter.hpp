@@ -58,6 +58,7 @@ namespace FishEditor
 		friend class FishEditor::AssetDatabase;
 		friend class FishEditor::SceneOutputArchive;
 		friend class MetaInputArchive;
+		friend class AssetImportScheduler;
 		
 		virtual void Reimport() { abort(); }
 		
@@ -71,6 +72,9 @@ namespace FishEditor
 		template<class AssetImporterType>
 		static std::shared_ptr<AssetImporterType> GetAssetImporter(FishEngine::Path const & assetPath);
 
+		// add the importer to the lookup tables and write its .meta file if it is newly created.
+		static void RegisterImporter(FishEngine::Path const & path, AssetImporterPtr const & importer);
+
 		//Get or set the AssetBundle name.
 		std::string						m_assetBundleName;
 		
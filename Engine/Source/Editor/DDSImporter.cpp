@@ -10,6 +10,7 @@
 #endif
 
 #include <GLEnvironment.hpp>
+#include <GLStateCache.hpp>
 #include <Debug.hpp>
 #include <Common.hpp>
 #include <Mathf.hpp>
@@ -206,7 +207,7 @@ GLuint CreateTextureFromDDS(char const* path, FishEngine::TextureDimension* out_
 
 	GLuint gl_texture_name = 0;
 	glGenTextures(1, &gl_texture_name);
-	glBindTexture(target, gl_texture_name);
+	GLStateCache::BindTexture(target, gl_texture_name);
 	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
 	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(gli_texture.levels() - 1));
 	glTexParameteri(target, GL_TEXTURE_SWIZZLE_R, gli_format.Swizzles[0]);
@@ -9,6 +9,7 @@
 #include <Debug.hpp>
 #include <GameObject.hpp>
 #include <MeshFilter.hpp>
+#include <LODGroup.hpp>
 #include <MeshRenderer.hpp>
 #include <SkinnedMeshRenderer.hpp>
 #include <Texture.hpp>
@@ -17,6 +18,8 @@
 
 #include "AssetDataBase.hpp"
 #include "FBXImporter/RawMesh.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
 
 //#include <Animation/AnimationUtility.hpp>
 //#include <Animation/AnimationClip.hpp>
@@ -595,6 +598,35 @@ MeshPtr FishEditor::FBXImporter::ParseMesh(FbxMesh* fbxMesh)
 
 	auto mesh = rawMesh.ToMesh();
 	GetLinkData(fbxMesh, mesh, rawMesh.m_vertexIndexRemapping);
+
+	// after GetLinkData: bone weights are welded and reordered together with the other attributes
+	if (m_optimizeMesh)
+	{
+		auto stats = MeshOptimizer::Optimize(mesh);
+		LogInfo(Format("Optimize mesh [%1%]: vertices %2% -> %3%, ACMR %4% -> %5%, %6%-bit indices",
+			fbxMesh->GetNode()->GetName(), stats.vertexCountBefore, stats.vertexCountAfter,
+			stats.ACMRBefore, stats.ACMRAfter, stats.vertexCountAfter <= 0xFFFF ? 16 : 32));
+	}
+
+	// Low packs normals and tangents; Medium and High also pack uvs and bone data.
+	// Positions are never quantized, so High is the same as Medium.
+	if (m_meshCompression == ModelImporterMeshCompression::Low)
+		mesh->setVertexCompression(VertexCompression::PackedNormals);
+	else if (m_meshCompression != ModelImporterMeshCompression::Off)
+		mesh->setVertexCompression(VertexCompression::PackedAll);
+
+	{
+		// every vertex is fetched at least once per draw, depth-only passes only read the position stream
+		const uint32_t vertexCount = mesh->vertexCount();
+		const uint32_t indexCount = static_cast<uint32_t>(mesh->m_triangles.size());
+		const uint32_t indexBytes = indexCount * mesh->indexSize();
+		const uint32_t memory = vertexCount * mesh->vertexStride() + indexBytes;
+		const uint32_t uncompressedMemory = vertexCount * mesh->uncompressedVertexStride() + indexCount * 4;
+		LogInfo(Format("Mesh [%1%]: %2% bytes/vertex (uncompressed %3%), memory and fetch per draw %4% KB (uncompressed %5% KB), depth-only fetch %6% KB",
+			fbxMesh->GetNode()->GetName(), mesh->vertexStride(), mesh->uncompressedVertexStride(),
+			memory / 1024.f, uncompressedMemory / 1024.f,
+			(vertexCount * 3 * sizeof(float) + indexBytes) / 1024.f));
+	}
 	
 	m_model.m_fbxMeshLookup[fbxMesh] = m_model.m_meshes.size();
 	m_model.m_meshes.push_back(mesh);
@@ -723,6 +755,38 @@ void FishEditor::FBXImporter::BakeTransforms(FbxScene * scene)
 	//scene->GetRootNode()->ResetPivotSetAndConvertAnimation();
 }
 
+// mesh and its simplified versions (m_lodCount levels at most), cached per mesh
+std::vector<MeshPtr> const & FishEditor::FBXImporter::GenerateLODs(MeshPtr const & mesh)
+{
+	auto it = m_model.m_lodMeshes.find(mesh.get());
+	if (it != m_model.m_lodMeshes.end())
+		return it->second;
+
+	auto & lods = m_model.m_lodMeshes[mesh.get()];
+	lods.push_back(mesh);
+	for (int i = 1; i < m_lodCount; ++i)
+	{
+		auto lod = MeshSimplifier::Simplify(mesh, std::pow(0.5f, static_cast<float>(i)));
+		if (lod->triangleCount() >= lods.back()->triangleCount())
+			break;	// can not be simplified any further
+		lod->setName(mesh->name() + "_LOD" + std::to_string(i));
+		m_model.m_meshes.push_back(lod);
+		if (m_recycleNameToFileID.find(lod->name()) == m_recycleNameToFileID.end())
+		{
+			m_recycleNameToFileID[lod->name()] = m_nextMeshFileID;
+			m_fileIDToRecycleName[m_nextMeshFileID] = lod->name();
+			m_nextMeshFileID += 2;
+		}
+		lods.push_back(lod);
+	}
+
+	std::string counts = std::to_string(mesh->triangleCount());
+	for (size_t i = 1; i < lods.size(); ++i)
+		counts += " / " + std::to_string(lods[i]->triangleCount());
+	LogInfo(Format("Mesh [%1%]: %2% LODs, triangles %3%", mesh->name(), lods.size(), counts));
+	return lods;
+}
+
 /**
 * Print a node, its attributes, and all its children recursively.
 */
@@ -801,6 +865,18 @@ GameObjectPtr FishEditor::FBXImporter::ParseNodeRecursively(FbxNode* pNode)
 				go->AddComponent<MeshFilter>()->SetMesh(mesh);
 				renderer = go->AddComponent<MeshRenderer>();
 				renderer->SetMaterial(material);
+
+				if (m_generateLODs && m_lodCount > 1)
+				{
+					auto const & lods = GenerateLODs(mesh);
+					// LOD i covers half the screen height of LOD i-1, the last LOD is never culled
+					std::vector<float> heights(lods.size());
+					for (size_t i = 0; i < lods.size(); ++i)
+					{
+						heights[i] = (i + 1 == lods.size()) ? 0.0f : std::pow(0.5f, static_cast<float>(i + 1));
+					}
+					go->AddComponent<LODGroup>()->SetLODs(lods, heights);
+				}
 			}
 			
 			for (int i = 1; i < lMaterialCount; ++i)
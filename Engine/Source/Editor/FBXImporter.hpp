@@ -73,6 +73,8 @@ namespace FishEditor
 		std::vector<FishEngine::MeshPtr>		m_meshes;
 		std::unordered_map<fbxsdk::FbxMesh*, size_t> 
 												m_fbxMeshLookup; // fbxmesh -> index in m_meshes
+		std::unordered_map<FishEngine::Mesh*, std::vector<FishEngine::MeshPtr>>
+												m_lodMeshes;	// mesh -> all its LODs, LOD0 is the mesh itself
 
 		std::vector<FishEngine::MaterialPtr>	m_materials;
 		std::unordered_map<fbxsdk::FbxSurfaceMaterial*, size_t> 
@@ -116,6 +118,9 @@ namespace FishEditor
 
 		FishEngine::MeshPtr ParseMesh(fbxsdk::FbxMesh* fbxMesh);
 
+		// LOD0 (mesh itself) to LOD m_lodCount-1, simplified meshes are added to m_model.m_meshes
+		std::vector<FishEngine::MeshPtr> const & GenerateLODs(FishEngine::MeshPtr const & mesh);
+
 		FishEngine::MaterialPtr ParseMaterial(fbxsdk::FbxSurfaceMaterial * pMaterial);
 
 		void GetLinkData(fbxsdk::FbxMesh* pGeometry, FishEngine::MeshPtr mesh, std::map<uint32_t, uint32_t> const & vertexIndexRemapping);
@@ -3,6 +3,7 @@
 #include "AssetImporter.hpp"
 #include "TextureImporter.hpp"
 #include "AssetDataBase.hpp"
+#include "AssetImportScheduler.hpp"
 #include "GameObject.hpp"
 
 #include <Application.hpp>
@@ -141,14 +142,10 @@ namespace FishEditor
 		s_assetRoot->m_path = path;
 		//s_nameToNode[boost::filesystem::absolute(path).string()] = this;
 		
-		std::vector<Path> modelPaths;
-		s_assetRoot->BuildNodeTree(path, modelPaths);
+		std::vector<Path> assetPaths;
+		s_assetRoot->BuildNodeTree(path, assetPaths);
 		
-		
-		for (auto & p : modelPaths)
-		{
-			AddFileNode(p);
-		}
+		AssetImportScheduler::ImportAll(assetPaths);
 	}
 
 	FileInfo* FileInfo::fileInfo(const std::string &path)
@@ -217,13 +214,11 @@ namespace FishEditor
 	}
 
 	// path must be a dir
-	void FileInfo::BuildNodeTree(const Path & path, std::vector<Path> & modelPaths)
+	// collect files only, they are imported later by AssetImportScheduler
+	void FileInfo::BuildNodeTree(const Path & path, std::vector<Path> & assetPaths)
 	{
 		s_nameToNode[boost::filesystem::absolute(path).make_preferred().string()] = this;
 		
-		// models should be imported after all materials and texutures
-		//std::vector<Path> modelPaths;
-		
 		for (auto& it : boost::filesystem::directory_iterator(path))
 		{
 			const Path & p = it.path();
@@ -240,37 +235,15 @@ namespace FishEditor
 			{
 				m_dirChildren.emplace_back(fileNode);
 				fileNode->m_isDirectory = true;
-				fileNode->BuildNodeTree(p, modelPaths);
+				fileNode->BuildNodeTree(p, assetPaths);
 			}
 			else
 			{
 				m_fileChildren.emplace_back(fileNode);
 				fileNode->m_isDirectory = false;
-				auto relative_path = boost::filesystem::relative(p, FishEngine::Application::dataPath().parent_path());
-				auto ext = p.extension();
-				auto assetType = Resources::GetAssetType(ext);
-				if (assetType == AssetType::Model)
-				{
-					modelPaths.push_back(p);
-				}
-				else
-				{
-					AssetDatabase::LoadAssetAtPath(relative_path);
-				}
+				assetPaths.push_back(p);
 			}
 		}
-
-	}
-	
-	void FileInfo::AddFileNode(const Path & path)
-	{
-		auto parentDir = path.parent_path();
-		auto parentNode = fileInfo(parentDir.string());
-		auto fileNode = new FileInfo();
-		fileNode->m_path = path;
-		fileNode->m_parent = parentNode;
-		auto relative_path = boost::filesystem::relative(path, FishEngine::Application::dataPath().parent_path());
-		AssetDatabase::LoadAssetAtPath(relative_path);
 	}
 }
 
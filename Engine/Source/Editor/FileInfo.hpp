@@ -87,8 +87,7 @@ namespace FishEditor
 
 	private:
 		friend class ::ProjectViewFileModel;
-		void BuildNodeTree(const Path & path, std::vector<Path> & modelPaths);
-		static void AddFileNode(const Path & path);
+		void BuildNodeTree(const Path & path, std::vector<Path> & assetPaths);
 
 		Path                    m_path;
 		FileInfo*               m_parent = nullptr;
@@ -43,21 +43,31 @@ namespace FishEditor
 	public:
 		typedef std::function<void()> Actor;
 
-		void operator += (Actor const& actor)
+		// Returns the id to remove the actor with.
+		int operator += (Actor const& actor)
 		{
-			m_actors.push_back(actor);
+			m_actors.emplace_back(++m_nextID, actor);
+			return m_nextID;
+		}
+
+		void operator -= (int id)
+		{
+			m_actors.remove_if([id](std::pair<int, Actor> const & a) {
+				return a.first == id;
+			});
 		}
 
 		void operator()() const
 		{
 			for (auto const & a : m_actors)
 			{
-				a();
+				a.second();
 			}
 		}
 
 	private:
-		std::list<Actor> m_actors;
+		std::list<std::pair<int, Actor>> m_actors;
+		int m_nextID = 0;
 	};
 }
 
@@ -168,7 +168,7 @@ template<>
 void Inspector::OnInspectorGUI(const FishEngine::MaterialPtr& material)
 {
 	EditorGUI::FloatField("Instance ID", material->GetInstanceID());
-	auto& uniforms = material->m_shader->uniforms();
+	auto& uniforms = material->m_shader->propertyUniforms();
 	for (auto& u : uniforms)
 	{
 		if (u.type == GL_FLOAT)
@@ -191,8 +191,9 @@ void Inspector::OnInspectorGUI(const FishEngine::MaterialPtr& material)
 			//ImGui::Image((void*)tex->GetNativeTexturePtr(), ImVec2(64, 64));
 			//ImGui::SameLine();
 			//ImGui::Button("Select");
-			auto& tex = material->m_textures[u.name];
+			auto tex = material->m_textures[u.name];
 			EditorGUI::TextureField(u.name, &tex);
+			material->SetTexture(u.name, tex);
 		}
 	}
 }
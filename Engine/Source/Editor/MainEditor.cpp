@@ -36,6 +36,10 @@
 #include "SceneViewEditor.hpp"
 #include "AssetDataBase.hpp"
 #include "EditorResources.hpp"
+#include <GLStateCache.hpp>
+#include <StaticBatchingUtility.hpp>
+#include <GameLoop.hpp>
+#include <SceneSnapshot.hpp>
 
 
 using namespace FishEngine;
@@ -854,6 +858,10 @@ namespace FishEditor
 
 	void MainEditor::Run()
 	{
+		// Qt touches the GL state between two paintGL calls
+		GLStateCache::Reset();
+		GLStateCache::BeginFrame();
+
 		GLint framebuffer; // qt's framebuffer
 		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
 		
@@ -862,23 +870,18 @@ namespace FishEditor
 
 		if (Application::isPlaying())
 		{
-			static auto time = std::chrono::high_resolution_clock::now();
-			auto now = std::chrono::high_resolution_clock::now();
-			auto elapse = now - time;
-			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapse).count();
-			time = now;
-			Time::m_deltaTime = ms / 1000.0f;
-			Scene::Update();
-			PhysicsSystem::FixedUpdate();
+			GameLoop::Tick();
 			AudioSystem::Update();
 		}
 		else
 		{
 			m_mainSceneViewEditor->Update();
 		}
+		GameLoop::BeginRender();
 		m_mainSceneViewEditor->Render();
+		GameLoop::EndRender();
 
-		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 		//Graphics::Blit()
 		glViewport(0, 0, Screen::width(), Screen::height());
 		auto quad = Mesh::builtinMesh(PrimitiveType::ScreenAlignedQuad);
@@ -888,24 +891,23 @@ namespace FishEditor
 		Graphics::DrawMesh(quad, mtl);
 		//Debug::Log("paintGL");
 
+		// to the hierarchy view, once per frame
+		Scene::DispatchChanges();
+
 		Input::Update();
 	}
 
 	void MainEditor::Play()
 	{
-//		ofstream fout("temp.yaml");
-//		YAMLOutputArchive archive(fout);
-//		for (auto const & go : Scene::GameObjects())
-//		{
-//			archive << go;
-//		}
-		
+		// restored by Stop
+		SceneSnapshot::Capture();
+
 		Application::s_isPlaying = true;
 		PhysicsSystem::Init();
 		//m_inPlayMode = true;
 		Camera::setMainCamera(nullptr);
 		//Camera::m_mainCamera = nullptr;
-		Time::m_time = 0;
+		GameLoop::Reset();
 		Scene::Start();
 	}
 
@@ -915,7 +917,12 @@ namespace FishEditor
 		Application::s_isPlaying = false;
 		//Camera::m_mainCamera = EditorGUI::m_mainSceneViewEditor->camera();
 		Camera::setMainCamera(m_mainSceneViewEditor->camera());
+		GameLoop::Reset();
 		PhysicsSystem::Clean();
+		// static objects may be edited again
+		StaticBatchingUtility::Clear();
+		// undo the changes made in play mode
+		SceneSnapshot::Restore();
 	}
 
 	void MainEditor::Resize(int width, int height)
@@ -0,0 +1,362 @@
+#include "MeshOptimizer.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include <Mesh.hpp>
+
+using namespace FishEngine;
+
+namespace
+{
+	constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+	// FNV-1a
+	inline void HashBytes(uint32_t & h, void const * data, std::size_t size)
+	{
+		auto bytes = static_cast<uint8_t const *>(data);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			h ^= bytes[i];
+			h *= 16777619u;
+		}
+	}
+
+	template<class T>
+	inline void HashAttribute(uint32_t & h, std::vector<T> const & attribute, uint32_t v)
+	{
+		if (!attribute.empty())
+			HashBytes(h, &attribute[v], sizeof(T));
+	}
+
+	template<class T>
+	inline bool SameAttribute(std::vector<T> const & attribute, uint32_t a, uint32_t b)
+	{
+		return attribute.empty() || std::memcmp(&attribute[a], &attribute[b], sizeof(T)) == 0;
+	}
+
+	template<class T>
+	void RemapAttribute(std::vector<T> & attribute, std::vector<uint32_t> const & remap, uint32_t newVertexCount)
+	{
+		if (attribute.empty())
+			return;
+		std::vector<T> result(newVertexCount);
+		for (std::size_t v = 0; v < remap.size(); ++v)
+		{
+			if (remap[v] != InvalidIndex)
+				result[remap[v]] = attribute[v];
+		}
+		attribute = std::move(result);
+	}
+
+	// [first, last) ranges of the index buffer, one for each sub-mesh
+	std::vector<std::pair<uint32_t, uint32_t>> SubMeshRanges(Mesh const & mesh)
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> ranges;
+		const uint32_t indexCount = static_cast<uint32_t>(mesh.m_triangles.size());
+		if (mesh.m_subMeshCount <= 1)
+		{
+			ranges.emplace_back(0, indexCount);
+			return ranges;
+		}
+		for (int i = 0; i < mesh.m_subMeshCount; ++i)
+		{
+			uint32_t first = mesh.m_subMeshIndexOffset[i];
+			uint32_t last = (i == mesh.m_subMeshCount - 1) ? indexCount : mesh.m_subMeshIndexOffset[i + 1];
+			ranges.emplace_back(first, last);
+		}
+		return ranges;
+	}
+
+	// Forsyth's scoring function
+	constexpr int   ForsythCacheSize			= 32;
+	constexpr float ForsythCacheDecayPower		= 1.5f;
+	constexpr float ForsythLastTriScore			= 0.75f;
+	constexpr float ForsythValenceBoostScale	= 2.0f;
+	constexpr float ForsythValenceBoostPower	= 0.5f;
+
+	float ForsythVertexScore(int cachePosition, uint32_t remainingValence)
+	{
+		if (remainingValence == 0)
+			return -1.0f;	// no triangle needs this vertex
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// used by the last triangle, fixed score so that the next triangle does not simply reuse the same edge
+				score = ForsythLastTriScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (ForsythCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, ForsythCacheDecayPower);
+			}
+		}
+		// bonus for vertices with few triangles left, so that lone triangles are not left behind
+		score += ForsythValenceBoostScale * std::pow(static_cast<float>(remainingValence), -ForsythValenceBoostPower);
+		return score;
+	}
+
+	// reorder the triangles of indices[0, indexCount)
+	void ForsythReorder(uint32_t * indices, uint32_t indexCount, uint32_t vertexCount)
+	{
+		const uint32_t triangleCount = indexCount / 3;
+		if (triangleCount <= 1)
+			return;
+
+		// vertex -> triangles adjacency
+		std::vector<uint32_t> valence(vertexCount, 0);
+		for (uint32_t i = 0; i < indexCount; ++i)
+			valence[indices[i]]++;
+		std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+		std::vector<uint32_t> adjacency(indexCount);
+		{
+			std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (uint32_t t = 0; t < triangleCount; ++t)
+				for (int c = 0; c < 3; ++c)
+				{
+					uint32_t v = indices[t * 3 + c];
+					adjacency[fill[v]++] = t;
+				}
+		}
+
+		// valence[] is now the number of remaining triangles, adjacency list of v is [offset, offset + valence)
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			vertexScore[v] = ForsythVertexScore(-1, valence[v]);
+
+		std::vector<float> triangleScore(triangleCount);
+		std::vector<bool> triangleEmitted(triangleCount, false);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+			triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+		std::vector<uint32_t> result;
+		result.reserve(indexCount);
+
+		uint32_t cache[ForsythCacheSize + 3];
+		int cacheCount = 0;
+		uint32_t newCache[ForsythCacheSize + 3];
+
+		uint32_t bestTriangle = 0;
+		for (uint32_t t = 1; t < triangleCount; ++t)
+		{
+			if (triangleScore[t] > triangleScore[bestTriangle])
+				bestTriangle = t;
+		}
+
+		uint32_t scanCursor = 0;	// for the rare case that no triangle in the cache is usable
+		for (uint32_t emitted = 0; emitted < triangleCount; ++emitted)
+		{
+			if (bestTriangle == InvalidIndex)
+			{
+				while (triangleEmitted[scanCursor])
+					scanCursor++;
+				bestTriangle = scanCursor;
+			}
+
+			const uint32_t * tri = indices + bestTriangle * 3;
+			triangleEmitted[bestTriangle] = true;
+
+			// the emitted triangle goes to the front of the cache
+			int newCacheCount = 0;
+			for (int c = 0; c < 3; ++c)
+			{
+				uint32_t v = tri[c];
+				result.push_back(v);
+				newCache[newCacheCount++] = v;
+
+				// remove triangle from the adjacency of v
+				uint32_t * adj = adjacency.data() + adjacencyOffset[v];
+				uint32_t n = valence[v];
+				for (uint32_t k = 0; k < n; ++k)
+				{
+					if (adj[k] == bestTriangle)
+					{
+						adj[k] = adj[n - 1];
+						break;
+					}
+				}
+				valence[v]--;
+			}
+			for (int i = 0; i < cacheCount; ++i)
+			{
+				uint32_t v = cache[i];
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					newCache[newCacheCount++] = v;
+			}
+
+			// update scores of the vertices in the cache, and of those just pushed out
+			for (int i = 0; i < newCacheCount; ++i)
+			{
+				uint32_t v = newCache[i];
+				int position = i < ForsythCacheSize ? i : -1;
+				cachePosition[v] = position;
+				vertexScore[v] = ForsythVertexScore(position, valence[v]);
+			}
+
+			bestTriangle = InvalidIndex;
+			float bestScore = -1.0f;
+			for (int i = 0; i < newCacheCount; ++i)
+			{
+				uint32_t v = newCache[i];
+				uint32_t const * adj = adjacency.data() + adjacencyOffset[v];
+				for (uint32_t k = 0; k < valence[v]; ++k)
+				{
+					uint32_t t = adj[k];
+					float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+					triangleScore[t] = score;
+					if (score > bestScore)
+					{
+						bestScore = score;
+						bestTriangle = t;
+					}
+				}
+			}
+
+			cacheCount = std::min(newCacheCount, ForsythCacheSize);
+			std::copy(newCache, newCache + cacheCount, cache);
+		}
+
+		std::copy(result.begin(), result.end(), indices);
+	}
+}
+
+namespace FishEditor
+{
+	float MeshOptimizer::ACMR(std::vector<uint32_t> const & indices, uint32_t vertexCount, int cacheSize)
+	{
+		if (indices.size() < 3)
+			return 0.0f;
+		// a vertex is in the FIFO cache if it was inserted less than cacheSize misses ago
+		std::vector<uint32_t> insertedAt(vertexCount, InvalidIndex);
+		uint32_t misses = 0;
+		for (auto v : indices)
+		{
+			if (insertedAt[v] == InvalidIndex || misses - insertedAt[v] >= static_cast<uint32_t>(cacheSize))
+			{
+				insertedAt[v] = misses;
+				misses++;
+			}
+		}
+		return static_cast<float>(misses) / (indices.size() / 3);
+	}
+
+	void MeshOptimizer::RemapVertices(MeshPtr const & mesh, std::vector<uint32_t> const & remap, uint32_t newVertexCount)
+	{
+		RemapAttribute(mesh->m_vertices, remap, newVertexCount);
+		RemapAttribute(mesh->m_normals, remap, newVertexCount);
+		RemapAttribute(mesh->m_uv, remap, newVertexCount);
+		RemapAttribute(mesh->m_tangents, remap, newVertexCount);
+		RemapAttribute(mesh->m_boneWeights, remap, newVertexCount);
+		for (auto & i : mesh->m_triangles)
+		{
+			i = remap[i];
+		}
+		mesh->m_vertexCount = newVertexCount;
+	}
+
+	uint32_t MeshOptimizer::WeldVertices(MeshPtr const & mesh)
+	{
+		const uint32_t vertexCount = static_cast<uint32_t>(mesh->m_vertices.size());
+		if (vertexCount == 0)
+			return 0;
+
+		auto hashOf = [&mesh](uint32_t v)
+		{
+			uint32_t h = 2166136261u;
+			HashAttribute(h, mesh->m_vertices, v);
+			HashAttribute(h, mesh->m_normals, v);
+			HashAttribute(h, mesh->m_uv, v);
+			HashAttribute(h, mesh->m_tangents, v);
+			HashAttribute(h, mesh->m_boneWeights, v);
+			return h;
+		};
+		auto equal = [&mesh](uint32_t a, uint32_t b)
+		{
+			return SameAttribute(mesh->m_vertices, a, b)
+				&& SameAttribute(mesh->m_normals, a, b)
+				&& SameAttribute(mesh->m_uv, a, b)
+				&& SameAttribute(mesh->m_tangents, a, b)
+				&& SameAttribute(mesh->m_boneWeights, a, b);
+		};
+
+		// open addressing, load factor <= 0.5
+		uint32_t tableSize = 1;
+		while (tableSize < vertexCount * 2)
+			tableSize <<= 1;
+		const uint32_t mask = tableSize - 1;
+		std::vector<uint32_t> table(tableSize, InvalidIndex);
+
+		std::vector<uint32_t> remap(vertexCount);
+		uint32_t uniqueCount = 0;
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			uint32_t slot = hashOf(v) & mask;
+			while (true)
+			{
+				uint32_t other = table[slot];
+				if (other == InvalidIndex)
+				{
+					table[slot] = v;
+					remap[v] = uniqueCount++;
+					break;
+				}
+				if (equal(v, other))
+				{
+					remap[v] = remap[other];
+					break;
+				}
+				slot = (slot + 1) & mask;
+			}
+		}
+
+		if (uniqueCount != vertexCount)
+		{
+			RemapVertices(mesh, remap, uniqueCount);
+		}
+		return vertexCount - uniqueCount;
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(MeshPtr const & mesh)
+	{
+		const uint32_t vertexCount = static_cast<uint32_t>(mesh->m_vertices.size());
+		for (auto const & range : SubMeshRanges(*mesh))
+		{
+			ForsythReorder(mesh->m_triangles.data() + range.first, range.second - range.first, vertexCount);
+		}
+	}
+
+	void MeshOptimizer::OptimizeVertexFetch(MeshPtr const & mesh)
+	{
+		const uint32_t vertexCount = static_cast<uint32_t>(mesh->m_vertices.size());
+		std::vector<uint32_t> remap(vertexCount, InvalidIndex);
+		uint32_t next = 0;
+		for (auto i : mesh->m_triangles)
+		{
+			if (remap[i] == InvalidIndex)
+				remap[i] = next++;
+		}
+		RemapVertices(mesh, remap, next);
+	}
+
+	MeshOptimizer::Statistics MeshOptimizer::Optimize(MeshPtr const & mesh)
+	{
+		Statistics stats;
+		stats.vertexCountBefore = static_cast<uint32_t>(mesh->m_vertices.size());
+		stats.ACMRBefore = ACMR(mesh->m_triangles, stats.vertexCountBefore);
+
+		WeldVertices(mesh);
+		OptimizeVertexCache(mesh);
+		OptimizeVertexFetch(mesh);
+
+		stats.vertexCountAfter = static_cast<uint32_t>(mesh->m_vertices.size());
+		stats.ACMRAfter = ACMR(mesh->m_triangles, stats.vertexCountAfter);
+		return stats;
+	}
+}
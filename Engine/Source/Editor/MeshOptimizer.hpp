@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <FishEngine.hpp>
+#include <ReflectClass.hpp>
+
+namespace FishEditor
+{
+	// Import-time optimisation of indexed triangle meshes.
+	// Sub-mesh ranges and skin weights are preserved.
+	class Meta(NonSerializable) MeshOptimizer
+	{
+	public:
+		MeshOptimizer() = delete;
+
+		// FIFO cache size used to compute ACMR, a conservative size for current GPUs.
+		static constexpr int ACMRCacheSize = 16;
+
+		struct Statistics
+		{
+			uint32_t	vertexCountBefore	= 0;
+			uint32_t	vertexCountAfter	= 0;
+			float		ACMRBefore			= 0;
+			float		ACMRAfter			= 0;
+		};
+
+		// Weld + vertex cache + vertex fetch optimisation.
+		static Statistics Optimize(FishEngine::MeshPtr const & mesh);
+
+		// Merge vertices whose attributes (position, normal, uv, tangent, bone weights) are bitwise identical.
+		// Returns the number of removed vertices.
+		static uint32_t WeldVertices(FishEngine::MeshPtr const & mesh);
+
+		// Reorder triangles of each sub-mesh for the post-transform vertex cache.
+		// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation", 2006.
+		static void OptimizeVertexCache(FishEngine::MeshPtr const & mesh);
+
+		// Renumber vertices in the order they are first referenced by the index buffer,
+		// so vertex fetches are (mostly) sequential. Unreferenced vertices are removed.
+		static void OptimizeVertexFetch(FishEngine::MeshPtr const & mesh);
+
+		// Average cache miss ratio: vertex shader invocations per triangle, simulated with a FIFO cache.
+		// 0.5 is the (unreachable) optimum for regular grids, 3.0 means no reuse at all.
+		static float ACMR(std::vector<uint32_t> const & indices, uint32_t vertexCount, int cacheSize = ACMRCacheSize);
+
+	private:
+		// remap[oldVertex] = newVertex, or UINT32_MAX to drop the vertex
+		static void RemapVertices(FishEngine::MeshPtr const & mesh, std::vector<uint32_t> const & remap, uint32_t newVertexCount);
+	};
+}
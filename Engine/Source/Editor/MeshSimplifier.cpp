@@ -0,0 +1,317 @@
+#include "MeshSimplifier.hpp"
+
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+
+#include <Mesh.hpp>
+
+#include "MeshOptimizer.hpp"
+
+using namespace FishEngine;
+
+namespace
+{
+	// symmetric 4x4 matrix, upper triangle: aa ab ac ad bb bc bd cc cd dd
+	struct Quadric
+	{
+		double m[10] = { 0 };
+
+		// squared distance to the plane ax + by + cz + d = 0, (a, b, c) normalized
+		static Quadric FromPlane(double a, double b, double c, double d)
+		{
+			Quadric q;
+			q.m[0] = a*a;	q.m[1] = a*b;	q.m[2] = a*c;	q.m[3] = a*d;
+			q.m[4] = b*b;	q.m[5] = b*c;	q.m[6] = b*d;
+			q.m[7] = c*c;	q.m[8] = c*d;
+			q.m[9] = d*d;
+			return q;
+		}
+
+		Quadric & operator+=(Quadric const & rhs)
+		{
+			for (int i = 0; i < 10; ++i)
+				m[i] += rhs.m[i];
+			return *this;
+		}
+
+		double Error(Vector3 const & p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			return m[0]*x*x + 2*m[1]*x*y + 2*m[2]*x*z + 2*m[3]*x
+				+ m[4]*y*y + 2*m[5]*y*z + 2*m[6]*y
+				+ m[7]*z*z + 2*m[8]*z
+				+ m[9];
+		}
+	};
+
+	// move vertex "from" onto vertex "to"
+	struct Collapse
+	{
+		uint32_t	from;
+		uint32_t	to;
+		double		error;
+	};
+
+	// vertices with bitwise identical positions get the same id
+	std::vector<uint32_t> BuildPositionIDs(std::vector<Vector3> const & positions)
+	{
+		const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+		std::vector<uint32_t> order(vertexCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&positions](uint32_t a, uint32_t b)
+		{
+			return std::memcmp(&positions[a], &positions[b], sizeof(Vector3)) < 0;
+		});
+
+		std::vector<uint32_t> ids(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			const uint32_t v = order[i];
+			if (i > 0 && std::memcmp(&positions[v], &positions[order[i-1]], sizeof(Vector3)) == 0)
+				ids[v] = ids[order[i-1]];
+			else
+				ids[v] = v;
+		}
+		return ids;
+	}
+
+	Vector3 TriangleNormal(Vector3 const & a, Vector3 const & b, Vector3 const & c)
+	{
+		return Vector3::Cross(b - a, c - a);
+	}
+}
+
+namespace FishEditor
+{
+	MeshPtr MeshSimplifier::Simplify(MeshPtr const & mesh, float targetRatio, float maxError)
+	{
+		auto const & positions = mesh->m_vertices;
+		const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+		std::vector<uint32_t> indices = mesh->m_triangles;
+		uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		const uint32_t targetTriangleCount = std::max(1u, static_cast<uint32_t>(triangleCount * targetRatio));
+
+		// sub-mesh of every triangle
+		std::vector<int> triangleSubMesh(triangleCount, 0);
+		if (mesh->m_subMeshCount > 1)
+		{
+			for (int s = 0; s < mesh->m_subMeshCount; ++s)
+			{
+				uint32_t first = mesh->m_subMeshIndexOffset[s] / 3;
+				uint32_t last = (s == mesh->m_subMeshCount - 1) ? triangleCount : mesh->m_subMeshIndexOffset[s + 1] / 3;
+				std::fill(triangleSubMesh.begin() + first, triangleSubMesh.begin() + last, s);
+			}
+		}
+
+		// lock vertices whose position is shared by several vertices (uv/normal seams),
+		// used by several sub-meshes or on an open border
+		const auto positionIDs = BuildPositionIDs(positions);
+		std::vector<uint8_t> lockedPosition(vertexCount, 0);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			if (positionIDs[v] != v)
+			{
+				lockedPosition[positionIDs[v]] = 1;
+			}
+		}
+
+		std::vector<int> vertexSubMesh(vertexCount, -1);
+		std::unordered_map<uint64_t, int> edgeUseCount;
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				const uint32_t v = indices[t*3 + e];
+				if (vertexSubMesh[v] == -1)
+					vertexSubMesh[v] = triangleSubMesh[t];
+				else if (vertexSubMesh[v] != triangleSubMesh[t])
+					lockedPosition[positionIDs[v]] = 1;
+
+				uint64_t a = positionIDs[v];
+				uint64_t b = positionIDs[indices[t*3 + (e+1)%3]];
+				if (a > b)
+					std::swap(a, b);
+				edgeUseCount[(a << 32) | b]++;
+			}
+		}
+		for (auto const & edge : edgeUseCount)
+		{
+			if (edge.second == 1)
+			{
+				lockedPosition[static_cast<uint32_t>(edge.first >> 32)] = 1;
+				lockedPosition[static_cast<uint32_t>(edge.first & 0xFFFFFFFFu)] = 1;
+			}
+		}
+		auto isLocked = [&](uint32_t v) { return lockedPosition[positionIDs[v]] != 0; };
+
+		std::vector<Quadric> quadrics(vertexCount);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const uint32_t a = indices[t*3], b = indices[t*3+1], c = indices[t*3+2];
+			Vector3 n = TriangleNormal(positions[a], positions[b], positions[c]);
+			const float length = n.magnitude();
+			if (length <= 0)
+				continue;
+			n /= length;
+			const auto q = Quadric::FromPlane(n.x, n.y, n.z, -Vector3::Dot(n, positions[a]));
+			quadrics[a] += q;
+			quadrics[b] += q;
+			quadrics[c] += q;
+		}
+
+		const double errorLimit = Mathf::Pow(maxError * mesh->bounds().size().magnitude(), 2.0f);
+
+		// Collapses are done in passes: sort all candidate collapses by error, then collapse in that order,
+		// skipping vertices whose neighbourhood has already changed in this pass.
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<uint8_t> touched(vertexCount);
+		std::vector<Collapse> collapses;
+		while (triangleCount > targetTriangleCount)
+		{
+			// vertex -> triangles
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (auto i : indices)
+				adjacencyOffsets[i + 1]++;
+			for (uint32_t v = 0; v < vertexCount; ++v)
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+			adjacency.resize(indices.size());
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (uint32_t i = 0; i < indices.size(); ++i)
+					adjacency[fill[indices[i]]++] = i / 3;
+			}
+
+			collapses.clear();
+			for (uint32_t i = 0; i < indices.size(); ++i)
+			{
+				const uint32_t a = indices[i];
+				const uint32_t b = indices[i - i%3 + (i+1)%3];
+				if (!isLocked(a))
+					collapses.push_back({ a, b, quadrics[a].Error(positions[b]) });
+				if (!isLocked(b))
+					collapses.push_back({ b, a, quadrics[b].Error(positions[a]) });
+			}
+			std::sort(collapses.begin(), collapses.end(), [](Collapse const & x, Collapse const & y)
+			{
+				return x.error < y.error;
+			});
+
+			std::iota(remap.begin(), remap.end(), 0);
+			std::fill(touched.begin(), touched.end(), 0);
+			uint32_t removed = 0;
+			uint32_t collapsed = 0;
+			for (auto const & c : collapses)
+			{
+				if (c.error > errorLimit || triangleCount - removed <= targetTriangleCount)
+					break;
+				if (touched[c.from] || touched[c.to])
+					continue;
+
+				// reject collapses that flip a remaining triangle or rotate it by more than 60 degrees
+				uint32_t degenerate = 0;
+				bool flipped = false;
+				for (uint32_t k = adjacencyOffsets[c.from]; k < adjacencyOffsets[c.from + 1]; ++k)
+				{
+					const uint32_t t = adjacency[k];
+					uint32_t corners[3] = { indices[t*3], indices[t*3+1], indices[t*3+2] };
+					if (positionIDs[corners[0]] == positionIDs[c.to] || positionIDs[corners[1]] == positionIDs[c.to]
+						|| positionIDs[corners[2]] == positionIDs[c.to])
+					{
+						degenerate++;
+						continue;
+					}
+					const Vector3 before = TriangleNormal(positions[corners[0]], positions[corners[1]], positions[corners[2]]);
+					for (auto & v : corners)
+					{
+						if (v == c.from)
+							v = c.to;
+					}
+					const Vector3 after = TriangleNormal(positions[corners[0]], positions[corners[1]], positions[corners[2]]);
+					if (Vector3::Dot(before, after) <= 0.5f * before.magnitude() * after.magnitude())
+					{
+						flipped = true;
+						break;
+					}
+				}
+				if (flipped)
+					continue;
+
+				remap[c.from] = c.to;
+				quadrics[c.to] += quadrics[c.from];
+				touched[c.to] = 1;
+				for (uint32_t k = adjacencyOffsets[c.from]; k < adjacencyOffsets[c.from + 1]; ++k)
+				{
+					const uint32_t t = adjacency[k];
+					touched[indices[t*3]] = touched[indices[t*3+1]] = touched[indices[t*3+2]] = 1;
+				}
+				removed += degenerate;
+				collapsed++;
+			}
+
+			if (collapsed == 0)
+				break;
+
+			// apply the collapses and drop degenerate triangles, keeping sub-mesh order
+			uint32_t write = 0;
+			for (uint32_t t = 0; t < triangleCount; ++t)
+			{
+				const uint32_t a = remap[indices[t*3]];
+				const uint32_t b = remap[indices[t*3+1]];
+				const uint32_t c = remap[indices[t*3+2]];
+				if (positionIDs[a] == positionIDs[b] || positionIDs[b] == positionIDs[c] || positionIDs[c] == positionIDs[a])
+					continue;
+				indices[write*3] = a;
+				indices[write*3+1] = b;
+				indices[write*3+2] = c;
+				triangleSubMesh[write] = triangleSubMesh[t];
+				write++;
+			}
+			triangleCount = write;
+			indices.resize(triangleCount * 3);
+			triangleSubMesh.resize(triangleCount);
+		}
+
+		auto lod = std::make_shared<Mesh>();
+		lod->m_vertices = mesh->m_vertices;
+		lod->m_normals = mesh->m_normals;
+		lod->m_uv = mesh->m_uv;
+		lod->m_tangents = mesh->m_tangents;
+		lod->m_boneWeights = mesh->m_boneWeights;
+		lod->m_bindposes = mesh->m_bindposes;
+		lod->m_boneNames = mesh->m_boneNames;
+		lod->m_skinned = mesh->m_skinned;
+		lod->m_triangles = std::move(indices);
+		lod->m_vertexCount = vertexCount;
+		lod->m_triangleCount = triangleCount;
+		lod->m_bounds = mesh->m_bounds;		// keep LOD selection consistent between levels
+		lod->m_subMeshCount = mesh->m_subMeshCount;
+		if (mesh->m_subMeshCount > 1)
+		{
+			lod->m_subMeshIndexOffset.assign(mesh->m_subMeshCount, 0);
+			int subMesh = 0;
+			for (uint32_t t = 0; t <= triangleCount; ++t)
+			{
+				const int s = (t == triangleCount) ? mesh->m_subMeshCount : triangleSubMesh[t];
+				while (subMesh < s)
+				{
+					subMesh++;
+					if (subMesh < mesh->m_subMeshCount)
+						lod->m_subMeshIndexOffset[subMesh] = t * 3;
+				}
+			}
+		}
+		else
+		{
+			lod->m_subMeshIndexOffset.push_back(triangleCount);
+		}
+		lod->setVertexCompression(mesh->vertexCompression());
+
+		MeshOptimizer::OptimizeVertexCache(lod);
+		MeshOptimizer::OptimizeVertexFetch(lod);
+		return lod;
+	}
+}
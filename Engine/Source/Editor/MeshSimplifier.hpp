@@ -0,0 +1,22 @@
+#pragma once
+
+#include <FishEngine.hpp>
+#include <ReflectClass.hpp>
+
+namespace FishEditor
+{
+	// Import-time mesh simplification by edge collapse, driven by quadric error metrics.
+	// Michael Garland, Paul S. Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997.
+	class Meta(NonSerializable) MeshSimplifier
+	{
+	public:
+		MeshSimplifier() = delete;
+
+		// Returns a new mesh with about targetRatio of the triangles of mesh.
+		// Every collapse moves a vertex onto one of its neighbours, so vertex attributes (uv, normal, bone weights)
+		// are never interpolated. Vertices on open borders, attribute seams and sub-mesh borders are locked.
+		// Simplification stops early when a collapse would move the surface further than
+		// maxError * (size of the mesh bounds).
+		static FishEngine::MeshPtr Simplify(FishEngine::MeshPtr const & mesh, float targetRatio, float maxError = 0.02f);
+	};
+}
@@ -693,6 +693,10 @@ namespace FishEditor
 		m_importNormals = rhs.m_importNormals;
 		m_importTangents = rhs.m_importTangents;
 		m_materialSearch = rhs.m_materialSearch;
+		m_optimizeMesh = rhs.m_optimizeMesh;
+		m_meshCompression = rhs.m_meshCompression;
+		m_generateLODs = rhs.m_generateLODs;
+		m_lodCount = rhs.m_lodCount;
 		return *this;
 	}
 	
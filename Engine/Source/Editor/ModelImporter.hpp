@@ -211,6 +211,22 @@ namespace FishEditor
 		// Existing material search setting.
 		ModelImporterMaterialSearch m_materialSearch;
 
+		// Vertices and indices are reordered for better GPU performance.
+		Meta(Optional)
+		bool m_optimizeMesh = true;
+
+		// Mesh compression setting.
+		Meta(Optional)
+		ModelImporterMeshCompression m_meshCompression = ModelImporterMeshCompression::Off;
+
+		// Generate simplified meshes and a LODGroup for every static mesh.
+		Meta(Optional)
+		bool m_generateLODs = false;
+
+		// Number of levels including the original mesh, each level has half the triangles of the previous one.
+		Meta(Optional)
+		int m_lodCount = 3;
+
 		// remove dummy nodes
 		Meta(NonSerializable)
 		std::map<std::string, std::map<std::string, FishEngine::Matrix4x4>> m_nodeTransformations;
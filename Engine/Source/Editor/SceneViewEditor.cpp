@@ -22,6 +22,7 @@
 #include <RenderTarget.hpp>
 #include <Command.hpp>
 #include <RenderBuffer.hpp>
+#include <GLStateCache.hpp>
 
 #include "Selection.hpp"
 #include "EditorResources.hpp"
@@ -134,9 +135,9 @@ namespace FishEditor
 		/************************************************************************/
 		/* Gizmos                                                               */
 		/************************************************************************/
-		glDepthFunc(GL_LEQUAL);
+		GLStateCache::DepthFunc(GL_LEQUAL);
 		Scene::OnDrawGizmos();
-		glDepthFunc(GL_LESS);
+		GLStateCache::DepthFunc(GL_LESS);
 
 		Gizmos::setColor(Color::red);
 		Bounds b = Scene::bounds();
@@ -171,9 +172,9 @@ namespace FishEditor
 			//auto view = camera->worldToCameraMatrix();
 			//auto proj = camera->projectionMatrix();
 			//auto vp = proj * view;
-			glEnable(GL_POLYGON_OFFSET_LINE);
+			GLStateCache::Enable(GL_POLYGON_OFFSET_LINE);
 			glPolygonOffset(-1.0, -1.0f);
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+			GLStateCache::PolygonMode(GL_LINE);
 			auto material = Material::builtinMaterial("SolidColor");
 			material->DisableKeyword(ShaderKeyword::All);
 			material->SetVector4("Color", Vector4(0.375f, 0.388f, 0.463f, 1));
@@ -222,8 +223,8 @@ namespace FishEditor
 					Graphics::DrawMesh(mesh, model, material);
 				}
 			}
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			glDisable(GL_POLYGON_OFFSET_LINE);
+			GLStateCache::PolygonMode(GL_FILL);
+			GLStateCache::Disable(GL_POLYGON_OFFSET_LINE);
 		}
 #else
 		auto selection = Selection::transforms();
@@ -301,17 +302,17 @@ namespace FishEditor
 #endif
 
 		if (m_isWireFrameMode)
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+			GLStateCache::PolygonMode(GL_LINE);
 		else
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			GLStateCache::PolygonMode(GL_FILL);
 
 		if (m_useGammaCorrection)
-			glEnable(GL_FRAMEBUFFER_SRGB);
+			GLStateCache::Enable(GL_FRAMEBUFFER_SRGB);
 		else
-			glDisable(GL_FRAMEBUFFER_SRGB);
+			GLStateCache::Disable(GL_FRAMEBUFFER_SRGB);
 
 		if (m_isWireFrameMode)
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			GLStateCache::PolygonMode(GL_FILL);
 
 		/************************************************************************/
 		/* Selection Gizmos                                                     */
@@ -351,6 +352,9 @@ namespace FishEditor
 		}
 #endif
 
+		// scene gizmos, depth tested against the scene
+		Gizmos::Flush();
+
 		glClear(GL_DEPTH_BUFFER_BIT);
 		DrawSceneGizmo();
 
@@ -384,6 +388,9 @@ namespace FishEditor
 			}
 		}
 
+		// transform tool gizmos
+		Gizmos::Flush();
+
 		Pipeline::PopRenderTarget();
 	}
 
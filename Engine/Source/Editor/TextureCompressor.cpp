@@ -0,0 +1,534 @@
+#include "TextureCompressor.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <JobSystem.hpp>
+
+using namespace FishEngine;
+using namespace FishEditor;
+
+namespace
+{
+	struct SRGBTables
+	{
+		static constexpr int LinearSteps = 4096;
+
+		float	toLinear[256];
+		uint8_t	fromLinear[LinearSteps];
+
+		SRGBTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				const float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < LinearSteps; ++i)
+			{
+				const float l = i / float(LinearSteps - 1);
+				const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+				fromLinear[i] = static_cast<uint8_t>(std::min(255.0f, c * 255.0f + 0.5f));
+			}
+		}
+
+		static SRGBTables const & instance()
+		{
+			static SRGBTables s_tables;
+			return s_tables;
+		}
+	};
+
+	inline float Saturate(float x)
+	{
+		return x < 0 ? 0 : (x > 1 ? 1 : x);
+	}
+
+	// Kaiser windowed sinc for 2:1 downsampling, 8 taps at source pixel offsets -3.5 ... 3.5
+	struct KaiserKernel
+	{
+		float weights[8];
+
+		static double BesselI0(double x)
+		{
+			double sum = 1, term = 1;
+			for (int k = 1; k < 32; ++k)
+			{
+				term *= (x / (2 * k)) * (x / (2 * k));
+				sum += term;
+			}
+			return sum;
+		}
+
+		KaiserKernel()
+		{
+			constexpr double alpha = 4.0;
+			constexpr double width = 2.0;	// in destination pixels
+			constexpr double pi = 3.14159265358979323846;
+			double sum = 0;
+			for (int k = 0; k < 8; ++k)
+			{
+				const double t = (k - 3.5) * 0.5;	// in destination pixels
+				const double sinc = std::sin(pi * t) / (pi * t);
+				const double r = t / width;
+				const double window = BesselI0(alpha * std::sqrt(std::max(0.0, 1 - r*r))) / BesselI0(alpha);
+				weights[k] = static_cast<float>(sinc * window);
+				sum += weights[k];
+			}
+			for (auto & w : weights)
+				w = static_cast<float>(w / sum);
+		}
+
+		static KaiserKernel const & instance()
+		{
+			static KaiserKernel s_kernel;
+			return s_kernel;
+		}
+	};
+
+	// Halve one dimension of a float image. horizontal: width, otherwise height.
+	void Downsample(std::vector<float> const & src, int width, int height, int channels, bool horizontal,
+		TextureImporterMipFilter filter, std::vector<float> & dst)
+	{
+		const int dstWidth = horizontal ? std::max(1, width / 2) : width;
+		const int dstHeight = horizontal ? height : std::max(1, height / 2);
+		const int srcLength = horizontal ? width : height;
+		dst.resize(static_cast<std::size_t>(dstWidth) * dstHeight * channels);
+
+		const std::size_t srcStep = horizontal ? channels : static_cast<std::size_t>(width) * channels;
+		auto const & kaiser = KaiserKernel::instance().weights;
+
+		JobSystem::ParallelFor(0, dstHeight, [&](std::size_t row)
+		{
+			const int y = static_cast<int>(row);
+			for (int x = 0; x < dstWidth; ++x)
+			{
+				// output pixel (x, y); along the filtered axis its index is o, the other axis is fixed
+				const int o = horizontal ? x : y;
+				const std::size_t base = horizontal
+					? static_cast<std::size_t>(y) * width * channels
+					: static_cast<std::size_t>(x) * channels;
+				float * out = &dst[(static_cast<std::size_t>(y) * dstWidth + x) * channels];
+
+				if (filter == TextureImporterMipFilter::KaiserFilter && srcLength >= 8)
+				{
+					for (int c = 0; c < channels; ++c)
+						out[c] = 0;
+					for (int k = 0; k < 8; ++k)
+					{
+						const int s = std::min(srcLength - 1, std::max(0, 2*o - 3 + k));
+						const float * p = &src[base + s * srcStep];
+						for (int c = 0; c < channels; ++c)
+							out[c] += kaiser[k] * p[c];
+					}
+				}
+				else
+				{
+					const float * p0 = &src[base + std::min(2*o, srcLength - 1) * srcStep];
+					const float * p1 = &src[base + std::min(2*o + 1, srcLength - 1) * srcStep];
+					for (int c = 0; c < channels; ++c)
+						out[c] = 0.5f * (p0[c] + p1[c]);
+				}
+			}
+		}, 0, "TextureCompressor.Downsample");
+	}
+
+	/************************************************************************/
+	/* BC1 (color)                                                          */
+	/************************************************************************/
+
+	inline uint16_t To565(float const color[3])
+	{
+		const int r = static_cast<int>(Saturate(color[0] / 255.0f) * 31 + 0.5f);
+		const int g = static_cast<int>(Saturate(color[1] / 255.0f) * 63 + 0.5f);
+		const int b = static_cast<int>(Saturate(color[2] / 255.0f) * 31 + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	inline void From565(uint16_t c, float color[3])
+	{
+		const int r = (c >> 11) & 31;
+		const int g = (c >> 5) & 63;
+		const int b = c & 31;
+		color[0] = static_cast<float>((r << 3) | (r >> 2));
+		color[1] = static_cast<float>((g << 2) | (g >> 4));
+		color[2] = static_cast<float>((b << 3) | (b >> 2));
+	}
+
+	struct BC1Result
+	{
+		uint16_t	c0 = 0;
+		uint16_t	c1 = 0;
+		uint32_t	indices = 0;
+		float		error = 0;
+	};
+
+	// weight of c0 for each index in 4-color mode
+	const float BC1Weights[4] = { 1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f };
+
+	BC1Result EncodeBC1Endpoints(float const pixels[16][3], float const e0[3], float const e1[3])
+	{
+		BC1Result result;
+		result.c0 = To565(e0);
+		result.c1 = To565(e1);
+		if (result.c0 < result.c1)
+			std::swap(result.c0, result.c1);
+
+		float palette[4][3];
+		From565(result.c0, palette[0]);
+		From565(result.c1, palette[1]);
+		const int paletteSize = (result.c0 == result.c1) ? 1 : 4;
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3.0f;
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int best = 0;
+			float bestError = 1e30f;
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				const float dr = pixels[i][0] - palette[p][0];
+				const float dg = pixels[i][1] - palette[p][1];
+				const float db = pixels[i][2] - palette[p][2];
+				const float e = dr*dr + dg*dg + db*db;
+				if (e < bestError)
+				{
+					bestError = e;
+					best = p;
+				}
+			}
+			result.indices |= static_cast<uint32_t>(best) << (2 * i);
+			result.error += bestError;
+		}
+		return result;
+	}
+
+	void EncodeBC1(uint8_t const rgba[16][4], uint8_t * out, int refinements)
+	{
+		float pixels[16][3];
+		float mean[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				pixels[i][c] = rgba[i][c];
+				mean[c] += pixels[i][c];
+			}
+		}
+		for (auto & m : mean)
+			m /= 16.0f;
+
+		// principal axis of the colors by power iteration on the covariance matrix
+		float cov[6] = { 0 };	// rr rg rb gg gb bb
+		for (int i = 0; i < 16; ++i)
+		{
+			const float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+			cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+			cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+		}
+		float axis[3] = { 1, 1, 1 };
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			const float x = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+			const float y = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+			const float z = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+			const float m = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+			if (m <= 1e-6f)
+				break;
+			axis[0] = x / m; axis[1] = y / m; axis[2] = z / m;
+		}
+
+		float tMin = 1e30f, tMax = -1e30f;
+		for (int i = 0; i < 16; ++i)
+		{
+			const float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+		const float axisLengthSq = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+		float e0[3], e1[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			e0[c] = mean[c] + axis[c] * tMax / axisLengthSq;
+			e1[c] = mean[c] + axis[c] * tMin / axisLengthSq;
+		}
+
+		BC1Result best = EncodeBC1Endpoints(pixels, e0, e1);
+
+		// least squares fit of the endpoints to the chosen indices
+		for (int iteration = 0; iteration < refinements && best.error > 0; ++iteration)
+		{
+			float aa = 0, ab = 0, bb = 0;
+			float ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+			for (int i = 0; i < 16; ++i)
+			{
+				const float a = BC1Weights[(best.indices >> (2 * i)) & 3];
+				const float b = 1.0f - a;
+				aa += a*a; ab += a*b; bb += b*b;
+				for (int c = 0; c < 3; ++c)
+				{
+					ax[c] += a * pixels[i][c];
+					bx[c] += b * pixels[i][c];
+				}
+			}
+			const float det = aa*bb - ab*ab;
+			if (std::abs(det) < 1e-6f)
+				break;
+			for (int c = 0; c < 3; ++c)
+			{
+				e0[c] = (bb*ax[c] - ab*bx[c]) / det;
+				e1[c] = (aa*bx[c] - ab*ax[c]) / det;
+			}
+			auto candidate = EncodeBC1Endpoints(pixels, e0, e1);
+			if (candidate.error >= best.error)
+				break;
+			best = candidate;
+		}
+
+		out[0] = static_cast<uint8_t>(best.c0 & 0xFF);
+		out[1] = static_cast<uint8_t>(best.c0 >> 8);
+		out[2] = static_cast<uint8_t>(best.c1 & 0xFF);
+		out[3] = static_cast<uint8_t>(best.c1 >> 8);
+		for (int i = 0; i < 4; ++i)
+			out[4 + i] = static_cast<uint8_t>(best.indices >> (8 * i));
+	}
+
+	/************************************************************************/
+	/* BC4 (single channel, also the alpha block of BC3)                    */
+	/************************************************************************/
+
+	struct BC4Result
+	{
+		uint8_t		r0 = 0;
+		uint8_t		r1 = 0;
+		uint64_t	indices = 0;
+		int			error = 0;
+	};
+
+	BC4Result EncodeBC4Endpoints(uint8_t const values[16], int r0, int r1)
+	{
+		BC4Result result;
+		result.r0 = static_cast<uint8_t>(r0);
+		result.r1 = static_cast<uint8_t>(r1);
+		int palette[8];
+		palette[0] = r0;
+		palette[1] = r1;
+		if (r0 > r1)
+		{
+			for (int i = 2; i < 8; ++i)
+				palette[i] = ((8 - i) * r0 + (i - 1) * r1 + 3) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+				palette[i] = ((6 - i) * r0 + (i - 1) * r1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			int best = 0;
+			int bestError = 1 << 30;
+			for (int p = 0; p < 8; ++p)
+			{
+				const int d = values[i] - palette[p];
+				if (d*d < bestError)
+				{
+					bestError = d*d;
+					best = p;
+				}
+			}
+			result.indices |= static_cast<uint64_t>(best) << (3 * i);
+			result.error += bestError;
+		}
+		return result;
+	}
+
+	void EncodeBC4(uint8_t const values[16], uint8_t * out, bool highQuality)
+	{
+		int lo = 255, hi = 0;
+		int innerLo = 255, innerHi = 0;	// ignoring 0 and 255, for the 6 values mode
+		for (int i = 0; i < 16; ++i)
+		{
+			lo = std::min<int>(lo, values[i]);
+			hi = std::max<int>(hi, values[i]);
+			if (values[i] != 0 && values[i] != 255)
+			{
+				innerLo = std::min<int>(innerLo, values[i]);
+				innerHi = std::max<int>(innerHi, values[i]);
+			}
+		}
+
+		BC4Result best;
+		if (lo == hi)
+		{
+			best = EncodeBC4Endpoints(values, lo, lo);
+		}
+		else
+		{
+			best = EncodeBC4Endpoints(values, hi, lo);
+			if (highQuality)
+			{
+				// shrink the range a little, the extremes are often outliers
+				for (int inset = 1; inset <= 4 && hi - lo > 2 * inset; ++inset)
+				{
+					auto candidate = EncodeBC4Endpoints(values, hi - inset, lo + inset);
+					if (candidate.error < best.error)
+						best = candidate;
+				}
+				if (innerLo <= innerHi)
+				{
+					auto candidate = EncodeBC4Endpoints(values, innerLo, innerHi);
+					if (candidate.error < best.error)
+						best = candidate;
+				}
+			}
+		}
+
+		out[0] = best.r0;
+		out[1] = best.r1;
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = static_cast<uint8_t>(best.indices >> (8 * i));
+	}
+}
+
+namespace FishEditor
+{
+	void TextureCompressor::GenerateMipmaps(std::vector<Image> & levels, bool sRGB, TextureImporterMipFilter filter)
+	{
+		if (levels.size() != 1)
+			abort();
+
+		auto const & tables = SRGBTables::instance();
+		const int channels = levels[0].channels;
+		const int colorChannels = sRGB ? std::min(channels, 3) : 0;
+
+		auto toFloat = [&](uint8_t v, int c)
+		{
+			return c < colorChannels ? tables.toLinear[v] : v / 255.0f;
+		};
+		auto fromFloat = [&](float v, int c)
+		{
+			v = Saturate(v);
+			if (c < colorChannels)
+				return tables.fromLinear[static_cast<int>(v * (SRGBTables::LinearSteps - 1) + 0.5f)];
+			return static_cast<uint8_t>(v * 255.0f + 0.5f);
+		};
+
+		// filter from the previous float level, so rounding errors do not accumulate
+		int width = levels[0].width;
+		int height = levels[0].height;
+		std::vector<float> current(levels[0].pixels.size());
+		for (std::size_t i = 0; i < current.size(); ++i)
+			current[i] = toFloat(levels[0].pixels[i], static_cast<int>(i % channels));
+
+		std::vector<float> halfWidth, next;
+		while (width > 1 || height > 1)
+		{
+			Downsample(current, width, height, channels, true, filter, halfWidth);
+			width = std::max(1, width / 2);
+			Downsample(halfWidth, width, height, channels, false, filter, next);
+			height = std::max(1, height / 2);
+			current.swap(next);
+
+			Image level;
+			level.width = width;
+			level.height = height;
+			level.channels = channels;
+			level.pixels.resize(current.size());
+			for (std::size_t i = 0; i < current.size(); ++i)
+				level.pixels[i] = fromFloat(current[i], static_cast<int>(i % channels));
+			levels.push_back(std::move(level));
+		}
+	}
+
+	void TextureCompressor::Compress(Image const & image, TextureFormat format, TextureImporterCompression quality, std::vector<uint8_t> & output)
+	{
+		if (!IsBlockCompressed(format))
+			abort();
+
+		const int blocksX = (image.width + 3) / 4;
+		const int blocksY = (image.height + 3) / 4;
+		const int blockBytes = ImageByteCount(format, 4, 4);
+		const std::size_t offset = output.size();
+		output.resize(offset + static_cast<std::size_t>(blocksX) * blocksY * blockBytes);
+
+		const int refinements = quality == TextureImporterCompression::CompressedLQ ? 0
+			: (quality == TextureImporterCompression::CompressedHQ ? 4 : 1);
+		const bool highQuality = quality == TextureImporterCompression::CompressedHQ;
+
+		JobSystem::ParallelFor(0, blocksY, [&](std::size_t row)
+		{
+			const int by = static_cast<int>(row);
+			for (int bx = 0; bx < blocksX; ++bx)
+			{
+				// gather the block as rgba, repeating the border for images smaller than 4x4
+				uint8_t rgba[16][4];
+				for (int i = 0; i < 16; ++i)
+				{
+					const int x = std::min(bx * 4 + (i & 3), image.width - 1);
+					const int y = std::min(by * 4 + (i >> 2), image.height - 1);
+					const uint8_t * p = &image.pixels[(static_cast<std::size_t>(y) * image.width + x) * image.channels];
+					if (image.channels == 1)
+					{
+						rgba[i][0] = rgba[i][1] = rgba[i][2] = p[0];
+						rgba[i][3] = 255;
+					}
+					else
+					{
+						for (int c = 0; c < 4; ++c)
+							rgba[i][c] = c < image.channels ? p[c] : (c == 3 ? 255 : 0);
+					}
+				}
+
+				uint8_t * out = &output[offset + (static_cast<std::size_t>(by) * blocksX + bx) * blockBytes];
+				uint8_t channel[16];
+				auto extract = [&rgba, &channel](int c)
+				{
+					for (int i = 0; i < 16; ++i)
+						channel[i] = rgba[i][c];
+				};
+
+				switch (format)
+				{
+				case TextureFormat::DXT1:
+					EncodeBC1(rgba, out, refinements);
+					break;
+				case TextureFormat::DXT5:
+					extract(3);
+					EncodeBC4(channel, out, highQuality);
+					EncodeBC1(rgba, out + 8, refinements);
+					break;
+				case TextureFormat::BC4:
+					extract(0);
+					EncodeBC4(channel, out, highQuality);
+					break;
+				case TextureFormat::BC5:
+					extract(0);
+					EncodeBC4(channel, out, highQuality);
+					extract(1);
+					EncodeBC4(channel, out + 8, highQuality);
+					break;
+				default:
+					abort();
+				}
+			}
+		}, 0, "TextureCompressor.Compress");
+	}
+
+	bool TextureCompressor::IsOpaque(Image const & image)
+	{
+		if (image.channels != 4)
+			return true;
+		for (std::size_t i = 3; i < image.pixels.size(); i += 4)
+		{
+			if (image.pixels[i] != 255)
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <FishEngine.hpp>
+#include <ReflectClass.hpp>
+#include <TextureProperty.hpp>
+
+#include "TextureImporterProperties.hpp"
+
+namespace FishEditor
+{
+	// Import-time texture processing: mip map generation and BC1/BC3/BC4/BC5 block compression on the CPU.
+	// No GL calls, safe to use on JobSystem workers; the work itself is split with JobSystem::ParallelFor.
+	class Meta(NonSerializable) TextureCompressor
+	{
+	public:
+		TextureCompressor() = delete;
+
+		// 8 bits per channel, channels interleaved, rows from bottom to top (as FreeImage and GL).
+		struct Image
+		{
+			int						width		= 0;
+			int						height		= 0;
+			int						channels	= 4;
+			std::vector<uint8_t>	pixels;
+		};
+
+		// Append mip levels to levels (which must contain level 0 only), down to 1x1.
+		// If sRGB, color channels are filtered in linear space; alpha is always linear.
+		static void GenerateMipmaps(std::vector<Image> & levels, bool sRGB, TextureImporterMipFilter filter);
+
+		// Append the blocks of image, compressed to format, to output.
+		// DXT1 uses rgb, DXT5 rgba, BC4 the first channel and BC5 the first two channels.
+		// CompressedLQ: bounding box endpoints; Compressed: principal axis endpoints refined once by least squares;
+		// CompressedHQ: more refinement iterations, and both BC4 modes are tried.
+		static void Compress(Image const & image, FishEngine::TextureFormat format, TextureImporterCompression quality, std::vector<uint8_t> & output);
+
+		// false if any alpha is below 255
+		static bool IsOpaque(Image const & image);
+	};
+}
@@ -3,12 +3,19 @@
 #include <FreeImage.h>
 
 #include <GLEnvironment.hpp>
+#include <GLStateCache.hpp>
 #include <Debug.hpp>
 #include <Common.hpp>
 #include <Mathf.hpp>
 #include <Texture2D.hpp>
+#include <Application.hpp>
+
+#include <fstream>
+#include <cstring>
+#include <boost/filesystem.hpp>
 
 #include "AssetDataBase.hpp"
+#include "TextureCompressor.hpp"
 
 #include <QImage>
 
@@ -115,6 +122,8 @@ namespace FishEditor
 		m_sRGBTexture = rhs.m_sRGBTexture;
 		m_isReadable = rhs.m_isReadable;
 		m_mipmapEnabled = rhs.m_mipmapEnabled;
+		m_textureCompression = rhs.m_textureCompression;
+		m_mipmapFilter = rhs.m_mipmapFilter;
 		return *this;
 	}
 	
@@ -133,7 +142,7 @@ namespace FishEditor
 		//assert(data!=nullptr);
 		GLuint t;
 		glGenTextures(1, &t);
-		glBindTexture(GL_TEXTURE_2D, t);
+		GLStateCache::BindTexture(GL_TEXTURE_2D, t);
 		
 		GLenum internal_format = GL_RGBA8;
 		GLenum format = GL_RGBA;
@@ -172,15 +181,19 @@ namespace FishEditor
 		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
 		free(data);
 		return t;
 	}
 #endif
 	
-	void TextureImporter::ImportTo(FishEngine::Texture2DPtr & texture)
+	// CPU only, no GL or Qt calls here: this runs on a worker thread during bulk import.
+	void TextureImporter::Decode(DecodedImage & image) const
 	{
-		auto fm_instance = FreeImagePlugin::instance();
+		if (LoadFromCache(image))
+			return;
+
+		FreeImagePlugin::instance();
 		FREE_IMAGE_FORMAT fif = FIF_UNKNOWN;
 		FIBITMAP *dib = nullptr;
 		uint8_t * bits = nullptr;
@@ -348,35 +361,253 @@ namespace FishEditor
 //			{
 //				abort();
 //			}
-		auto data = srcData;
-		texture->m_width = width;
-		texture->m_height = height;
-		texture->m_format = format;
-		texture->m_data.resize(length);
-		std::copy(data, data + length, texture->m_data.begin());
+		image.m_width = width;
+		image.m_height = height;
+		image.m_format = format;
+		image.m_data.assign(srcData, srcData + length);
 			
 		// get icon
 		//FreeImage_Rescale();
 		auto thumbnail = FreeImage_MakeThumbnail(dib, 64);
 		FreeImage_FlipVertical(thumbnail);	// flip for Qt
-		QImage::Format qformat;
-		if (format == TextureFormat::RGBA32)
-		{
-			qformat = QImage::Format_RGBA8888;
-		}
-		else if (format == TextureFormat::BGRA32)
+		if (format == TextureFormat::BGRA32)
 		{
 			// TODO
 			SwapRedBlue32(thumbnail);
-			//data = FreeImage_GetBits(dib);
+		}
+		auto data = FreeImage_GetBits(thumbnail);
+		image.m_thumbnailWidth = FreeImage_GetWidth(thumbnail);
+		image.m_thumbnailHeight = FreeImage_GetHeight(thumbnail);
+		image.m_thumbnailChannels = bpp / 8;
+		length = image.m_thumbnailWidth * image.m_thumbnailHeight * (bpp / 8);
+		image.m_thumbnail.assign(data, data + length);
+
+		// clean
+		FreeImage_Unload(thumbnail);
+		FreeImage_Unload(dib);
+
+		ProcessImage(image);
+		SaveToCache(image);
+	}
+
+	void TextureImporter::ProcessImage(DecodedImage & image) const
+	{
+		int channels = 0;
+		if (image.m_format == TextureFormat::R8)
+			channels = 1;
+		else if (image.m_format == TextureFormat::RGB24)
+			channels = 3;
+		else if (image.m_format == TextureFormat::RGBA32 || image.m_format == TextureFormat::BGRA32)
+			channels = 4;
+		else
+			return;		// float textures: level 0 only, mip maps are generated by the GPU
+
+		// RGB is expanded to RGBA, so small mip levels have no row alignment issues
+		TextureCompressor::Image base;
+		base.width = image.m_width;
+		base.height = image.m_height;
+		base.channels = (channels == 1) ? 1 : 4;
+		const std::size_t pixelCount = static_cast<std::size_t>(image.m_width) * image.m_height;
+		base.pixels.resize(pixelCount * base.channels);
+		const bool bgra = image.m_format == TextureFormat::BGRA32;
+		for (std::size_t i = 0; i < pixelCount; ++i)
+		{
+			const uint8_t * src = &image.m_data[i * channels];
+			uint8_t * dst = &base.pixels[i * base.channels];
+			if (channels == 1)
+			{
+				dst[0] = src[0];
+			}
+			else
+			{
+				dst[0] = src[bgra ? 2 : 0];
+				dst[1] = src[1];
+				dst[2] = src[bgra ? 0 : 2];
+				dst[3] = (channels == 4) ? src[3] : 255;
+			}
+		}
+		image.m_data.clear();
+		image.m_data.shrink_to_fit();
+
+		std::vector<TextureCompressor::Image> levels;
+		levels.push_back(std::move(base));
+		const bool isNormalMap = m_textureType == TextureImporterType::NormalMap;
+		if (m_mipmapEnabled)
+		{
+			const bool sRGB = m_sRGBTexture && !isNormalMap && m_textureType != TextureImporterType::SingleChannel;
+			TextureCompressor::GenerateMipmaps(levels, sRGB, m_mipmapFilter);
+		}
+
+		TextureFormat format;
+		if (m_textureCompression == TextureImporterCompression::Uncompressed)
+			format = (channels == 1) ? TextureFormat::R8 : TextureFormat::RGBA32;
+		else if (channels == 1)
+			format = TextureFormat::BC4;
+		else if (isNormalMap)
+			format = TextureFormat::BC5;	// xy only, z is reconstructed in the shader
+		else if (TextureCompressor::IsOpaque(levels[0]))
+			format = TextureFormat::DXT1;
+		else
+			format = TextureFormat::DXT5;
+
+		std::size_t uncompressedSize = 0;
+		for (auto const & level : levels)
+		{
+			uncompressedSize += level.pixels.size() / level.channels * 4;
+			if (IsBlockCompressed(format))
+				TextureCompressor::Compress(level, format, m_textureCompression, image.m_data);
+			else
+				image.m_data.insert(image.m_data.end(), level.pixels.begin(), level.pixels.end());
+		}
+		image.m_format = format;
+		image.m_mipmapCount = static_cast<int>(levels.size());
+
+		LogInfo(Format("Texture [%1%]: %2%x%3%, %4% mip levels, %5% KB (RGBA32 %6% KB)",
+			m_assetPath.filename().string(), image.m_width, image.m_height, image.m_mipmapCount,
+			image.m_data.size() / 1024, uncompressedSize / 1024));
+	}
+
+	/************************************************************************/
+	/* Texture cache                                                        */
+	/************************************************************************/
+
+	namespace
+	{
+		// bump when the output of ProcessImage changes
+		constexpr uint32_t TextureCacheVersion = 1;
+
+		struct TextureCacheHeader
+		{
+			char		magic[4];
+			uint32_t	version;
+			uint64_t	key;
+			int32_t		width;
+			int32_t		height;
+			int32_t		format;
+			int32_t		mipmapCount;
+			uint32_t	dataSize;
+			int32_t		thumbnailWidth;
+			int32_t		thumbnailHeight;
+			int32_t		thumbnailChannels;
+			uint32_t	thumbnailSize;
+		};
+
+		// FNV-1a
+		void HashCombine(uint64_t & hash, uint64_t value)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				hash ^= (value >> (8 * i)) & 0xFF;
+				hash *= 1099511628211ull;
+			}
+		}
+	}
+
+	Path TextureImporter::cachePath() const
+	{
+		return Application::dataPath().parent_path() / "Library" / "TextureCache" / (ToString(m_guid) + ".tex");
+	}
+
+	// the source file and every setting that changes the output of Decode
+	uint64_t TextureImporter::CacheKey() const
+	{
+		uint64_t hash = 14695981039346656037ull;
+		boost::system::error_code ec;
+		HashCombine(hash, boost::filesystem::file_size(m_assetPath, ec));
+		HashCombine(hash, static_cast<uint64_t>(boost::filesystem::last_write_time(m_assetPath, ec)));
+		HashCombine(hash, static_cast<uint64_t>(m_textureType));
+		HashCombine(hash, m_sRGBTexture);
+		HashCombine(hash, m_mipmapEnabled);
+		HashCombine(hash, static_cast<uint64_t>(m_textureCompression));
+		HashCombine(hash, static_cast<uint64_t>(m_mipmapFilter));
+		return hash;
+	}
+
+	bool TextureImporter::LoadFromCache(DecodedImage & image) const
+	{
+		std::ifstream file(cachePath().string(), std::ios::binary);
+		if (!file)
+			return false;
+		TextureCacheHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| std::memcmp(header.magic, "FTEX", 4) != 0
+			|| header.version != TextureCacheVersion
+			|| header.key != CacheKey())
+		{
+			return false;
+		}
+		image.m_width = header.width;
+		image.m_height = header.height;
+		image.m_format = static_cast<TextureFormat>(header.format);
+		image.m_mipmapCount = header.mipmapCount;
+		image.m_data.resize(header.dataSize);
+		image.m_thumbnailWidth = header.thumbnailWidth;
+		image.m_thumbnailHeight = header.thumbnailHeight;
+		image.m_thumbnailChannels = header.thumbnailChannels;
+		image.m_thumbnail.resize(header.thumbnailSize);
+		file.read(reinterpret_cast<char*>(image.m_data.data()), header.dataSize);
+		file.read(reinterpret_cast<char*>(image.m_thumbnail.data()), header.thumbnailSize);
+		return static_cast<bool>(file);
+	}
+
+	void TextureImporter::SaveToCache(DecodedImage const & image) const
+	{
+		auto path = cachePath();
+		boost::system::error_code ec;
+		boost::filesystem::create_directories(path.parent_path(), ec);
+
+		TextureCacheHeader header;
+		std::memcpy(header.magic, "FTEX", 4);
+		header.version = TextureCacheVersion;
+		header.key = CacheKey();
+		header.width = image.m_width;
+		header.height = image.m_height;
+		header.format = static_cast<int32_t>(image.m_format);
+		header.mipmapCount = image.m_mipmapCount;
+		header.dataSize = static_cast<uint32_t>(image.m_data.size());
+		header.thumbnailWidth = image.m_thumbnailWidth;
+		header.thumbnailHeight = image.m_thumbnailHeight;
+		header.thumbnailChannels = image.m_thumbnailChannels;
+		header.thumbnailSize = static_cast<uint32_t>(image.m_thumbnail.size());
+
+		// write to a temporary file first, a partially written cache is never read
+		auto temp = path;
+		temp += ".tmp";
+		{
+			std::ofstream file(temp.string(), std::ios::binary | std::ios::trunc);
+			if (!file)
+			{
+				LogWarning("Can not write texture cache: " + temp.string());
+				return;
+			}
+			file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+			file.write(reinterpret_cast<char const*>(image.m_data.data()), image.m_data.size());
+			file.write(reinterpret_cast<char const*>(image.m_thumbnail.data()), image.m_thumbnail.size());
+		}
+		boost::filesystem::rename(temp, path, ec);
+	}
+
+	// main thread only
+	void TextureImporter::ApplyDecodedImage(FishEngine::Texture2DPtr & texture, DecodedImage & image)
+	{
+		auto format = image.m_format;
+		texture->m_width = image.m_width;
+		texture->m_height = image.m_height;
+		texture->m_format = format;
+		texture->m_mipmapCount = image.m_mipmapCount;
+		texture->m_data = std::move(image.m_data);
+
+		QImage::Format qformat;
+		if (image.m_thumbnailChannels == 4)
+		{
 			qformat = QImage::Format_RGBA8888;
 		}
-		else if (format == TextureFormat::RGB24)
+		else if (image.m_thumbnailChannels == 3)
 		{
 			qformat = QImage::Format_RGB888;
 				
 		}
-		else if (format == TextureFormat::R8)
+		else if (image.m_thumbnailChannels == 1)
 		{
 			qformat = QImage::Format_Grayscale8;
 		}
@@ -384,18 +615,18 @@ namespace FishEditor
 		{
 			abort();
 		}
-		data = FreeImage_GetBits(thumbnail);
-		width = FreeImage_GetWidth(thumbnail);
-		height = FreeImage_GetHeight(thumbnail);
-		length = width * height * (bpp / 8);
-		auto qimage = QImage(width, height, qformat);
-		std::copy(data, data + length, qimage.bits());
+		auto qimage = QImage(image.m_thumbnailWidth, image.m_thumbnailHeight, qformat);
+		std::copy(image.m_thumbnail.begin(), image.m_thumbnail.end(), qimage.bits());
 		auto qpixmap = QPixmap::fromImage(std::move(qimage));
 		AssetDatabase::s_cacheIcons[m_assetPath] = QIcon(qpixmap);
+		image.m_thumbnail.clear();
+	}
 
-		// clean
-		FreeImage_Unload(thumbnail);
-		FreeImage_Unload(dib);
+	void TextureImporter::ImportTo(FishEngine::Texture2DPtr & texture)
+	{
+		DecodedImage image;
+		Decode(image);
+		ApplyDecodedImage(texture, image);
 	}
 
 	FishEngine::TexturePtr TextureImporter::Import(Path const & path)
@@ -406,6 +637,15 @@ namespace FishEditor
 		m_asset->Add(texture);
 		return texture;
 	}
+
+	FishEngine::TexturePtr TextureImporter::Import(Path const & path, DecodedImage & image)
+	{
+		m_assetPath = path;
+		auto texture = std::make_shared<Texture2D>();
+		this->ApplyDecodedImage(texture, image);
+		m_asset->Add(texture);
+		return texture;
+	}
 	
 	void TextureImporter::Reimport()
 	{
@@ -30,8 +30,32 @@ namespace FishEditor
 		
 		TextureImporter& operator=(TextureImporter const & rhs);
 
+		// Pixels and thumbnail of an image file, decoded on the CPU and not yet attached to a texture.
+		// m_data holds m_mipmapCount levels (see Texture2D::m_data), possibly block compressed.
+		struct DecodedImage
+		{
+			int							m_width = 0;
+			int							m_height = 0;
+			FishEngine::TextureFormat	m_format = FishEngine::TextureFormat::RGBA32;
+			int							m_mipmapCount = 0;
+			std::vector<std::uint8_t>	m_data;
+			int							m_thumbnailWidth = 0;
+			int							m_thumbnailHeight = 0;
+			int							m_thumbnailChannels = 4;
+			std::vector<std::uint8_t>	m_thumbnail;
+		};
+
 		FishEngine::TexturePtr Import(FishEngine::Path const & path);
 
+		// Finish an import whose image was decoded by Decode() (possibly on a worker thread).
+		// Main thread only.
+		FishEngine::TexturePtr Import(FishEngine::Path const & path, DecodedImage & image);
+
+		// Load and convert the image at assetPath(), then build mip maps and compress it as set by the import settings.
+		// The result is kept in the texture cache and reused while the source file and the settings are unchanged.
+		// Thread safe, does not touch GL, Qt or the asset database.
+		void Decode(DecodedImage & image) const;
+
 		//FishEngine::TexturePtr FromFile(const FishEngine::Path& path);
 
 		//FishEngine::TexturePtr FromRawData(const uint8_t* data, int width, int height, FishEngine::TextureFormat format);
@@ -112,9 +136,42 @@ namespace FishEditor
 		{
 			m_mipmapEnabled = mipmapEnabled;
 		}
+
+		// Compression of imported texture.
+		Meta(Optional)
+		TextureImporterCompression textureCompression() const
+		{
+			return m_textureCompression;
+		}
+
+		void setTextureCompression(const TextureImporterCompression textureCompression)
+		{
+			m_textureCompression = textureCompression;
+		}
+
+		// Mipmap filtering mode.
+		Meta(Optional)
+		TextureImporterMipFilter mipmapFilter() const
+		{
+			return m_mipmapFilter;
+		}
+
+		void setMipmapFilter(const TextureImporterMipFilter mipmapFilter)
+		{
+			m_mipmapFilter = mipmapFilter;
+		}
 		
 	protected:
 		void ImportTo(FishEngine::Texture2DPtr & texture);
+		void ApplyDecodedImage(FishEngine::Texture2DPtr & texture, DecodedImage & image);
+
+		// mip maps and block compression of a freshly decoded image
+		void ProcessImage(DecodedImage & image) const;
+
+		FishEngine::Path cachePath() const;
+		uint64_t CacheKey() const;
+		bool LoadFromCache(DecodedImage & image) const;
+		void SaveToCache(DecodedImage const & image) const;
 		
 		virtual void Reimport() override;
 		
@@ -171,6 +228,12 @@ namespace FishEditor
 		
 		// Select this to enable mip-map generation. Mip maps are smaller versions of the Texture that get used when the Texture is very small on screen.
 		bool m_mipmapEnabled = true;
+
+		// Compression of imported texture.
+		TextureImporterCompression m_textureCompression = TextureImporterCompression::Compressed;
+
+		// Mipmap filtering mode.
+		TextureImporterMipFilter m_mipmapFilter = TextureImporterMipFilter::BoxFilter;
 		
 		// Scaling mode for non power of two textures in TextureImporter.
 		TextureImporterNPOTScale m_npotScale = TextureImporterNPOTScale::ToNearest;
@@ -0,0 +1,303 @@
+#include "HierarchyModel.hpp"
+
+#include <QColor>
+#include <algorithm>
+
+#include <Transform.hpp>
+#include <GameObject.hpp>
+#include <Scene.hpp>
+
+using namespace FishEngine;
+
+namespace
+{
+	// row of child in the live children of parent
+	int ChildRow(TransformPtr const & parent, TransformPtr const & child)
+	{
+		int row = 0;
+		for (auto const & c : parent->children())
+		{
+			if (c == child)
+				return row;
+			row++;
+		}
+		return row;
+	}
+}
+
+HierarchyModel::HierarchyModel(QObject *parent)
+	: QAbstractItemModel(parent)
+{
+	m_root.fetched = true;
+}
+
+HierarchyModel::~HierarchyModel() = default;
+
+void HierarchyModel::Reset()
+{
+	beginResetModel();
+	m_root.children.clear();
+	m_nodes.clear();
+	for (auto const & go : Scene::GameObjects())
+	{
+		auto transform = go->transform();
+		if (transform->parent() != nullptr)
+			continue;
+		auto node = std::make_unique<Node>();
+		node->transform = transform;
+		node->instanceID = go->GetInstanceID();
+		node->parent = &m_root;
+		node->row = static_cast<int>(m_root.children.size());
+		m_nodes[node->instanceID] = node.get();
+		m_root.children.push_back(std::move(node));
+	}
+	endResetModel();
+}
+
+void HierarchyModel::ApplyChanges(std::vector<SceneChange> const & changes)
+{
+	for (auto const & change : changes)
+	{
+		auto it = m_nodes.find(change.instanceID);
+		Node* node = (it == m_nodes.end()) ? nullptr : it->second;
+
+		auto go = change.gameObject.lock();
+		TransformPtr transform = (go == nullptr) ? nullptr : go->transform();
+		if ((change.flags & SceneChange::Destroyed) || transform == nullptr)
+		{
+			if (node != nullptr)
+				RemoveNode(node);
+			continue;
+		}
+
+		if (change.flags & (SceneChange::Created | SceneChange::Reparented))
+		{
+			auto parentTransform = transform->parent();
+			Node* parentNode = (parentTransform == nullptr) ? &m_root : FindNode(parentTransform);
+			if (node != nullptr && node->parent != parentNode)
+			{
+				RemoveNode(node);
+				node = nullptr;
+			}
+			if (node == nullptr && parentNode != nullptr)
+			{
+				if (parentNode->fetched)
+				{
+					int row = static_cast<int>(parentNode->children.size());
+					if (parentNode != &m_root)
+						row = std::min(ChildRow(parentTransform, transform), row);
+					node = InsertNode(parentNode, row, transform);
+				}
+				else
+				{
+					// the expand arrow of the parent
+					EmitDataChanged(parentNode, false);
+				}
+			}
+		}
+
+		if (node != nullptr && (change.flags & (SceneChange::Renamed | SceneChange::Activated)))
+		{
+			// activeInHierarchy of the children changes too
+			EmitDataChanged(node, (change.flags & SceneChange::Activated) != 0);
+		}
+	}
+}
+
+std::shared_ptr<Transform> HierarchyModel::transform(const QModelIndex & index) const
+{
+	auto node = NodeOf(index);
+	if (node == &m_root)
+		return nullptr;
+	return node->transform.lock();
+}
+
+QModelIndex HierarchyModel::IndexOf(TransformPtr const & transform)
+{
+	if (transform == nullptr)
+		return QModelIndex();
+	std::vector<TransformPtr> path;
+	for (auto t = transform; t != nullptr; t = t->parent())
+	{
+		path.push_back(t);
+	}
+
+	Node* node = &m_root;
+	for (auto it = path.rbegin(); it != path.rend(); ++it)
+	{
+		Fetch(node);
+		auto child = FindNode(*it);
+		if (child == nullptr || child->parent != node)
+			return QModelIndex();
+		node = child;
+	}
+	return IndexOf(node);
+}
+
+QModelIndex HierarchyModel::index(int row, int column, const QModelIndex & parent) const
+{
+	auto node = NodeOf(parent);
+	if (column != 0 || row < 0 || row >= static_cast<int>(node->children.size()))
+		return QModelIndex();
+	return createIndex(row, 0, node->children[row].get());
+}
+
+QModelIndex HierarchyModel::parent(const QModelIndex & index) const
+{
+	auto node = NodeOf(index);
+	if (node == &m_root)
+		return QModelIndex();
+	return IndexOf(node->parent);
+}
+
+int HierarchyModel::rowCount(const QModelIndex & parent) const
+{
+	if (parent.column() > 0)
+		return 0;
+	return static_cast<int>(NodeOf(parent)->children.size());
+}
+
+int HierarchyModel::columnCount(const QModelIndex &) const
+{
+	return 1;
+}
+
+bool HierarchyModel::hasChildren(const QModelIndex & parent) const
+{
+	auto node = NodeOf(parent);
+	if (node->fetched)
+		return !node->children.empty();
+	auto t = node->transform.lock();
+	return t != nullptr && t->childCount() > 0;
+}
+
+bool HierarchyModel::canFetchMore(const QModelIndex & parent) const
+{
+	auto node = NodeOf(parent);
+	return !node->fetched && hasChildren(parent);
+}
+
+void HierarchyModel::fetchMore(const QModelIndex & parent)
+{
+	Fetch(NodeOf(parent));
+}
+
+QVariant HierarchyModel::data(const QModelIndex & index, int role) const
+{
+	auto t = transform(index);
+	if (t == nullptr)
+		return QVariant();
+	auto go = t->gameObject();
+	if (role == Qt::DisplayRole || role == Qt::EditRole)
+		return QString::fromStdString(go->name());
+	if (role == Qt::ForegroundRole && !go->activeInHierarchy())
+		return QColor(Qt::gray);
+	return QVariant();
+}
+
+Qt::ItemFlags HierarchyModel::flags(const QModelIndex & index) const
+{
+	if (!index.isValid())
+		return Qt::ItemIsDropEnabled;
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled;
+}
+
+HierarchyModel::Node* HierarchyModel::NodeOf(const QModelIndex & index) const
+{
+	if (!index.isValid())
+		return const_cast<Node*>(&m_root);
+	return static_cast<Node*>(index.internalPointer());
+}
+
+QModelIndex HierarchyModel::IndexOf(Node* node) const
+{
+	if (node == &m_root)
+		return QModelIndex();
+	return createIndex(node->row, 0, node);
+}
+
+HierarchyModel::Node* HierarchyModel::FindNode(TransformPtr const & transform) const
+{
+	auto go = transform->gameObject();
+	if (go == nullptr)
+		return nullptr;
+	auto it = m_nodes.find(go->GetInstanceID());
+	return (it == m_nodes.end()) ? nullptr : it->second;
+}
+
+void HierarchyModel::Fetch(Node* node)
+{
+	if (node->fetched)
+		return;
+	node->fetched = true;
+	auto t = node->transform.lock();
+	if (t == nullptr || t->childCount() == 0)
+		return;
+
+	beginInsertRows(IndexOf(node), 0, static_cast<int>(t->childCount()) - 1);
+	for (auto const & child : t->children())
+	{
+		auto c = std::make_unique<Node>();
+		c->transform = child;
+		c->instanceID = child->gameObject()->GetInstanceID();
+		c->parent = node;
+		c->row = static_cast<int>(node->children.size());
+		m_nodes[c->instanceID] = c.get();
+		node->children.push_back(std::move(c));
+	}
+	endInsertRows();
+}
+
+HierarchyModel::Node* HierarchyModel::InsertNode(Node* parent, int row, TransformPtr const & transform)
+{
+	beginInsertRows(IndexOf(parent), row, row);
+	auto node = std::make_unique<Node>();
+	node->transform = transform;
+	node->instanceID = transform->gameObject()->GetInstanceID();
+	node->parent = parent;
+	auto result = node.get();
+	m_nodes[node->instanceID] = result;
+	parent->children.insert(parent->children.begin() + row, std::move(node));
+	for (int i = row; i < static_cast<int>(parent->children.size()); ++i)
+	{
+		parent->children[i]->row = i;
+	}
+	endInsertRows();
+	return result;
+}
+
+void HierarchyModel::RemoveNode(Node* node)
+{
+	auto parent = node->parent;
+	const int row = node->row;
+	beginRemoveRows(IndexOf(parent), row, row);
+	Unregister(node);
+	parent->children.erase(parent->children.begin() + row);
+	for (int i = row; i < static_cast<int>(parent->children.size()); ++i)
+	{
+		parent->children[i]->row = i;
+	}
+	endRemoveRows();
+}
+
+void HierarchyModel::Unregister(Node* node)
+{
+	m_nodes.erase(node->instanceID);
+	for (auto const & child : node->children)
+	{
+		Unregister(child.get());
+	}
+}
+
+void HierarchyModel::EmitDataChanged(Node* node, bool recursive)
+{
+	auto index = IndexOf(node);
+	emit dataChanged(index, index);
+	if (recursive)
+	{
+		for (auto const & child : node->children)
+		{
+			EmitDataChanged(child.get(), true);
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace FishEngine
+{
+	class Transform;
+	struct SceneChange;
+}
+
+// The scene hierarchy, one row per game object. The rows of the children of a transform are created the first time
+// the view asks for them (fetchMore, i.e. when it is expanded), and ApplyChanges updates only the rows of the game
+// objects in the changes, instead of rebuilding the whole tree.
+class HierarchyModel : public QAbstractItemModel
+{
+public:
+	explicit HierarchyModel(QObject *parent = nullptr);
+	~HierarchyModel();
+
+	// rebuild the root rows from Scene::GameObjects()
+	void Reset();
+
+	// changes from Scene::AddChangeListener
+	void ApplyChanges(std::vector<FishEngine::SceneChange> const & changes);
+
+	std::shared_ptr<FishEngine::Transform> transform(const QModelIndex & index) const;
+
+	// Fetch the rows of the ancestors of transform if needed. Invalid if transform is not in the hierarchy.
+	QModelIndex IndexOf(std::shared_ptr<FishEngine::Transform> const & transform);
+
+	virtual QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
+	virtual QModelIndex parent(const QModelIndex & index) const Q_DECL_OVERRIDE;
+	virtual int rowCount(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
+	virtual int columnCount(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
+	virtual bool hasChildren(const QModelIndex & parent = QModelIndex()) const Q_DECL_OVERRIDE;
+	virtual bool canFetchMore(const QModelIndex & parent) const Q_DECL_OVERRIDE;
+	virtual void fetchMore(const QModelIndex & parent) Q_DECL_OVERRIDE;
+	virtual QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+	virtual Qt::ItemFlags flags(const QModelIndex & index) const Q_DECL_OVERRIDE;
+
+private:
+	struct Node
+	{
+		std::weak_ptr<FishEngine::Transform>	transform;
+		int										instanceID = 0;	// of the game object
+		Node*									parent = nullptr;
+		int										row = 0;
+		bool									fetched = false;	// children created
+		std::vector<std::unique_ptr<Node>>		children;
+	};
+
+	Node m_root;	// invisible, the children are the root game objects
+
+	// game object instance id -> node, for the rows created so far
+	std::unordered_map<int, Node*> m_nodes;
+
+	Node* NodeOf(const QModelIndex & index) const;
+	QModelIndex IndexOf(Node* node) const;
+	Node* FindNode(std::shared_ptr<FishEngine::Transform> const & transform) const;
+
+	void Fetch(Node* node);
+	Node* InsertNode(Node* parent, int row, std::shared_ptr<FishEngine::Transform> const & transform);
+	void RemoveNode(Node* node);
+	void Unregister(Node* node);
+	void EmitDataChanged(Node* node, bool recursive);
+};
@@ -1,6 +1,6 @@
 #include "HierarchyTreeView.hpp"
+#include "HierarchyModel.hpp"
 
-#include <QStandardItemModel>
 #include <QTimer>
 #include <QMenu>
 
@@ -15,7 +15,6 @@
 #include "UIDebug.hpp"
 
 #include <QDropEvent>
-#include <QStandardItemModel>
 
 #include "Selection.hpp"
 
@@ -24,8 +23,6 @@
 using namespace FishEngine;
 using namespace FishEditor;
 
-Q_DECLARE_METATYPE(std::weak_ptr<FishEngine::Transform>)
-
 void CreateEmpty()
 {
 	auto const & selections = Selection::transforms();
@@ -76,7 +73,15 @@ void CreatePrimitive(PrimitiveType type)
 HierarchyTreeView::HierarchyTreeView(QWidget *parent)
 	: QTreeView(parent)
 {
-	m_hierarchyModel = new QStandardItemModel();
+	m_hierarchyModel = new HierarchyModel(this);
+	m_hierarchyModel->Reset();
+	m_sceneListenerID = Scene::AddChangeListener([this](std::vector<SceneChange> const & changes) {
+		m_pendingChanges.insert(m_pendingChanges.end(), changes.begin(), changes.end());
+	});
+	m_selectionListenerID = Selection::selectionChanged += [this]() {
+		if (!m_blockSignal)
+			m_selectionDirty = true;
+	};
 
 	QAction * action;
 	m_menu = new QMenu(this);
@@ -182,6 +187,12 @@ HierarchyTreeView::HierarchyTreeView(QWidget *parent)
 	timer->start(1000 / 10.0f); // 10 fps
 }
 
+HierarchyTreeView::~HierarchyTreeView()
+{
+	Scene::RemoveChangeListener(m_sceneListenerID);
+	Selection::selectionChanged -= m_selectionListenerID;
+}
+
 QSize HierarchyTreeView::sizeHint() const
 {
 	return QSize(200, 400);
@@ -213,8 +224,7 @@ void HierarchyTreeView::dropEvent(QDropEvent *event)
 		return;
 	}
 
-	auto to_item = m_hierarchyModel->itemFromIndex(index);
-	auto new_parent = to_item->data().value<std::weak_ptr<FishEngine::Transform>>().lock();
+	auto new_parent = m_hierarchyModel->transform(index);
 
 	for (auto const & t : Selection::transforms())
 	{
@@ -240,145 +250,66 @@ void HierarchyTreeView::OnHierarchyViewSelectionChanged(QItemSelection const & ,
 	//auto const & selections = current.indexes();
 	if (selections.empty())
 	{
+		m_blockSignal = true;
 		FishEditor::Selection::setTransforms({});
+		m_blockSignal = false;
 	}
 	else
 	{
 		std::list<std::weak_ptr<FishEngine::Transform>> selected_transform;
 		for (auto const & index : selections)
 		{
-			auto item = m_hierarchyModel->itemFromIndex(index);
-			auto transform_ptr = item->data().value<std::weak_ptr<FishEngine::Transform>>();
-			selected_transform.push_back(transform_ptr);
+			selected_transform.push_back(m_hierarchyModel->transform(index));
 		}
+		// not an outside change, the view already shows it
+		m_blockSignal = true;
 		Selection::setTransforms(selected_transform);
+		m_blockSignal = false;
 		//Debug::LogError("OnHierarchyViewSelectionChanged[end] %d", Selection::transforms().size());
 	}
 }
 
 
-QStandardItem* CreateHierarchyItem(TransformPtr const & transform)
-{
-	QStandardItem* item = new QStandardItem(QString(transform->gameObject()->name().c_str()));
-	QVariant v;
-	std::weak_ptr<FishEngine::Transform> pt = transform;
-	v.setValue(pt);
-	item->setData(v);
-	for (auto const & child : transform->children())
-	{
-		if (child != nullptr)
-		{
-			item->appendRow(CreateHierarchyItem(child));
-		}
-		else
-		{
-			abort();
-		}
-	}
-	return item;
-}
-
-QStandardItem* HierarchyTreeView::UpdateHierarchyItem(QStandardItem * item, TransformPtr const & transform)
+void HierarchyTreeView::UpdateHierarchyModel()
 {
-	if (item == nullptr)    // new
-	{
-		return CreateHierarchyItem(transform);
-	}
+	if (m_inDragDropMode)
+		return;
 
-	auto transform_in_data = item->data().value<std::weak_ptr<FishEngine::Transform>>();
-	if (transform_in_data.lock() != transform)
-	{
-		item->setText(QString(transform->gameObject()->name().c_str()));
-		QVariant v;
-		std::weak_ptr<FishEngine::Transform> pt = transform;
-		v.setValue(pt);
-		item->setData(v);
-	}
-	else
+	if (!m_pendingChanges.empty())
 	{
-		auto display_name = item->text();
-		QString name = transform->gameObject()->name().c_str();
-		if (display_name != name)
-		{
-			item->setText(name);
-		}
+		std::vector<SceneChange> changes;
+		changes.swap(m_pendingChanges);
+		m_hierarchyModel->ApplyChanges(changes);
 	}
 
-	int row = 0;
-	for (auto const & child_transform : transform->children())
+	if (m_selectionDirty)
 	{
-		if (child_transform != nullptr)
-		{
-			auto child_item = item->child(row);
-			if (child_item == nullptr)
-			{
-				auto new_item = UpdateHierarchyItem(nullptr, child_transform);
-				item->setChild(row, 0, new_item);
-			}
-			else
-			{
-				UpdateHierarchyItem(child_item, child_transform);
-			}
-		}
-		else
-		{
-			abort();
-		}
-		row ++;
+		m_selectionDirty = false;
+		SyncSelection();
 	}
-	int redundantRows = item->rowCount() - row;
-	if (redundantRows > 0)
-	{
-		item->removeRows(row, redundantRows);
-	}
-	if (Selection::Contains(transform))
-	{
-		selectionModel()->select(item->index(), QItemSelectionModel::Select);
-	}
-	return item;
 }
 
-void HierarchyTreeView::UpdateHierarchyModel()
+// select the rows of Selection::transforms(), expanding their parents
+void HierarchyTreeView::SyncSelection()
 {
-	if (m_inDragDropMode)
-		return;
-	//LOG;
-	//Debug::LogError("Here %d", Selection::transforms().size());
-	//auto count = m_hierarchyModel->rowCount();
-	//ui->hierarchyTreeView->selectionModel()->blockSignals(true);
 	m_blockSignal = true;
-	selectionModel()->clearSelection();
-
-	int row = 0;
-	for (auto go : Scene::GameObjects())
+	QItemSelection selection;
+	QModelIndex current;
+	for (auto const & t : Selection::transforms())
 	{
-		auto transform = go->transform();
-		if (transform->parent() != nullptr)
-		{
+		auto index = m_hierarchyModel->IndexOf(t.lock());
+		if (!index.isValid())
 			continue;
-		}
-		auto item = m_hierarchyModel->item(row);
-		if (item == nullptr)
+		for (auto p = index.parent(); p.isValid(); p = p.parent())
 		{
-			//m_hierarchyModel->appendRow(UpdateHierarchyItem(nullptr, transform));
-			auto new_item = UpdateHierarchyItem(nullptr, transform);
-			m_hierarchyModel->setItem(row, new_item);
+			expand(p);
 		}
-		else
-		{
-			UpdateHierarchyItem(item, transform);
-		}
-		row++;
-		//ui->hierarchyTreeView->selectionModel()->sele
-	}
-
-	int redundantRows = m_hierarchyModel->rowCount() - row;
-	if (redundantRows > 0)
-	{
-		m_hierarchyModel->removeRows(row, redundantRows);
+		selection.select(index, index);
+		current = index;
 	}
-	//ui->hierarchyTreeView->update();
-	//ui->hierarchyTreeView->selectionModel()->blockSignals(false);
+	selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+	if (current.isValid())
+		scrollTo(current);
 	m_blockSignal = false;
 }
 
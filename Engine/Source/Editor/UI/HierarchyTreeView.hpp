@@ -3,21 +3,24 @@
 
 #include <QTreeView>
 #include <memory>
+#include <vector>
+
+#include <Scene.hpp>
 
 namespace FishEngine
 {
 	class Transform;
 }
 
-class QStandardItemModel;
-class QStandardItem;
 class QItemSelection;
+class HierarchyModel;
 
 class HierarchyTreeView : public QTreeView
 {
 	Q_OBJECT
 public:
 	explicit HierarchyTreeView(QWidget *parent = 0);
+	~HierarchyTreeView();
 
 	virtual QSize sizeHint() const override;
 	
@@ -36,6 +39,12 @@ private:
 	bool m_blockSignal = false;
 	bool m_inDragDropMode = false;
 
+	// Selection changed outside of this view since the last UpdateHierarchyModel
+	bool m_selectionDirty = true;
+
+	int m_sceneListenerID = 0;
+	int m_selectionListenerID = 0;
+
 	QMenu * m_menu;
 	
 	//QAction * m_createEmptyAction;
@@ -44,11 +53,14 @@ private:
 	//QAction * m_createCameraAction;
 
 	//QStandardItem* UpdateHierarchyItem(std::shared_ptr<FishEngine::Transform> const & transform);
-	QStandardItemModel * m_hierarchyModel;
+	HierarchyModel * m_hierarchyModel;
+
+	// scene changes not applied to m_hierarchyModel yet (held back while dragging)
+	std::vector<FishEngine::SceneChange> m_pendingChanges;
 
 	//void CreatePrimitive(PrimitiveType type);
 
-	QStandardItem* UpdateHierarchyItem(QStandardItem * item, std::shared_ptr<FishEngine::Transform> const & transform);
+	void SyncSelection();
 
 	virtual void dragEnterEvent(QDragEnterEvent *event) override;
 	virtual void dropEvent(QDropEvent *event) override;
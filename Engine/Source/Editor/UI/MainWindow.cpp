@@ -29,6 +29,7 @@
 #include <Timer.hpp>
 #include <Path.hpp>
 #include <Shader.hpp>
+#include <JobSystem.hpp>
 
 #include "SceneArchive.hpp"
 #include "AssetArchive.hpp"
@@ -182,6 +183,7 @@ MainWindow::MainWindow(QWidget *parent) :
 MainWindow::~MainWindow()
 {
 	delete ui;
+	JobSystem::Clean();
 }
 
 
@@ -204,6 +206,8 @@ void MainWindow::Init()
 	
 	Shader::Init(shaderRoot.string());
 
+	JobSystem::Init();
+
 	//FishEngine::Timer t("Load assets");
 	FishEditor::FileInfo::SetAssetRootPath(Application::s_dataPath);
 	//t.StopAndPrint();
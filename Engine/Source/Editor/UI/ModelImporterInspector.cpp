@@ -16,6 +16,7 @@
 #include "generate/Enum_ModelImporterNormals.hpp"
 #include "generate/Enum_ModelImporterTangents.hpp"
 #include "generate/Enum_ModelImporterMaterialSearch.hpp"
+#include "generate/Enum_ModelImporterMeshCompression.hpp"
 
 using namespace FishEditor;
 using namespace FishEngine;
@@ -53,6 +54,12 @@ ModelImporterInspector::ModelImporterInspector(QWidget *parent) : QWidget(parent
 	m_verticalLayout->addWidget(m_tangentsCombox);
 	m_materialSearchCombox = CreateCombox<decltype(ModelImporter::m_materialSearch)>("Material Search");
 	m_verticalLayout->addWidget(m_materialSearchCombox);
+	m_optimizeMeshToggle = new UIBool("Optimize Mesh", true);
+	m_verticalLayout->addWidget(m_optimizeMeshToggle);
+	m_meshCompressionCombox = CreateCombox<decltype(ModelImporter::m_meshCompression)>("Mesh Compression");
+	m_verticalLayout->addWidget(m_meshCompressionCombox);
+	m_generateLODsToggle = new UIBool("Generate LODs", false);
+	m_verticalLayout->addWidget(m_generateLODsToggle);
 	
 	m_revertApplyButtons = new UIRevertApplyButtons();
 	m_verticalLayout->addWidget(m_revertApplyButtons);
@@ -97,6 +104,27 @@ ModelImporterInspector::ModelImporterInspector(QWidget *parent) : QWidget(parent
 				this->SetDirty(true);
 			});
 
+	connect(m_optimizeMeshToggle,
+			&UIBool::OnValueChanged,
+			[this](bool value) {
+				m_cachedImporter->m_optimizeMesh = value;
+				this->SetDirty(true);
+			});
+
+	connect(m_meshCompressionCombox,
+			&UIComboBox::OnValueChanged,
+			[this](int index) {
+				m_cachedImporter->m_meshCompression = FishEngine::ToEnum<decltype(m_cachedImporter->m_meshCompression)>(index);
+				this->SetDirty(true);
+			});
+
+	connect(m_generateLODsToggle,
+			&UIBool::OnValueChanged,
+			[this](bool value) {
+				m_cachedImporter->m_generateLODs = value;
+				this->SetDirty(true);
+			});
+
 	
 	connect(m_revertApplyButtons, &UIRevertApplyButtons::OnRevert, this, &ModelImporterInspector::Revert);
 	
@@ -152,6 +180,10 @@ void ModelImporterInspector::Bind(std::shared_ptr<FishEditor::ModelImporter> con
 		m_tangentsCombox->SetValue(index);
 		index = FishEngine::EnumToIndex(m_cachedImporter->m_materialSearch);
 		m_materialSearchCombox->SetValue(index);
+		m_optimizeMeshToggle->SetValue(m_cachedImporter->m_optimizeMesh);
+		index = FishEngine::EnumToIndex(m_cachedImporter->m_meshCompression);
+		m_meshCompressionCombox->SetValue(index);
+		m_generateLODsToggle->SetValue(m_cachedImporter->m_generateLODs);
 	}
 }
 
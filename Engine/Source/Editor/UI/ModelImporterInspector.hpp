@@ -50,6 +50,9 @@ private:
 	UIComboBox		* m_normalsCombox;
 	UIComboBox		* m_tangentsCombox;
 	UIComboBox		* m_materialSearchCombox;
+	UIBool			* m_optimizeMeshToggle;
+	UIComboBox		* m_meshCompressionCombox;
+	UIBool			* m_generateLODsToggle;
 	
 	bool m_isDirty = false;
 	
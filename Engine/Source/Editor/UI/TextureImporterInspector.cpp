@@ -17,6 +17,8 @@
 #include "generate/Enum_TextureImporterShape.hpp"
 #include "generate/Enum_FilterMode.hpp"
 #include "generate/Enum_TextureWrapMode.hpp"
+#include "generate/Enum_TextureImporterMipFilter.hpp"
+#include "generate/Enum_TextureImporterCompression.hpp"
 
 using namespace FishEditor;
 using namespace FishEngine;
@@ -56,10 +58,14 @@ TextureImporterInspector::TextureImporterInspector(QWidget *parent) :
 	m_verticalLayout->addWidget(m_readWriteToggle);
 	m_mipmapToggle = new UIBool("Generate Mip Maps", true);
 	m_verticalLayout->addWidget(m_mipmapToggle);
+	m_mipmapFilterCombox = CreateCombox<TextureImporterMipFilter>("Mip Map Filtering");
+	m_verticalLayout->addWidget(m_mipmapFilterCombox);
 	m_filterModeCombox = CreateCombox<FilterMode>("Filter Mode");
 	m_verticalLayout->addWidget(m_filterModeCombox);
 	m_wrapModeCombox = CreateCombox<TextureWrapMode>("Wrap Mode");
 	m_verticalLayout->addWidget(m_wrapModeCombox);
+	m_compressionCombox = CreateCombox<TextureImporterCompression>("Compression");
+	m_verticalLayout->addWidget(m_compressionCombox);
 	
 	m_revertApplyButtons = new UIRevertApplyButtons();
 	m_verticalLayout->addWidget(m_revertApplyButtons);
@@ -112,6 +118,20 @@ TextureImporterInspector::TextureImporterInspector(QWidget *parent) :
 				this->SetDirty(true);
 			});
 	
+	connect(m_mipmapFilterCombox,
+			&UIComboBox::OnValueChanged,
+			[this](int index) {
+				m_cachedImporter->m_mipmapFilter = FishEngine::ToEnum<decltype(m_cachedImporter->m_mipmapFilter)>(index);
+				this->SetDirty(true);
+			});
+	
+	connect(m_compressionCombox,
+			&UIComboBox::OnValueChanged,
+			[this](int index) {
+				m_cachedImporter->m_textureCompression = FishEngine::ToEnum<decltype(m_cachedImporter->m_textureCompression)>(index);
+				this->SetDirty(true);
+			});
+	
 	connect(m_revertApplyButtons, &UIRevertApplyButtons::OnRevert, this, &TextureImporterInspector::Revert);
 	
 	connect(m_revertApplyButtons, &UIRevertApplyButtons::OnApply, this, &TextureImporterInspector::Apply);
@@ -171,6 +191,10 @@ void TextureImporterInspector::Bind(std::shared_ptr<FishEditor::TextureImporter>
 		m_filterModeCombox->SetValue(index);
 		index = FishEngine::EnumToIndex(m_cachedImporter->wrapMode());
 		m_wrapModeCombox->SetValue(index);
+		index = FishEngine::EnumToIndex(m_cachedImporter->m_mipmapFilter);
+		m_mipmapFilterCombox->SetValue(index);
+		index = FishEngine::EnumToIndex(m_cachedImporter->m_textureCompression);
+		m_compressionCombox->SetValue(index);
 	}
 }
 
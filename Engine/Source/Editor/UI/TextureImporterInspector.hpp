@@ -52,6 +52,8 @@ private:
 	UIComboBox		* m_shapeCombox;
 	UIBool			* m_readWriteToggle;
 	UIBool			* m_mipmapToggle;
+	UIComboBox		* m_mipmapFilterCombox;
+	UIComboBox		* m_compressionCombox;
 	UIComboBox		* m_filterModeCombox;
 	UIComboBox		* m_wrapModeCombox;
 	
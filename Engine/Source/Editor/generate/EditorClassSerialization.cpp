@@ -225,6 +225,10 @@ namespace FishEditor
 		archive << FishEngine::make_nvp("m_importNormals", m_importNormals); // FishEditor::ModelImporterNormals
 		archive << FishEngine::make_nvp("m_importTangents", m_importTangents); // FishEditor::ModelImporterTangents
 		archive << FishEngine::make_nvp("m_materialSearch", m_materialSearch); // FishEditor::ModelImporterMaterialSearch
+		archive << FishEngine::make_nvp("m_optimizeMesh", m_optimizeMesh); // bool
+		archive << FishEngine::make_nvp("m_meshCompression", m_meshCompression); // FishEditor::ModelImporterMeshCompression
+		archive << FishEngine::make_nvp("m_generateLODs", m_generateLODs); // bool
+		archive << FishEngine::make_nvp("m_lodCount", m_lodCount); // int
 		//archive.EndClass();
 	}
 
@@ -236,6 +240,14 @@ namespace FishEditor
 		archive >> FishEngine::make_nvp("m_importNormals", m_importNormals); // FishEditor::ModelImporterNormals
 		archive >> FishEngine::make_nvp("m_importTangents", m_importTangents); // FishEditor::ModelImporterTangents
 		archive >> FishEngine::make_nvp("m_materialSearch", m_materialSearch); // FishEditor::ModelImporterMaterialSearch
+		if (archive.HasNVP("m_optimizeMesh"))
+			archive >> FishEngine::make_nvp("m_optimizeMesh", m_optimizeMesh); // bool
+		if (archive.HasNVP("m_meshCompression"))
+			archive >> FishEngine::make_nvp("m_meshCompression", m_meshCompression); // FishEditor::ModelImporterMeshCompression
+		if (archive.HasNVP("m_generateLODs"))
+			archive >> FishEngine::make_nvp("m_generateLODs", m_generateLODs); // bool
+		if (archive.HasNVP("m_lodCount"))
+			archive >> FishEngine::make_nvp("m_lodCount", m_lodCount); // int
 		//archive.EndClass();
 	}
 
@@ -302,6 +314,8 @@ namespace FishEditor
 		archive << FishEngine::make_nvp("m_isReadable", m_isReadable); // bool
 		archive << FishEngine::make_nvp("m_mipmapEnabled", m_mipmapEnabled); // bool
 		archive << FishEngine::make_nvp("m_npotScale", m_npotScale); // FishEditor::TextureImporterNPOTScale
+		archive << FishEngine::make_nvp("m_textureCompression", m_textureCompression); // FishEditor::TextureImporterCompression
+		archive << FishEngine::make_nvp("m_mipmapFilter", m_mipmapFilter); // FishEditor::TextureImporterMipFilter
 		//archive.EndClass();
 	}
 
@@ -327,6 +341,10 @@ namespace FishEditor
 		archive >> FishEngine::make_nvp("m_isReadable", m_isReadable); // bool
 		archive >> FishEngine::make_nvp("m_mipmapEnabled", m_mipmapEnabled); // bool
 		archive >> FishEngine::make_nvp("m_npotScale", m_npotScale); // FishEditor::TextureImporterNPOTScale
+		if (archive.HasNVP("m_textureCompression"))
+			archive >> FishEngine::make_nvp("m_textureCompression", m_textureCompression); // FishEditor::TextureImporterCompression
+		if (archive.HasNVP("m_mipmapFilter"))
+			archive >> FishEngine::make_nvp("m_mipmapFilter", m_mipmapFilter); // FishEditor::TextureImporterMipFilter
 		//archive.EndClass();
 	}
 
@@ -125,7 +125,9 @@ namespace FishEngine
 		template<class T, std::enable_if_t<std::is_base_of<Object, T>::value, int> = 0>
 		InputArchive & operator >> (std::shared_ptr<T> & obj)
 		{
-			DeserializeObject(obj);
+			ObjectPtr temp = obj;
+			DeserializeObject(temp);
+			obj = std::dynamic_pointer_cast<T>(temp);
 			return *this;
 		}
 		
@@ -133,7 +135,9 @@ namespace FishEngine
 		template<class T, std::enable_if_t<std::is_base_of<Object, T>::value, int> = 0>
 		InputArchive & operator >> (std::weak_ptr<T> & obj)
 		{
-			DeserializeWeakObject(obj);
+			std::weak_ptr<Object> temp = obj;
+			DeserializeWeakObject(temp);
+			obj = std::dynamic_pointer_cast<T>(temp.lock());
 			return *this;
 		}
 
@@ -152,7 +156,8 @@ namespace FishEngine
 		{ 
 			NameOfNVP(nvp.name);
 			MiddleOfNVP();
-			DeserializeObject(nvp.value);
+			ObjectPtr temp = nvp.value;
+			DeserializeObject(temp);
 			EndNVP();
 			return *this;
 		}
@@ -175,13 +180,15 @@ namespace FishEngine
 		template<class T>
 		InputArchive & operator >> (std::list<T> & t)
 		{
-			//BeginSequence(t.size());
-			//for (auto & item : t)
-			//{
-			//	(*this) << item;
-			//}
-			//EndSequence();
-			abort();
+			auto size = BeginSequence();
+			t.resize(size);
+			for (auto & x : t)
+			{
+				BeforeASequenceItem();
+				(*this) >> x;
+				AfterASequenceItem();
+			}
+			EndSequence();
 			return *this;
 		}
 
@@ -228,8 +235,9 @@ namespace FishEngine
 		//virtual void Serialize(const char* t) { m_istream >> t; }
 		//virtual void Serialize(std::nullptr_t const & t) { }
 
-		virtual void DeserializeObject(ObjectPtr const & obj) = 0;
-		virtual void DeserializeWeakObject(std::weak_ptr<Object> const & obj) = 0;
+		// obj is left unchanged by archives that do not restore references
+		virtual void DeserializeObject(ObjectPtr & obj) = 0;
+		virtual void DeserializeWeakObject(std::weak_ptr<Object> & obj) = 0;
 		
 		//virtual std::size_t GetSizeTag() = 0;
 
@@ -247,6 +255,14 @@ namespace FishEngine
 		virtual void EndNVP() = 0;
 		virtual void NameOfNVP(const char* name) = 0;
 		virtual void MiddleOfNVP() = 0;
+
+	public:
+		// false if the current object has no value named name (written before the member was added),
+		// see Meta(Optional)
+		virtual bool HasNVP(const char* name)
+		{
+			return true;
+		}
 	};
 
 	
@@ -0,0 +1,379 @@
+#include "ClusteredLighting.hpp"
+#include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
+#include "Camera.hpp"
+#include "Light.hpp"
+#include "Transform.hpp"
+#include "GameObject.hpp"
+#include "Screen.hpp"
+#include "Shader.hpp"
+#include "JobSystem.hpp"
+#include "Mathf.hpp"
+
+#include <chrono>
+#include <cmath>
+
+namespace FishEngine
+{
+	std::vector<ClusteredLighting::ClusterBounds>	ClusteredLighting::s_clusterBounds;
+	Matrix4x4										ClusteredLighting::s_clusterProjection;
+	float											ClusteredLighting::s_clusterNear = 0;
+	float											ClusteredLighting::s_clusterFar = 0;
+	unsigned int									ClusteredLighting::s_lightBuffer = 0;
+	unsigned int									ClusteredLighting::s_lightTexture = 0;
+	unsigned int									ClusteredLighting::s_gridBuffer = 0;
+	unsigned int									ClusteredLighting::s_gridTexture = 0;
+	unsigned int									ClusteredLighting::s_indexBuffer = 0;
+	unsigned int									ClusteredLighting::s_indexTexture = 0;
+	ClusteredLighting::Statistics					ClusteredLighting::s_statistics;
+
+	namespace
+	{
+		struct CulledLight
+		{
+			// view space bounding sphere
+			Vector3		center;
+			float		radius;
+
+			// view space cone, spot lights only
+			bool		spot;
+			Vector3		apex;
+			Vector3		direction;
+			float		range;
+			float		cosHalfAngle;
+			float		sinHalfAngle;
+
+			// RGBA32F texels of LocalLights, see ClusteredLighting.inc
+			Vector4		texels[3];
+		};
+
+		// bounding spheres of the lights overlapping one depth slice, structure of arrays so that the
+		// sphere-AABB test over all candidates of a cluster is a plain loop the compiler can vectorise
+		struct SliceCandidates
+		{
+			std::vector<float>		x;
+			std::vector<float>		y;
+			std::vector<float>		z;
+			std::vector<float>		radiusSq;
+			std::vector<uint16_t>	light;
+		};
+
+		float SliceDepth(int slice, float near, float far)
+		{
+			return near * std::pow(far / near, static_cast<float>(slice) / ClusteredLighting::ClusterCountZ);
+		}
+
+		int DepthSlice(float depth, float near, float far)
+		{
+			if (depth <= near)
+				return 0;
+			int slice = static_cast<int>(std::floor(std::log(depth / near) / std::log(far / near) * ClusteredLighting::ClusterCountZ));
+			return Mathf::Clamp(slice, 0, ClusteredLighting::ClusterCountZ - 1);
+		}
+
+		// cone vs sphere, false if the sphere is certainly outside of the cone
+		bool ConeIntersectsSphere(CulledLight const & light, Vector3 const & center, float radius)
+		{
+			const Vector3 v = center - light.apex;
+			const float lengthSq = Vector3::Dot(v, v);
+			const float v1 = Vector3::Dot(v, light.direction);
+			const float distanceToAxis = std::sqrt(std::max(lengthSq - v1 * v1, 0.0f));
+			const float distanceToCone = light.cosHalfAngle * distanceToAxis - v1 * light.sinHalfAngle;
+			return !(distanceToCone > radius || v1 > radius + light.range || v1 < -radius);
+		}
+
+		void UploadTextureBuffer(unsigned int buffer, std::size_t size, void const * data)
+		{
+			GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, buffer);
+			glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+		}
+	}
+
+	void ClusteredLighting::Init()
+	{
+		glGenBuffers(1, &s_lightBuffer);
+		glGenBuffers(1, &s_gridBuffer);
+		glGenBuffers(1, &s_indexBuffer);
+		glGenTextures(1, &s_lightTexture);
+		glGenTextures(1, &s_gridTexture);
+		glGenTextures(1, &s_indexTexture);
+
+		// empty lists until the first Build
+		Vector4 noLight[3];
+		const uint32_t emptyGrid[2 * ClusterCount] = {};
+		const uint16_t noIndex = 0;
+		UploadTextureBuffer(s_lightBuffer, sizeof(noLight), noLight);
+		UploadTextureBuffer(s_gridBuffer, sizeof(emptyGrid), emptyGrid);
+		UploadTextureBuffer(s_indexBuffer, sizeof(noIndex), &noIndex);
+
+		GLStateCache::BindTexture(GL_TEXTURE_BUFFER, s_lightTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, s_lightBuffer);
+		GLStateCache::BindTexture(GL_TEXTURE_BUFFER, s_gridTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, s_gridBuffer);
+		GLStateCache::BindTexture(GL_TEXTURE_BUFFER, s_indexTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, s_indexBuffer);
+		GLStateCache::BindTexture(GL_TEXTURE_BUFFER, 0);
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, 0);
+		glCheckError();
+
+		Shader::SetGlobalBufferTexture("LocalLights", s_lightTexture);
+		Shader::SetGlobalBufferTexture("ClusterGrid", s_gridTexture);
+		Shader::SetGlobalBufferTexture("ClusterLightIndices", s_indexTexture);
+	}
+
+	Vector4 ClusteredLighting::ClusterParams(CameraPtr const & camera)
+	{
+		const float near = camera->nearClipPlane();
+		const float far = camera->farClipPlane();
+		const float scale = ClusterCountZ / std::log(far / near);
+		return Vector4(
+			static_cast<float>(ClusterCountX) / Screen::width(),
+			static_cast<float>(ClusterCountY) / Screen::height(),
+			scale,
+			-std::log(near) * scale);
+	}
+
+	void ClusteredLighting::UpdateClusterBounds(Matrix4x4 const & projection, Vector3 const & forward, float near, float far)
+	{
+		s_clusterProjection = projection;
+		s_clusterNear = near;
+		s_clusterFar = far;
+		s_clusterBounds.resize(ClusterCount);
+
+		// a point on the ray of a NDC xy at any view depth: interpolate between the near and far plane points,
+		// works for perspective and orthographic projections
+		const auto invProjection = projection.inverse();
+		auto pointAtDepth = [&invProjection, &forward](float ndcX, float ndcY, float depth)
+		{
+			const Vector3 pn = invProjection.MultiplyPoint(ndcX, ndcY, -1);
+			const Vector3 pf = invProjection.MultiplyPoint(ndcX, ndcY, 1);
+			const float dn = Vector3::Dot(pn, forward);
+			const float df = Vector3::Dot(pf, forward);
+			return pn + (pf - pn) * ((depth - dn) / (df - dn));
+		};
+
+		JobSystem::ParallelFor(0, ClusterCount, [&](std::size_t c)
+		{
+			const int x = static_cast<int>(c % ClusterCountX);
+			const int y = static_cast<int>((c / ClusterCountX) % ClusterCountY);
+			const int z = static_cast<int>(c / (ClusterCountX * ClusterCountY));
+			const float x0 = -1.0f + 2.0f * x / ClusterCountX;
+			const float x1 = -1.0f + 2.0f * (x + 1) / ClusterCountX;
+			const float y0 = -1.0f + 2.0f * y / ClusterCountY;
+			const float y1 = -1.0f + 2.0f * (y + 1) / ClusterCountY;
+			const float depths[2] = { SliceDepth(z, near, far), SliceDepth(z + 1, near, far) };
+
+			Vector3 bmin = Vector3::one * Mathf::Infinity;
+			Vector3 bmax = Vector3::one * -Mathf::Infinity;
+			for (float depth : depths)
+			{
+				for (auto const & p : { pointAtDepth(x0, y0, depth), pointAtDepth(x1, y0, depth), pointAtDepth(x0, y1, depth), pointAtDepth(x1, y1, depth) })
+				{
+					bmin = Vector3::Min(bmin, p);
+					bmax = Vector3::Max(bmax, p);
+				}
+			}
+			s_clusterBounds[c].min = bmin;
+			s_clusterBounds[c].max = bmax;
+		}, ClusterCountX * ClusterCountY, "ClusteredLighting.Bounds");
+	}
+
+	void ClusteredLighting::Build(CameraPtr const & camera)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+		s_statistics = Statistics();
+
+		auto const & view = camera->worldToCameraMatrix();
+		auto const & projection = camera->projectionMatrix();
+		const float near = camera->nearClipPlane();
+		const float far = camera->farClipPlane();
+		const Vector3 forward = view.MultiplyVector(camera->transform()->forward()).normalized();
+		if (s_clusterBounds.empty() || projection != s_clusterProjection || near != s_clusterNear || far != s_clusterFar)
+		{
+			UpdateClusterBounds(projection, forward, near, far);
+		}
+
+		/************************************************************************/
+		/* Gather lights                                                        */
+		/************************************************************************/
+		std::vector<CulledLight> lights;
+		for (auto const & l : Light::m_lights)
+		{
+			auto light = l.lock();
+			if (light == nullptr || (light->m_type != LightType::Point && light->m_type != LightType::Spot))
+				continue;
+			if (!light->isActiveAndEnabled() || light->m_range <= 0 || light->m_intensity <= 0)
+				continue;
+			s_statistics.lights++;
+			if (lights.size() >= MaxLights)
+				continue;
+
+			auto t = light->transform();
+			const Vector3 positionWS = t->position();
+			const Vector3 directionWS = t->forward();
+
+			CulledLight cl;
+			cl.spot = light->m_type == LightType::Spot;
+			cl.apex = view.MultiplyPoint3x4(positionWS);
+			cl.direction = view.MultiplyVector(directionWS).normalized();
+			cl.range = light->m_range;
+			const float halfAngle = Mathf::Clamp(light->m_spotAngle, 1.0f, 179.0f) * 0.5f * Mathf::Deg2Rad;
+			cl.cosHalfAngle = std::cos(halfAngle);
+			cl.sinHalfAngle = std::sin(halfAngle);
+			if (!cl.spot)
+			{
+				cl.center = cl.apex;
+				cl.radius = cl.range;
+			}
+			else if (halfAngle > Mathf::PI * 0.25f)
+			{
+				cl.center = cl.apex + cl.direction * (cl.range * cl.cosHalfAngle);
+				cl.radius = cl.range * cl.sinHalfAngle;
+			}
+			else
+			{
+				cl.radius = cl.range / (2.0f * cl.cosHalfAngle);
+				cl.center = cl.apex + cl.direction * cl.radius;
+			}
+
+			const float depth = Vector3::Dot(cl.center, forward);
+			if (depth + cl.radius < near || depth - cl.radius > far)
+				continue;
+
+			// spot attenuation = saturate(dot(-L, direction) * scale + offset), 1 for point lights
+			float spotScale = 0;
+			float spotOffset = 1;
+			if (cl.spot)
+			{
+				const float cosOuter = cl.cosHalfAngle;
+				const float cosInner = std::cos(halfAngle * 0.8f);
+				spotScale = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+				spotOffset = -cosOuter * spotScale;
+			}
+			auto const & color = light->m_color;
+			const float intensity = light->m_intensity;
+			cl.texels[0] = Vector4(positionWS, 1.0f / (cl.range * cl.range));
+			cl.texels[1] = Vector4(color.r * intensity, color.g * intensity, color.b * intensity, spotScale);
+			cl.texels[2] = Vector4(directionWS, spotOffset);
+			lights.push_back(cl);
+		}
+
+		/************************************************************************/
+		/* Depth slices                                                         */
+		/************************************************************************/
+		SliceCandidates slices[ClusterCountZ];
+		for (std::size_t i = 0; i < lights.size(); ++i)
+		{
+			auto const & cl = lights[i];
+			const float depth = Vector3::Dot(cl.center, forward);
+			const int first = DepthSlice(depth - cl.radius, near, far);
+			const int last = DepthSlice(depth + cl.radius, near, far);
+			for (int z = first; z <= last; ++z)
+			{
+				auto & s = slices[z];
+				s.x.push_back(cl.center.x);
+				s.y.push_back(cl.center.y);
+				s.z.push_back(cl.center.z);
+				s.radiusSq.push_back(cl.radius * cl.radius);
+				s.light.push_back(static_cast<uint16_t>(i));
+			}
+		}
+
+		/************************************************************************/
+		/* Clusters                                                             */
+		/************************************************************************/
+		static std::vector<uint16_t> clusterLights;
+		static std::vector<int> clusterLightCounts;
+		clusterLights.resize(static_cast<std::size_t>(ClusterCount) * MaxLightsPerCluster);
+		clusterLightCounts.assign(ClusterCount, 0);
+		std::vector<int> dropped(ClusterCount, 0);
+
+		JobSystem::ParallelFor(0, ClusterCount, [&](std::size_t c)
+		{
+			auto const & b = s_clusterBounds[c];
+			auto const & s = slices[c / (ClusterCountX * ClusterCountY)];
+			const std::size_t candidateCount = s.light.size();
+			if (candidateCount == 0)
+				return;
+
+			thread_local std::vector<uint8_t> hits;
+			hits.resize(candidateCount);
+			const float minX = b.min.x, minY = b.min.y, minZ = b.min.z;
+			const float maxX = b.max.x, maxY = b.max.y, maxZ = b.max.z;
+			const float * px = s.x.data();
+			const float * py = s.y.data();
+			const float * pz = s.z.data();
+			const float * pr = s.radiusSq.data();
+			uint8_t * ph = hits.data();
+			for (std::size_t i = 0; i < candidateCount; ++i)
+			{
+				const float dx = std::max(std::max(minX - px[i], 0.0f), px[i] - maxX);
+				const float dy = std::max(std::max(minY - py[i], 0.0f), py[i] - maxY);
+				const float dz = std::max(std::max(minZ - pz[i], 0.0f), pz[i] - maxZ);
+				ph[i] = (dx * dx + dy * dy + dz * dz <= pr[i]) ? 1 : 0;
+			}
+
+			const Vector3 center = (b.min + b.max) * 0.5f;
+			const float radius = (b.max - b.min).magnitude() * 0.5f;
+			uint16_t * out = &clusterLights[c * MaxLightsPerCluster];
+			int count = 0;
+			for (std::size_t i = 0; i < candidateCount; ++i)
+			{
+				if (!ph[i])
+					continue;
+				const uint16_t index = s.light[i];
+				if (lights[index].spot && !ConeIntersectsSphere(lights[index], center, radius))
+					continue;
+				if (count < MaxLightsPerCluster)
+					out[count++] = index;
+				else
+					dropped[c]++;
+			}
+			clusterLightCounts[c] = count;
+		}, ClusterCountX, "ClusteredLighting.Assign");
+
+		/************************************************************************/
+		/* Pack                                                                 */
+		/************************************************************************/
+		std::vector<uint32_t> grid(2 * ClusterCount);
+		std::vector<uint16_t> indices;
+		std::vector<uint8_t> referenced(lights.size(), 0);
+		for (int c = 0; c < ClusterCount; ++c)
+		{
+			const int count = clusterLightCounts[c];
+			grid[2 * c] = static_cast<uint32_t>(indices.size());
+			grid[2 * c + 1] = static_cast<uint32_t>(count);
+			const uint16_t * first = &clusterLights[static_cast<std::size_t>(c) * MaxLightsPerCluster];
+			indices.insert(indices.end(), first, first + count);
+			for (int i = 0; i < count; ++i)
+				referenced[first[i]] = 1;
+			if (count > 0)
+				s_statistics.nonEmptyClusters++;
+			s_statistics.maxLightsPerCluster = std::max(s_statistics.maxLightsPerCluster, count);
+			s_statistics.droppedLights += dropped[c];
+		}
+		std::vector<Vector4> lightTexels;
+		lightTexels.reserve(3 * lights.size());
+		for (auto const & cl : lights)
+		{
+			lightTexels.insert(lightTexels.end(), cl.texels, cl.texels + 3);
+		}
+		for (auto r : referenced)
+			s_statistics.visibleLights += r;
+		if (s_statistics.nonEmptyClusters > 0)
+			s_statistics.averageLightsPerCluster = static_cast<float>(indices.size()) / s_statistics.nonEmptyClusters;
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		s_statistics.cullTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+
+		if (lightTexels.empty())
+			lightTexels.resize(3);
+		if (indices.empty())
+			indices.push_back(0);
+		UploadTextureBuffer(s_lightBuffer, lightTexels.size() * sizeof(Vector4), lightTexels.data());
+		UploadTextureBuffer(s_gridBuffer, grid.size() * sizeof(uint32_t), grid.data());
+		UploadTextureBuffer(s_indexBuffer, indices.size() * sizeof(uint16_t), indices.data());
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, 0);
+		glCheckError();
+	}
+}
@@ -0,0 +1,87 @@
+#ifndef ClusteredLighting_hpp
+#define ClusteredLighting_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+#include "Vector3.hpp"
+#include "Vector4.hpp"
+#include "Matrix4x4.hpp"
+
+#include <vector>
+
+namespace FishEngine
+{
+	// Clustered forward+ lighting for point and spot lights.
+	// The view frustum of the camera is split into a ClusterCountX * ClusterCountY * ClusterCountZ grid of froxels
+	// (screen tiles * exponential depth slices). Every frame the visible lights are culled against the froxels on the CPU
+	// and the per-froxel light lists are uploaded to texture buffers, read by ClusteredLighting.inc.
+	// The main directional light is not part of the lists, it still goes through LightingUniforms.
+	class FE_EXPORT Meta(NonSerializable) ClusteredLighting
+	{
+	public:
+		ClusteredLighting() = delete;
+
+		static constexpr int ClusterCountX = 16;
+		static constexpr int ClusterCountY = 9;
+		static constexpr int ClusterCountZ = 24;
+		static constexpr int ClusterCount = ClusterCountX * ClusterCountY * ClusterCountZ;
+
+		// Lights in one cluster beyond this are dropped (and counted in statistics().droppedLights).
+		static constexpr int MaxLightsPerCluster = 128;
+
+		// Lights beyond this are ignored, light indices are 16 bit.
+		static constexpr int MaxLights = 65535;
+
+		static void Init();
+
+		// Cull all point and spot lights against the clusters of camera and upload the light lists.
+		// Call after Pipeline::BindCamera(camera), before drawing.
+		static void Build(CameraPtr const & camera);
+
+		// x, y: 1 / cluster size in pixels; z, w: scale and bias of the depth slice, slice = log(depth) * z + w.
+		// Set as PerCameraUniforms.ClusterParams by Pipeline::BindCamera.
+		static Vector4 ClusterParams(CameraPtr const & camera);
+
+		struct Statistics
+		{
+			int		lights = 0;					// point and spot lights in the scene
+			int		visibleLights = 0;			// lights in at least one cluster
+			int		nonEmptyClusters = 0;
+			int		maxLightsPerCluster = 0;
+			float	averageLightsPerCluster = 0;	// over non-empty clusters
+			int		droppedLights = 0;			// overflow of MaxLightsPerCluster
+			float	cullTime = 0;				// in milliseconds, for the last Build
+		};
+
+		static Statistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+	private:
+		// view space bounds of each cluster
+		static void UpdateClusterBounds(Matrix4x4 const & projection, Vector3 const & forward, float near, float far);
+
+		struct ClusterBounds
+		{
+			Vector3 min;
+			Vector3 max;
+		};
+
+		static std::vector<ClusterBounds>	s_clusterBounds;
+		static Matrix4x4					s_clusterProjection;	// projection of s_clusterBounds
+		static float						s_clusterNear;
+		static float						s_clusterFar;
+
+		static unsigned int					s_lightBuffer;			// 3 RGBA32F texels per light
+		static unsigned int					s_lightTexture;
+		static unsigned int					s_gridBuffer;			// RG32UI per cluster: offset, count
+		static unsigned int					s_gridTexture;
+		static unsigned int					s_indexBuffer;			// R16UI light index lists
+		static unsigned int					s_indexTexture;
+
+		static Statistics					s_statistics;
+	};
+}
+
+#endif // ClusteredLighting_hpp
@@ -35,6 +35,8 @@ namespace FishEngine
 		//virtual void Init() {}
 		virtual void Start() {}
 		virtual void Update() {}
+		// called by GameLoop at every fixed step, once started
+		virtual void FixedUpdate() {}
 		virtual void OnDestroy() {}
 
 		//static PComponent CreateComponent(const std::string& componentClassName);
@@ -47,11 +49,17 @@ namespace FishEngine
 		friend class GameObject;
 		friend class Scene;
 		friend class FishEditor::SceneViewEditor;
+		friend class ComponentPool;
+		friend class ObjectPool;
 
 		std::weak_ptr<GameObject> m_gameObject;
 
 		Meta(NonSerializable)
 		bool m_isStartFunctionCalled = false;
+
+		// in the ComponentPool of its ClassID, -1: not attached
+		Meta(NonSerializable)
+		int m_poolIndex = -1;
 	};
 }
 
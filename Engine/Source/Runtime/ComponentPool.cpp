@@ -0,0 +1,36 @@
+#include "ComponentPool.hpp"
+#include "Component.hpp"
+
+namespace FishEngine
+{
+	std::map<int, std::vector<Component*>> ComponentPool::s_pools;
+
+	std::vector<Component*> const & ComponentPool::Components(int classID)
+	{
+		static const std::vector<Component*> empty;
+		auto it = s_pools.find(classID);
+		return it == s_pools.end() ? empty : it->second;
+	}
+
+	void ComponentPool::Add(Component* component)
+	{
+		if (component->m_poolIndex >= 0)
+			return;
+		auto & pool = s_pools[component->ClassID()];
+		component->m_poolIndex = static_cast<int>(pool.size());
+		pool.push_back(component);
+	}
+
+	void ComponentPool::Remove(Component* component)
+	{
+		if (component->m_poolIndex < 0)
+			return;
+		// swap with the last one
+		auto & pool = s_pools[component->ClassID()];
+		auto last = pool.back();
+		pool[component->m_poolIndex] = last;
+		last->m_poolIndex = component->m_poolIndex;
+		pool.pop_back();
+		component->m_poolIndex = -1;
+	}
+}
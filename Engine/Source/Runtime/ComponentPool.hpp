@@ -0,0 +1,60 @@
+#ifndef ComponentPool_hpp
+#define ComponentPool_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+
+#include <map>
+#include <vector>
+
+namespace FishEngine
+{
+	// Components attached to game objects, in one dense array per ClassID: systems iterate "all MeshRenderers" or
+	// "all Scripts" linearly instead of walking every game object and its components.
+	// Kept up to date by GameObject (AddComponent, RemoveComponent, destruction), main thread only. The components
+	// stay owned by their shared_ptr, the pools hold raw pointers.
+	class FE_EXPORT Meta(NonSerializable) ComponentPool
+	{
+	public:
+		ComponentPool() = delete;
+
+		// components whose class is exactly classID (all user scripts are Scripts)
+		static std::vector<Component*> const & Components(int classID);
+
+		// Call func(T*) for every component of class T or of a class derived from T.
+		// Components added by func are not visited, do not remove components in func.
+		template<class T, class Func>
+		static void ForEach(Func && func)
+		{
+			static_assert(std::is_base_of<Component, T>::value, "Component only");
+			for (auto & pool : s_pools)
+			{
+				if (!IsSubClassOf<T>(pool.first))
+					continue;
+				auto const & components = pool.second;
+				const std::size_t count = components.size();
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					func(static_cast<T*>(components[i]));
+				}
+			}
+		}
+
+		// of class classID, see Components
+		static std::size_t Count(int classID)
+		{
+			return Components(classID).size();
+		}
+
+	private:
+		friend class GameObject;
+		friend class Scene;
+
+		static void Add(Component* component);
+		static void Remove(Component* component);
+
+		static std::map<int, std::vector<Component*>> s_pools;
+	};
+}
+
+#endif // ComponentPool_hpp
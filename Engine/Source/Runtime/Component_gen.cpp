@@ -4,6 +4,7 @@
 #include "Camera.hpp"
 #include "Animator.hpp"
 #include "MeshFilter.hpp"
+#include "LODGroup.hpp"
 #include "Rigidbody.hpp"
 #include "MeshRenderer.hpp"
 #include "SkinnedMeshRenderer.hpp"
@@ -23,6 +24,7 @@ AddComponentToGameObject(
 	CASE(Camera)
 	CASE(Animator)
 	CASE(MeshFilter)
+	CASE(LODGroup)
 	CASE(MeshRenderer)
 	CASE(Rigidbody)
 	CASE(SkinnedMeshRenderer)
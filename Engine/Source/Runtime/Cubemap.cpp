@@ -1,4 +1,5 @@
 #include "Cubemap.hpp"
+#include "GLStateCache.hpp"
 
 void FishEngine::Cubemap::UploadToGPU()
 {
@@ -23,7 +24,7 @@ void FishEngine::Cubemap::UploadToGPU()
 	
 	glGenTextures(1, &m_GLNativeTexture);
 	glCheckError();
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_GLNativeTexture);
+	GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, m_GLNativeTexture);
 	glCheckError();
 
 	
@@ -51,7 +52,7 @@ void FishEngine::Cubemap::UploadToGPU()
 	glCheckError();
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glCheckError();
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, 0);
 	m_uploaded = true;
 	glCheckError();
 }
@@ -32,6 +32,7 @@ namespace FishEngine
 	class Object;
 	class ScriptableObject;
 	class Prefab;
+	class ObjectPool;
 	class GameObject;
 	class Transform;
 	class Component;
@@ -39,6 +40,7 @@ namespace FishEngine
 	class Camera;
 	class Renderer;
 	class MeshFilter;
+	class LODGroup;
 	class MeshRenderer;
 	class SkinnedMeshRenderer;
 	class Script;
@@ -97,6 +99,7 @@ namespace FishEngine
 	typedef std::shared_ptr<Camera> CameraPtr;
 	typedef std::shared_ptr<Renderer> RendererPtr;
 	typedef std::shared_ptr<MeshFilter> MeshFilterPtr;
+	typedef std::shared_ptr<LODGroup> LODGroupPtr;
 	typedef std::shared_ptr<MeshRenderer> MeshRendererPtr;
 	typedef std::shared_ptr<SkinnedMeshRenderer> SkinnedMeshRendererPtr;
 	typedef std::shared_ptr<Script> ScriptPtr;
@@ -3,8 +3,43 @@
 
 using namespace FishEngine;
 
+namespace
+{
+	// errors are reported by DebugMessageCallback, glGetError round-trips are not needed
+	bool s_debugOutputEnabled = false;
+
+#if FISHENGINE_PLATFORM_WINDOWS && FISHENGINE_GL_DEBUG
+	void APIENTRY DebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
+	{
+		std::string text = Format("GL debug [id %1%]: %2%", id, message);
+		if (type == GL_DEBUG_TYPE_ERROR || severity == GL_DEBUG_SEVERITY_HIGH)
+			LogError(text);
+		else
+			LogWarning(text);
+	}
+#endif
+}
+
+void EnableGLDebugOutput()
+{
+#if FISHENGINE_PLATFORM_WINDOWS && FISHENGINE_GL_DEBUG
+	if (!GLEW_VERSION_4_3 && !GLEW_KHR_debug)
+		return;
+	glEnable(GL_DEBUG_OUTPUT);
+	// report in the call that caused the message, so a breakpoint in the callback shows the call stack
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback(DebugMessageCallback, nullptr);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+	s_debugOutputEnabled = true;
+	LogInfo("GL debug output enabled");
+#endif
+}
+
 void _checkOpenGLError(const char *file, int line)
 {
+	if (s_debugOutputEnabled)
+		return;
+
 	GLenum err(glGetError());
 
 	while (err != GL_NO_ERROR)
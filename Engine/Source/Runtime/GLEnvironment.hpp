@@ -27,12 +27,20 @@
 	#include <OpenGL/gl3ext.h>
 #endif
 
-//#ifdef _DEBUG
+// Debug builds report GL errors through a KHR_debug callback when the context supports it (GL 4.3),
+// glCheckError() then does nothing; otherwise (macOS, GL 4.1) it falls back to glGetError.
+// Release builds compile glCheckError() out.
+#if defined(_DEBUG) || defined(DEBUG)
+#define FISHENGINE_GL_DEBUG 1
 #define glCheckError() _checkOpenGLError(__FILE__,__LINE__)
-//#else
-//#define glCheckError()
-//#endif
+#else
+#define FISHENGINE_GL_DEBUG 0
+#define glCheckError() ((void)0)
+#endif
 
 FE_EXPORT void _checkOpenGLError(const char *file, int line);
 
+// Install the KHR_debug message callback (debug builds only). Call after the context is created.
+FE_EXPORT void EnableGLDebugOutput();
+
 #endif // GLEnvironment_hpp
@@ -0,0 +1,380 @@
+#include "GLStateCache.hpp"
+
+namespace
+{
+	using namespace FishEngine;
+
+	constexpr GLuint Unknown = 0xFFFFFFFFu;
+
+	// capabilities we track, others go straight to the driver
+	constexpr GLenum TrackedCapabilities[] = {
+		GL_DEPTH_TEST,
+		GL_CULL_FACE,
+		GL_BLEND,
+		GL_DEPTH_CLAMP,
+		GL_RASTERIZER_DISCARD,
+		GL_POLYGON_OFFSET_LINE,
+		GL_FRAMEBUFFER_SRGB,
+		GL_TEXTURE_CUBE_MAP_SEAMLESS,
+		GL_SCISSOR_TEST,
+	};
+	constexpr int TrackedCapabilityCount = sizeof(TrackedCapabilities) / sizeof(TrackedCapabilities[0]);
+
+	// texture targets per unit
+	constexpr GLenum TrackedTextureTargets[] = {
+		GL_TEXTURE_2D,
+		GL_TEXTURE_CUBE_MAP,
+		GL_TEXTURE_2D_ARRAY,
+		GL_TEXTURE_BUFFER,
+		GL_TEXTURE_3D,
+	};
+	constexpr int TrackedTextureTargetCount = sizeof(TrackedTextureTargets) / sizeof(TrackedTextureTargets[0]);
+
+	// generic buffer binding points
+	constexpr GLenum TrackedBufferTargets[] = {
+		GL_ARRAY_BUFFER,
+		GL_UNIFORM_BUFFER,
+		GL_TEXTURE_BUFFER,
+	};
+	constexpr int TrackedBufferTargetCount = sizeof(TrackedBufferTargets) / sizeof(TrackedBufferTargets[0]);
+
+	struct BufferRange
+	{
+		GLuint		buffer;
+		GLintptr	offset;
+		GLsizeiptr	size;		// -1: whole buffer (glBindBufferBase)
+	};
+
+	struct State
+	{
+		GLuint		capabilities[TrackedCapabilityCount];	// GL_TRUE, GL_FALSE or Unknown
+		GLuint		depthFunc;
+		GLuint		depthMask;
+		GLuint		cullFace;
+		GLuint		blendFunc[4];
+		GLuint		polygonMode;
+		GLuint		program;
+		GLuint		vao;
+		GLuint		buffers[TrackedBufferTargetCount];
+		BufferRange	uniformBuffers[GLStateCache::MaxUniformBufferBindings];
+		GLuint		activeTexture;
+		GLuint		textures[GLStateCache::MaxTextureUnits][TrackedTextureTargetCount];
+		GLuint		samplers[GLStateCache::MaxTextureUnits];
+		GLuint		drawFramebuffer;
+		GLuint		readFramebuffer;
+	};
+
+	State s_state;
+	bool s_stateInitialized = false;
+
+	template<int N>
+	int IndexOf(GLenum const (&list)[N], GLenum value)
+	{
+		for (int i = 0; i < N; ++i)
+		{
+			if (list[i] == value)
+				return i;
+		}
+		return -1;
+	}
+
+	// true if the cached value already is value, otherwise caches it
+	inline bool Same(GLuint & cached, GLuint value, GLStateCache::Statistics & statistics)
+	{
+		if (cached == value)
+		{
+			statistics.avoidedCalls++;
+			return true;
+		}
+		cached = value;
+		statistics.issuedCalls++;
+		return false;
+	}
+}
+
+namespace FishEngine
+{
+	GLStateCache::Statistics GLStateCache::s_statistics;
+	GLStateCache::Statistics GLStateCache::s_lastFrameStatistics;
+
+	void GLStateCache::Reset()
+	{
+		auto & s = s_state;
+		for (auto & c : s.capabilities)
+			c = Unknown;
+		s.depthFunc = Unknown;
+		s.depthMask = Unknown;
+		s.cullFace = Unknown;
+		for (auto & f : s.blendFunc)
+			f = Unknown;
+		s.polygonMode = Unknown;
+		s.program = Unknown;
+		s.vao = Unknown;
+		for (auto & b : s.buffers)
+			b = Unknown;
+		for (auto & b : s.uniformBuffers)
+			b = { Unknown, 0, -1 };
+		s.activeTexture = Unknown;
+		for (auto & unit : s.textures)
+			for (auto & t : unit)
+				t = Unknown;
+		for (auto & sampler : s.samplers)
+			sampler = Unknown;
+		s.drawFramebuffer = Unknown;
+		s.readFramebuffer = Unknown;
+		s_stateInitialized = true;
+	}
+
+	void GLStateCache::SetEnabled(GLenum capability, bool enabled)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		int index = IndexOf(TrackedCapabilities, capability);
+		if (index >= 0 && Same(s_state.capabilities[index], enabled ? GL_TRUE : GL_FALSE, s_statistics))
+			return;
+		if (index < 0)
+			s_statistics.issuedCalls++;
+		if (enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+	}
+
+	void GLStateCache::DepthFunc(GLenum func)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		if (!Same(s_state.depthFunc, func, s_statistics))
+			glDepthFunc(func);
+	}
+
+	void GLStateCache::DepthMask(bool write)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		if (!Same(s_state.depthMask, write ? GL_TRUE : GL_FALSE, s_statistics))
+			glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+
+	void GLStateCache::CullFace(GLenum face)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		if (!Same(s_state.cullFace, face, s_statistics))
+			glCullFace(face);
+	}
+
+	void GLStateCache::BlendFunc(GLenum src, GLenum dst)
+	{
+		BlendFuncSeparate(src, dst, src, dst);
+	}
+
+	void GLStateCache::BlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		auto & f = s_state.blendFunc;
+		if (f[0] == srcRGB && f[1] == dstRGB && f[2] == srcAlpha && f[3] == dstAlpha)
+		{
+			s_statistics.avoidedCalls++;
+			return;
+		}
+		f[0] = srcRGB;
+		f[1] = dstRGB;
+		f[2] = srcAlpha;
+		f[3] = dstAlpha;
+		s_statistics.issuedCalls++;
+		glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+	}
+
+	void GLStateCache::PolygonMode(GLenum mode)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		if (!Same(s_state.polygonMode, mode, s_statistics))
+			glPolygonMode(GL_FRONT_AND_BACK, mode);
+	}
+
+	void GLStateCache::UseProgram(GLuint program)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		if (!Same(s_state.program, program, s_statistics))
+			glUseProgram(program);
+	}
+
+	void GLStateCache::BindVertexArray(GLuint vao)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		if (!Same(s_state.vao, vao, s_statistics))
+			glBindVertexArray(vao);
+	}
+
+	void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		int index = IndexOf(TrackedBufferTargets, target);
+		if (index >= 0 && Same(s_state.buffers[index], buffer, s_statistics))
+			return;
+		if (index < 0)
+			s_statistics.issuedCalls++;
+		glBindBuffer(target, buffer);
+	}
+
+	void GLStateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+	{
+		BindBufferRange(target, index, buffer, 0, -1);
+	}
+
+	void GLStateCache::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		bool tracked = (target == GL_UNIFORM_BUFFER && index < MaxUniformBufferBindings);
+		if (tracked)
+		{
+			auto & b = s_state.uniformBuffers[index];
+			if (b.buffer == buffer && b.offset == offset && b.size == size)
+			{
+				s_statistics.avoidedCalls++;
+				return;
+			}
+			b = { buffer, offset, size };
+		}
+		s_statistics.issuedCalls++;
+		if (size < 0)
+			glBindBufferBase(target, index, buffer);
+		else
+			glBindBufferRange(target, index, buffer, offset, size);
+
+		// the indexed binding functions also bind the generic binding point
+		int generic = IndexOf(TrackedBufferTargets, target);
+		if (generic >= 0)
+			s_state.buffers[generic] = buffer;
+	}
+
+	void GLStateCache::ActiveTexture(GLenum unit)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		if (!Same(s_state.activeTexture, unit, s_statistics))
+			glActiveTexture(unit);
+	}
+
+	void GLStateCache::BindTexture(GLenum target, GLuint texture)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		int unit = static_cast<int>(s_state.activeTexture - GL_TEXTURE0);
+		int index = IndexOf(TrackedTextureTargets, target);
+		if (s_state.activeTexture != Unknown && unit >= 0 && unit < MaxTextureUnits && index >= 0)
+		{
+			if (Same(s_state.textures[unit][index], texture, s_statistics))
+				return;
+		}
+		else
+		{
+			s_statistics.issuedCalls++;
+		}
+		glBindTexture(target, texture);
+	}
+
+	void GLStateCache::BindTexture(int unit, GLenum target, GLuint texture)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		int index = IndexOf(TrackedTextureTargets, target);
+		if (unit >= 0 && unit < MaxTextureUnits && index >= 0 && s_state.textures[unit][index] == texture)
+		{
+			s_statistics.avoidedCalls++;
+			return;
+		}
+		ActiveTexture(GLenum(GL_TEXTURE0 + unit));
+		BindTexture(target, texture);
+	}
+
+	void GLStateCache::BindSampler(GLuint unit, GLuint sampler)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		if (unit < MaxTextureUnits && Same(s_state.samplers[unit], sampler, s_statistics))
+			return;
+		if (unit >= MaxTextureUnits)
+			s_statistics.issuedCalls++;
+		glBindSampler(unit, sampler);
+	}
+
+	void GLStateCache::BindFramebuffer(GLenum target, GLuint fbo)
+	{
+		if (!s_stateInitialized)
+			Reset();
+		auto & s = s_state;
+		bool draw = (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER);
+		bool read = (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER);
+		if ((!draw || s.drawFramebuffer == fbo) && (!read || s.readFramebuffer == fbo))
+		{
+			s_statistics.avoidedCalls++;
+			return;
+		}
+		if (draw)
+			s.drawFramebuffer = fbo;
+		if (read)
+			s.readFramebuffer = fbo;
+		s_statistics.issuedCalls++;
+		glBindFramebuffer(target, fbo);
+	}
+
+	void GLStateCache::OnDeleteTexture(GLuint texture)
+	{
+		for (auto & unit : s_state.textures)
+		{
+			for (auto & t : unit)
+			{
+				if (t == texture)
+					t = Unknown;
+			}
+		}
+	}
+
+	void GLStateCache::OnDeleteBuffer(GLuint buffer)
+	{
+		for (auto & b : s_state.buffers)
+		{
+			if (b == buffer)
+				b = Unknown;
+		}
+		for (auto & b : s_state.uniformBuffers)
+		{
+			if (b.buffer == buffer)
+				b.buffer = Unknown;
+		}
+	}
+
+	void GLStateCache::OnDeleteFramebuffer(GLuint fbo)
+	{
+		if (s_state.drawFramebuffer == fbo)
+			s_state.drawFramebuffer = Unknown;
+		if (s_state.readFramebuffer == fbo)
+			s_state.readFramebuffer = Unknown;
+	}
+
+	void GLStateCache::OnDeleteVertexArray(GLuint vao)
+	{
+		if (s_state.vao == vao)
+			s_state.vao = Unknown;
+	}
+
+	void GLStateCache::OnDeleteProgram(GLuint program)
+	{
+		if (s_state.program == program)
+			s_state.program = Unknown;
+	}
+
+	void GLStateCache::BeginFrame()
+	{
+		s_lastFrameStatistics = s_statistics;
+		s_statistics = Statistics();
+	}
+}
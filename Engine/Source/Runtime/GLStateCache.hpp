@@ -0,0 +1,81 @@
+#ifndef GLStateCache_hpp
+#define GLStateCache_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+#include "GLEnvironment.hpp"
+
+namespace FishEngine
+{
+	// Shadow copy of the GL context state.
+	// All render state changes go through here; a call that would set the state to its current value is dropped.
+	// Anything that touches the same state with raw gl* calls (e.g. Qt between two frames) must call Reset() afterwards.
+	// Objects deleted with glDelete* must be reported (OnDelete*), GL reuses the names.
+	class FE_EXPORT Meta(NonSerializable) GLStateCache
+	{
+	public:
+		GLStateCache() = delete;
+
+		static constexpr int MaxTextureUnits = 32;
+		static constexpr int MaxUniformBufferBindings = 16;
+
+		// Forget the cached state, the next call of every setter reaches the driver.
+		static void Reset();
+
+		// Capabilities (glEnable / glDisable).
+		static void SetEnabled(GLenum capability, bool enabled);
+		static void Enable(GLenum capability) { SetEnabled(capability, true); }
+		static void Disable(GLenum capability) { SetEnabled(capability, false); }
+
+		static void DepthFunc(GLenum func);
+		static void DepthMask(bool write);
+		static void CullFace(GLenum face);
+		static void BlendFunc(GLenum src, GLenum dst);
+		static void BlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+		static void PolygonMode(GLenum mode);	// GL_FRONT_AND_BACK
+
+		static void UseProgram(GLuint program);
+		static void BindVertexArray(GLuint vao);
+
+		// GL_ELEMENT_ARRAY_BUFFER is part of the VAO state and is not cached.
+		static void BindBuffer(GLenum target, GLuint buffer);
+		static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+		static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+		static void ActiveTexture(GLenum unit);	// GL_TEXTURE0 + i
+		// bind on the active unit
+		static void BindTexture(GLenum target, GLuint texture);
+		static void BindTexture(int unit, GLenum target, GLuint texture);
+		static void BindSampler(GLuint unit, GLuint sampler);
+
+		// GL_FRAMEBUFFER binds both draw and read framebuffers
+		static void BindFramebuffer(GLenum target, GLuint fbo);
+
+		static void OnDeleteTexture(GLuint texture);
+		static void OnDeleteBuffer(GLuint buffer);
+		static void OnDeleteFramebuffer(GLuint fbo);
+		static void OnDeleteVertexArray(GLuint vao);
+		static void OnDeleteProgram(GLuint program);
+
+		struct Statistics
+		{
+			uint32_t	issuedCalls = 0;	// state calls that reached the driver
+			uint32_t	avoidedCalls = 0;	// redundant state calls filtered out
+		};
+
+		// Counters of the last finished frame.
+		static Statistics const & statistics()
+		{
+			return s_lastFrameStatistics;
+		}
+
+		// Call once per frame, before rendering.
+		static void BeginFrame();
+
+	private:
+		static Statistics	s_statistics;
+		static Statistics	s_lastFrameStatistics;
+	};
+}
+
+#endif // GLStateCache_hpp
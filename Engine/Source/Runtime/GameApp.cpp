@@ -10,6 +10,10 @@
 #include "Input.hpp"
 #include "Screen.hpp"
 #include "RenderSystem.hpp"
+#include "ClusteredLighting.hpp"
+#include "GLStateCache.hpp"
+#include "OcclusionCulling.hpp"
+#include "HiZCulling.hpp"
 #include "Scene.hpp"
 #include "Camera.hpp"
 #include "PhysicsSystem.hpp"
@@ -18,6 +22,8 @@
 #include "Material.hpp"
 //#include "ModelImporter.hpp"
 #include "Graphics.hpp"
+#include "JobSystem.hpp"
+#include "GameLoop.hpp"
 
 using namespace std;
 
@@ -81,12 +87,14 @@ int GameApp::Run()
 	Resources::Init();
 	Input::Init();
 	RenderSystem::Init();
+	JobSystem::Init();
 	//WindowSizeCallback(m_window, m_windowWidth, m_windowHeight);
 
 	Init();
 	Scene::Init();
 	PhysicsSystem::Init();
 
+	GameLoop::Reset();
 	Scene::Start();
 	//PhysicsSystem::Start();
 
@@ -107,18 +115,37 @@ int GameApp::Run()
 		float y = static_cast<float>(ypos);
 		Input::UpdateMousePosition(x / m_windowWidth, 1.0f - y / m_windowHeight);
 
-		Scene::Update();
-		PhysicsSystem::FixedUpdate();
+		GameLoop::Tick();
 
 		glViewport(0, 0, Screen::width(), Screen::height());
+		GLStateCache::BeginFrame();
+		GameLoop::BeginRender();
 		RenderSystem::Render();
+		GameLoop::EndRender();
 
 		frames++;
 		if (frames >= report_frames)
 		{
 			float new_time_stamp = static_cast<float>(glfwGetTime());
 			fps = static_cast<int>(report_frames / (new_time_stamp - time_stamp));
-			string title = "FishEngine FPS: " + to_string(fps);
+			auto const & stats = RenderSystem::statistics();
+			auto const & lighting = ClusteredLighting::statistics();
+			auto const & glState = GLStateCache::statistics();
+			auto const & occlusion = OcclusionCulling::statistics();
+			auto const & hiZ = HiZCulling::statistics();
+			auto const & loop = GameLoop::statistics();
+			string title = "FishEngine FPS: " + to_string(fps)
+				+ " (sim " + to_string(loop.simulationTime) + " ms, render " + to_string(loop.renderTime)
+				+ " ms, GPU " + to_string(loop.gpuTime) + " ms, " + to_string(loop.fixedSteps) + " fixed steps)"
+				+ " Tris: " + to_string(stats.triangles) + " (without LOD " + to_string(stats.trianglesWithoutLOD) + ")"
+				+ " Lights: " + to_string(lighting.visibleLights) + "/" + to_string(lighting.lights)
+				+ " (cull " + to_string(lighting.cullTime) + " ms, per cluster avg " + to_string(lighting.averageLightsPerCluster)
+				+ " max " + to_string(lighting.maxLightsPerCluster) + ")"
+				+ " Occlusion culled: " + to_string(occlusion.culled) + "/" + to_string(occlusion.tested)
+				+ " (" + to_string(occlusion.occluders) + " occluders, " + to_string(occlusion.rasterizeTime) + " ms)"
+				+ " GPU occlusion: " + to_string(hiZ.visible) + "/" + to_string(hiZ.candidates) + " visible"
+				+ " RT: " + to_string(stats.renderTargetBytes / (1024 * 1024)) + " MB"
+				+ " GL state calls: " + to_string(glState.issuedCalls) + " (avoided " + to_string(glState.avoidedCalls) + ")";
 			glfwSetWindowTitle(m_window, title.c_str());
 			time_stamp = new_time_stamp;
 			frames = 0;
@@ -128,6 +155,7 @@ int GameApp::Run()
 		glfwSwapBuffers(m_window);
 	}
 
+	JobSystem::Clean();
 	glfwTerminate();
 	return 0;
 }
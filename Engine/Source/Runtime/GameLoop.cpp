@@ -0,0 +1,133 @@
+#include "GameLoop.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+#include "GLEnvironment.hpp"
+#include "Time.hpp"
+#include "Scene.hpp"
+#include "PhysicsSystem.hpp"
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	bool				g_clockStarted = false;
+	Clock::time_point	g_lastTick;
+	Clock::time_point	g_renderStart;
+
+	// GL_TIME_ELAPSED queries of the last frames, the oldest one is read back
+	constexpr int		GPUTimerCount = 4;
+	GLuint				g_gpuTimers[GPUTimerCount] = { 0 };
+	bool				g_gpuTimerIssued[GPUTimerCount] = { false };
+	int					g_gpuTimerIndex = 0;
+
+	float Milliseconds(Clock::duration duration)
+	{
+		return std::chrono::duration<float, std::milli>(duration).count();
+	}
+}
+
+namespace FishEngine
+{
+	int						GameLoop::s_maxFixedSteps = 5;
+	bool					GameLoop::s_interpolation = true;
+	bool					GameLoop::s_pipelined = false;
+	double					GameLoop::s_accumulator = 0;
+	float					GameLoop::s_interpolationFactor = 0;
+	bool					GameLoop::s_physicsStepInFlight = false;
+	GameLoop::Statistics	GameLoop::s_statistics;
+
+	void GameLoop::Reset()
+	{
+		FinishPhysicsStep();
+		g_clockStarted = false;
+		s_accumulator = 0;
+		s_interpolationFactor = 0;
+		Time::m_time = 0;
+	}
+
+	void GameLoop::FinishPhysicsStep()
+	{
+		if (s_physicsStepInFlight)
+		{
+			PhysicsSystem::FetchResults();
+			s_physicsStepInFlight = false;
+		}
+	}
+
+	void GameLoop::Tick()
+	{
+		const auto start = Clock::now();
+		if (!g_clockStarted)
+		{
+			g_lastTick = start;
+			g_clockStarted = true;
+		}
+		const double realDeltaTime = std::chrono::duration<double>(start - g_lastTick).count();
+		g_lastTick = start;
+
+		// the step kicked by the last frame
+		FinishPhysicsStep();
+
+		const double deltaTime = realDeltaTime * Time::m_timeScale;
+		const double fixedDeltaTime = std::max(static_cast<double>(Time::m_fixedDeltaTime), 1e-4);
+		s_accumulator += deltaTime;
+		int steps = static_cast<int>(s_accumulator / fixedDeltaTime);
+		s_accumulator -= steps * fixedDeltaTime;
+		s_statistics.droppedSteps = std::max(steps - s_maxFixedSteps, 0);
+		steps = std::min(steps, s_maxFixedSteps);
+		s_statistics.fixedSteps = steps;
+
+		// Time::deltaTime is fixedDeltaTime in FixedUpdate
+		Time::m_deltaTime = Time::m_fixedDeltaTime;
+		for (int i = 0; i < steps; ++i)
+		{
+			Scene::FixedUpdate();
+			// the last step of a pipelined frame is kicked after Scene::Update: components started by Update add
+			// their actors to the physics scene, which is not allowed during a simulation
+			if (s_pipelined && i == steps - 1)
+				break;
+			PhysicsSystem::Simulate(Time::m_fixedDeltaTime);
+			PhysicsSystem::FetchResults();
+		}
+
+		s_interpolationFactor = static_cast<float>(s_accumulator / fixedDeltaTime);
+		Time::m_deltaTime = static_cast<float>(deltaTime);
+		Time::m_time += static_cast<float>(deltaTime);
+		Scene::Update();
+
+		if (s_pipelined && steps > 0)
+		{
+			PhysicsSystem::Simulate(Time::m_fixedDeltaTime);
+			s_physicsStepInFlight = true;
+		}
+
+		s_statistics.simulationTime = Milliseconds(Clock::now() - start);
+	}
+
+	void GameLoop::BeginRender()
+	{
+		g_renderStart = Clock::now();
+		if (g_gpuTimers[0] == 0)
+			glGenQueries(GPUTimerCount, g_gpuTimers);
+
+		// the query issued GPUTimerCount frames ago is done by now
+		const int index = g_gpuTimerIndex;
+		if (g_gpuTimerIssued[index])
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(g_gpuTimers[index], GL_QUERY_RESULT, &elapsed);
+			s_statistics.gpuTime = static_cast<float>(elapsed / 1e6);
+		}
+		glBeginQuery(GL_TIME_ELAPSED, g_gpuTimers[index]);
+	}
+
+	void GameLoop::EndRender()
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		g_gpuTimerIssued[g_gpuTimerIndex] = true;
+		g_gpuTimerIndex = (g_gpuTimerIndex + 1) % GPUTimerCount;
+		s_statistics.renderTime = Milliseconds(Clock::now() - g_renderStart);
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef GameLoop_hpp
+#define GameLoop_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+
+namespace FishEngine
+{
+	// Frame scheduler of the play mode.
+	// Tick advances the simulation by the real time since the last Tick: the time is accumulated and consumed in
+	// fixed steps of Time::fixedDeltaTime (Script::FixedUpdate then one physics step), at most maxFixedSteps per frame,
+	// then Scene::Update runs once with the variable deltaTime. Rigidbodies are drawn between the poses of the last two
+	// physics steps by interpolationFactor, the time left in the accumulator.
+	// In the pipelined mode the last physics step of a frame is not waited for: it runs on the PhysX threads while the
+	// frame is rendered and is fetched by the next Tick. PhysX buffers the poses read and written during a simulation,
+	// so the frame renders from the poses of the previous step.
+	// BeginRender/EndRender around the rendering of a frame measure its CPU and GPU time.
+	class FE_EXPORT Meta(NonSerializable) GameLoop
+	{
+	public:
+		GameLoop() = delete;
+
+		// Restart the clock and the simulation time, wait for a pipelined physics step. Call when the play mode
+		// starts or stops.
+		static void Reset();
+
+		// Simulate the frame: fixed steps and Scene::Update.
+		static void Tick();
+
+		static void BeginRender();
+		static void EndRender();
+
+		// Fixed steps of a frame, the time beyond them is dropped: the game slows down instead of spiraling when
+		// a step costs more than fixedDeltaTime.
+		static int maxFixedSteps()
+		{
+			return s_maxFixedSteps;
+		}
+
+		static void setMaxFixedSteps(int value)
+		{
+			s_maxFixedSteps = value;
+		}
+
+		static bool interpolation()
+		{
+			return s_interpolation;
+		}
+
+		static void setInterpolation(bool value)
+		{
+			s_interpolation = value;
+		}
+
+		static bool pipelined()
+		{
+			return s_pipelined;
+		}
+
+		static void setPipelined(bool value)
+		{
+			s_pipelined = value;
+		}
+
+		// [0, 1): position of the frame between the last two fixed steps
+		static float interpolationFactor()
+		{
+			return s_interpolationFactor;
+		}
+
+		struct Statistics
+		{
+			// of the last frame, in ms
+			float	simulationTime = 0;
+			float	renderTime = 0;
+			float	gpuTime = 0;		// read back a few frames late to avoid a stall
+			int		fixedSteps = 0;
+			int		droppedSteps = 0;	// beyond maxFixedSteps
+		};
+
+		static Statistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+	private:
+		static void FinishPhysicsStep();
+
+		static int			s_maxFixedSteps;
+		static bool			s_interpolation;
+		static bool			s_pipelined;
+		static double		s_accumulator;		// s
+		static float		s_interpolationFactor;
+		static bool			s_physicsStepInFlight;
+		static Statistics	s_statistics;
+	};
+}
+
+#endif // GameLoop_hpp
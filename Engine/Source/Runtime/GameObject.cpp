@@ -1,6 +1,7 @@
 #include "GameObject.hpp"
 
 #include <deque>
+#include <algorithm>
 
 #include "Scene.hpp"
 #include "Gizmos.hpp"
@@ -11,12 +12,15 @@
 #include "CapsuleCollider.hpp"
 #include "Rigidbody.hpp"
 #include "MeshRenderer.hpp"
+#include "ComponentPool.hpp"
 
 #include "TagManager.hpp"
 #include "generate/Enum_PrimitiveType.hpp"
 
 namespace FishEngine
 {
+	constexpr int GameObject::s_componentSlotClassIDs[];
+
 	bool GameObject::activeInHierarchy() const
 	{
 		if (m_activeSelf && m_transform->parent() != nullptr)
@@ -32,7 +36,7 @@ namespace FishEngine
 	}
 
 	GameObject::GameObject(const std::string& name)
-		: m_transform(std::make_shared<Transform>())
+		: m_transform(AllocateShared<Transform>())
 	{
 		m_name = name;
 	}
@@ -41,11 +45,51 @@ namespace FishEngine
 	GameObject::~GameObject()
 	{
 		//Debug::Log("GameObject::~GameObject: %s", m_name.c_str());
+		for (auto & c : m_components)
+		{
+			ComponentPool::Remove(c.get());
+		}
+	}
+
+	void GameObject::SetActive(bool value)
+	{
+		if (m_activeSelf == value)
+			return;
+		m_activeSelf = value;
+		Scene::NotifyChange(m_transform->gameObject(), SceneChange::Activated);
+	}
+
+	void GameObject::RemoveComponent(ComponentPtr component)
+	{
+		auto it = std::find(m_components.begin(), m_components.end(), component);
+		if (it == m_components.end())
+			return;
+		ComponentPool::Remove(component.get());
+		m_components.erase(it);
+		OnComponentsChanged();
+	}
+
+	void GameObject::OnComponentsChanged()
+	{
+		Assert(m_components.size() < 256);
+		m_componentSlots.fill(0);
+		for (std::size_t i = 0; i < m_components.size(); ++i)
+		{
+			auto const & c = m_components[i];
+			ComponentPool::Add(c.get());
+			const int id = c->ClassID();
+			for (int slot = 0; slot < ComponentSlotCount; ++slot)
+			{
+				if (m_componentSlots[slot] == 0 && IsDerivedFrom(id, s_componentSlotClassIDs[slot]))
+					m_componentSlots[slot] = static_cast<uint8_t>(i + 1);
+			}
+		}
+		m_slottedComponentCount = m_components.size();
 	}
 	
 	GameObjectPtr GameObject::Create()
 	{
-		auto go = std::make_shared<GameObject>();
+		auto go = AllocateShared<GameObject>();
 		go->m_transform->m_gameObject = go;
 		go->m_transform->m_gameObjectStrongRef = go;
 		return go;
@@ -58,7 +102,19 @@ namespace FishEngine
 	
 	void GameObject::setTag(const std::string& tag)
 	{
-		m_tagIndex = TagManager::TagToIndex(tag);
+		const int tagIndex = TagManager::TagToIndex(tag);
+		if (tagIndex == m_tagIndex)
+			return;
+		m_tagIndex = tagIndex;
+		Scene::UpdateIndices(*this);
+	}
+
+	void GameObject::setLayer(int layer)
+	{
+		if (layer == m_layer)
+			return;
+		m_layer = layer;
+		Scene::UpdateIndices(*this);
 	}
 
 	FishEngine::GameObjectPtr GameObject::CreatePrimitive(PrimitiveType type)
@@ -93,8 +149,10 @@ namespace FishEngine
 	{
 		m_transform->Update();
 
-		for (auto& c : m_components)
+		// Start and Update may add components
+		for (std::size_t i = 0; i < m_components.size(); ++i)
 		{
+			auto c = m_components[i];
 			if (!c->m_isStartFunctionCalled)
 			{
 				if (IsScript(c->ClassID()))
@@ -163,6 +221,29 @@ namespace FishEngine
 		return clonedGameObject;
 	}
 
+	GameObjectPtr GameObject::Clone(ClonePlan const & plan, CloneUtility & cloneUtility)
+	{
+		// step 1. the game objects and transforms, parents first
+		auto & cloned = cloneUtility.m_clonedObject;
+		for (auto const & node : plan.nodes)
+		{
+			auto clonedGameObject = MakeShared<GameObject>();
+			cloned.slot(node.slot) = clonedGameObject;
+			cloned.slot(node.slot + 1) = clonedGameObject->m_transform;
+			if (node.parent >= 0)
+			{
+				auto const & parentOfCloned = cloned.slot(plan.nodes[node.parent].slot + 1);
+				clonedGameObject->m_transform->SetParent(std::static_pointer_cast<Transform>(parentOfCloned), false);
+			}
+		}
+
+		// step 2. copy serializable data
+		auto clonedGameObject = std::static_pointer_cast<GameObject>(cloned.slot(plan.nodes[0].slot));
+		this->CopyValueTo(clonedGameObject, cloneUtility);
+		cloned.EndClone();
+		return clonedGameObject;
+	}
+
 	void GameObject::CopyValueTo(GameObjectPtr destGameObject, CloneUtility & cloneUtility)
 	{
 		Object::CopyValueTo(destGameObject, cloneUtility);
@@ -173,6 +254,7 @@ namespace FishEngine
 			destGameObject->AddComponent(clonedComponent);
 		}
 		destGameObject->m_activeSelf = this->m_activeSelf; // bool
+		destGameObject->m_isStatic = this->m_isStatic; // bool
 		destGameObject->m_layer = this->m_layer; // int
 		destGameObject->m_tagIndex = this->m_tagIndex; // int
 		//cloneUtility.Clone(this->m_transform, ptr->m_transform); // TransformPtr
@@ -181,8 +263,9 @@ namespace FishEngine
 
 	void GameObject::Start()
 	{
-		for (auto& c : m_components)
+		for (std::size_t i = 0; i < m_components.size(); ++i)
 		{
+			auto c = m_components[i];
 			if (IsScript(c->ClassID()))
 			{
 				// // TODO:
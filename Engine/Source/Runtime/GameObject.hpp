@@ -9,6 +9,7 @@
 #include "Component_gen.hpp"
 
 #include <memory>
+#include <array>
 #include "PrimitiveType.hpp"
 
 namespace FishEngine
@@ -51,9 +52,17 @@ namespace FishEngine
 			return m_layer;
 		}
 
-		void setLayer(int layer) 
+		void setLayer(int layer);
+
+		// Static game objects are not expected to move: the shadows they cast are cached (see Light).
+		bool isStatic() const
+		{
+			return m_isStatic;
+		}
+
+		void setIsStatic(bool value)
 		{
-			m_layer = layer;
+			m_isStatic = value;
 		}
 
 		// The tag of this game object.
@@ -76,6 +85,12 @@ namespace FishEngine
 		std::shared_ptr<T> GetComponent() const
 		{
 			static_assert(std::is_base_of<Component, T>::value, "Component only");
+			constexpr int slot = ComponentSlot(FishEngine::ClassID<T>());
+			if (slot >= 0 && m_slottedComponentCount == m_components.size())
+			{
+				const int index = m_componentSlots[slot];
+				return index == 0 ? nullptr : std::static_pointer_cast<T>(m_components[index - 1]);
+			}
 			for (auto& comp : m_components)
 			{
 				int id = comp->ClassID();
@@ -144,6 +159,7 @@ namespace FishEngine
 			//}
 			component->m_gameObject = m_transform->gameObject();
 			m_components.push_back(component);
+			OnComponentsChanged();
 			if (IsScript(component->ClassID()))
 			{
 				auto script = std::static_pointer_cast<Script>(component);
@@ -161,22 +177,17 @@ namespace FishEngine
 			{
 				return nullptr;
 			}
-			auto component = std::make_shared<T>();
+			auto component = MakeShared<T>();
 			component->m_gameObject = m_transform->gameObject();
 			m_components.push_back(component);
+			OnComponentsChanged();
 			return component;
 		}
 
-		void RemoveComponent(ComponentPtr component)
-		{
-			m_components.remove(component);
-		}
+		void RemoveComponent(ComponentPtr component);
 
 		// Activates/Deactivates the GameObject (activeSelf).
-		void SetActive(bool value)
-		{
-			m_activeSelf = value;
-		}
+		void SetActive(bool value);
 
 		/************************************************************************/
 		/*                    Static Functions                                  */
@@ -192,7 +203,7 @@ namespace FishEngine
 		//virtual ObjectPtr Clone() const override;
 		//virtual void CopyValueTo(ObjectPtr target) const override;
 		
-		std::list<ComponentPtr> const & Components() const
+		std::vector<ComponentPtr> const & Components() const
 		{
 			return m_components;
 		}
@@ -204,6 +215,8 @@ namespace FishEngine
 		void OnDrawGizmosSelected();
 
 		GameObjectPtr Clone(CloneUtility & cloneUtility);
+		// plan: of this game object, cloneUtility.m_clonedObject is Reset with it
+		GameObjectPtr Clone(ClonePlan const & plan, CloneUtility & cloneUtility);
 		void CopyValueTo(GameObjectPtr target, CloneUtility & cloneUtility);
 
 	private:
@@ -211,14 +224,94 @@ namespace FishEngine
 		friend class Scene;
 		friend class Transform;
 		friend class CloneUtility;
+		friend class SceneSnapshot;
+		friend class ObjectPool;
 		friend class ::UIGameObjectHeader;
 		friend class FishEditor::Inspector;
 		friend class FishEditor::EditorGUI;
 		friend class FishEditor::SceneViewEditor;
 
-		std::list<ComponentPtr> m_components;
+		std::vector<ComponentPtr> m_components;
+
+		// Component classes with a slot in m_componentSlots: GetComponent of them (or of a base class of them) is a
+		// table look up, the others walk m_components.
+		static constexpr int ComponentSlotCount = 20;
+		static constexpr int s_componentSlotClassIDs[ComponentSlotCount] = {
+			FishEngine::ClassID<Behaviour>(),
+			FishEngine::ClassID<Script>(),
+			FishEngine::ClassID<Camera>(),
+			FishEngine::ClassID<Light>(),
+			FishEngine::ClassID<Skybox>(),
+			FishEngine::ClassID<MeshFilter>(),
+			FishEngine::ClassID<Renderer>(),
+			FishEngine::ClassID<MeshRenderer>(),
+			FishEngine::ClassID<SkinnedMeshRenderer>(),
+			FishEngine::ClassID<LODGroup>(),
+			FishEngine::ClassID<Collider>(),
+			FishEngine::ClassID<BoxCollider>(),
+			FishEngine::ClassID<SphereCollider>(),
+			FishEngine::ClassID<CapsuleCollider>(),
+			FishEngine::ClassID<MeshCollider>(),
+			FishEngine::ClassID<Rigidbody>(),
+			FishEngine::ClassID<Animator>(),
+			FishEngine::ClassID<Animation>(),
+			FishEngine::ClassID<AudioSource>(),
+			FishEngine::ClassID<AudioListener>(),
+		};
+
+		static constexpr int ComponentSlot(int classID)
+		{
+			for (int i = 0; i < ComponentSlotCount; ++i)
+			{
+				if (s_componentSlotClassIDs[i] == classID)
+					return i;
+			}
+			return -1;
+		}
+
+		// Update the slots and the ComponentPool after m_components changed.
+		void OnComponentsChanged();
+
+		// by slot: 1 + index in m_components of the first component of that class or of a derived class, 0: none
+		Meta(NonSerializable)
+		std::array<uint8_t, ComponentSlotCount> m_componentSlots{};
+
+		// m_components.size() when m_componentSlots was built, not up to date: GetComponent walks m_components
+		Meta(NonSerializable)
+		std::size_t m_slottedComponentCount = 0;
+
+		// position in Scene::GameObjects(), valid if m_isInScene
+		Meta(NonSerializable)
+		std::list<GameObjectPtr>::iterator m_sceneIterator;
+
+		Meta(NonSerializable)
+		bool			m_isInScene = false;
+
+		// the keys of this game object in the indices of Scene (the name, tag and layer when it was indexed) and its
+		// positions there, valid if m_isInScene
+		Meta(NonSerializable)
+		std::string		m_indexedName;
+
+		Meta(NonSerializable)
+		int				m_indexedTag = 0;
+
+		Meta(NonSerializable)
+		int				m_indexedLayer = 0;
+
+		Meta(NonSerializable)
+		std::array<int, 3> m_indexPositions{};
+
+		// the pool which spawned this game object, Destroy returns it there
+		Meta(NonSerializable)
+		ObjectPool*		m_pool = nullptr;
+
+		// index in the active instances of m_pool, -1 if inactive
+		Meta(NonSerializable)
+		int				m_poolActiveIndex = -1;
 
 		bool			m_activeSelf	= true;
+		Meta(Optional)
+		bool			m_isStatic		= false;
 		int				m_layer			= 0;
 		int				m_tagIndex		= 0;		// index in TagManager
 		TransformPtr	m_transform;
@@ -1,4 +1,8 @@
 #include "Gizmos.hpp"
+
+#include <cstddef>
+#include <mutex>
+
 #include "Shader.hpp"
 #include "Camera.hpp"
 #include "Mesh.hpp"
@@ -6,15 +10,15 @@
 #include "Texture.hpp"
 //#include "ModelImporter.hpp"
 #include "Transform.hpp"
+#include "GLStateCache.hpp"
+#include "ShaderVariables_gen.hpp"
 //#include "TextureImporter.hpp"
 
 using namespace FishEngine;
 
 Color       Gizmos::s_color         = Color::green;
 Matrix4x4   Gizmos::s_matrix        = Matrix4x4::identity;
-SimpleMeshPtr Gizmos::s_circleMesh    = nullptr;
-SimpleMeshPtr Gizmos::s_boxMesh       = nullptr;
-SimpleMeshPtr Gizmos::s_light         = nullptr;
+bool        Gizmos::s_overlay       = false;
 
 
 static TexturePtr cameraGizmoTexture;
@@ -25,6 +29,81 @@ static TexturePtr lightGizmoTexture;
 constexpr int circleVertexCount = 64;
 
 
+/************************************************************************/
+/* recorded gizmos                                                      */
+/************************************************************************/
+
+namespace
+{
+	constexpr int PrimitiveCount = 4;	// Gizmos::Primitive::Count
+
+	struct GizmoVertex
+	{
+		Vector3 position;
+		Color   color;
+	};
+
+	// same layout as the instance attributes of Gizmos.shader
+	struct GizmoInstance
+	{
+		Vector4 rows[3];	// the first 3 rows of an affine matrix
+		Color   color;
+	};
+
+	struct GizmoLayer
+	{
+		std::vector<GizmoVertex>    lines;
+		std::vector<GizmoVertex>    triangles;
+		std::vector<GizmoInstance>  instances[PrimitiveCount];
+
+		bool empty() const
+		{
+			for (auto const & i : instances)
+			{
+				if (!i.empty())
+					return false;
+			}
+			return lines.empty() && triangles.empty();
+		}
+
+		void clear()
+		{
+			lines.clear();
+			triangles.clear();
+			for (auto & i : instances)
+				i.clear();
+		}
+	};
+
+	GizmoLayer  s_layers[2];    // depth tested, overlay
+	std::mutex  s_layersMutex;
+
+	// vertices of the primitives, line lists
+	GLuint      s_primitiveVAO = 0;
+	GLuint      s_primitiveBuffer = 0;
+	GLint       s_primitiveFirst[PrimitiveCount];
+	GLsizei     s_primitiveCount[PrimitiveCount];
+	GLuint      s_instanceBuffer = 0;
+
+	// lines and triangles
+	GLuint      s_vertexVAO = 0;
+	GLuint      s_vertexBuffer = 0;
+
+	constexpr GLuint ColorIndex = 1;
+	constexpr GLuint InstanceRowIndex = 2;	// 3 rows
+
+	void SetupInstanceAttributes(std::size_t firstInstance)
+	{
+		const auto offset = firstInstance * sizeof(GizmoInstance);
+		for (GLuint i = 0; i < 3; ++i)
+		{
+			glVertexAttribPointer(InstanceRowIndex + i, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoInstance), (GLvoid*)(offset + i * sizeof(Vector4)));
+		}
+		glVertexAttribPointer(ColorIndex, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoInstance), (GLvoid*)(offset + offsetof(GizmoInstance, color)));
+	}
+}
+
+
 /************************************************************************/
 /* helper functions                                                     */
 /************************************************************************/
@@ -47,17 +126,40 @@ void Gizmos::Init()
 #endif
 	// circle
 	constexpr float radStep = 2.0f * Mathf::PI / circleVertexCount;
-	float circle_vertex[circleVertexCount*3];
+	Vector3 circle[circleVertexCount];
 	for (int i = 0; i < circleVertexCount; ++i) {
-		const int j = i * 3;
 		const float rad = radStep * i - Mathf::PI/2;
-		circle_vertex[j] = std::cosf(rad);
-		circle_vertex[j+1] = 0.f;
-		circle_vertex[j+2] = std::sinf(rad);
+		circle[i].Set(std::cosf(rad), 0.f, std::sinf(rad));
 	}
-	s_circleMesh = std::make_shared<SimpleMesh>(circle_vertex, circleVertexCount, GL_LINE_LOOP);
-	
-	float box_vertex[] = {
+
+	std::vector<Vector3> vertices;
+	auto begin = [&vertices](Primitive primitive)
+	{
+		s_primitiveFirst[static_cast<int>(primitive)] = static_cast<GLint>(vertices.size());
+	};
+	auto end = [&vertices](Primitive primitive)
+	{
+		const int p = static_cast<int>(primitive);
+		s_primitiveCount[p] = static_cast<GLsizei>(vertices.size()) - s_primitiveFirst[p];
+	};
+
+	// line loop
+	begin(Primitive::Circle);
+	for (int i = 0; i < circleVertexCount; ++i) {
+		vertices.push_back(circle[i]);
+		vertices.push_back(circle[(i + 1) % circleVertexCount]);
+	}
+	end(Primitive::Circle);
+
+	// line strip of the first half
+	begin(Primitive::HalfCircle);
+	for (int i = 0; i < circleVertexCount / 2; ++i) {
+		vertices.push_back(circle[i]);
+		vertices.push_back(circle[i + 1]);
+	}
+	end(Primitive::HalfCircle);
+
+	const float box_vertex[] = {
 		 0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,
 		 0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,
 		 0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,
@@ -74,26 +176,56 @@ void Gizmos::Init()
 		 0.5f, -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,
 		 0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f,
 	};
-	s_boxMesh = std::make_shared<SimpleMesh>(box_vertex, 24, GL_LINES);
-
-	float lightGizmoVertex[circleVertexCount * 3 + 8 * 2 * 3];
-	memcpy(lightGizmoVertex, circle_vertex, circleVertexCount * 3 * sizeof(float));
+	begin(Primitive::Box);
+	for (int i = 0; i < 24; ++i)
+		vertices.emplace_back(box_vertex[i*3], box_vertex[i*3+1], box_vertex[i*3+2]);
+	end(Primitive::Box);
+
+	// the circle points taken as a line list: dashed
+	begin(Primitive::Light);
+	for (int i = 0; i < circleVertexCount; ++i)
+		vertices.push_back(circle[i]);
 	constexpr int   numLines    = 8;
 	constexpr float step        = Mathf::PI * 2.0f / numLines;
 	for (int i = 0; i < numLines; ++i)
 	{
-		int j = circleVertexCount * 3 + i * 2 * 3;
 		const float rad = step * i;
 		float s = std::sinf(rad);
 		float c = std::cosf(rad);
-		lightGizmoVertex[j]     = c;
-		lightGizmoVertex[j + 1] = 0;
-		lightGizmoVertex[j + 2] = s;
-		lightGizmoVertex[j + 3] = c;
-		lightGizmoVertex[j + 4] = 8;
-		lightGizmoVertex[j + 5] = s;
+		vertices.emplace_back(c, 0.f, s);
+		vertices.emplace_back(c, 8.f, s);
 	}
-	s_light = std::make_shared<SimpleMesh>(lightGizmoVertex, circleVertexCount + numLines * 2, GL_LINES);
+	end(Primitive::Light);
+
+	glGenVertexArrays(1, &s_primitiveVAO);
+	glGenBuffers(1, &s_primitiveBuffer);
+	glGenBuffers(1, &s_instanceBuffer);
+	GLStateCache::BindVertexArray(s_primitiveVAO);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_primitiveBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vector3), vertices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(PositionIndex, 3, GL_FLOAT, GL_FALSE, sizeof(Vector3), (GLvoid*)0);
+	glEnableVertexAttribArray(PositionIndex);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_instanceBuffer);
+	SetupInstanceAttributes(0);
+	for (GLuint i = ColorIndex; i < InstanceRowIndex + 3; ++i)
+	{
+		glVertexAttribDivisor(i, 1);
+		glEnableVertexAttribArray(i);
+	}
+
+	glGenVertexArrays(1, &s_vertexVAO);
+	glGenBuffers(1, &s_vertexBuffer);
+	GLStateCache::BindVertexArray(s_vertexVAO);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_vertexBuffer);
+	glVertexAttribPointer(PositionIndex, 3, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), (GLvoid*)offsetof(GizmoVertex, position));
+	glEnableVertexAttribArray(PositionIndex);
+	glVertexAttribPointer(ColorIndex, 4, GL_FLOAT, GL_FALSE, sizeof(GizmoVertex), (GLvoid*)offsetof(GizmoVertex, color));
+	glEnableVertexAttribArray(ColorIndex);
+	// the instance rows are the constant identity, see Flush
+
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
+	GLStateCache::BindVertexArray(0);
+	glCheckError();
 	
 	// wired sphere
 	//constexpr float radStep = 2.0f * Mathf::PI / circleVertexCount;
@@ -112,24 +244,149 @@ void Gizmos::Init()
 }
 
 
-void Gizmos::DrawLine(const Vector3& from, const Vector3& to)
+void Gizmos::Flush()
 {
-	auto shader = Shader::FindBuiltin("SolidColor-Internal");
-	static DynamicMesh lineMesh;
-	float vertices[6];
-	vertices[0] = from.x;
-	vertices[1] = from.y;
-	vertices[2] = from.z;
-	vertices[3] = to.x;
-	vertices[4] = to.y;
-	vertices[5] = to.z;
-	//glLineWidth(50);  // TODO, no effect
-	auto const & view = Camera::main()->worldToCameraMatrix();
-	auto const & proj = Camera::main()->projectionMatrix();
+	std::lock_guard<std::mutex> lock(s_layersMutex);
+	if (s_layers[0].empty() && s_layers[1].empty())
+		return;
+
+	auto camera = Camera::main();
+	static auto shader = Shader::FindBuiltin("Gizmos-Internal");
 	shader->Use();
-	shader->BindUniformMat4("MATRIX_MVP", proj*view*s_matrix);
-	shader->BindUniformVec4("_Color", s_color);
-	lineMesh.Render(vertices, 2, GL_LINES);
+	shader->PreRender();
+	shader->BindUniformMat4("MATRIX_VP", camera->projectionMatrix() * camera->worldToCameraMatrix());
+
+	for (int l = 0; l < 2; ++l)
+	{
+		auto & layer = s_layers[l];
+		if (layer.empty())
+			continue;
+		if (l == 0)
+		{
+			GLStateCache::Enable(GL_DEPTH_TEST);
+			GLStateCache::DepthFunc(GL_LEQUAL);
+		}
+		else
+		{
+			GLStateCache::Disable(GL_DEPTH_TEST);
+		}
+
+		// triangles then lines, in one buffer
+		if (!layer.lines.empty() || !layer.triangles.empty())
+		{
+			const std::size_t triangleBytes = layer.triangles.size() * sizeof(GizmoVertex);
+			const std::size_t lineBytes = layer.lines.size() * sizeof(GizmoVertex);
+			GLStateCache::BindVertexArray(s_vertexVAO);
+			GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_vertexBuffer);
+			glBufferData(GL_ARRAY_BUFFER, triangleBytes + lineBytes, nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, triangleBytes, layer.triangles.data());
+			glBufferSubData(GL_ARRAY_BUFFER, triangleBytes, lineBytes, layer.lines.data());
+			glVertexAttrib4f(InstanceRowIndex + 0, 1, 0, 0, 0);
+			glVertexAttrib4f(InstanceRowIndex + 1, 0, 1, 0, 0);
+			glVertexAttrib4f(InstanceRowIndex + 2, 0, 0, 1, 0);
+			if (!layer.triangles.empty())
+				glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(layer.triangles.size()));
+			if (!layer.lines.empty())
+				glDrawArrays(GL_LINES, static_cast<GLint>(layer.triangles.size()), static_cast<GLsizei>(layer.lines.size()));
+		}
+
+		// one instanced draw per primitive, from one buffer
+		std::size_t instanceCount = 0;
+		for (auto const & instances : layer.instances)
+			instanceCount += instances.size();
+		if (instanceCount > 0)
+		{
+			GLStateCache::BindVertexArray(s_primitiveVAO);
+			GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_instanceBuffer);
+			glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(GizmoInstance), nullptr, GL_STREAM_DRAW);
+			std::size_t first = 0;
+			for (int p = 0; p < PrimitiveCount; ++p)
+			{
+				auto const & instances = layer.instances[p];
+				if (instances.empty())
+					continue;
+				glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(GizmoInstance), instances.size() * sizeof(GizmoInstance), instances.data());
+				// no baseInstance in GL 4.1: point the instance attributes at the first instance instead
+				SetupInstanceAttributes(first);
+				glDrawArraysInstanced(GL_LINES, s_primitiveFirst[p], s_primitiveCount[p], static_cast<GLsizei>(instances.size()));
+				first += instances.size();
+			}
+		}
+
+		layer.clear();
+	}
+
+	shader->PostRender();
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
+	GLStateCache::Enable(GL_DEPTH_TEST);
+	GLStateCache::DepthFunc(GL_LESS);
+	glCheckError();
+}
+
+
+void Gizmos::Clear()
+{
+	std::lock_guard<std::mutex> lock(s_layersMutex);
+	s_layers[0].clear();
+	s_layers[1].clear();
+}
+
+
+void Gizmos::DrawPrimitive(Primitive primitive, const Matrix4x4& matrix)
+{
+	GizmoInstance instance;
+	for (int i = 0; i < 3; ++i)
+		instance.rows[i] = matrix.rows[i];
+	instance.color = s_color;
+	std::lock_guard<std::mutex> lock(s_layersMutex);
+	s_layers[s_overlay ? 1 : 0].instances[static_cast<int>(primitive)].push_back(instance);
+}
+
+
+void Gizmos::DrawLine(const Vector3& from, const Vector3& to)
+{
+	DrawLine(s_matrix.MultiplyPoint(from), s_matrix.MultiplyPoint(to), s_color, s_overlay);
+}
+
+
+void Gizmos::DrawLine(const Vector3& from, const Vector3& to, const Color& color, bool overlay)
+{
+	std::lock_guard<std::mutex> lock(s_layersMutex);
+	auto & lines = s_layers[overlay ? 1 : 0].lines;
+	lines.push_back({ from, color });
+	lines.push_back({ to, color });
+}
+
+
+void Gizmos::DrawTriangle(const Vector3& a, const Vector3& b, const Vector3& c, const Color& color, bool overlay)
+{
+	std::lock_guard<std::mutex> lock(s_layersMutex);
+	auto & triangles = s_layers[overlay ? 1 : 0].triangles;
+	triangles.push_back({ a, color });
+	triangles.push_back({ b, color });
+	triangles.push_back({ c, color });
+}
+
+
+void Gizmos::DrawCube(const Vector3& center, const Vector3& size)
+{
+	Vector3 v[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		Vector3 corner((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+		v[i] = s_matrix.MultiplyPoint(center + Vector3::Scale(corner, size));
+	}
+	// 2 triangles per face
+	const int faces[6][4] = {
+		{ 0, 1, 3, 2 }, { 4, 6, 7, 5 },
+		{ 0, 4, 5, 1 }, { 2, 3, 7, 6 },
+		{ 0, 2, 6, 4 }, { 1, 5, 7, 3 },
+	};
+	for (auto const & f : faces)
+	{
+		DrawTriangle(v[f[0]], v[f[1]], v[f[2]], s_color, s_overlay);
+		DrawTriangle(v[f[0]], v[f[2]], v[f[3]], s_color, s_overlay);
+	}
 }
 
 
@@ -172,12 +429,6 @@ DrawWireSphere(
 	const float         radius)
 {
 	Matrix4x4 m;
-	auto const & view = Camera::main()->worldToCameraMatrix();
-	auto const & proj = Camera::main()->projectionMatrix();
-	auto shader = Shader::FindBuiltin("SolidColor-Internal");
-	shader->Use();
-	shader->BindUniformVec4("_Color", s_color);
-	
 	float euler_angles[] =
 	{
 		0, 0, 90,
@@ -189,8 +440,7 @@ DrawWireSphere(
 	{
 		float* e = euler_angles + i*3;
 		m.SetTRS(center, Quaternion::Euler(Vector3(e)), Vector3::one * radius);
-		shader->BindUniformMat4("MATRIX_MVP", proj*view*s_matrix*m);
-		s_circleMesh->Render();
+		DrawPrimitive(Primitive::Circle, s_matrix*m);
 	}
 }
 
@@ -201,34 +451,18 @@ DrawHalfWireSphere(
 	const float         radius,
 	const Matrix4x4&    modelMatrix)
 {
-	auto shader = Shader::FindBuiltin("SolidColor-Internal");
 	Matrix4x4 m;
-	auto const & v = Camera::main()->worldToCameraMatrix();
-	auto const & p = Camera::main()->projectionMatrix();
-
 	float euler_angles[] = {
 		0, 0, 90,
 		0, 0, 0,
 		0, 90, 90,
 	};
 	
-	shader->Use();
-	shader->BindUniformVec4("_Color", s_color);
 	for (int i = 0; i < 3; ++i)
 	{
 		float* e = euler_angles + i*3;
 		m.SetTRS(center, Quaternion::Euler(Vector3(e)), Vector3::one * radius);
-		shader->BindUniformMat4("MATRIX_MVP", p * v * m * modelMatrix);
-		glBindVertexArray(s_circleMesh->m_VAO);
-		GLsizei count = static_cast<GLsizei>(s_circleMesh->m_positionBuffer.size()/3);
-		if (i == 1) {
-			glDrawArrays(GL_LINE_LOOP, 0, count);
-		} else {
-			count = count/2+1;
-			glDrawArrays(GL_LINE_STRIP, 0, count);
-		}
-		
-		glBindVertexArray(0);
+		DrawPrimitive(i == 1 ? Primitive::Circle : Primitive::HalfCircle, m * modelMatrix);
 	}
 
 }
@@ -239,16 +473,9 @@ DrawWireCube(
 	const Vector3& center,
 	const Vector3& size)
 {
-	auto shader = Shader::FindBuiltin("SolidColor-Internal");
-	shader->Use();
 	Matrix4x4 m;
 	m.SetTRS(center, Quaternion::identity, size);
-	ShaderUniforms uniforms;
-	auto const & v = Camera::main()->worldToCameraMatrix();
-	auto const & p = Camera::main()->projectionMatrix();
-	shader->BindUniformVec4("_Color", s_color);
-	shader->BindUniformMat4("MATRIX_MVP", p * v * s_matrix * m);
-	s_boxMesh->Render();
+	DrawPrimitive(Primitive::Box, s_matrix * m);
 }
 
 
@@ -281,11 +508,6 @@ DrawHalfCircle(
 	const Vector3&  dir1,
 	const Vector3&  dir2)
 {
-	const auto& shader = Shader::FindBuiltin("SolidColor-Internal");
-	shader->Use();
-	auto const & v = Camera::main()->worldToCameraMatrix();
-	auto const & p = Camera::main()->projectionMatrix();
-
 	Vector3 y = Vector3::Normalize(dir1);
 	Vector3 x = Vector3::Normalize(dir2);
 	Vector3 z = Vector3::Normalize(Vector3::Cross(x, y));
@@ -300,13 +522,7 @@ DrawHalfCircle(
 	m.rows[2][3] = center.z;
 	//Matrix4x4 m;
 	//m.SetTRS(center, Quaternion::FromToRotation(Vector3::up, dir1), Vector3(radius, radius, radius));
-	shader->BindUniformMat4("MATRIX_MVP", p * v * m);
-	shader->BindUniformVec4("_Color", s_color);
-	glBindVertexArray(s_circleMesh->m_VAO);
-	GLsizei count = static_cast<GLsizei>(s_circleMesh->m_positionBuffer.size() / 3);
-	count = count / 2 + 1;
-	glDrawArrays(GL_LINE_STRIP, 0, count);
-	glBindVertexArray(0);
+	DrawPrimitive(Primitive::HalfCircle, m);
 }
 
 
@@ -316,15 +532,9 @@ DrawCircle(
 	const float     radius,
 	const Vector3&  direction)
 {
-	const auto& shader = Shader::FindBuiltin("SolidColor-Internal");
-	shader->Use();
-	auto const & v = Camera::main()->worldToCameraMatrix();
-	auto const & p = Camera::main()->projectionMatrix();
 	Matrix4x4 m;
 	m.SetTRS(center, Quaternion::FromToRotation(Vector3::up, direction), Vector3(radius, radius, radius));
-	shader->BindUniformMat4("MATRIX_MVP", p * v * m);
-	shader->BindUniformVec4("_Color", s_color);
-	s_circleMesh->Render();
+	DrawPrimitive(Primitive::Circle, m);
 }
 
 
@@ -333,17 +543,10 @@ DrawLight(
 	const Vector3& center,
 	const Vector3& direction)
 {
-	const auto& shader = Shader::FindBuiltin("SolidColor-Internal");
-	shader->Use();
 	float scale = getScaleForConstantSizeGeometry(center, 0.02f);
 	Matrix4x4 m;
 	m.SetTRS(center, Quaternion::FromToRotation(Vector3::up, direction), Vector3::one*scale);
-	auto const & view = Camera::main()->worldToCameraMatrix();
-	auto const & proj = Camera::main()->projectionMatrix();
-	shader->Use();
-	shader->BindUniformMat4("MATRIX_MVP", proj*view*m);
-	shader->BindUniformVec4("_Color", s_color);
-	s_light->Render();
+	DrawPrimitive(Primitive::Light, m);
 }
 
 
@@ -355,9 +558,7 @@ DrawFrustum(
 	const float     minRange,
 	const float     aspect)
 {
-	static DynamicMesh frustumMesh;
 	constexpr int numLines = 4 * 3;
-	float vertices[numLines * 2 * 3];
 	float rad = Mathf::Radians(fov) * 0.5f;
 	float tan2 = Mathf::Tan(rad);
 	//float tan2 = Mathf::Tan(fov * 0.5f);
@@ -386,22 +587,10 @@ DrawFrustum(
 		0, 4, 1, 5, 2, 6, 3, 7,
 	};
 
-	float *p = vertices;
-	for (int i = 0; i < numLines * 2; ++i)
+	for (int i = 0; i < numLines * 2; i += 2)
 	{
-		auto v3 = v[indices[i]];
-		*p = v3.x; p++;
-		*p = v3.y; p++;
-		*p = v3.z; p++;
+		DrawLine(v[indices[i]], v[indices[i+1]], s_color, s_overlay);
 	}
-
-	auto const & view = Camera::main()->worldToCameraMatrix();
-	auto const & proj = Camera::main()->projectionMatrix();
-	auto shader = Shader::FindBuiltin("SolidColor-Internal");
-	shader->Use();
-	shader->BindUniformMat4("MATRIX_MVP", proj*view);
-	shader->BindUniformVec4("_Color", s_color);
-	frustumMesh.Render(vertices, numLines * 2, GL_LINES);
 }
 
 void Gizmos::DrawFrustum(
@@ -12,6 +12,11 @@
 namespace FishEngine
 {
 	// Gizmos are used to give visual debugging or setup aids in the scene view.
+	// Draw calls only record the gizmos: lines and triangles into per-frame vertex arrays, circles, boxes, etc. as
+	// instances of unit primitives. Flush draws all of them with a few draws at the end of the frame, the depth
+	// tested layer first, then the overlay layer (see setOverlay).
+	// The overloads taking a color record in world space and are thread-safe, e.g. for JobSystem jobs. The others use
+	// color(), the matrix and overlay() and are for the main thread.
 	class FE_EXPORT Meta(NonSerializable) Gizmos
 	{
 	public:
@@ -33,6 +38,18 @@ namespace FishEngine
 		{
 			s_matrix = matrix;
 		}
+
+		// Draw the next gizmos on top of the scene, without depth test.
+		static bool overlay()
+		{
+			return s_overlay;
+		}
+
+		static void
+		setOverlay(bool overlay)
+		{
+			s_overlay = overlay;
+		}
 		
 		static void
 		DrawCube(
@@ -49,6 +66,23 @@ namespace FishEngine
 		DrawLine(
 			const Vector3& from,
 			const Vector3& to);
+
+		// thread-safe, world space
+		static void
+		DrawLine(
+			const Vector3&	from,
+			const Vector3&	to,
+			const Color&	color,
+			bool			overlay = false);
+
+		// thread-safe, world space, both sides
+		static void
+		DrawTriangle(
+			const Vector3&	a,
+			const Vector3&	b,
+			const Vector3&	c,
+			const Color&	color,
+			bool			overlay = false);
 		
 		
 		static void
@@ -116,6 +150,12 @@ namespace FishEngine
 			const float         radius,
 			const float         height);
 
+		// Draw the gizmos recorded since the last Flush with the main camera, in the current render target.
+		static void Flush();
+
+		// Drop the gizmos recorded since the last Flush.
+		static void Clear();
+
 	private:
 		//friend FishEditor::EditorRenderSystem;
 		friend FishEditor::Inspector;
@@ -126,6 +166,17 @@ namespace FishEngine
 			const Vector3& center,
 			const float radius,
 			const Matrix4x4& modelMatrix = Matrix4x4::identity);
+
+		enum class Primitive
+		{
+			Circle,			// radius 1 in the xz plane
+			HalfCircle,		// x >= 0 half of Circle
+			Box,			// size 1, edges
+			Light,			// dashed Circle and 8 rays along +y
+			Count,
+		};
+
+		static void DrawPrimitive(Primitive primitive, const Matrix4x4& matrix);
 		
 		// Sets the color for the gizmos that will be drawn next.
 		static Color        s_color;
@@ -133,12 +184,9 @@ namespace FishEngine
 		// Set the gizmo matrix used to draw all gizmos.
 		static Matrix4x4    s_matrix;
 
+		static bool         s_overlay;
+
 		static void Init();
-		
-		static SimpleMeshPtr s_circleMesh;
-		static SimpleMeshPtr s_boxMesh;
-		static SimpleMeshPtr s_light;
-		//static PSimpleMesh s_wiredSphereMesh;
 	};
 }
 
@@ -6,12 +6,33 @@
 #include "Light.hpp"
 #include "RenderSettings.hpp"
 #include "RenderSystem.hpp"
+#include "MaterialTable.hpp"
+
+namespace
+{
+	using namespace FishEngine;
+
+	void SetAmbientTextures(const MaterialPtr& material)
+	{
+		auto const & shader = material->shader();
+		if (shader->HasUniform("AmbientCubemap"))
+		{
+			//shader->BindTexture("AmbientCubemap", RenderSettings::ambientCubemap());
+			material->SetTexture("AmbientCubemap", RenderSettings::ambientCubemap());
+		}
+		if (shader->HasUniform("PreIntegratedGF"))
+		{
+			//shader->BindTexture("PreIntegratedGF", RenderSettings::preintegratedGF());
+			material->SetTexture("PreIntegratedGF", RenderSettings::preintegratedGF());
+		}
+	}
+}
 
 namespace FishEngine
 {
 	void Graphics::DrawMesh(const MeshPtr& mesh, const Matrix4x4& matrix, const MaterialPtr& material)
 	{
-		Pipeline::UpdatePerDrawUniforms(matrix);
+		Pipeline::UpdatePerDrawUniforms(matrix, 0, MaterialTable::IndexOf(material));
 		DrawMesh(mesh, material);
 	}
 
@@ -42,24 +63,42 @@ namespace FishEngine
 		//}
 		
 		auto shader = material->shader();
-		if (shader->HasUniform("AmbientCubemap"))
-		{
-			//shader->BindTexture("AmbientCubemap", RenderSettings::ambientCubemap());
-			material->SetTexture("AmbientCubemap", RenderSettings::ambientCubemap());
-		}
-		if (shader->HasUniform("PreIntegratedGF"))
-		{
-			//shader->BindTexture("PreIntegratedGF", RenderSettings::preintegratedGF());
-			material->SetTexture("PreIntegratedGF", RenderSettings::preintegratedGF());
-		}
+		SetAmbientTextures(material);
 
-		
-		shader->Use();
+		// textures from the MaterialTable if the per-draw uniforms carry the row of this material
+		int materialIndex = MaterialTable::IndexOf(material);
+		bool useMaterialTable = materialIndex >= 0 && materialIndex == Pipeline::perDrawMaterialIndex();
+		shader->Use(useMaterialTable ? static_cast<ShaderKeywords>(ShaderKeyword::MaterialTable) : 0);
 		shader->PreRender();
 		material->BindProperties();
 		shader->CheckStatus();
 		mesh->Render(subMeshIndex);
 		shader->PostRender();
 	}
-}
 
+	void Graphics::DrawMeshes(int pool, MeshPool::DrawCommand const * commands, std::size_t count, const MaterialPtr& material)
+	{
+		auto shader = material->shader();
+		SetAmbientTextures(material);
+
+		shader->Use(static_cast<ShaderKeywords>(ShaderKeyword::IndirectDraw));
+		shader->PreRender();
+		material->BindProperties();
+		shader->CheckStatus();
+		MeshPool::MultiDraw(pool, commands, count);
+		shader->PostRender();
+	}
+
+	void Graphics::DrawMeshesIndirect(int pool, unsigned int commandBuffer, std::size_t firstCommand, std::size_t count, const MaterialPtr& material)
+	{
+		auto shader = material->shader();
+		SetAmbientTextures(material);
+
+		shader->Use(static_cast<ShaderKeywords>(ShaderKeyword::IndirectDraw));
+		shader->PreRender();
+		material->BindProperties();
+		shader->CheckStatus();
+		MeshPool::MultiDrawIndirect(pool, commandBuffer, firstCommand, count);
+		shader->PostRender();
+	}
+}
@@ -2,6 +2,7 @@
 
 #include "FishEngine.hpp"
 #include "ReflectClass.hpp"
+#include "MeshPool.hpp"
 
 namespace FishEngine
 {
@@ -17,6 +18,13 @@ namespace FishEngine
 		static void DrawMesh(const MeshPtr& mesh, const Matrix4x4& matrix, const MaterialPtr& material);
 		static void DrawMesh(const MeshPtr& mesh, const MaterialPtr& material);
 		static void DrawMesh(const MeshPtr& mesh, const MaterialPtr& material, int subMeshIndex);
+
+		// Draw the commands of a MeshPool::MultiDraw with the ShaderKeyword::IndirectDraw variant of the shader,
+		// the per-draw uniforms of the draw IDs are uploaded with Pipeline::UpdatePerDrawBatch.
+		static void DrawMeshes(int pool, MeshPool::DrawCommand const * commands, std::size_t count, const MaterialPtr& material);
+
+		// DrawMeshes with the commands in a GPU buffer, see MeshPool::MultiDrawIndirect
+		static void DrawMeshesIndirect(int pool, unsigned int commandBuffer, std::size_t firstCommand, std::size_t count, const MaterialPtr& material);
 		static void DrawTexture();
 
 		static void SetRenderTarget(RenderTexturePtr rt);
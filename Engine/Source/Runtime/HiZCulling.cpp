@@ -0,0 +1,235 @@
+#include "HiZCulling.hpp"
+#include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
+#include "RenderBuffer.hpp"
+#include "Debug.hpp"
+#include "Path.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
+namespace FishEngine
+{
+	bool					HiZCulling::s_enabled = true;
+	unsigned int			HiZCulling::s_buildFirstLevelProgram = 0;
+	unsigned int			HiZCulling::s_buildProgram = 0;
+	unsigned int			HiZCulling::s_cullProgram = 0;
+	unsigned int			HiZCulling::s_hiZTexture = 0;
+	int						HiZCulling::s_hiZWidth = 0;
+	int						HiZCulling::s_hiZHeight = 0;
+	int						HiZCulling::s_hiZLevels = 0;
+	Matrix4x4				HiZCulling::s_hiZViewProjection;
+	unsigned int			HiZCulling::s_inputCommandBuffer = 0;
+	unsigned int			HiZCulling::s_outputCommandBuffer = 0;
+	unsigned int			HiZCulling::s_boundsBuffer = 0;
+	unsigned int			HiZCulling::s_visibleCountBuffer = 0;
+	uint32_t				HiZCulling::s_culledCommands = 0;
+	HiZCulling::Statistics	HiZCulling::s_statistics;
+
+#if FISHENGINE_PLATFORM_WINDOWS
+	namespace
+	{
+		// 0 if the kernel does not compile, HiZCulling is then inactive
+		GLuint CreateComputeProgram(std::string const & source, const char * define)
+		{
+			std::string text = std::string("#version 430 core\n#define ") + define + "\n" + source;
+			const GLchar * text_c_str = text.c_str();
+			GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+			glShaderSource(shader, 1, &text_c_str, NULL);
+			glCompileShader(shader);
+			GLint success = GL_FALSE;
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				GLint infoLogLength = 0;
+				glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+				std::vector<char> infoLog(infoLogLength + 1);
+				glGetShaderInfoLog(shader, infoLogLength, NULL, infoLog.data());
+				LogWarning(Format("HiZCulling: %1% does not compile: %2%", define, infoLog.data()));
+				glDeleteShader(shader);
+				return 0;
+			}
+
+			GLuint program = glCreateProgram();
+			glAttachShader(program, shader);
+			glLinkProgram(program);
+			glDetachShader(program, shader);
+			glDeleteShader(shader);
+			glGetProgramiv(program, GL_LINK_STATUS, &success);
+			if (!success)
+			{
+				LogWarning(Format("HiZCulling: %1% does not link", define));
+				glDeleteProgram(program);
+				return 0;
+			}
+			return program;
+		}
+	}
+#endif
+
+	void HiZCulling::Init(std::string const & shaderRootDir)
+	{
+		if (!Supported())
+		{
+			LogInfo("HiZCulling: no compute shaders, occlusion culling on the CPU");
+			return;
+		}
+#if FISHENGINE_PLATFORM_WINDOWS
+		std::ifstream fin((Path(shaderRootDir) / "HiZ.compute").string());
+		if (!fin)
+		{
+			LogWarning("HiZCulling: HiZ.compute not found");
+			return;
+		}
+		std::stringstream buffer;
+		buffer << fin.rdbuf();
+		const std::string source = buffer.str();
+
+		s_buildFirstLevelProgram = CreateComputeProgram(source, "HIZ_BUILD_FIRST_LEVEL");
+		s_buildProgram = CreateComputeProgram(source, "HIZ_BUILD");
+		s_cullProgram = CreateComputeProgram(source, "HIZ_CULL");
+
+		glGenBuffers(1, &s_inputCommandBuffer);
+		glGenBuffers(1, &s_outputCommandBuffer);
+		glGenBuffers(1, &s_boundsBuffer);
+		glGenBuffers(1, &s_visibleCountBuffer);
+		GLStateCache::BindBuffer(GL_ATOMIC_COUNTER_BUFFER, s_visibleCountBuffer);
+		GLuint zero = 0;
+		glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_READ);
+		GLStateCache::BindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+		glCheckError();
+#endif
+	}
+
+	bool HiZCulling::Supported()
+	{
+		// compute shaders, SSBOs and glMultiDrawElementsIndirect: GL 4.3, not on macOS (GL 4.1)
+#if FISHENGINE_PLATFORM_WINDOWS
+		static const bool supported = MeshPool::MultiDrawIndirectSupported() &&
+			(GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_shader_image_load_store));
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	bool HiZCulling::active()
+	{
+		return s_enabled && s_cullProgram != 0 && s_hiZTexture != 0;
+	}
+
+	void HiZCulling::BuildHiZ(DepthBufferPtr const & depth, Matrix4x4 const & viewProjection)
+	{
+		if (!s_enabled || s_buildFirstLevelProgram == 0 || s_buildProgram == 0)
+			return;
+#if FISHENGINE_PLATFORM_WINDOWS
+		const int width = std::max(1, static_cast<int>(depth->width()) / 2);
+		const int height = std::max(1, static_cast<int>(depth->height()) / 2);
+		if (width != s_hiZWidth || height != s_hiZHeight)
+		{
+			if (s_hiZTexture != 0)
+			{
+				GLStateCache::OnDeleteTexture(s_hiZTexture);
+				glDeleteTextures(1, &s_hiZTexture);
+			}
+			s_hiZWidth = width;
+			s_hiZHeight = height;
+			s_hiZLevels = 1;
+			while ((std::max(width, height) >> s_hiZLevels) > 0)
+				s_hiZLevels++;
+			glGenTextures(1, &s_hiZTexture);
+			GLStateCache::BindTexture(GL_TEXTURE_2D, s_hiZTexture);
+			glTexStorage2D(GL_TEXTURE_2D, s_hiZLevels, GL_R32F, width, height);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
+		}
+		s_hiZViewProjection = viewProjection;
+
+		auto dispatch = [](int w, int h) {
+			glDispatchCompute((w + 7) / 8, (h + 7) / 8, 1);
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+		};
+
+		GLStateCache::UseProgram(s_buildFirstLevelProgram);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, depth->GetNativeTexturePtr());
+		glUniform1i(glGetUniformLocation(s_buildFirstLevelProgram, "SourceDepth"), 0);
+		glUniform2i(glGetUniformLocation(s_buildFirstLevelProgram, "SourceSize"), depth->width(), depth->height());
+		glBindImageTexture(1, s_hiZTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glUniform1i(glGetUniformLocation(s_buildFirstLevelProgram, "Destination"), 1);
+		dispatch(width, height);
+
+		GLStateCache::UseProgram(s_buildProgram);
+		glUniform1i(glGetUniformLocation(s_buildProgram, "Source"), 0);
+		glUniform1i(glGetUniformLocation(s_buildProgram, "Destination"), 1);
+		for (int level = 1; level < s_hiZLevels; ++level)
+		{
+			const int sourceWidth = std::max(1, width >> (level - 1));
+			const int sourceHeight = std::max(1, height >> (level - 1));
+			glUniform2i(glGetUniformLocation(s_buildProgram, "SourceSize"), sourceWidth, sourceHeight);
+			glBindImageTexture(0, s_hiZTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+			glBindImageTexture(1, s_hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+			dispatch(std::max(1, width >> level), std::max(1, height >> level));
+		}
+		glCheckError();
+#endif
+	}
+
+	void HiZCulling::Cull(std::vector<Bounds> const & bounds, std::vector<MeshPool::DrawCommand> const & commands)
+	{
+		assert(bounds.size() == commands.size());
+		if (!active())
+			return;
+#if FISHENGINE_PLATFORM_WINDOWS
+		// the count of the previous Cull, its commands were drawn since
+		GLStateCache::BindBuffer(GL_ATOMIC_COUNTER_BUFFER, s_visibleCountBuffer);
+		GLuint visible = 0;
+		glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &visible);
+		s_statistics.visible = visible;
+		s_statistics.candidates = s_culledCommands;
+		s_culledCommands = static_cast<uint32_t>(commands.size());
+		visible = 0;
+		glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &visible);
+		GLStateCache::BindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+		if (commands.empty())
+			return;
+
+		std::vector<Vector4> packedBounds(bounds.size() * 2);
+		for (std::size_t i = 0; i < bounds.size(); ++i)
+		{
+			auto center = bounds[i].center();
+			auto extents = bounds[i].extents();
+			packedBounds[i * 2] = Vector4(center.x, center.y, center.z, 0);
+			packedBounds[i * 2 + 1] = Vector4(extents.x, extents.y, extents.z, 0);
+		}
+
+		const GLsizeiptr commandBytes = commands.size() * sizeof(MeshPool::DrawCommand);
+		GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, s_inputCommandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, commandBytes, commands.data(), GL_STREAM_DRAW);
+		GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, s_outputCommandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, commandBytes, nullptr, GL_STREAM_DRAW);
+		GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, s_boundsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, packedBounds.size() * sizeof(Vector4), packedBounds.data(), GL_STREAM_DRAW);
+		GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		GLStateCache::UseProgram(s_cullProgram);
+		GLStateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, s_inputCommandBuffer);
+		GLStateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, s_outputCommandBuffer);
+		GLStateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, s_boundsBuffer);
+		GLStateCache::BindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, s_visibleCountBuffer);
+		GLStateCache::BindTexture(0, GL_TEXTURE_2D, s_hiZTexture);
+		glUniform1i(glGetUniformLocation(s_cullProgram, "HiZ"), 0);
+		// Matrix4x4 is row major
+		glUniformMatrix4fv(glGetUniformLocation(s_cullProgram, "HiZViewProjection"), 1, GL_TRUE, s_hiZViewProjection.data());
+		glUniform1i(glGetUniformLocation(s_cullProgram, "HiZLevels"), s_hiZLevels);
+		glUniform1ui(glGetUniformLocation(s_cullProgram, "CommandCount"), static_cast<GLuint>(commands.size()));
+		glDispatchCompute(static_cast<GLuint>((commands.size() + 63) / 64), 1, 1);
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+		glCheckError();
+#endif
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef HiZCulling_hpp
+#define HiZCulling_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+#include "Matrix4x4.hpp"
+#include "Bounds.hpp"
+#include "MeshPool.hpp"
+
+#include <vector>
+
+namespace FishEngine
+{
+	// GPU occlusion culling of MeshPool multi-draws against a hierarchical Z buffer.
+	// At the end of a frame BuildHiZ reduces the depth buffer into a max-depth mip chain (compute shader). The next
+	// frame Cull tests the bounds of each draw command against it, reprojected with the view projection of the frame
+	// the pyramid was built from, and writes the commands to commandBuffer() with instanceCount 0 for the hidden
+	// ones, consumed by MeshPool::MultiDrawIndirect without a read back.
+	// Needs compute shaders, SSBOs and glMultiDrawElementsIndirect (GL 4.3), see Supported(). Without them, or before
+	// the first pyramid, active() is false and RenderSystem uses the CPU OcclusionCulling instead.
+	class FE_EXPORT Meta(NonSerializable) HiZCulling
+	{
+	public:
+		HiZCulling() = delete;
+
+		// Load the compute shaders from shaderRootDir (HiZ.compute). Called by Shader::Init.
+		static void Init(std::string const & shaderRootDir);
+
+		static bool Supported();
+
+		static bool enabled()
+		{
+			return s_enabled;
+		}
+
+		static void setEnabled(bool value)
+		{
+			s_enabled = value;
+		}
+
+		// enabled, supported and a pyramid to test against
+		static bool active();
+
+		// Build the pyramid from depth, rendered with viewProjection.
+		static void BuildHiZ(DepthBufferPtr const & depth, Matrix4x4 const & viewProjection);
+
+		// Cull commands (bounds[i]: world space bounds of commands[i]) into commandBuffer(), in the same order.
+		// Call once per frame, before drawing from commandBuffer().
+		static void Cull(std::vector<Bounds> const & bounds, std::vector<MeshPool::DrawCommand> const & commands);
+
+		// GL_DRAW_INDIRECT_BUFFER written by Cull
+		static unsigned int commandBuffer()
+		{
+			return s_outputCommandBuffer;
+		}
+
+		struct Statistics
+		{
+			// of the Cull before the last one, read back one frame late to avoid a stall
+			uint32_t	candidates = 0;
+			uint32_t	visible = 0;
+		};
+
+		static Statistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+	private:
+		static bool				s_enabled;
+		static unsigned int		s_buildFirstLevelProgram;	// depth buffer -> level 0 (half size)
+		static unsigned int		s_buildProgram;				// level i -> level i+1
+		static unsigned int		s_cullProgram;
+		static unsigned int		s_hiZTexture;				// R32F, max depth
+		static int				s_hiZWidth;
+		static int				s_hiZHeight;
+		static int				s_hiZLevels;
+		static Matrix4x4		s_hiZViewProjection;
+		static unsigned int		s_inputCommandBuffer;
+		static unsigned int		s_outputCommandBuffer;
+		static unsigned int		s_boundsBuffer;
+		static unsigned int		s_visibleCountBuffer;		// atomic counter
+		static uint32_t			s_culledCommands;			// by the last Cull
+		static Statistics		s_statistics;
+	};
+}
+
+#endif // HiZCulling_hpp
@@ -0,0 +1,419 @@
+#include "JobSystem.hpp"
+
+#include <deque>
+#include <string>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <condition_variable>
+
+#include "Debug.hpp"
+
+namespace
+{
+	struct JobEntry
+	{
+		FishEngine::JobSystem::Job	job;
+		FishEngine::JobHandle		counter;
+		const char*					tag = nullptr;
+	};
+
+	// Owner pushes and pops at the back, thieves steal from the front.
+	// A lock per deque: jobs are coarse enough for the lock not to matter, see the JobSystemBenchmark test.
+	struct WorkQueue
+	{
+		std::mutex				mutex;
+		std::deque<JobEntry>	jobs;
+	};
+
+	// 0: main thread, 1...: workers
+	std::vector<std::unique_ptr<WorkQueue>>	s_queues;
+	std::vector<std::thread>		s_workers;
+	std::atomic<int>				s_queuedJobs{0};		// in s_queues
+	std::atomic<unsigned>			s_nextQueue{0};			// for threads without a queue
+	std::mutex						s_sleepMutex;
+	std::condition_variable			s_sleepCondition;
+	bool							s_quit = false;
+
+	// queue of the calling thread, -1 for threads not owned by the JobSystem
+	thread_local int				t_queueIndex = -1;
+
+	std::deque<JobEntry>			s_mainThreadJobs;
+	std::mutex						s_mainThreadJobsMutex;
+
+	std::thread::id					s_mainThreadID;
+
+	std::mutex						s_profileMutex;
+	std::map<std::string, FishEngine::JobSystem::TagProfile>	s_profile;	// the same literal may have several addresses
+
+	void Submit(JobEntry entry);
+
+	void Finish(FishEngine::JobHandle const & counter)
+	{
+		if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+		std::vector<std::function<void()>> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter->m_continuationsMutex);
+			continuations.swap(counter->m_continuations);
+		}
+		for (auto & c : continuations)
+		{
+			c();
+		}
+	}
+
+	void Execute(JobEntry & entry)
+	{
+		if (entry.tag != nullptr && FishEngine::JobSystem::profiling())
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			entry.job();
+			auto time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			std::lock_guard<std::mutex> lock(s_profileMutex);
+			auto & p = s_profile[entry.tag];
+			p.tag = entry.tag;
+			p.jobs++;
+			p.totalTime += time;
+			p.maxTime = std::max(p.maxTime, time);
+		}
+		else
+		{
+			entry.job();
+		}
+		if (entry.counter != nullptr)
+		{
+			Finish(entry.counter);
+		}
+	}
+
+	void Submit(JobEntry entry)
+	{
+		int index = t_queueIndex;
+		if (index < 0)
+			index = static_cast<int>(s_nextQueue.fetch_add(1, std::memory_order_relaxed) % s_queues.size());
+		auto & queue = *s_queues[index];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(entry));
+		}
+		s_queuedJobs.fetch_add(1, std::memory_order_release);
+		// a worker checking s_queuedJobs before going to sleep holds s_sleepMutex, wait for it to sleep
+		{
+			std::lock_guard<std::mutex> lock(s_sleepMutex);
+		}
+		s_sleepCondition.notify_one();
+	}
+
+	bool TryPopOwn(JobEntry & entry)
+	{
+		if (t_queueIndex < 0)
+			return false;
+		auto & queue = *s_queues[t_queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			return false;
+		entry = std::move(queue.jobs.back());
+		queue.jobs.pop_back();
+		s_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool TrySteal(JobEntry & entry)
+	{
+		const int count = static_cast<int>(s_queues.size());
+		const int first = t_queueIndex < 0 ? 0 : t_queueIndex + 1;
+		for (int i = 0; i < count; ++i)
+		{
+			const int index = (first + i) % count;
+			if (index == t_queueIndex)
+				continue;
+			auto & queue = *s_queues[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.jobs.empty())
+				continue;
+			entry = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			s_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	bool TryPop(JobEntry & entry)
+	{
+		return TryPopOwn(entry) || TrySteal(entry);
+	}
+
+	bool TryPopMainThreadJob(JobEntry & entry)
+	{
+		std::lock_guard<std::mutex> lock(s_mainThreadJobsMutex);
+		if (s_mainThreadJobs.empty())
+			return false;
+		entry = std::move(s_mainThreadJobs.front());
+		s_mainThreadJobs.pop_front();
+		return true;
+	}
+
+	bool OwnQueueEmpty()
+	{
+		if (t_queueIndex < 0)
+			return true;
+		auto & queue = *s_queues[t_queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		return queue.jobs.empty();
+	}
+
+	void WorkerMain(int queueIndex)
+	{
+		t_queueIndex = queueIndex;
+		while (true)
+		{
+			JobEntry entry;
+			if (TryPop(entry))
+			{
+				Execute(entry);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(s_sleepMutex);
+			s_sleepCondition.wait(lock, []{ return s_quit || s_queuedJobs.load(std::memory_order_acquire) > 0; });
+			if (s_quit && s_queuedJobs.load(std::memory_order_acquire) == 0)
+				return;
+		}
+	}
+
+	// Lazy binary splitting: iterations are run grainSize at a time and the rest of the range is split in half
+	// whenever the half pushed before has been stolen, so the chunks follow the number of idle workers.
+	void RunRange(std::size_t first, std::size_t last, std::size_t grainSize, std::function<void(std::size_t)> const & func,
+		FishEngine::JobHandle const & counter, const char* tag)
+	{
+		while (first < last)
+		{
+			if (last - first > 2 * grainSize && OwnQueueEmpty())
+			{
+				const std::size_t middle = first + (last - first) / 2;
+				FishEngine::JobSystem::Schedule([middle, last, grainSize, &func, counter, tag]()
+				{
+					RunRange(middle, last, grainSize, func, counter, tag);
+				}, counter, tag);
+				last = middle;
+				continue;
+			}
+			const std::size_t stop = std::min(last, first + grainSize);
+			for (auto i = first; i < stop; ++i)
+				func(i);
+			first = stop;
+		}
+	}
+}
+
+namespace FishEngine
+{
+	bool JobSystem::s_initialized = false;
+	bool JobSystem::s_profiling = false;
+
+	void JobSystem::Init(int workerCount)
+	{
+		if (s_initialized)
+			return;
+		s_mainThreadID = std::this_thread::get_id();
+		if (workerCount <= 0)
+		{
+			workerCount = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+			if (workerCount < 1)
+				workerCount = 1;
+		}
+		s_quit = false;
+		s_queuedJobs = 0;
+		for (int i = 0; i <= workerCount; ++i)
+		{
+			s_queues.emplace_back(new WorkQueue);
+		}
+		t_queueIndex = 0;
+		for (int i = 0; i < workerCount; ++i)
+		{
+			s_workers.emplace_back(WorkerMain, i + 1);
+		}
+		s_initialized = true;
+		LogInfo(Format("JobSystem: %1% worker threads", workerCount));
+	}
+
+	void JobSystem::Clean()
+	{
+		if (!s_initialized)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(s_sleepMutex);
+			s_quit = true;
+		}
+		s_sleepCondition.notify_all();
+		for (auto & t : s_workers)
+		{
+			t.join();
+		}
+		s_workers.clear();
+		s_queues.clear();
+		t_queueIndex = -1;
+		s_initialized = false;
+	}
+
+	int JobSystem::workerCount()
+	{
+		return static_cast<int>(s_workers.size());
+	}
+
+	bool JobSystem::IsMainThread()
+	{
+		// before Init, the only thread that can touch the engine is the main thread
+		return !s_initialized || std::this_thread::get_id() == s_mainThreadID;
+	}
+
+	JobHandle JobSystem::Schedule(Job job, JobHandle counter, const char* tag)
+	{
+		if (counter == nullptr)
+		{
+			counter = std::make_shared<JobCounter>();
+		}
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+		JobEntry entry{ std::move(job), counter, tag };
+		if (!s_initialized)
+		{
+			Execute(entry);
+			return counter;
+		}
+		Submit(std::move(entry));
+		return counter;
+	}
+
+	JobHandle JobSystem::ScheduleAfter(JobHandle const & dependency, Job job, JobHandle counter, const char* tag)
+	{
+		if (counter == nullptr)
+		{
+			counter = std::make_shared<JobCounter>();
+		}
+		if (dependency == nullptr || !s_initialized)
+		{
+			Wait(dependency);
+			return Schedule(std::move(job), counter, tag);
+		}
+
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+		auto entry = std::make_shared<JobEntry>(JobEntry{ std::move(job), counter, tag });
+		std::function<void()> submit = [entry]()
+		{
+			Submit(std::move(*entry));
+		};
+		{
+			// Finish takes the continuations under this lock after the counter reached zero
+			std::lock_guard<std::mutex> lock(dependency->m_continuationsMutex);
+			if (!dependency->IsDone())
+			{
+				dependency->m_continuations.push_back(std::move(submit));
+				return counter;
+			}
+		}
+		submit();
+		return counter;
+	}
+
+	JobHandle JobSystem::ScheduleOnMainThread(Job job, JobHandle counter, const char* tag)
+	{
+		if (counter == nullptr)
+		{
+			counter = std::make_shared<JobCounter>();
+		}
+		counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+		std::lock_guard<std::mutex> lock(s_mainThreadJobsMutex);
+		s_mainThreadJobs.push_back(JobEntry{ std::move(job), counter, tag });
+		return counter;
+	}
+
+	void JobSystem::Wait(JobHandle const & counter)
+	{
+		if (counter == nullptr)
+			return;
+		const bool mainThread = IsMainThread();
+		while (!counter->IsDone())
+		{
+			JobEntry entry;
+			if (TryPop(entry) || (mainThread && TryPopMainThreadJob(entry)))
+			{
+				Execute(entry);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::ParallelFor(std::size_t begin, std::size_t end, std::function<void(std::size_t)> const & func, int grainSize, const char* tag)
+	{
+		if (begin >= end)
+			return;
+		const std::size_t count = end - begin;
+		if (grainSize <= 0)
+		{
+			const std::size_t chunks = (s_workers.size() + 1) * 16;
+			grainSize = static_cast<int>( std::max<std::size_t>(1, count / chunks) );
+		}
+
+		if (!s_initialized || count <= static_cast<std::size_t>(grainSize))
+		{
+			for (auto i = begin; i < end; ++i)
+				func(i);
+			return;
+		}
+
+		auto counter = std::make_shared<JobCounter>();
+		Schedule([begin, end, grainSize, &func, counter, tag]()
+		{
+			RunRange(begin, end, static_cast<std::size_t>(grainSize), func, counter, tag);
+		}, counter, tag);
+		Wait(counter);
+	}
+
+	void JobSystem::RunOnMainThread(Job job)
+	{
+		std::lock_guard<std::mutex> lock(s_mainThreadJobsMutex);
+		s_mainThreadJobs.push_back(JobEntry{ std::move(job), nullptr, nullptr });
+	}
+
+	int JobSystem::ExecuteMainThreadJobs(int maxJobs)
+	{
+		Assert(IsMainThread());
+		int executed = 0;
+		while (maxJobs < 0 || executed < maxJobs)
+		{
+			JobEntry entry;
+			if (!TryPopMainThreadJob(entry))
+				break;
+			Execute(entry);
+			executed++;
+		}
+		return executed;
+	}
+
+	std::vector<JobSystem::TagProfile> JobSystem::profile()
+	{
+		std::vector<TagProfile> result;
+		std::lock_guard<std::mutex> lock(s_profileMutex);
+		for (auto const & p : s_profile)
+		{
+			result.push_back(p.second);
+		}
+		std::sort(result.begin(), result.end(), [](TagProfile const & a, TagProfile const & b) {
+			return a.totalTime > b.totalTime;
+		});
+		return result;
+	}
+
+	void JobSystem::ResetProfile()
+	{
+		std::lock_guard<std::mutex> lock(s_profileMutex);
+		s_profile.clear();
+	}
+}
@@ -0,0 +1,108 @@
+#ifndef JobSystem_hpp
+#define JobSystem_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace FishEngine
+{
+	// Counter shared by a group of jobs. The group is finished when the counter reaches zero.
+	struct JobCounter
+	{
+		std::atomic<int> m_pending{0};
+
+		bool IsDone() const
+		{
+			return m_pending.load(std::memory_order_acquire) == 0;
+		}
+
+		// jobs scheduled with JobSystem::ScheduleAfter this counter, submitted when it reaches zero
+		std::mutex m_continuationsMutex;
+		std::vector<std::function<void()>> m_continuations;
+	};
+
+	typedef std::shared_ptr<JobCounter> JobHandle;
+
+	// The worker pool for CPU-bound work of the engine (culling, animation, per-draw constants, asset import, etc.).
+	// Every worker owns a deque: jobs scheduled by a worker go to its own deque and are popped LIFO, idle workers
+	// steal the oldest jobs of the others. The main thread owns a deque too, worked through while it Waits.
+	// GL and Qt calls are NOT allowed on workers, use ScheduleOnMainThread or RunOnMainThread instead.
+	class FE_EXPORT Meta(NonSerializable) JobSystem
+	{
+	public:
+		JobSystem() = delete;
+
+		typedef std::function<void()> Job;
+
+		// workerCount <= 0: one worker per hardware thread, minus the main thread.
+		// must be called from the main thread.
+		static void Init(int workerCount = 0);
+		static void Clean();
+
+		static bool initialized() { return s_initialized; }
+
+		static int workerCount();
+
+		static bool IsMainThread();
+
+		// Run job on a worker. counter (may be null) is incremented now and decremented when the job is finished.
+		// tag (a string literal, may be null) names the job in the profile.
+		static JobHandle Schedule(Job job, JobHandle counter = nullptr, const char* tag = nullptr);
+
+		// Schedule job once dependency reaches zero. counter is incremented now, so waiting on it waits for the
+		// dependency too.
+		static JobHandle ScheduleAfter(JobHandle const & dependency, Job job, JobHandle counter = nullptr, const char* tag = nullptr);
+
+		// Run job on the main thread, by ExecuteMainThreadJobs or by a Wait of the main thread.
+		static JobHandle ScheduleOnMainThread(Job job, JobHandle counter = nullptr, const char* tag = nullptr);
+
+		// Block until the counter reaches zero. The calling thread executes pending jobs while waiting.
+		static void Wait(JobHandle const & counter);
+
+		// Call func(i) for every i in [begin, end). Blocks until all iterations are done.
+		// The range is split in halves while other workers are idle to steal them, down to grainSize iterations
+		// (grainSize <= 0: a fraction of the range per worker).
+		static void ParallelFor(std::size_t begin, std::size_t end, std::function<void(std::size_t)> const & func, int grainSize = 0, const char* tag = nullptr);
+
+		// Queue job to be executed by ExecuteMainThreadJobs. Can be called from any thread.
+		static void RunOnMainThread(Job job);
+
+		// Execute at most maxJobs (all if maxJobs < 0) jobs queued by RunOnMainThread and ScheduleOnMainThread.
+		// Returns the number of executed jobs.
+		static int ExecuteMainThreadJobs(int maxJobs = -1);
+
+		// Record the time of the tagged jobs, off by default.
+		static bool profiling()
+		{
+			return s_profiling;
+		}
+
+		static void setProfiling(bool value)
+		{
+			s_profiling = value;
+		}
+
+		struct TagProfile
+		{
+			const char*	tag;
+			int			jobs = 0;
+			float		totalTime = 0;	// ms, summed over all threads
+			float		maxTime = 0;	// ms, of one job
+		};
+
+		// since the last ResetProfile, by tag
+		static std::vector<TagProfile> profile();
+		static void ResetProfile();
+
+	private:
+		static bool s_initialized;
+		static bool s_profiling;
+	};
+}
+
+#endif // JobSystem_hpp
@@ -0,0 +1,95 @@
+#include "LODGroup.hpp"
+#include "Camera.hpp"
+#include "Transform.hpp"
+#include "Bounds.hpp"
+#include "Time.hpp"
+#include "Debug.hpp"
+
+namespace FishEngine
+{
+	float LODGroup::s_crossFadeAnimationDuration = 0.5f;
+
+	void LODGroup::SetLODs(std::vector<MeshPtr> const & meshes, std::vector<float> const & screenRelativeTransitionHeights)
+	{
+		if (meshes.size() != screenRelativeTransitionHeights.size())
+		{
+			LogWarning("LODGroup::SetLODs: one transition height per mesh expected");
+			return;
+		}
+		m_meshes = meshes;
+		m_screenRelativeTransitionHeights = screenRelativeTransitionHeights;
+		m_selected = false;
+		m_currentLOD = -1;
+		m_fadingLOD = -1;
+	}
+
+	float LODGroup::ScreenRelativeHeight(CameraPtr const & camera, Bounds const & worldBounds)
+	{
+		auto size = worldBounds.size();
+		const float height = Mathf::Max(size.x, Mathf::Max(size.y, size.z));
+		if (camera->orghographic())
+		{
+			return height / (2.0f * camera->orthographicSize());
+		}
+		const float distance = Vector3::Distance(camera->transform()->position(), worldBounds.center());
+		const float halfFov = camera->fieldOfView() * 0.5f * Mathf::Deg2Rad;
+		if (distance <= 0)
+			return Mathf::Infinity;
+		return height / (2.0f * distance * Mathf::Tan(halfFov));
+	}
+
+	int LODGroup::LODForScreenRelativeHeight(float height) const
+	{
+		for (int i = 0; i < lodCount(); ++i)
+		{
+			if (height >= m_screenRelativeTransitionHeights[i])
+				return i;
+		}
+		return -1;
+	}
+
+	bool LODGroup::SelectLOD(CameraPtr const & camera, Bounds const & worldBounds)
+	{
+		const int lod = LODForScreenRelativeHeight(ScreenRelativeHeight(camera, worldBounds));
+		const float now = Time::time();
+
+		if (!m_selected)
+		{
+			m_selected = true;
+			m_currentLOD = lod;
+		}
+		else if (lod != m_currentLOD)
+		{
+			if (!m_animateCrossFading)
+			{
+				m_fadingLOD = -1;
+			}
+			else if (lod == m_fadingLOD)
+			{
+				// switched back in the middle of a fade: reverse it
+				const float elapsed = now - m_fadeStartTime;
+				m_fadingLOD = m_currentLOD;
+				m_fadeStartTime = now - Mathf::Max(0.0f, s_crossFadeAnimationDuration - elapsed);
+			}
+			else
+			{
+				m_fadingLOD = m_currentLOD;
+				m_fadeStartTime = now;
+			}
+			m_currentLOD = lod;
+		}
+
+		if (m_fadingLOD >= 0 && now - m_fadeStartTime >= s_crossFadeAnimationDuration)
+		{
+			m_fadingLOD = -1;
+		}
+		return m_currentLOD >= 0 || m_fadingLOD >= 0;
+	}
+
+	float LODGroup::crossFade() const
+	{
+		if (m_fadingLOD < 0 || s_crossFadeAnimationDuration <= 0)
+			return 1.0f;
+		return Mathf::Clamp01((Time::time() - m_fadeStartTime) / s_crossFadeAnimationDuration);
+	}
+}
@@ -0,0 +1,112 @@
+#ifndef LODGroup_hpp
+#define LODGroup_hpp
+
+#include "Component.hpp"
+
+namespace FishEngine
+{
+	// Switches the mesh of the MeshFilter on the same GameObject between levels of detail,
+	// based on the height of the object on screen.
+	class FE_EXPORT Meta(DisallowMultipleComponent) LODGroup : public Component
+	{
+	public:
+		DefineComponent(LODGroup);
+
+		LODGroup() = default;
+
+		// meshes[0] is the most detailed level. LOD i is used while the height of the object on screen,
+		// relative to the screen height, is at least screenRelativeTransitionHeights[i] (descending).
+		// Below the last height the object is culled, a last height of 0 never culls.
+		void SetLODs(std::vector<MeshPtr> const & meshes, std::vector<float> const & screenRelativeTransitionHeights);
+
+		int lodCount() const
+		{
+			return static_cast<int>(m_meshes.size());
+		}
+
+		MeshPtr const & lodMesh(int lod) const
+		{
+			return m_meshes[lod];
+		}
+
+		float screenRelativeTransitionHeight(int lod) const
+		{
+			return m_screenRelativeTransitionHeights[lod];
+		}
+
+		// Cross-fade (dithered) from the previous LOD instead of switching instantly.
+		bool animateCrossFading() const
+		{
+			return m_animateCrossFading;
+		}
+
+		void setAnimateCrossFading(bool value)
+		{
+			m_animateCrossFading = value;
+		}
+
+		// Duration of a cross-fade in seconds.
+		static float crossFadeAnimationDuration()
+		{
+			return s_crossFadeAnimationDuration;
+		}
+
+		static void setCrossFadeAnimationDuration(float value)
+		{
+			s_crossFadeAnimationDuration = value;
+		}
+
+		// Select the LOD for camera, worldBounds are the bounds of the renderer.
+		// Returns false if nothing is to be drawn (culled and not fading out).
+		bool SelectLOD(CameraPtr const & camera, Bounds const & worldBounds);
+
+		// The LOD chosen by the last SelectLOD, -1 if culled.
+		int currentLOD() const
+		{
+			return m_currentLOD;
+		}
+
+		// Mesh of currentLOD(), nullptr if culled.
+		MeshPtr currentMesh() const
+		{
+			return m_currentLOD < 0 ? nullptr : m_meshes[m_currentLOD];
+		}
+
+		// Mesh of the LOD being faded out, nullptr if not fading.
+		MeshPtr fadingMesh() const
+		{
+			return m_fadingLOD < 0 ? nullptr : m_meshes[m_fadingLOD];
+		}
+
+		// Progress of the cross-fade in (0, 1], 1 if not fading.
+		float crossFade() const;
+
+		// Relative height of worldBounds on the screen of camera.
+		static float ScreenRelativeHeight(CameraPtr const & camera, Bounds const & worldBounds);
+
+	private:
+		friend class FishEditor::Inspector;
+
+		int LODForScreenRelativeHeight(float height) const;
+
+		std::vector<MeshPtr>	m_meshes;
+		std::vector<float>		m_screenRelativeTransitionHeights;
+		bool					m_animateCrossFading = false;
+
+		Meta(NonSerializable)
+		bool					m_selected = false;
+
+		Meta(NonSerializable)
+		int						m_currentLOD = -1;
+
+		Meta(NonSerializable)
+		int						m_fadingLOD = -1;
+
+		Meta(NonSerializable)
+		float					m_fadeStartTime = 0;
+
+		static float			s_crossFadeAnimationDuration;
+	};
+}
+
+#endif // LODGroup_hpp
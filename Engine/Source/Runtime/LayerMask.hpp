@@ -25,7 +25,7 @@ namespace FishEngine
 				{
 					if (s_layerNames[i] == name)
 					{
-						result |= i;
+						result |= (1 << i);
 						break;
 					}
 				}
@@ -34,6 +34,11 @@ namespace FishEngine
 			if (light != nullptr)
 			{
 				light->m_shadowMap->Resize(shadow_map_size, shadow_map_size);
+				if (light->m_staticShadowMap != nullptr)
+				{
+					light->m_staticShadowMap->Resize(shadow_map_size, shadow_map_size);
+					light->InvalidateStaticShadowMap();
+				}
 			}
 		}
 	}
@@ -43,14 +48,34 @@ namespace FishEngine
 		auto shadow_map_size = QualitySettings::CalculateShadowMapSize();
 		//constexpr uint32_t shadow_map_size = 2048;
 
-		m_renderTarget = std::make_shared<RenderTarget>();
-		//m_renderTarget->Set(m_shadowMap, m_depthBuffer);
-
 		m_shadowMap = LayeredDepthBuffer::Create(shadow_map_size, shadow_map_size, 4, false);
 		//m_tempColorBuffer = LayeredColorBuffer::Create(shadow_map_size, shadow_map_size, 4, TextureFormat::R32);
 		m_shadowMap->setFilterMode(FilterMode::Bilinear);
 		m_shadowMap->setWrapMode(TextureWrapMode::Clamp);
-		m_renderTarget->SetDepthBufferOnly(m_shadowMap);
+		for (int i = 0; i < 4; ++i)
+		{
+			m_cascadeRenderTargets[i] = std::make_shared<RenderTarget>();
+			m_cascadeRenderTargets[i]->SetDepthBufferLayer(m_shadowMap, i);
+		}
+	}
+
+	void Light::CreateStaticShadowMap()
+	{
+		if (m_staticShadowMap != nullptr)
+			return;
+		m_staticShadowMap = LayeredDepthBuffer::Create(m_shadowMap->width(), m_shadowMap->height(), 4, false);
+		for (int i = 0; i < 4; ++i)
+		{
+			m_staticCascadeRenderTargets[i] = std::make_shared<RenderTarget>();
+			m_staticCascadeRenderTargets[i]->SetDepthBufferLayer(m_staticShadowMap, i);
+		}
+		InvalidateStaticShadowMap();
+	}
+
+	void Light::InvalidateStaticShadowMap()
+	{
+		for (auto & key : m_staticShadowMapKeys)
+			key = 0;
 	}
 
 	LightPtr Light::Create()
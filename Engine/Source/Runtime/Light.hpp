@@ -67,7 +67,13 @@ namespace FishEngine
 
 		static void ResizeShadowMaps();
 
+		// Redraw the static shadow casters next frame. Moving, adding or removing a static caster is detected
+		// already, call this for changes that are not (e.g. a new mesh with the same address).
+		void InvalidateStaticShadowMap();
+
 	private:
+		void CreateStaticShadowMap();
+
 		friend class Scene;
 		//friend class FishEditor::EditorRenderSystem;
 		friend class RenderSystem;
@@ -76,6 +82,7 @@ namespace FishEngine
 		friend class SkinnedMeshRenderer;
 		friend class Graphics;
 		friend class Pipeline;
+		friend class ClusteredLighting;
 
 		// The current type of light. Possible values are Directional, Point, Spot and Area
 		LightType m_type = LightType::Directional;
@@ -100,8 +107,20 @@ namespace FishEngine
 		Meta(NonSerializable)
 		LayeredDepthBufferPtr m_shadowMap;
 
+		// one render target per cascade (layer of m_shadowMap)
+		Meta(NonSerializable)
+		RenderTargetPtr m_cascadeRenderTargets[4];
+
+		// Depth of the static shadow casters only, copied into m_shadowMap before the dynamic casters are drawn.
+		// Created with the first static caster, a cascade is redrawn when its key changes (see Scene::RenderShadow).
+		Meta(NonSerializable)
+		LayeredDepthBufferPtr m_staticShadowMap;
+
+		Meta(NonSerializable)
+		RenderTargetPtr m_staticCascadeRenderTargets[4];
+
 		Meta(NonSerializable)
-		RenderTargetPtr m_renderTarget;
+		std::size_t m_staticShadowMapKeys[4] = { 0, 0, 0, 0 };
 
 		Meta(NonSerializable)
 		Matrix4x4 m_viewMatrixForShadowMap[4];
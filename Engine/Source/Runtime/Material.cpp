@@ -71,6 +71,7 @@ namespace FishEngine
 	void Material::setShader(const ShaderPtr& shader)
 	{
 		m_shader = shader;
+		m_textureVersion++;
 		m_uniforms.floats.clear();
 		m_uniforms.vec2s.clear();
 		m_uniforms.vec3s.clear();
@@ -78,7 +79,7 @@ namespace FishEngine
 		m_uniforms.mat4s.clear();
 		m_savedProperties = shader->m_savedProperties;
 		m_properties.clear();
-		for (auto& u : m_shader->uniforms())
+		for (auto& u : m_shader->propertyUniforms())
 		{
 			if (u.type == GL_FLOAT)
 			{
@@ -214,7 +215,12 @@ namespace FishEngine
 //			}
 //		}
 //		Debug::LogWarning("Uniform %s[texture] not found.", name.c_str());
-		m_textures[name] = texture;
+		auto & t = m_textures[name];
+		if (t != texture)
+		{
+			t = texture;
+			m_textureVersion++;
+		}
 	}
 
 
@@ -256,7 +262,7 @@ namespace FishEngine
 	{
 		for (auto& pair : textures)
 		{
-			m_textures[pair.first] = pair.second;
+			SetTexture(pair.first, pair.second);
 		}
 	}
 
@@ -154,6 +154,7 @@ namespace FishEngine
 
 	private:
 		friend class FishEditor::Inspector;
+		friend class MaterialTable;
 
 		Meta(NonSerializable)
 		ShaderPtr                           m_shader = nullptr;
@@ -164,6 +165,14 @@ namespace FishEngine
 		Meta(NonSerializable)
 		ShaderLabProperties m_savedProperties;
 
+		// see MaterialTable
+		Meta(NonSerializable)
+		int					m_materialTableRow = -1;
+
+		// bumped whenever m_textures or m_shader changes, rebuilds the MaterialTable row
+		Meta(NonSerializable)
+		uint32_t			m_textureVersion = 0;
+
 		static std::map<std::string, MaterialPtr>   s_builtinMaterialInstance;
 		//static MaterialPtr                          s_defaultMaterial;
 	};
@@ -0,0 +1,410 @@
+#include "MaterialTable.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
+#include "ClassID.hpp"
+#include "Debug.hpp"
+#include "Material.hpp"
+#include "RenderBuffer.hpp"
+#include "Shader.hpp"
+#include "Texture2D.hpp"
+
+namespace
+{
+	// entry of a slot the material has no texture for, sampled as white
+	constexpr uint32_t NoTexture = 0xFFFFFFFFu;
+
+	bool BindlessSupported()
+	{
+#if FISHENGINE_PLATFORM_WINDOWS
+		return GLEW_ARB_bindless_texture != 0;
+#else
+		return false;
+#endif
+	}
+
+	// glCopyImageSubData is GL 4.3 (or ARB_copy_image), without it the layers are read back and uploaded again.
+	bool CopyImageSupported()
+	{
+#if FISHENGINE_PLATFORM_WINDOWS
+		static const bool supported = GLEW_VERSION_4_3 || GLEW_ARB_copy_image;
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	std::string TextureArrayName(int index)
+	{
+		return "MaterialTextureArray" + std::to_string(index);
+	}
+}
+
+namespace FishEngine
+{
+	MaterialTable::Mode								MaterialTable::s_mode = MaterialTable::Mode::Disabled;
+	std::vector<MaterialTable::Row>					MaterialTable::s_rows;
+	std::vector<int>								MaterialTable::s_freeRows;
+	std::vector<MaterialTable::Entry>				MaterialTable::s_entries;
+	bool											MaterialTable::s_dirty = false;
+	std::vector<MaterialTable::TextureArray>		MaterialTable::s_arrays;
+	int												MaterialTable::s_maxArrayLayers = 256;
+	std::map<unsigned int, uint64_t>				MaterialTable::s_handles;
+	unsigned int									MaterialTable::s_tableBuffer = 0;
+	unsigned int									MaterialTable::s_tableTexture = 0;
+	MaterialTable::Statistics						MaterialTable::s_statistics;
+
+	bool MaterialTable::ArrayKey::operator<(ArrayKey const & rhs) const
+	{
+		return std::tie(format, width, height, mipmapCount, filterMode, wrapMode)
+			< std::tie(rhs.format, rhs.width, rhs.height, rhs.mipmapCount, rhs.filterMode, rhs.wrapMode);
+	}
+
+	void MaterialTable::Init()
+	{
+		s_mode = BindlessSupported() ? Mode::Bindless : Mode::TextureArrays;
+		LogInfo(s_mode == Mode::Bindless ? "MaterialTable: bindless textures" : "MaterialTable: texture arrays");
+
+		GLint maxLayers = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+		if (maxLayers > 0)
+			s_maxArrayLayers = maxLayers;
+
+		glGenBuffers(1, &s_tableBuffer);
+		glGenTextures(1, &s_tableTexture);
+
+		// one empty row until the first Build
+		const Entry empty[MaxTextureSlots] = { { NoTexture, NoTexture }, { NoTexture, NoTexture }, { NoTexture, NoTexture }, { NoTexture, NoTexture } };
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, s_tableBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(empty), empty, GL_DYNAMIC_DRAW);
+		GLStateCache::BindTexture(GL_TEXTURE_BUFFER, s_tableTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, s_tableBuffer);
+		GLStateCache::BindTexture(GL_TEXTURE_BUFFER, 0);
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, 0);
+		glCheckError();
+
+		Shader::SetGlobalBufferTexture("MaterialTable", s_tableTexture);
+		if (s_mode == Mode::TextureArrays)
+		{
+			for (int i = 0; i < MaxTextureArrays; ++i)
+				Shader::SetGlobalTexture(TextureArrayName(i), GL_TEXTURE_2D_ARRAY, 0);
+		}
+	}
+
+	int MaterialTable::IndexOf(MaterialPtr const & material)
+	{
+		if (s_mode == Mode::Disabled || material == nullptr)
+			return -1;
+
+		int index = material->m_materialTableRow;
+		// also catches copies of a material that carry the row of the original
+		if (index < 0 || index >= s_rows.size() || s_rows[index].material.lock() != material)
+		{
+			if (!s_freeRows.empty())
+			{
+				index = s_freeRows.back();
+				s_freeRows.pop_back();
+			}
+			else
+			{
+				index = static_cast<int>(s_rows.size());
+				s_rows.emplace_back();
+			}
+			s_rows[index] = Row();
+			s_rows[index].material = material;
+			s_rows[index].inUse = true;
+			material->m_materialTableRow = index;
+			s_dirty = true;
+			return -1;
+		}
+
+		auto const & row = s_rows[index];
+		if (!row.built || row.version != material->m_textureVersion)
+		{
+			s_dirty = true;
+			return -1;
+		}
+		return row.valid ? index : -1;
+	}
+
+	void MaterialTable::Build()
+	{
+		if (s_mode == Mode::Disabled || !s_dirty)
+			return;
+		s_dirty = false;
+
+		s_entries.resize(std::max<std::size_t>(1, s_rows.size()) * MaxTextureSlots, Entry{ NoTexture, NoTexture });
+		for (int i = 0; i < s_rows.size(); ++i)
+		{
+			auto & row = s_rows[i];
+			auto * entries = &s_entries[i * MaxTextureSlots];
+			auto material = row.material.lock();
+			if (material == nullptr)
+			{
+				// material destroyed, free the row
+				if (row.inUse)
+				{
+					row = Row();
+					s_freeRows.push_back(i);
+					for (int slot = 0; slot < MaxTextureSlots; ++slot)
+						entries[slot] = { NoTexture, NoTexture };
+				}
+				continue;
+			}
+			if (row.built && row.version == material->m_textureVersion)
+				continue;
+
+			row.version = material->m_textureVersion;
+			row.built = true;
+			row.valid = BuildRow(*material, entries);
+			if (!row.valid)
+			{
+				for (int slot = 0; slot < MaxTextureSlots; ++slot)
+					entries[slot] = { NoTexture, NoTexture };
+			}
+		}
+
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, s_tableBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, s_entries.size() * sizeof(Entry), s_entries.data(), GL_DYNAMIC_DRAW);
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		if (s_mode == Mode::TextureArrays)
+		{
+			for (int i = 0; i < s_arrays.size(); ++i)
+				Shader::SetGlobalTexture(TextureArrayName(i), GL_TEXTURE_2D_ARRAY, s_arrays[i].texture);
+		}
+		glCheckError();
+		UpdateStatistics();
+	}
+
+	bool MaterialTable::BuildRow(Material const & material, Entry * entries)
+	{
+		if (material.m_shader == nullptr)
+			return false;
+		auto const & names = material.m_shader->materialTextures();
+		if (names.empty() || names.size() > MaxTextureSlots)
+			return false;
+
+		for (int slot = 0; slot < MaxTextureSlots; ++slot)
+		{
+			entries[slot] = { NoTexture, NoTexture };
+			if (slot >= names.size() || names[slot].empty())
+				continue;
+			auto it = material.m_textures.find(names[slot]);
+			if (it == material.m_textures.end() || it->second == nullptr)
+				continue;
+
+			// render targets change every frame and are not mip-mapped like the arrays, keep them per draw
+			auto const & texture = it->second;
+			if (texture->ClassID() != ClassID<Texture2D>()
+				|| dynamic_cast<ColorBuffer *>(texture.get()) != nullptr || dynamic_cast<DepthBuffer *>(texture.get()) != nullptr)
+				return false;
+
+			bool added;
+			if (s_mode == Mode::Bindless)
+				added = BindlessEntry(texture, entries[slot]);
+			else
+				added = ArrayEntry(std::static_pointer_cast<Texture2D>(texture), entries[slot]);
+			if (!added)
+				return false;
+		}
+		return true;
+	}
+
+	bool MaterialTable::BindlessEntry(TexturePtr const & texture, Entry & entry)
+	{
+#if FISHENGINE_PLATFORM_WINDOWS
+		auto id = texture->GetNativeTexturePtr();
+		auto it = s_handles.find(id);
+		if (it == s_handles.end())
+		{
+			// the handle takes the sampling state of the texture object, as the per-draw binds do
+			GLuint64 handle = glGetTextureHandleARB(id);
+			if (handle == 0)
+				return false;
+			glMakeTextureHandleResidentARB(handle);
+			it = s_handles.emplace(id, handle).first;
+		}
+		entry = { static_cast<uint32_t>(it->second & 0xFFFFFFFFu), static_cast<uint32_t>(it->second >> 32) };
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	bool MaterialTable::ArrayEntry(Texture2DPtr const & texture, Entry & entry)
+	{
+		texture->GetNativeTexturePtr();		// upload, m_mipmapCount is final after that
+		if (ImageByteCount(texture->format(), 4, 4) <= 0)
+			return false;
+
+		ArrayKey key{ texture->format(), static_cast<int>(texture->width()), static_cast<int>(texture->height()), static_cast<int>(texture->mipmapCount()),
+			texture->filterMode(), texture->wrapMode() };
+		auto array = std::find_if(s_arrays.begin(), s_arrays.end(), [&key](TextureArray const & a) {
+			return !(a.key < key) && !(key < a.key);
+		});
+		if (array == s_arrays.end())
+		{
+			if (s_arrays.size() >= MaxTextureArrays)
+				return false;
+			s_arrays.emplace_back();
+			array = s_arrays.end() - 1;
+			array->key = key;
+		}
+		const uint32_t arrayIndex = static_cast<uint32_t>(array - s_arrays.begin());
+
+		int layer = -1;
+		for (int i = 0; i < array->layers.size(); ++i)
+		{
+			auto t = array->layers[i].lock();
+			if (t == texture)
+			{
+				entry = { arrayIndex, static_cast<uint32_t>(i) };
+				return true;
+			}
+			if (t == nullptr && layer < 0)
+				layer = i;
+		}
+
+		if (layer < 0)
+		{
+			layer = static_cast<int>(array->layers.size());
+			if (layer >= array->capacity && !GrowArray(*array, layer + 1))
+				return false;
+			array->layers.emplace_back();
+		}
+		array->layers[layer] = texture;
+		CopyToLayer(*texture, *array, layer);
+		entry = { arrayIndex, static_cast<uint32_t>(layer) };
+		return true;
+	}
+
+	bool MaterialTable::GrowArray(TextureArray & array, int layerCount)
+	{
+		if (layerCount > s_maxArrayLayers)
+			return false;
+		int capacity = std::min(std::max(4, array.capacity * 2), s_maxArrayLayers);
+		capacity = std::max(capacity, layerCount);
+
+		// texture storage is immutable, allocate a bigger array and copy the live layers again
+		GLenum internalFormat = GL_RGBA8;
+		GLenum format = GL_RGBA;
+		GLenum type = GL_UNSIGNED_BYTE;
+		TextureFormat2GLFormat(array.key.format, &internalFormat, &format, &type);
+
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, array.key.mipmapCount, internalFormat, array.key.width, array.key.height, capacity);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.key.mipmapCount - 1);
+		GLint minFilter = GL_LINEAR;
+		if (array.key.filterMode == FilterMode::Point)
+			minFilter = array.key.mipmapCount > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+		else if (array.key.mipmapCount > 1)
+			minFilter = array.key.filterMode == FilterMode::Trilinear ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR_MIPMAP_NEAREST;
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, minFilter);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, array.key.filterMode == FilterMode::Point ? GL_NEAREST : GL_LINEAR);
+		GLint wrap = array.key.wrapMode == TextureWrapMode::Clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+		glCheckError();
+
+		if (array.texture != 0)
+		{
+			GLStateCache::OnDeleteTexture(array.texture);
+			glDeleteTextures(1, &array.texture);
+		}
+		array.texture = texture;
+		array.capacity = capacity;
+
+		for (int i = 0; i < array.layers.size(); ++i)
+		{
+			auto t = array.layers[i].lock();
+			if (t != nullptr)
+				CopyToLayer(static_cast<Texture2D &>(*t), array, i);
+		}
+		return true;
+	}
+
+	void MaterialTable::CopyToLayer(Texture2D & texture, TextureArray const & array, int layer)
+	{
+		const GLuint source = texture.GetNativeTexturePtr();
+		const int levels = array.key.mipmapCount;
+		if (CopyImageSupported())
+		{
+			for (int level = 0; level < levels; ++level)
+			{
+				const int w = std::max(1, array.key.width >> level);
+				const int h = std::max(1, array.key.height >> level);
+				glCopyImageSubData(source, GL_TEXTURE_2D, level, 0, 0, 0, array.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, w, h, 1);
+			}
+			glCheckError();
+			return;
+		}
+
+		// the pixels were dropped after upload, read them back from the texture
+		GLenum internalFormat = GL_RGBA8;
+		GLenum format = GL_RGBA;
+		GLenum type = GL_UNSIGNED_BYTE;
+		TextureFormat2GLFormat(array.key.format, &internalFormat, &format, &type);
+		const bool compressed = IsBlockCompressed(array.key.format);
+
+		GLStateCache::BindTexture(GL_TEXTURE_2D, source);
+		GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		std::vector<uint8_t> pixels;
+		for (int level = 0; level < levels; ++level)
+		{
+			const int w = std::max(1, array.key.width >> level);
+			const int h = std::max(1, array.key.height >> level);
+			const int size = ImageByteCount(array.key.format, w, h);
+			pixels.resize(size);
+			if (compressed)
+			{
+				glGetCompressedTexImage(GL_TEXTURE_2D, level, pixels.data());
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, w, h, 1, internalFormat, size, pixels.data());
+			}
+			else
+			{
+				glGetTexImage(GL_TEXTURE_2D, level, format, type, pixels.data());
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, w, h, 1, format, type, pixels.data());
+			}
+		}
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glCheckError();
+	}
+
+	void MaterialTable::OnDeleteTexture(unsigned int texture)
+	{
+		// deleting the texture releases its handles
+		s_handles.erase(texture);
+	}
+
+	void MaterialTable::UpdateStatistics()
+	{
+		Statistics s;
+		for (auto const & row : s_rows)
+		{
+			if (row.valid && !row.material.expired())
+				s.rows++;
+		}
+		s.textureArrays = static_cast<int>(s_arrays.size());
+		for (auto const & array : s_arrays)
+		{
+			s.textureArrayLayers += array.capacity;
+			for (int level = 0; level < array.key.mipmapCount; ++level)
+			{
+				const int w = std::max(1, array.key.width >> level);
+				const int h = std::max(1, array.key.height >> level);
+				s.textureArrayBytes += std::size_t(ImageByteCount(array.key.format, w, h)) * array.capacity;
+			}
+		}
+		s.residentHandles = static_cast<int>(s_handles.size());
+		s_statistics = s;
+	}
+}
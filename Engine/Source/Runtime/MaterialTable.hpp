@@ -0,0 +1,131 @@
+#ifndef MaterialTable_hpp
+#define MaterialTable_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+#include "TextureProperty.hpp"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace FishEngine
+{
+	// Material textures without per-draw texture binds.
+	// Shaders that sample their material textures with MATERIAL_TEXTURE(slot, name, uv) (see MaterialTable.inc) get a
+	// variant (ShaderKeyword::MaterialTable) that looks the textures up in a table, at the material row given by
+	// PerDrawUniforms.MaterialIndex. The table is a texture buffer, one RG32UI texel per material and slot:
+	//  - Bindless:       the GL_ARB_bindless_texture handle of the texture.
+	//  - TextureArrays:  the array and layer the texture was copied to. Textures are grouped into GL_TEXTURE_2D_ARRAY
+	//                    by format, size, mip count and sampler state; the copies cost as much memory as the originals.
+	// The table and the arrays are bound once for all draws, so consecutive draws only differ by their per-draw uniforms.
+	// Materials with a texture the table can not hold (render targets, cubemaps, too many array groups) get no row
+	// and keep binding their textures per draw.
+	class FE_EXPORT Meta(NonSerializable) MaterialTable
+	{
+	public:
+		MaterialTable() = delete;
+
+		enum class Mode
+		{
+			Disabled,		// before Init
+			Bindless,
+			TextureArrays,
+		};
+
+		static constexpr int MaxTextureSlots = 4;	// MATERIAL_TEXTURE_SLOTS in MaterialTable.inc
+		static constexpr int MaxTextureArrays = 8;	// MaterialTextureArray0..7 in MaterialTable.inc
+
+		// Pick the mode supported by the context and create the table. Call before compiling shaders.
+		static void Init();
+
+		static Mode mode()
+		{
+			return s_mode;
+		}
+
+		// Row of material in the table, -1 if the material binds its textures per draw.
+		// New materials and materials whose textures changed get their row at the next Build().
+		static int IndexOf(MaterialPtr const & material);
+
+		// Build the rows of new and changed materials and upload the table. Call once per frame, before drawing.
+		static void Build();
+
+		// GL names are reused, forget the bindless handle of a deleted texture.
+		static void OnDeleteTexture(unsigned int texture);
+
+		struct Statistics
+		{
+			int			rows = 0;				// materials in the table
+			int			textureArrays = 0;
+			int			textureArrayLayers = 0;
+			std::size_t	textureArrayBytes = 0;	// copies of the material textures
+			int			residentHandles = 0;
+		};
+
+		static Statistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+	private:
+		struct Row
+		{
+			std::weak_ptr<Material>	material;
+			uint32_t				version = 0;	// Material::m_textureVersion the row was built from
+			bool					inUse = false;
+			bool					built = false;
+			bool					valid = false;	// false: the material binds its textures per draw
+		};
+
+		// x, y: low and high 32 bits of the bindless handle, or array index and layer
+		struct Entry
+		{
+			uint32_t	x;
+			uint32_t	y;
+		};
+
+		struct ArrayKey
+		{
+			TextureFormat	format;
+			int				width;
+			int				height;
+			int				mipmapCount;
+			FilterMode		filterMode;
+			TextureWrapMode	wrapMode;
+
+			bool operator<(ArrayKey const & rhs) const;
+		};
+
+		struct TextureArray
+		{
+			ArrayKey							key;
+			unsigned int						texture = 0;
+			int									capacity = 0;	// allocated layers
+			std::vector<std::weak_ptr<Texture>>	layers;			// expired layers are reused
+		};
+
+		static bool BuildRow(Material const & material, Entry * entries);
+		static bool BindlessEntry(TexturePtr const & texture, Entry & entry);
+		static bool ArrayEntry(Texture2DPtr const & texture, Entry & entry);
+		static bool GrowArray(TextureArray & array, int layerCount);
+		static void CopyToLayer(Texture2D & texture, TextureArray const & array, int layer);
+		static void UpdateStatistics();
+
+		static Mode										s_mode;
+		static std::vector<Row>							s_rows;
+		static std::vector<int>							s_freeRows;
+		static std::vector<Entry>						s_entries;		// MaxTextureSlots per row
+		static bool										s_dirty;
+
+		static std::vector<TextureArray>				s_arrays;
+		static int										s_maxArrayLayers;
+		static std::map<unsigned int, uint64_t>			s_handles;		// resident bindless handle by GL texture
+
+		static unsigned int								s_tableBuffer;
+		static unsigned int								s_tableTexture;
+		static Statistics								s_statistics;
+	};
+}
+
+#endif // MaterialTable_hpp
@@ -1,6 +1,8 @@
 #include "Mathf.hpp"
 #include "Time.hpp"
 
+#include <cstring>
+
 
 float FishEngine::Mathf::SmoothDamp(float current, float target, float & /*ref*/ currentVelocity, float smoothTime, float maxSpeed /*= Mathf::Infinity*/)
 {
@@ -13,3 +15,73 @@ float FishEngine::Mathf::SmoothDampAngle(float current, float target, float& cur
 	float deltaTime = Time::deltaTime();
 	return Mathf::SmoothDampAngle(current, target, currentVelocity, smoothTime, maxSpeed, deltaTime);
 }
+
+uint16_t FishEngine::Mathf::FloatToHalf(float val)
+{
+	uint32_t f;
+	std::memcpy(&f, &val, sizeof(f));
+	const uint32_t sign = (f >> 16) & 0x8000u;
+	const uint32_t absf = f & 0x7FFFFFFFu;
+
+	if (absf >= 0x7F800000u)	// Inf or NaN
+	{
+		return static_cast<uint16_t>(sign | 0x7C00u | (absf > 0x7F800000u ? 0x200u : 0u));
+	}
+	if (absf >= 0x477FF000u)	// rounds to a value larger than 65504
+	{
+		return static_cast<uint16_t>(sign | 0x7C00u);
+	}
+	if (absf < 0x38800000u)		// denormal or zero
+	{
+		if (absf < 0x33000000u)
+			return static_cast<uint16_t>(sign);
+		const uint32_t mantissa = (absf & 0x007FFFFFu) | 0x00800000u;
+		const int shift = 126 - static_cast<int>(absf >> 23);	// 14..24
+		uint32_t h = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (h & 1u)))
+			h++;
+		return static_cast<uint16_t>(sign | h);
+	}
+
+	// normal: rebias exponent from 127 to 15 and round the mantissa from 23 to 10 bits
+	uint32_t h = (absf - 0x38000000u) >> 13;
+	const uint32_t remainder = absf & 0x1FFFu;
+	if (remainder > 0x1000u || (remainder == 0x1000u && (h & 1u)))
+		h++;
+	return static_cast<uint16_t>(sign | h);
+}
+
+float FishEngine::Mathf::HalfToFloat(uint16_t val)
+{
+	const uint32_t sign = (static_cast<uint32_t>(val) & 0x8000u) << 16;
+	uint32_t exponent = (val >> 10) & 0x1Fu;
+	uint32_t mantissa = val & 0x3FFu;
+	uint32_t f;
+	if (exponent == 0x1Fu)			// Inf or NaN
+	{
+		f = sign | 0x7F800000u | (mantissa << 13);
+	}
+	else if (exponent != 0)			// normal
+	{
+		f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0)			// zero
+	{
+		f = sign;
+	}
+	else							// denormal, normalize it
+	{
+		exponent = 113;
+		while ((mantissa & 0x400u) == 0)
+		{
+			mantissa <<= 1;
+			exponent--;
+		}
+		f = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+	}
+	float result;
+	std::memcpy(&result, &f, sizeof(result));
+	return result;
+}
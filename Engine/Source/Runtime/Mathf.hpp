@@ -473,8 +473,11 @@ namespace FishEngine
 			return length - Mathf::Abs(t - length);
 		}
 
-		// ushort FloatToHalf(float val);
-		// float HalfToFloat(ushort val);
+		// Converts a float to its IEEE 754 half-precision representation (round to nearest even).
+		static uint16_t FloatToHalf(float val);
+
+		// Converts a half-precision value back to float.
+		static float HalfToFloat(uint16_t val);
 
 		// Calculates the shortest difference between two given angles given in degrees.
 		static float DeltaAngle(float current, float target)
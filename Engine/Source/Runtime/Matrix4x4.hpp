@@ -42,6 +42,10 @@ namespace FishEngine
 		// The inverse of this matrix (Read Only).
 		Matrix4x4 inverse() const;
 
+		// The inverse of this matrix, which must be affine (last row is 0, 0, 0, 1),
+		// e.g. a TRS matrix. Much cheaper than inverse().
+		Matrix4x4 inverseAffine() const;
+
 		// Returns the transpose of this matrix (Read Only).
 		Matrix4x4 transpose() const;
 
@@ -33,6 +33,36 @@ namespace FishEngine
 		return Matrix4x4::Inverse(*this);
 	}
 
+	inline Matrix4x4 Matrix4x4::inverseAffine() const
+	{
+		// [A t; 0 1]^-1 = [A^-1 -A^-1*t; 0 1]
+		const float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+		const float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+		const float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+		const float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+		if (det == 0.0f)
+			return Matrix4x4::Inverse(*this);
+		const float invDet = 1.0f / det;
+
+		Matrix4x4 result;
+		result.m[0][0] = c00 * invDet;
+		result.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+		result.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+		result.m[1][0] = c01 * invDet;
+		result.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+		result.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+		result.m[2][0] = c02 * invDet;
+		result.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+		result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+		for (int i = 0; i < 3; ++i)
+		{
+			result.m[i][3] = -(result.m[i][0] * m[0][3] + result.m[i][1] * m[1][3] + result.m[i][2] * m[2][3]);
+		}
+		result.m[3][0] = result.m[3][1] = result.m[3][2] = 0;
+		result.m[3][3] = 1;
+		return result;
+	}
+
 	inline Matrix4x4 Matrix4x4::transpose() const
 	{
 		return Matrix4x4::Transpose(*this);
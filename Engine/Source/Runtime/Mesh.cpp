@@ -4,15 +4,114 @@
 #include <fstream>
 #include <sstream>
 #include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <array>
 
 #include "Shader.hpp"
 #include "Debug.hpp"
+#include "Mathf.hpp"
 #include "Common.hpp"
 #include "ShaderVariables_gen.hpp"
 #include "generate/Enum_PrimitiveType.hpp"
+#include "GLStateCache.hpp"
 
 using namespace std;
 
+namespace
+{
+	using namespace FishEngine;
+
+	// byte offsets of the attributes inside the interleaved attribute stream
+	struct AttributeLayout
+	{
+		GLsizei stride;
+		GLenum	normalType;		// also used for tangents
+		GLint	normalSize;
+		GLenum	uvType;
+		std::size_t normalOffset;
+		std::size_t tangentOffset;
+		std::size_t uvOffset;
+	};
+
+	AttributeLayout GetAttributeLayout(VertexCompression compression)
+	{
+		AttributeLayout layout;
+		const bool packNormals = compression != VertexCompression::None;
+		const bool packUV = compression == VertexCompression::PackedAll;
+		layout.normalType = packNormals ? GL_INT_2_10_10_10_REV : GL_FLOAT;
+		layout.normalSize = packNormals ? 4 : 3;
+		layout.uvType = packUV ? GL_HALF_FLOAT : GL_FLOAT;
+		const std::size_t normalBytes = packNormals ? 4 : 3 * sizeof(GLfloat);
+		const std::size_t uvBytes = packUV ? 2 * sizeof(GLhalf) : 2 * sizeof(GLfloat);
+		layout.normalOffset = 0;
+		layout.tangentOffset = normalBytes;
+		layout.uvOffset = normalBytes * 2;
+		layout.stride = static_cast<GLsizei>(normalBytes * 2 + uvBytes);
+		return layout;
+	}
+
+	// 4 bone indices followed by 4 bone weights
+	GLsizei GetBoneStride(bool packed)
+	{
+		return packed ? 4 * sizeof(GLubyte) * 2 : 4 * (sizeof(GLuint) + sizeof(GLfloat));
+	}
+
+	// signed normalized 10-10-10-2, w = 0
+	uint32_t PackNormal(Vector3 const & v)
+	{
+		auto pack10 = [](float f) -> uint32_t
+		{
+			f = Mathf::Clamp(f, -1.f, 1.f);
+			int32_t i = static_cast<int32_t>(Mathf::Round(f * 511.f));
+			return static_cast<uint32_t>(i) & 0x3FFu;
+		};
+		return pack10(v.x) | (pack10(v.y) << 10) | (pack10(v.z) << 20);
+	}
+
+	Vector3 UnpackNormal(uint32_t packed)
+	{
+		auto unpack10 = [](uint32_t bits) -> float
+		{
+			// sign extend the 10 bits
+			int32_t i = static_cast<int32_t>(bits << 22) >> 22;
+			return Mathf::Max(i / 511.f, -1.f);
+		};
+		return Vector3(unpack10(packed & 0x3FFu), unpack10((packed >> 10) & 0x3FFu), unpack10((packed >> 20) & 0x3FFu));
+	}
+
+	template<typename T>
+	void Write(std::vector<uint8_t> & buffer, std::size_t offset, T const & value)
+	{
+		std::memcpy(buffer.data() + offset, &value, sizeof(T));
+	}
+
+	template<typename T>
+	T Read(std::vector<uint8_t> const & buffer, std::size_t offset)
+	{
+		T value;
+		std::memcpy(&value, buffer.data() + offset, sizeof(T));
+		return value;
+	}
+
+	// the vectors are not trivially copyable classes: read their floats
+	template<>
+	Vector3 Read<Vector3>(std::vector<uint8_t> const & buffer, std::size_t offset)
+	{
+		float v[3];
+		std::memcpy(v, buffer.data() + offset, sizeof(v));
+		return Vector3(v[0], v[1], v[2]);
+	}
+
+	template<>
+	Vector2 Read<Vector2>(std::vector<uint8_t> const & buffer, std::size_t offset)
+	{
+		float v[2];
+		std::memcpy(v, buffer.data() + offset, sizeof(v));
+		return Vector2(v[0], v[1]);
+	}
+}
+
 namespace FishEngine
 {
 	std::map<PrimitiveType, MeshPtr> Mesh::s_builtinMeshes;
@@ -57,13 +156,39 @@ namespace FishEngine
 
 	Mesh::~Mesh()
 	{
+		MeshPool::Free(m_poolAllocation);
+		GLStateCache::OnDeleteVertexArray(m_VAO);
+		GLStateCache::OnDeleteBuffer(m_positionVBO);
+		GLStateCache::OnDeleteBuffer(m_attributeVBO);
+		GLStateCache::OnDeleteBuffer(m_boneVBO);
 		glDeleteVertexArrays(1, &m_VAO);
 		glDeleteBuffers(1, &m_positionVBO);
-		glDeleteBuffers(1, &m_normalVBO);
-		glDeleteBuffers(1, &m_tangentVBO);
+		glDeleteBuffers(1, &m_attributeVBO);
+		glDeleteBuffers(1, &m_boneVBO);
 		glDeleteBuffers(1, &m_indexVBO);
 	}
 
+	uint32_t Mesh::vertexStride() const
+	{
+		uint32_t stride = 3 * sizeof(GLfloat) + GetAttributeLayout(m_vertexCompression).stride;
+		if (m_skinned)
+		{
+			const bool packBones = m_vertexCompression == VertexCompression::PackedAll && boneCount() <= 256;
+			stride += GetBoneStride(packBones);
+		}
+		return stride;
+	}
+
+	uint32_t Mesh::uncompressedVertexStride() const
+	{
+		uint32_t stride = 3 * sizeof(GLfloat) + GetAttributeLayout(VertexCompression::None).stride;
+		if (m_skinned)
+		{
+			stride += GetBoneStride(false);
+		}
+		return stride;
+	}
+
 	void Mesh::RecalculateBounds()
 	{
 		Vector3 bmin(Mathf::Infinity, Mathf::Infinity, Mathf::Infinity);
@@ -95,6 +220,10 @@ namespace FishEngine
 		BindBuffer();
 		glCheckError();
 
+		// the vertices may be cleared below
+		if (m_boneWeights.empty())
+			m_occluderMesh = OcclusionCulling::BuildOccluderMesh(m_vertices, m_triangles);
+
 		//m_vertexCount = static_cast<uint32_t>(m_vertices.size());
 		//m_triangleCount = static_cast<uint32_t>(m_triangles.size() / 3);
 		m_isReadable = !markNoLogerReadable;
@@ -131,166 +260,331 @@ namespace FishEngine
 	
 	void Mesh::GenerateBuffer()
 	{
+		std::vector<uint16_t> indices16;
+		void const * indices = m_triangles.data();
+		if (indexSize() == sizeof(GLushort))
+		{
+			// 16-bit indices: half the index memory and bandwidth
+			indices16.assign(m_triangles.begin(), m_triangles.end());
+			indices = indices16.data();
+			m_indexType = GL_UNSIGNED_SHORT;
+		}
+		else
+		{
+			m_indexType = GL_UNSIGNED_INT;
+		}
+		
+		// normal, tangent and uv, interleaved
+		const auto layout = GetAttributeLayout(m_vertexCompression);
+		const bool hasNormals = m_normals.size() == m_vertexCount;
+		const bool hasTangents = m_tangents.size() == m_vertexCount;
+		const bool hasUV = m_uv.size() == m_vertexCount;
+		std::vector<uint8_t> attributes(m_vertexCount * layout.stride, 0);
+		for (uint32_t i = 0; i < m_vertexCount; ++i)
+		{
+			const std::size_t base = i * layout.stride;
+			if (layout.normalType == GL_FLOAT)
+			{
+				if (hasNormals)
+					Write(attributes, base + layout.normalOffset, m_normals[i]);
+				if (hasTangents)
+					Write(attributes, base + layout.tangentOffset, m_tangents[i]);
+			}
+			else
+			{
+				if (hasNormals)
+					Write(attributes, base + layout.normalOffset, PackNormal(m_normals[i]));
+				if (hasTangents)
+					Write(attributes, base + layout.tangentOffset, PackNormal(m_tangents[i]));
+			}
+			if (hasUV)
+			{
+				if (layout.uvType == GL_FLOAT)
+				{
+					Write(attributes, base + layout.uvOffset, m_uv[i]);
+				}
+				else
+				{
+					const uint16_t uv[2] = { Mathf::FloatToHalf(m_uv[i].x), Mathf::FloatToHalf(m_uv[i].y) };
+					Write(attributes, base + layout.uvOffset, uv);
+				}
+			}
+		}
+		
+		if (!m_skinned)
+		{
+			// static meshes share the buffers and the VAO of the pool of their layout
+			m_poolAllocation = MeshPool::Allocate(m_vertexCompression, layout.stride, m_indexType, m_vertexCount,
+				m_vertices.data(), attributes.data(), static_cast<uint32_t>(m_triangles.size()), indices);
+			return;
+		}
+		
 		// VAO
 		assert(m_VAO == 0);
 		glGenVertexArrays(1, &m_VAO);
 		
 		// index VBO
+		// the element array binding belongs to the bound VAO, draws leave theirs bound
+		GLStateCache::BindVertexArray(0);
 		glGenBuffers(1, &m_indexVBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_triangles.size() * 4, m_triangles.data(), GL_STATIC_DRAW);
+		GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_triangles.size() * indexSize(), indices, GL_STATIC_DRAW);
 		
 		glGenBuffers(1, &m_positionVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
 		glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * 3 * 4, m_vertices.data(), GL_STATIC_DRAW);
 		
-		glGenBuffers(1, &m_normalVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
-		glBufferData(GL_ARRAY_BUFFER, m_normals.size() * 3 * 4, m_normals.data(), GL_STATIC_DRAW);
-		
-		glGenBuffers(1, &m_uvVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_uvVBO);
-		glBufferData(GL_ARRAY_BUFFER, m_uv.size() * 2 * 4, m_uv.data(), GL_STATIC_DRAW);
+		glGenBuffers(1, &m_attributeVBO);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_attributeVBO);
+		glBufferData(GL_ARRAY_BUFFER, attributes.size(), attributes.data(), GL_STATIC_DRAW);
 		
-		//float* tangents = new float[m_tangents.size() * 4];
-		//for (int i = 0; i < m_tangents.size(); ++i)
-		//{
-		//	Vector3 const & n = m_normals[i];
-		//	Vector3 const & t = m_tangents[i];
-		//}
-		glGenBuffers(1, &m_tangentVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_tangentVBO);
-		glBufferData(GL_ARRAY_BUFFER, m_tangents.size() * 3 * 4, m_tangents.data(), GL_STATIC_DRAW);
-		
-		if (m_skinned)
+		// 4 bone indices followed by 4 bone weights
+		const bool packBones = m_vertexCompression == VertexCompression::PackedAll && boneCount() <= 256;
+		const GLsizei boneStride = GetBoneStride(packBones);
+		std::vector<uint8_t> bones(m_boneWeights.size() * boneStride);
+		for (std::size_t i = 0; i < m_boneWeights.size(); ++i)
 		{
-			std::vector<Int4> boneIndexBuffer;
-			std::vector<Vector4> boneWeightBuffer;
-			boneIndexBuffer.reserve(m_boneWeights.size());
-			boneIndexBuffer.reserve(m_boneWeights.size());
-			for (auto const & b : m_boneWeights)
+			auto const & b = m_boneWeights[i];
+			const std::size_t base = i * boneStride;
+			if (packBones)
 			{
-				boneIndexBuffer.emplace_back(b.boneIndex[0], b.boneIndex[1], b.boneIndex[2], b.boneIndex[3]);
-				boneWeightBuffer.emplace_back(b.weight[0], b.weight[1], b.weight[2], b.weight[3]);
+				uint8_t weights[4];
+				int sum = 0;
+				int largest = 0;
+				for (int j = 0; j < 4; ++j)
+				{
+					bones[base + j] = static_cast<uint8_t>(b.boneIndex[j]);
+					weights[j] = static_cast<uint8_t>(Mathf::Clamp(Mathf::RoundToInt(b.weight[j] * 255.f), 0, 255));
+					sum += weights[j];
+					if (weights[j] > weights[largest])
+						largest = j;
+				}
+				// keep the quantized weights summing up to 1
+				weights[largest] = static_cast<uint8_t>(Mathf::Clamp(weights[largest] + 255 - sum, 0, 255));
+				std::memcpy(bones.data() + base + 4, weights, sizeof(weights));
 			}
+			else
+			{
+				const uint32_t boneIndices[4] = { static_cast<uint32_t>(b.boneIndex[0]), static_cast<uint32_t>(b.boneIndex[1]),
+					static_cast<uint32_t>(b.boneIndex[2]), static_cast<uint32_t>(b.boneIndex[3]) };
+				Write(bones, base, boneIndices);
+				Write(bones, base + sizeof(boneIndices), b.weight);
+			}
+		}
 
-			glGenTransformFeedbacks(1, &m_TFBO);
-
-			glGenVertexArrays(1, &m_animationInputVAO);
+		glGenTransformFeedbacks(1, &m_TFBO);
 
-			glGenBuffers(1, &m_animationOutputPositionVBO);
-			glBindBuffer(GL_ARRAY_BUFFER, m_animationOutputPositionVBO);
-			glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * 3 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
-			
-			glGenBuffers(1, &m_animationOutputNormalVBO);
-			glBindBuffer(GL_ARRAY_BUFFER, m_animationOutputNormalVBO);
-			glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * 3 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+		glGenVertexArrays(1, &m_animationInputVAO);
 
-			glGenBuffers(1, &m_animationOutputTangentVBO);
-			glBindBuffer(GL_ARRAY_BUFFER, m_animationOutputTangentVBO);
-			glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * 3 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+		glGenBuffers(1, &m_animationOutputPositionVBO);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_animationOutputPositionVBO);
+		glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * 3 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+		
+		glGenBuffers(1, &m_animationOutputNormalVBO);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_animationOutputNormalVBO);
+		glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * 3 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
 
-			glGenBuffers(1, &m_boneIndexVBO);
-			glBindBuffer(GL_ARRAY_BUFFER, m_boneIndexVBO);
-			glBufferData(GL_ARRAY_BUFFER, boneIndexBuffer.size() * 4 * sizeof(int), boneIndexBuffer.data(), GL_STATIC_DRAW);
+		glGenBuffers(1, &m_animationOutputTangentVBO);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_animationOutputTangentVBO);
+		glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * 3 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
 
-			glGenBuffers(1, &m_boneWeightVBO);
-			glBindBuffer(GL_ARRAY_BUFFER, m_boneWeightVBO);
-			glBufferData(GL_ARRAY_BUFFER, boneWeightBuffer.size() * 4 * sizeof(GLfloat), boneWeightBuffer.data(), GL_STATIC_DRAW);
+		glGenBuffers(1, &m_boneVBO);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_boneVBO);
+		glBufferData(GL_ARRAY_BUFFER, bones.size(), bones.data(), GL_STATIC_DRAW);
 
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-		}
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 	
 	void Mesh::BindBuffer()
 	{
-		if (m_skinned)
-		{
-			// Transform feedback input
-			glBindVertexArray(m_animationInputVAO);
-			
-			// position
-			glBindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
-			glVertexAttribPointer(PositionIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-			glEnableVertexAttribArray(PositionIndex);
-
-			// normal
-			glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
-			glVertexAttribPointer(NormalIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-			glEnableVertexAttribArray(NormalIndex);
-
-			// tangent
-			glBindBuffer(GL_ARRAY_BUFFER, m_tangentVBO);
-			glVertexAttribPointer(TangentIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-			glEnableVertexAttribArray(TangentIndex);
-			
-			// bone indices
-			glBindBuffer(GL_ARRAY_BUFFER, m_boneIndexVBO);
-			glVertexAttribIPointer(BoneIndexIndex, 4, GL_INT, 4 * sizeof(GLint), (GLvoid*)0);
-			glEnableVertexAttribArray(BoneIndexIndex);
-			
-			// bone weights
-			glBindBuffer(GL_ARRAY_BUFFER, m_boneWeightVBO);
-			glVertexAttribPointer(BoneWeightIndex, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
-			glEnableVertexAttribArray(BoneWeightIndex);
-			
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			glBindVertexArray(0);
-			
-			glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_TFBO);
-			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_animationOutputPositionVBO);
-			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, m_animationOutputNormalVBO);
-			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 2, m_animationOutputTangentVBO);
-			glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
-		}
+		// static meshes are drawn with the VAO of their MeshPool
+		if (!m_skinned)
+			return;
 		
-		glBindVertexArray(m_VAO);
+		const auto layout = GetAttributeLayout(m_vertexCompression);
+		const GLboolean normalized = layout.normalType == GL_FLOAT ? GL_FALSE : GL_TRUE;
 		
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+		// Transform feedback input
+		GLStateCache::BindVertexArray(m_animationInputVAO);
 		
-		if (m_skinned)
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, m_animationOutputPositionVBO);
-		}
-		else
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
-		}
+		// position
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_positionVBO);
 		glVertexAttribPointer(PositionIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
 		glEnableVertexAttribArray(PositionIndex);
+
+		// normal
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_attributeVBO);
+		glVertexAttribPointer(NormalIndex, layout.normalSize, layout.normalType, normalized, layout.stride, (GLvoid*)layout.normalOffset);
+		glEnableVertexAttribArray(NormalIndex);
+
+		// tangent
+		glVertexAttribPointer(TangentIndex, layout.normalSize, layout.normalType, normalized, layout.stride, (GLvoid*)layout.tangentOffset);
+		glEnableVertexAttribArray(TangentIndex);
 		
-		
-		if (m_skinned)
+		// bone indices and weights
+		const bool packBones = m_vertexCompression == VertexCompression::PackedAll && boneCount() <= 256;
+		const GLsizei boneStride = GetBoneStride(packBones);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_boneVBO);
+		if (packBones)
 		{
-			glBindBuffer(GL_ARRAY_BUFFER, m_animationOutputNormalVBO);
+			glVertexAttribIPointer(BoneIndexIndex, 4, GL_UNSIGNED_BYTE, boneStride, (GLvoid*)0);
+			glVertexAttribPointer(BoneWeightIndex, 4, GL_UNSIGNED_BYTE, GL_TRUE, boneStride, (GLvoid*)(4 * sizeof(GLubyte)));
 		}
 		else
 		{
-			glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+			glVertexAttribIPointer(BoneIndexIndex, 4, GL_UNSIGNED_INT, boneStride, (GLvoid*)0);
+			glVertexAttribPointer(BoneWeightIndex, 4, GL_FLOAT, GL_FALSE, boneStride, (GLvoid*)(4 * sizeof(GLuint)));
 		}
-		//glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+		glEnableVertexAttribArray(BoneIndexIndex);
+		glEnableVertexAttribArray(BoneWeightIndex);
+		
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
+		GLStateCache::BindVertexArray(0);
+		
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_TFBO);
+		GLStateCache::BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_animationOutputPositionVBO);
+		GLStateCache::BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, m_animationOutputNormalVBO);
+		GLStateCache::BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 2, m_animationOutputTangentVBO);
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+		
+		GLStateCache::BindVertexArray(m_VAO);
+		
+		GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+		
+		// skinned position, normal and tangent are written by transform feedback as floats
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_animationOutputPositionVBO);
+		glVertexAttribPointer(PositionIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+		glEnableVertexAttribArray(PositionIndex);
+		
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_animationOutputNormalVBO);
 		glVertexAttribPointer(NormalIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
 		glEnableVertexAttribArray(NormalIndex);
 		
-		glBindBuffer(GL_ARRAY_BUFFER, m_uvVBO);
-		glVertexAttribPointer(UVIndex, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_animationOutputTangentVBO);
+		glVertexAttribPointer(TangentIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+		glEnableVertexAttribArray(TangentIndex);
+		
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_attributeVBO);
+		glVertexAttribPointer(UVIndex, 2, layout.uvType, GL_FALSE, layout.stride, (GLvoid*)layout.uvOffset);
 		glEnableVertexAttribArray(UVIndex);
 		
-		if (m_skinned)
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0); // Note that this is allowed, the call to glVertexAttribPointer registered VBO as the currently bound vertex buffer object so afterwards we can safely unbind
+		
+		GLStateCache::BindVertexArray(0); // Unbind VAO (it's always a good thing to unbind any buffer/array to prevent strange bugs), remember: do NOT unbind the EBO, keep it bound to this VAO
+	}
+
+	void Mesh::SetupVertexStreams(VertexCompression compression, GLuint positionVBO, GLuint attributeVBO)
+	{
+		const auto layout = GetAttributeLayout(compression);
+		const GLboolean normalized = layout.normalType == GL_FLOAT ? GL_FALSE : GL_TRUE;
+		
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, positionVBO);
+		glVertexAttribPointer(PositionIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+		glEnableVertexAttribArray(PositionIndex);
+		
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, attributeVBO);
+		glVertexAttribPointer(NormalIndex, layout.normalSize, layout.normalType, normalized, layout.stride, (GLvoid*)layout.normalOffset);
+		glEnableVertexAttribArray(NormalIndex);
+		
+		glVertexAttribPointer(TangentIndex, layout.normalSize, layout.normalType, normalized, layout.stride, (GLvoid*)layout.tangentOffset);
+		glEnableVertexAttribArray(TangentIndex);
+		
+		glVertexAttribPointer(UVIndex, 2, layout.uvType, GL_FALSE, layout.stride, (GLvoid*)layout.uvOffset);
+		glEnableVertexAttribArray(UVIndex);
+	}
+
+	void Mesh::GetSubMeshRange(int subMeshIndex, uint32_t & firstIndex, uint32_t & indexCount) const
+	{
+		if (subMeshIndex < 0 || subMeshIndex >= m_subMeshCount || m_subMeshCount == 1)
 		{
-			glBindBuffer(GL_ARRAY_BUFFER, m_animationOutputTangentVBO);
+			firstIndex = 0;
+			indexCount = m_triangleCount * 3;
+			return;
 		}
+		firstIndex = m_subMeshIndexOffset[subMeshIndex];
+		if (subMeshIndex == m_subMeshCount-1) // the last one
+			indexCount = m_triangleCount * 3 - firstIndex;
 		else
+			indexCount = m_subMeshIndexOffset[subMeshIndex+1] - firstIndex;
+	}
+
+	MeshPool::DrawCommand Mesh::GetDrawCommand(int subMeshIndex, int subMeshCount, uint32_t drawID) const
+	{
+		assert(pooled());
+		uint32_t firstIndex, indexCount;
+		GetSubMeshRange(subMeshIndex, firstIndex, indexCount);
+		if (subMeshCount > 1 && subMeshIndex >= 0 && subMeshIndex + subMeshCount <= m_subMeshCount)
 		{
-			glBindBuffer(GL_ARRAY_BUFFER, m_tangentVBO);
+			uint32_t lastFirstIndex, lastIndexCount;
+			GetSubMeshRange(subMeshIndex + subMeshCount - 1, lastFirstIndex, lastIndexCount);
+			indexCount = lastFirstIndex + lastIndexCount - firstIndex;
 		}
-		//glBindBuffer(GL_ARRAY_BUFFER, m_tangentVBO);
-		glVertexAttribPointer(TangentIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-		glEnableVertexAttribArray(TangentIndex);
-		
-		glBindBuffer(GL_ARRAY_BUFFER, 0); // Note that this is allowed, the call to glVertexAttribPointer registered VBO as the currently bound vertex buffer object so afterwards we can safely unbind
-		
-		glBindVertexArray(0); // Unbind VAO (it's always a good thing to unbind any buffer/array to prevent strange bugs), remember: do NOT unbind the EBO, keep it bound to this VAO
+		return { indexCount, 1, m_poolAllocation.firstIndex + firstIndex, static_cast<int32_t>(m_poolAllocation.baseVertex), drawID };
+	}
+
+	bool Mesh::ReadMeshData(
+		std::vector<Vector3> &	outVertices,
+		std::vector<Vector3> &	outNormals,
+		std::vector<Vector3> &	outTangents,
+		std::vector<Vector2> &	outUV,
+		std::vector<uint32_t> &	outTriangles) const
+	{
+		if (!m_uploaded || m_isReadable)
+		{
+			outVertices = m_vertices;
+			outNormals = m_normals;
+			outTangents = m_tangents;
+			outUV = m_uv;
+			outTriangles = m_triangles;
+			return true;
+		}
+		if (!pooled())
+			return false;
+
+		std::vector<uint8_t> positions, attributes, indices;
+		MeshPool::Read(m_poolAllocation, positions, attributes, indices);
+
+		outVertices.resize(m_vertexCount);
+		for (uint32_t i = 0; i < m_vertexCount; ++i)
+		{
+			outVertices[i] = Read<Vector3>(positions, i * 3 * sizeof(float));
+		}
+
+		const auto layout = GetAttributeLayout(m_vertexCompression);
+		outNormals.resize(m_vertexCount);
+		outTangents.resize(m_vertexCount);
+		outUV.resize(m_vertexCount);
+		for (uint32_t i = 0; i < m_vertexCount; ++i)
+		{
+			const std::size_t base = i * layout.stride;
+			if (layout.normalType == GL_FLOAT)
+			{
+				outNormals[i] = Read<Vector3>(attributes, base + layout.normalOffset);
+				outTangents[i] = Read<Vector3>(attributes, base + layout.tangentOffset);
+			}
+			else
+			{
+				outNormals[i] = UnpackNormal(Read<uint32_t>(attributes, base + layout.normalOffset));
+				outTangents[i] = UnpackNormal(Read<uint32_t>(attributes, base + layout.tangentOffset));
+			}
+			if (layout.uvType == GL_FLOAT)
+			{
+				outUV[i] = Read<Vector2>(attributes, base + layout.uvOffset);
+			}
+			else
+			{
+				const auto uv = Read<std::array<uint16_t, 2>>(attributes, base + layout.uvOffset);
+				outUV[i] = Vector2(Mathf::HalfToFloat(uv[0]), Mathf::HalfToFloat(uv[1]));
+			}
+		}
+
+		const uint32_t indexCount = m_poolAllocation.indexCount;
+		outTriangles.resize(indexCount);
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			outTriangles[i] = m_indexType == GL_UNSIGNED_SHORT ? Read<uint16_t>(indices, i * sizeof(uint16_t)) : Read<uint32_t>(indices, i * sizeof(uint32_t));
+		}
+		return true;
 	}
 
 	void Mesh::Render( int subMeshIndex /* = -1*/)
@@ -301,7 +595,7 @@ namespace FishEngine
 			UploadMeshData();
 		}
 		
-		glBindVertexArray(m_VAO);
+		GLStateCache::BindVertexArray(pooled() ? MeshPool::vertexArray(m_poolAllocation.pool) : m_VAO);
 			
 		if (subMeshIndex < 0 && subMeshIndex != -1)
 		{
@@ -311,30 +605,14 @@ namespace FishEngine
 		else if (subMeshIndex >= m_subMeshCount)
 		{
 			//Debug::LogWarning("invalid subMeshIndex %d", subMeshIndex);
-			subMeshIndex = m_subMeshCount;
-		}
-			
-		if (subMeshIndex == -1 || m_subMeshCount == 1)
-		{
-			glDrawElements(GL_TRIANGLES, m_triangleCount * 3, GL_UNSIGNED_INT, 0);
-		}
-		else
-		{
-			GLvoid * offset = (GLvoid *)( m_subMeshIndexOffset[subMeshIndex] * sizeof(GLuint) );
-			int index_count = 0;
-			if (subMeshIndex == m_subMeshCount-1) // the last one
-			{
-				index_count = m_triangleCount * 3 - m_subMeshIndexOffset[m_subMeshCount-1];
-				//index_count = 0;
-			}
-			else
-			{
-				index_count = m_subMeshIndexOffset[subMeshIndex+1] - m_subMeshIndexOffset[subMeshIndex];
-			}
-			glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, offset);
+			subMeshIndex = -1;
 		}
 		
-		glBindVertexArray(0);
+		uint32_t firstIndex, indexCount;
+		GetSubMeshRange(subMeshIndex, firstIndex, indexCount);
+		firstIndex += m_poolAllocation.firstIndex;
+		glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, m_indexType, reinterpret_cast<GLvoid *>(static_cast<uintptr_t>(firstIndex * indexSize())), m_poolAllocation.baseVertex);
+		// the VAO stays bound, GLStateCache skips rebinding it for consecutive draws of this mesh or pool
 	}
 	
 	void Mesh::RenderSkinned()
@@ -345,8 +623,8 @@ namespace FishEngine
 		}
 		
 		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_TFBO);
-		glEnable(GL_RASTERIZER_DISCARD);
-		glBindVertexArray(m_animationInputVAO);
+		GLStateCache::Enable(GL_RASTERIZER_DISCARD);
+		GLStateCache::BindVertexArray(m_animationInputVAO);
 		//glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, m_animationOutputPositionVBO);
 		//glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_animationOutputPositionVBO);
 		glBeginTransformFeedback(GL_POINTS);
@@ -354,9 +632,9 @@ namespace FishEngine
 		glEndTransformFeedback();
 		//glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
 		//glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
-		glBindVertexArray(0);
+		GLStateCache::BindVertexArray(0);
 		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
-		glDisable(GL_RASTERIZER_DISCARD);
+		GLStateCache::Disable(GL_RASTERIZER_DISCARD);
 		glCheckError();
 	}
 
@@ -467,9 +745,9 @@ namespace FishEngine
 		m_drawMode(drawMode)
 	{
 		glGenVertexArrays(1, &m_VAO);
-		glBindVertexArray(m_VAO);
+		GLStateCache::BindVertexArray(m_VAO);
 		glGenBuffers(1, &m_VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
 		glBufferData(GL_ARRAY_BUFFER, m_positionBuffer.size() * sizeof(GLfloat), m_positionBuffer.data(), GL_DYNAMIC_DRAW);
 		glVertexAttribPointer(PositionIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
 		glEnableVertexAttribArray(PositionIndex);
@@ -486,23 +764,22 @@ namespace FishEngine
 
 	void SimpleMesh::Render() const
 	{
-		glBindVertexArray(m_VAO);
+		GLStateCache::BindVertexArray(m_VAO);
 		glDrawArrays(m_drawMode, 0, static_cast<GLsizei>(m_positionBuffer.size() / 3));
-		glBindVertexArray(0);
 	}
 
 	void DynamicMesh::Render(const float* positionBuffer, uint32_t vertexCount, GLenum drawMode)
 	{
 		if (m_VAO == 0)
 			glGenVertexArrays(1, &m_VAO);
-		glBindVertexArray(m_VAO);
+		GLStateCache::BindVertexArray(m_VAO);
 		if (m_VBO == 0)
 			glGenBuffers(1, &m_VBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
 		glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(GLfloat), positionBuffer, GL_DYNAMIC_DRAW);
 		glVertexAttribPointer(PositionIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
 		glEnableVertexAttribArray(PositionIndex);
 		glDrawArrays(m_drawMode, 0, vertexCount);
-		glBindVertexArray(0);
+		GLStateCache::BindVertexArray(0);
 	}
 }
@@ -11,14 +11,28 @@
 #include "BoneWeight.hpp"
 #include "Vector3.hpp"
 #include "Vector2.hpp"
+#include "MeshPool.hpp"
+#include "OcclusionCulling.hpp"
 
 namespace FishEditor
 {
 	class FBXImporter;
+	class MeshOptimizer;
+	class MeshSimplifier;
 }
 
 namespace FishEngine
 {
+	// GPU storage format of the vertex attributes, chosen per mesh at import time.
+	// Positions always stay float3 in their own stream (depth and shadow passes only need this stream),
+	// the other attributes are interleaved in a second stream and bone data in a third one.
+	enum class VertexCompression
+	{
+		None,			// float normals, tangents and uvs, 32-bit bone indices, float bone weights
+		PackedNormals,	// normals and tangents as normalized GL_INT_2_10_10_10_REV
+		PackedAll,		// PackedNormals + half float uvs, 8-bit bone indices and weights
+	};
+
 	class FE_EXPORT Mesh : public Object
 	{
 	public:
@@ -67,6 +81,12 @@ namespace FishEngine
 		{
 			return m_vertexCount;
 		}
+
+		// Returns the number of triangles in the Mesh, all sub-meshes together (Read Only).
+		uint32_t triangleCount() const
+		{
+			return m_triangleCount;
+		}
 		
 		// The number of sub-Meshes. Every Mesh has a separate triangle list.
 		// See Also: GetTriangles, SetTriangles.
@@ -76,6 +96,29 @@ namespace FishEngine
 		}
 		
 		
+		VertexCompression vertexCompression() const
+		{
+			return m_vertexCompression;
+		}
+
+		// Has no effect after the mesh is uploaded.
+		void setVertexCompression(VertexCompression compression)
+		{
+			m_vertexCompression = compression;
+		}
+
+		// Size in bytes of one vertex in GPU memory, all vertex streams together.
+		uint32_t vertexStride() const;
+
+		// Size in bytes of one vertex with float attributes and 32-bit bone indices.
+		uint32_t uncompressedVertexStride() const;
+
+		// Size in bytes of one index: 2 when vertexCount <= 65535, otherwise 4.
+		uint32_t indexSize() const
+		{
+			return m_vertexCount <= 0xFFFF ? 2 : 4;
+		}
+
 		const std::vector<BoneWeight> & boneWeights() const
 		{
 			return m_boneWeights;
@@ -177,6 +220,38 @@ namespace FishEngine
 		void Render(int subMeshIndex = -1);
 		
 		void RenderSkinned();
+
+		// Static meshes are stored in a MeshPool once uploaded, skinned meshes keep their own buffers.
+		bool pooled() const
+		{
+			return m_poolAllocation.pool >= 0;
+		}
+
+		int pool() const
+		{
+			return m_poolAllocation.pool;
+		}
+
+		// The largest triangles of a static mesh, kept for OcclusionCulling when the mesh is uploaded. null for
+		// skinned meshes.
+		OccluderMeshPtr const & occluderMesh() const
+		{
+			return m_occluderMesh;
+		}
+
+		// Command drawing subMeshCount consecutive sub-meshes from subMeshIndex (-1: all) of a pooled mesh in a
+		// MeshPool::MultiDraw, as one index range.
+		MeshPool::DrawCommand GetDrawCommand(int subMeshIndex, int subMeshCount, uint32_t drawID) const;
+
+		// The vertices, normals, tangents, uvs and triangles of a static mesh, also once it is no longer readable: they
+		// are then read back from its MeshPool and decoded (slow, for load time processing only).
+		// false if the mesh is skinned and not readable.
+		bool ReadMeshData(
+			std::vector<Vector3> &	outVertices,
+			std::vector<Vector3> &	outNormals,
+			std::vector<Vector3> &	outTangents,
+			std::vector<Vector2> &	outUV,
+			std::vector<uint32_t> &	outTriangles) const;
 		
 		//void renderPatch(const Shader& shader);
 		// Returns the number of vertices in the Mesh
@@ -234,8 +309,12 @@ namespace FishEngine
 		friend class FishEditor::Inspector;
 		friend class FishEditor::ModelImporter;
 		friend class FishEditor::FBXImporter;
+		friend class FishEditor::MeshOptimizer;
+		friend class FishEditor::MeshSimplifier;
 		friend class MeshRenderer;
 		friend class SkinnedMeshRenderer;
+		friend class MeshPool;
+		friend class StaticBatchingUtility;
 		//friend class Model;
 
 		static std::map<PrimitiveType, MeshPtr> s_builtinMeshes;
@@ -248,28 +327,29 @@ namespace FishEngine
 		Bounds m_bounds;
 
 		Meta(NonSerializable)
-		GLuint m_VAO = 0;
-
-		Meta(NonSerializable)
-		GLuint m_indexVBO = 0;
+		VertexCompression m_vertexCompression = VertexCompression::None;
 
+		// skinned meshes only, pooled meshes use the VAO of their pool
 		Meta(NonSerializable)
-		GLuint m_positionVBO = 0;
+		GLuint m_VAO = 0;
 
 		Meta(NonSerializable)
-		GLuint m_normalVBO = 0;
+		GLuint m_indexVBO = 0;
 
+		// GL_UNSIGNED_SHORT when vertexCount <= 65535, set in GenerateBuffer
 		Meta(NonSerializable)
-		GLuint m_uvVBO = 0;
+		GLenum m_indexType = GL_UNSIGNED_INT;
 
 		Meta(NonSerializable)
-		GLuint m_tangentVBO = 0;
+		GLuint m_positionVBO = 0;
 
+		// interleaved normal, tangent and uv
 		Meta(NonSerializable)
-		GLuint m_boneIndexVBO = 0;
+		GLuint m_attributeVBO = 0;
 
+		// interleaved bone indices and bone weights, skinned meshes only
 		Meta(NonSerializable)
-		GLuint m_boneWeightVBO = 0;
+		GLuint m_boneVBO = 0;
 
 		Meta(NonSerializable)
 		GLuint m_TFBO = 0;				// transform feedback buffer object, for Animation
@@ -286,8 +366,21 @@ namespace FishEngine
 		Meta(NonSerializable)
 		GLuint m_animationOutputTangentVBO = 0;
 
+		// vertices and indices in the MeshPool, static meshes only
+		Meta(NonSerializable)
+		MeshPool::Allocation m_poolAllocation;
+
+		Meta(NonSerializable)
+		OccluderMeshPtr m_occluderMesh;
+
 		void GenerateBuffer();
 		void BindBuffer();
+
+		// index range of a sub-mesh, all sub-meshes for -1
+		void GetSubMeshRange(int subMeshIndex, uint32_t & firstIndex, uint32_t & indexCount) const;
+
+		// position, normal, tangent and uv attributes of the bound VAO, from the two streams of GenerateBuffer
+		static void SetupVertexStreams(VertexCompression compression, GLuint positionVBO, GLuint attributeVBO);
 	};
 
 
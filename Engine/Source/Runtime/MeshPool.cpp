@@ -0,0 +1,386 @@
+#include "MeshPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
+#include "Debug.hpp"
+#include "Mesh.hpp"
+#include "JobSystem.hpp"
+#include "ShaderVariables_gen.hpp"
+
+namespace
+{
+	using namespace FishEngine;
+
+	// the first mesh of a layout gets a pool of this size, full pools double
+	constexpr uint32_t InitialVertexCapacity = 1 << 16;
+	constexpr uint32_t InitialIndexCapacity = 1 << 18;
+
+	std::size_t IndexSize(GLenum indexType)
+	{
+		return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	}
+
+	// first fit in a list of free ranges (offset -> size)
+	bool AllocateRange(std::map<uint32_t, uint32_t> & freeRanges, uint32_t size, uint32_t & offset)
+	{
+		for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+		{
+			if (it->second < size)
+				continue;
+			offset = it->first;
+			const uint32_t rest = it->second - size;
+			freeRanges.erase(it);
+			if (rest > 0)
+				freeRanges[offset + size] = rest;
+			return true;
+		}
+		return false;
+	}
+
+	// merged with its neighbours
+	void FreeRange(std::map<uint32_t, uint32_t> & freeRanges, uint32_t offset, uint32_t size)
+	{
+		if (size == 0)
+			return;
+		auto next = freeRanges.lower_bound(offset);
+		if (next != freeRanges.begin())
+		{
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset)
+			{
+				offset = prev->first;
+				size += prev->second;
+				freeRanges.erase(prev);
+			}
+		}
+		if (next != freeRanges.end() && offset + size == next->first)
+		{
+			size += next->second;
+			freeRanges.erase(next);
+		}
+		freeRanges[offset] = size;
+	}
+
+	// a larger copy of buffer, the old one is deleted
+	GLuint GrowBuffer(GLuint buffer, std::size_t oldSize, std::size_t newSize)
+	{
+		GLuint newBuffer = 0;
+		glGenBuffers(1, &newBuffer);
+		GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+		if (buffer != 0)
+		{
+			GLStateCache::BindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+			GLStateCache::OnDeleteBuffer(buffer);
+			glDeleteBuffers(1, &buffer);
+		}
+		return newBuffer;
+	}
+
+	void UploadRange(GLuint buffer, std::size_t offset, std::size_t size, void const * data)
+	{
+		GLStateCache::BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+	}
+}
+
+namespace FishEngine
+{
+	std::vector<MeshPool::Pool>		MeshPool::s_pools;
+	unsigned int					MeshPool::s_drawIDBuffer = 0;
+	unsigned int					MeshPool::s_indirectBuffer = 0;
+	MeshPool::Statistics			MeshPool::s_statistics;
+
+	bool MeshPool::MultiDrawIndirectSupported()
+	{
+		// glMultiDrawElementsIndirect is GL 4.3, the draw ID needs baseInstance (GL 4.2).
+		// Not available on macOS (GL 4.1).
+#if FISHENGINE_PLATFORM_WINDOWS
+		static const bool supported = GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	MeshPool::Allocation MeshPool::Allocate(
+		VertexCompression	compression,
+		uint32_t			attributeStride,
+		unsigned int		indexType,
+		uint32_t			vertexCount,
+		void const *		positions,
+		void const *		attributes,
+		uint32_t			indexCount,
+		void const *		indices)
+	{
+		Allocation allocation;
+		allocation.pool = FindOrCreatePool(compression, attributeStride, indexType);
+		auto & pool = s_pools[allocation.pool];
+
+		const bool gotVertices = AllocateRange(pool.freeVertices, vertexCount, allocation.baseVertex);
+		const bool gotIndices = gotVertices && AllocateRange(pool.freeIndices, indexCount, allocation.firstIndex);
+		if (!gotIndices)
+		{
+			uint32_t vertexCapacity = pool.vertexCapacity;
+			uint32_t indexCapacity = pool.indexCapacity;
+			if (gotVertices)
+			{
+				FreeRange(pool.freeVertices, allocation.baseVertex, vertexCount);
+				while (indexCapacity < pool.indexCapacity + indexCount)
+					indexCapacity *= 2;
+			}
+			else
+			{
+				while (vertexCapacity < pool.vertexCapacity + vertexCount)
+					vertexCapacity *= 2;
+			}
+			Grow(pool, vertexCapacity, indexCapacity);
+			return Allocate(compression, attributeStride, indexType, vertexCount, positions, attributes, indexCount, indices);
+		}
+		allocation.vertexCount = vertexCount;
+		allocation.indexCount = indexCount;
+
+		// GL_COPY_WRITE_BUFFER: binding GL_ELEMENT_ARRAY_BUFFER would change the bound VAO
+		const std::size_t indexSize = IndexSize(indexType);
+		UploadRange(pool.positionBuffer, allocation.baseVertex * 3 * sizeof(GLfloat), vertexCount * 3 * sizeof(GLfloat), positions);
+		UploadRange(pool.attributeBuffer, allocation.baseVertex * attributeStride, vertexCount * attributeStride, attributes);
+		UploadRange(pool.indexBuffer, allocation.firstIndex * indexSize, indexCount * indexSize, indices);
+		glCheckError();
+
+		s_statistics.meshes++;
+		s_statistics.usedBytes += vertexCount * (3 * sizeof(GLfloat) + attributeStride) + indexCount * indexSize;
+		return allocation;
+	}
+
+	void MeshPool::Free(Allocation & allocation)
+	{
+		if (allocation.pool < 0)
+			return;
+		auto & pool = s_pools[allocation.pool];
+		FreeRange(pool.freeVertices, allocation.baseVertex, allocation.vertexCount);
+		FreeRange(pool.freeIndices, allocation.firstIndex, allocation.indexCount);
+		s_statistics.meshes--;
+		s_statistics.usedBytes -= allocation.vertexCount * (3 * sizeof(GLfloat) + pool.attributeStride) + allocation.indexCount * IndexSize(pool.indexType);
+		allocation = Allocation();
+	}
+
+	void MeshPool::Read(
+		Allocation const &		allocation,
+		std::vector<uint8_t> &	outPositions,
+		std::vector<uint8_t> &	outAttributes,
+		std::vector<uint8_t> &	outIndices)
+	{
+		assert(allocation.pool >= 0);
+		auto const & pool = s_pools[allocation.pool];
+		const std::size_t indexSize = IndexSize(pool.indexType);
+		auto read = [](GLuint buffer, std::size_t offset, std::size_t size, std::vector<uint8_t> & out)
+		{
+			out.resize(size);
+			GLStateCache::BindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, offset, size, out.data());
+		};
+		read(pool.positionBuffer, allocation.baseVertex * 3 * sizeof(GLfloat), allocation.vertexCount * 3 * sizeof(GLfloat), outPositions);
+		read(pool.attributeBuffer, allocation.baseVertex * pool.attributeStride, allocation.vertexCount * pool.attributeStride, outAttributes);
+		read(pool.indexBuffer, allocation.firstIndex * indexSize, allocation.indexCount * indexSize, outIndices);
+		glCheckError();
+	}
+
+	unsigned int MeshPool::vertexArray(int pool)
+	{
+		return s_pools[pool].vertexArray;
+	}
+
+	unsigned int MeshPool::indexType(int pool)
+	{
+		return s_pools[pool].indexType;
+	}
+
+	int MeshPool::FindOrCreatePool(VertexCompression compression, uint32_t attributeStride, unsigned int indexType)
+	{
+		for (std::size_t i = 0; i < s_pools.size(); ++i)
+		{
+			if (s_pools[i].compression == compression && s_pools[i].indexType == indexType)
+				return static_cast<int>(i);
+		}
+
+		if (s_drawIDBuffer == 0)
+		{
+			std::vector<GLuint> drawIDs(MaxDrawIDs);
+			for (uint32_t i = 0; i < MaxDrawIDs; ++i)
+				drawIDs[i] = i;
+			glGenBuffers(1, &s_drawIDBuffer);
+			GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_drawIDBuffer);
+			glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(GLuint), drawIDs.data(), GL_STATIC_DRAW);
+			GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
+			glGenBuffers(1, &s_indirectBuffer);
+		}
+
+		Pool pool;
+		pool.compression = compression;
+		pool.attributeStride = attributeStride;
+		pool.indexType = indexType;
+		glGenVertexArrays(1, &pool.vertexArray);
+		Grow(pool, InitialVertexCapacity, InitialIndexCapacity);
+		s_pools.push_back(std::move(pool));
+		s_statistics.pools++;
+		return static_cast<int>(s_pools.size() - 1);
+	}
+
+	void MeshPool::Grow(Pool & pool, uint32_t vertexCapacity, uint32_t indexCapacity)
+	{
+		const std::size_t indexSize = IndexSize(pool.indexType);
+		if (vertexCapacity > pool.vertexCapacity)
+		{
+			pool.positionBuffer = GrowBuffer(pool.positionBuffer, pool.vertexCapacity * 3 * sizeof(GLfloat), vertexCapacity * 3 * sizeof(GLfloat));
+			pool.attributeBuffer = GrowBuffer(pool.attributeBuffer, pool.vertexCapacity * pool.attributeStride, vertexCapacity * pool.attributeStride);
+			FreeRange(pool.freeVertices, pool.vertexCapacity, vertexCapacity - pool.vertexCapacity);
+			s_statistics.allocatedBytes += (vertexCapacity - pool.vertexCapacity) * (3 * sizeof(GLfloat) + pool.attributeStride);
+			pool.vertexCapacity = vertexCapacity;
+		}
+		if (indexCapacity > pool.indexCapacity)
+		{
+			pool.indexBuffer = GrowBuffer(pool.indexBuffer, pool.indexCapacity * indexSize, indexCapacity * indexSize);
+			FreeRange(pool.freeIndices, pool.indexCapacity, indexCapacity - pool.indexCapacity);
+			s_statistics.allocatedBytes += (indexCapacity - pool.indexCapacity) * indexSize;
+			pool.indexCapacity = indexCapacity;
+		}
+		if (pool.vertexCapacity > InitialVertexCapacity || pool.indexCapacity > InitialIndexCapacity)
+		{
+			LogInfo(Format("MeshPool: %1% vertices, %2% indices", pool.vertexCapacity, pool.indexCapacity));
+		}
+
+		// same VAO, the meshes of the pool keep using it
+		SetupVertexArray(pool);
+		glCheckError();
+	}
+
+	void MeshPool::SetupVertexArray(Pool & pool)
+	{
+		GLStateCache::BindVertexArray(pool.vertexArray);
+		GLStateCache::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer);
+		Mesh::SetupVertexStreams(pool.compression, pool.positionBuffer, pool.attributeBuffer);
+
+		// instanced: each draw reads the entry at its baseInstance
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_drawIDBuffer);
+		glVertexAttribIPointer(DrawIDIndex, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid*)0);
+		glVertexAttribDivisor(DrawIDIndex, 1);
+		glEnableVertexAttribArray(DrawIDIndex);
+
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
+		GLStateCache::BindVertexArray(0);
+	}
+
+	void MeshPool::MultiDraw(int pool, DrawCommand const * commands, std::size_t count)
+	{
+		if (count == 0)
+			return;
+		auto const & p = s_pools[pool];
+		GLStateCache::BindVertexArray(p.vertexArray);
+
+#if FISHENGINE_PLATFORM_WINDOWS
+		if (MultiDrawIndirectSupported())
+		{
+			GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, s_indirectBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, count * sizeof(DrawCommand), commands, GL_STREAM_DRAW);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, p.indexType, nullptr, static_cast<GLsizei>(count), 0);
+		}
+		else
+#endif
+		{
+			// no baseInstance: point the draw ID attribute at the entry of each draw instead
+			const std::size_t indexSize = IndexSize(p.indexType);
+			GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_drawIDBuffer);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				auto const & c = commands[i];
+				glVertexAttribIPointer(DrawIDIndex, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid*)(c.baseInstance * sizeof(GLuint)));
+				glDrawElementsBaseVertex(GL_TRIANGLES, c.count, p.indexType, (GLvoid*)(c.firstIndex * indexSize), c.baseVertex);
+			}
+			glVertexAttribIPointer(DrawIDIndex, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid*)0);
+			GLStateCache::BindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		s_statistics.multiDraws++;
+		s_statistics.multiDrawCommands += static_cast<uint32_t>(count);
+	}
+
+	void MeshPool::MultiDrawIndirect(int pool, unsigned int commandBuffer, std::size_t firstCommand, std::size_t count)
+	{
+		if (count == 0)
+			return;
+#if FISHENGINE_PLATFORM_WINDOWS
+		assert(MultiDrawIndirectSupported());
+		auto const & p = s_pools[pool];
+		GLStateCache::BindVertexArray(p.vertexArray);
+		GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, p.indexType, (GLvoid*)(firstCommand * sizeof(DrawCommand)), static_cast<GLsizei>(count), 0);
+		s_statistics.multiDraws++;
+		s_statistics.multiDrawCommands += static_cast<uint32_t>(count);
+#else
+		LogError("MeshPool::MultiDrawIndirect: not supported");
+		abort();
+#endif
+	}
+
+	void MeshPool::BuildMultiDraws(
+		std::vector<Draw> const &	draws,
+		std::vector<Batch> &		outBatches,
+		std::vector<DrawCommand> &	outCommands,
+		std::vector<uint32_t> &		outOrder)
+	{
+		assert(draws.size() <= MaxDrawIDs);
+		outBatches.clear();
+
+		std::map<std::pair<void const *, int>, std::size_t> batchIndices;
+		std::vector<std::size_t> batchOfDraw(draws.size());
+		for (std::size_t i = 0; i < draws.size(); ++i)
+		{
+			auto const & draw = draws[i];
+			auto key = std::make_pair(draw.state, draw.mesh->m_poolAllocation.pool);
+			auto it = batchIndices.find(key);
+			if (it == batchIndices.end())
+			{
+				it = batchIndices.emplace(key, outBatches.size()).first;
+				outBatches.push_back({ key.first, key.second, 0, 0 });
+			}
+			batchOfDraw[i] = it->second;
+			outBatches[it->second].count++;
+		}
+
+		std::size_t first = 0;
+		for (auto & batch : outBatches)
+		{
+			batch.first = first;
+			first += batch.count;
+		}
+
+		outOrder.resize(draws.size());
+		std::vector<std::size_t> cursor(outBatches.size());
+		for (std::size_t i = 0; i < outBatches.size(); ++i)
+			cursor[i] = outBatches[i].first;
+		for (std::size_t i = 0; i < draws.size(); ++i)
+			outOrder[cursor[batchOfDraw[i]]++] = static_cast<uint32_t>(i);
+
+		outCommands.resize(draws.size());
+		auto build = [&draws, &outCommands, &outOrder](std::size_t i)
+		{
+			auto const & draw = draws[outOrder[i]];
+			outCommands[i] = draw.mesh->GetDrawCommand(draw.subMeshIndex, draw.subMeshCount, static_cast<uint32_t>(i));
+		};
+
+		constexpr std::size_t ParallelThreshold = 256;
+		if (draws.size() < ParallelThreshold)
+		{
+			for (std::size_t i = 0; i < draws.size(); ++i)
+				build(i);
+		}
+		else
+		{
+			JobSystem::ParallelFor(0, draws.size(), build, 64, "MeshPool.BuildCommands");
+		}
+	}
+}
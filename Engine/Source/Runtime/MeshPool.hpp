@@ -0,0 +1,157 @@
+#ifndef MeshPool_hpp
+#define MeshPool_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+
+#include <map>
+#include <vector>
+
+namespace FishEngine
+{
+	enum class VertexCompression;
+
+	// Shared vertex and index buffers for static meshes.
+	// Every vertex layout (VertexCompression and index type) has one pool: a position stream, an attribute stream,
+	// an index buffer and one VAO. Meshes get a range of vertices and indices in the pool of their layout and are
+	// drawn with a base vertex, so any number of meshes can be drawn without rebinding the VAO, and consecutive draws
+	// with the same state are merged into one MultiDraw.
+	//
+	// MultiDraw draws carry a draw ID (vertex attribute DrawIDIndex, instanced) that indexes the per-draw data
+	// uploaded with Pipeline::UpdatePerDrawBatch, read by the ShaderKeyword::IndirectDraw variant of the shaders.
+	// With GL 4.3 (or ARB_multi_draw_indirect) a MultiDraw is one glMultiDrawElementsIndirect, the draw ID comes from
+	// baseInstance. GL 4.1 (macOS) has neither, there the draws are issued one by one from the same command list.
+	class FE_EXPORT Meta(NonSerializable) MeshPool
+	{
+	public:
+		MeshPool() = delete;
+
+		// draw IDs of a MultiDraw are in [0, MaxDrawIDs)
+		static constexpr uint32_t MaxDrawIDs = 65536;
+
+		// vertices and indices of a mesh in a pool
+		struct Allocation
+		{
+			int			pool = -1;		// -1: not in a pool
+			uint32_t	baseVertex = 0;
+			uint32_t	firstIndex = 0;
+			uint32_t	vertexCount = 0;
+			uint32_t	indexCount = 0;
+		};
+
+		// same layout as DrawElementsIndirectCommand
+		struct DrawCommand
+		{
+			uint32_t	count;
+			uint32_t	instanceCount;
+			uint32_t	firstIndex;		// in the index buffer of the pool
+			int32_t		baseVertex;
+			uint32_t	baseInstance;	// draw ID
+		};
+
+		// Copy the vertex streams and the indices of a mesh into the pool of its layout.
+		// positions: vertexCount float3, attributes: vertexCount * attributeStride bytes (see Mesh::GenerateBuffer),
+		// indices: indexCount GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, relative to the first vertex of the mesh.
+		static Allocation Allocate(
+			VertexCompression	compression,
+			uint32_t			attributeStride,
+			unsigned int		indexType,
+			uint32_t			vertexCount,
+			void const *		positions,
+			void const *		attributes,
+			uint32_t			indexCount,
+			void const *		indices);
+
+		static void Free(Allocation & allocation);
+
+		// Copy the vertex streams and the indices of an allocation back from the GPU, in the layout given to Allocate.
+		// Stalls until the buffers are written, for load time processing only (e.g. StaticBatchingUtility).
+		static void Read(
+			Allocation const &		allocation,
+			std::vector<uint8_t> &	outPositions,
+			std::vector<uint8_t> &	outAttributes,
+			std::vector<uint8_t> &	outIndices);
+
+		static unsigned int vertexArray(int pool);
+		static unsigned int indexType(int pool);
+
+		// One draw per command with the VAO of pool, the program and the per-draw data are set by the caller.
+		static void MultiDraw(int pool, DrawCommand const * commands, std::size_t count);
+
+		// Same as MultiDraw, with count commands from firstCommand in a GL_DRAW_INDIRECT_BUFFER written on the GPU
+		// (see HiZCulling). MultiDrawIndirectSupported only.
+		static void MultiDrawIndirect(int pool, unsigned int commandBuffer, std::size_t firstCommand, std::size_t count);
+
+		static bool MultiDrawIndirectSupported();
+
+		// A draw that may be merged with the other draws of the same state and pool. state is a key of the caller,
+		// e.g. the material.
+		struct Draw
+		{
+			Mesh const *	mesh;		// uploaded, in a pool
+			int				subMeshIndex;
+			int				subMeshCount;	// consecutive sub-meshes from subMeshIndex, drawn as one index range
+			void const *	state;
+		};
+
+		// commands [first, first + count) of a state and pool
+		struct Batch
+		{
+			void const *	state;
+			int				pool;
+			std::size_t		first;
+			std::size_t		count;
+		};
+
+		// Group draws (at most MaxDrawIDs) by state and pool, in the order each group first appears.
+		// The draw ID of commands[i] is i, draws[order[i]] is the draw it comes from: the caller uploads the per-draw
+		// data in this order. Large lists are split across JobSystem workers.
+		static void BuildMultiDraws(
+			std::vector<Draw> const &	draws,
+			std::vector<Batch> &		outBatches,
+			std::vector<DrawCommand> &	outCommands,
+			std::vector<uint32_t> &		outOrder);
+
+		struct Statistics
+		{
+			int			pools = 0;
+			int			meshes = 0;
+			std::size_t	allocatedBytes = 0;		// vertex and index buffers of all pools
+			std::size_t	usedBytes = 0;
+			uint32_t	multiDraws = 0;			// MultiDraw calls since the start
+			uint32_t	multiDrawCommands = 0;
+		};
+
+		static Statistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+	private:
+		struct Pool
+		{
+			VertexCompression				compression;
+			uint32_t						attributeStride;
+			unsigned int					indexType;
+			unsigned int					vertexArray = 0;
+			unsigned int					positionBuffer = 0;
+			unsigned int					attributeBuffer = 0;
+			unsigned int					indexBuffer = 0;
+			uint32_t						vertexCapacity = 0;
+			uint32_t						indexCapacity = 0;
+			std::map<uint32_t, uint32_t>	freeVertices;	// offset -> size
+			std::map<uint32_t, uint32_t>	freeIndices;
+		};
+
+		static int FindOrCreatePool(VertexCompression compression, uint32_t attributeStride, unsigned int indexType);
+		static void Grow(Pool & pool, uint32_t vertexCapacity, uint32_t indexCapacity);
+		static void SetupVertexArray(Pool & pool);
+
+		static std::vector<Pool>	s_pools;
+		static unsigned int			s_drawIDBuffer;		// 0, 1, ..., MaxDrawIDs-1
+		static unsigned int			s_indirectBuffer;
+		static Statistics			s_statistics;
+	};
+}
+
+#endif // MeshPool_hpp
@@ -2,6 +2,7 @@
 #define MeshRenderer_hpp
 
 #include "Renderer.hpp"
+#include "StaticBatchingUtility.hpp"
 
 namespace FishEngine
 {
@@ -20,8 +21,24 @@ namespace FishEngine
 		virtual Bounds localBounds() const override;
 		virtual void OnDrawGizmosSelected() override;
 
+		// Combined into static batches by StaticBatchingUtility: drawn from the batches instead of its own mesh.
+		bool isPartOfStaticBatch() const
+		{
+			return !m_staticBatchParts.empty();
+		}
+
+		// by material index
+		std::vector<StaticBatchPart> const & staticBatchParts() const
+		{
+			return m_staticBatchParts;
+		}
+
 	private:
 		friend class FishEditor::Inspector;
+		friend class StaticBatchingUtility;
+
+		Meta(NonSerializable)
+		std::vector<StaticBatchPart> m_staticBatchParts;
 	};
 }
 
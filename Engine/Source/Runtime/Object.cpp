@@ -1,27 +1,67 @@
 #include "Object.hpp"
 
 #include <set>
+#include <unordered_map>
 #include <boost/lexical_cast.hpp>
 
 #include "Scene.hpp"
 #include "GameObject.hpp"
 #include "Prefab.hpp"
+#include "Transform.hpp"
+#include "ObjectPool.hpp"
 
 namespace FishEngine
 {
 
-	GameObjectPtr Object::Instantiate(GameObjectPtr const & original)
+	namespace
 	{
-		CloneUtility cu;
-		GameObjectPtr cloned;
-		if (original->m_prefabInternal != nullptr && original->m_prefabInternal->m_rootGameObject == original)
+		// of the prefab roots, by instance id. The plans of destroyed prefabs are dropped when a plan is built.
+		std::unordered_map<int, ClonePlan> s_prefabClonePlans;
+
+		bool IsPrefabRoot(GameObjectPtr const & go)
 		{
-			cloned = Instantiate(original->m_prefabInternal)->m_rootGameObject;
+			auto const & prefab = go->prefabInternal();
+			return prefab != nullptr && prefab->rootGameObject() == go;
 		}
-		else
+
+		// rebuilt if the prefab was edited since the last Instantiate
+		ClonePlan const & PrefabClonePlan(GameObjectPtr const & root)
 		{
-			cloned = original->Clone(cu);
+			auto it = s_prefabClonePlans.find(root->GetInstanceID());
+			if (it != s_prefabClonePlans.end() && !it->second.expired() && it->second.nodes[0].source.lock() == root && it->second.IsUpToDate())
+				return it->second;
+
+			for (auto i = s_prefabClonePlans.begin(); i != s_prefabClonePlans.end(); )
+			{
+				if (i->second.expired())
+					i = s_prefabClonePlans.erase(i);
+				else
+					++i;
+			}
+			auto & plan = s_prefabClonePlans[root->GetInstanceID()];
+			plan.Build(root);
+			return plan;
 		}
+	}
+
+	GameObjectPtr Object::Instantiate(GameObjectPtr const & original)
+	{
+		return Instantiate(original, 1)[0];
+	}
+
+	std::vector<GameObjectPtr> Object::Instantiate(GameObjectPtr const & original, int count,
+		std::vector<Vector3> const & positions, std::vector<Quaternion> const & rotations)
+	{
+		std::vector<GameObjectPtr> clones;
+		if (count <= 0)
+			return clones;
+		clones.reserve(count);
+
+		const bool isPrefabRoot = IsPrefabRoot(original);
+		ClonePlan localPlan;
+		if (!isPrefabRoot)
+			localPlan.Build(original);
+		ClonePlan const & plan = isPrefabRoot ? PrefabClonePlan(original) : localPlan;
 
 		std::set<std::string> siblingNames;
 		auto parent = original->transform()->parent();
@@ -31,7 +71,6 @@ namespace FishEngine
 			{
 				siblingNames.insert(go->name());
 			}
-			Scene::AddGameObject(cloned);
 		}
 		else
 		{
@@ -39,19 +78,17 @@ namespace FishEngine
 			{
 				siblingNames.insert(child->name());
 			}
-			cloned->transform()->SetParent( parent, false );
 		}
 		
 		int id = 1;
-		std::string name = original->name();
-		std::string prefix = name;
-		if (name[name.size()-1] == ')')
+		std::string prefix = original->name();
+		if (!prefix.empty() && prefix[prefix.size()-1] == ')')
 		{
-			auto pos = name.find_last_of("(");
+			auto pos = prefix.find_last_of("(");
 			if (pos != std::string::npos)
 			{
-				prefix = name.substr(0, pos);
-				std::string strID = name.substr(pos+1, name.size()-pos-2);
+				std::string strID = prefix.substr(pos+1, prefix.size()-pos-2);
+				prefix = prefix.substr(0, pos);
 				try
 				{
 					id = boost::lexical_cast<int>(strID) + 1;
@@ -63,22 +100,47 @@ namespace FishEngine
 			}
 		}
 
-		auto findResult = siblingNames.find(name);
-		if (findResult != siblingNames.end())
+		CloneUtility cloneUtility;
+		for (int i = 0; i < count; ++i)
 		{
-			do {
-				name = prefix + "(" + boost::lexical_cast<std::string>(id) + ")";
-				auto it = siblingNames.find(name);
-				if (it == siblingNames.end())
-				{
-					break;
-				}
-				id++;
-			} while (true);
+			GameObjectPtr cloned;
+			if (isPrefabRoot)
+			{
+				cloned = InstantiatePrefab(original->m_prefabInternal, plan, cloneUtility)->m_rootGameObject;
+			}
+			else
+			{
+				cloneUtility.m_clonedObject.Reset(&plan);
+				cloned = original->Clone(plan, cloneUtility);
+			}
+
+			std::string name = original->name();
+			if (siblingNames.find(name) != siblingNames.end())
+			{
+				do {
+					name = prefix + "(" + boost::lexical_cast<std::string>(id) + ")";
+					auto it = siblingNames.find(name);
+					if (it == siblingNames.end())
+					{
+						break;
+					}
+					id++;
+				} while (true);
+			}
+			siblingNames.insert(name);
+			cloned->setName(name);
+
+			if (parent == nullptr)
+				Scene::AddGameObject(cloned);
+			else
+				cloned->transform()->SetParent(parent, false);
+			if (static_cast<std::size_t>(i) < positions.size())
+				cloned->transform()->setPosition(positions[i]);
+			if (static_cast<std::size_t>(i) < rotations.size())
+				cloned->transform()->setRotation(rotations[i]);
+			clones.push_back(std::move(cloned));
 		}
-		
-		cloned->setName(name);
-		return cloned;
+		return clones;
 	}
 
 	//ComponentPtr Object::Instantiate(ComponentPtr const & original)
@@ -90,6 +152,12 @@ namespace FishEngine
 	FishEngine::PrefabPtr Object::Instantiate(PrefabPtr const & original)
 	{
 		CloneUtility cloneUtility;
+		return InstantiatePrefab(original, PrefabClonePlan(original->m_rootGameObject), cloneUtility);
+	}
+
+	PrefabPtr Object::InstantiatePrefab(PrefabPtr const & original, ClonePlan const & plan, CloneUtility & cloneUtility)
+	{
+		cloneUtility.m_clonedObject.Reset(&plan);
 		auto instance = std::make_shared<Prefab>();
 		instance->m_isPrefabParent = false;
 		instance->m_parentPrefab = original->m_rootGameObject->prefabInternal();
@@ -98,10 +166,25 @@ namespace FishEngine
 			instance->m_parentPrefab = instance->m_parentPrefab->m_parentPrefab;
 		}
 		cloneUtility.m_clonedObject[original->GetInstanceID()] = instance;
-		instance->m_rootGameObject = original->m_rootGameObject->Clone(cloneUtility);
+		instance->m_rootGameObject = original->m_rootGameObject->Clone(plan, cloneUtility);
 		return instance;
 	}
 
+	void Object::setName(const std::string& name)
+	{
+		if (name == m_name)
+			return;
+		m_name = name;
+		if (IsGameObject(ClassID()))
+		{
+			auto go = static_cast<GameObject*>(this);
+			Scene::UpdateIndices(*go);
+			auto transform = go->transform();
+			if (transform != nullptr)
+				Scene::NotifyChange(transform->gameObject(), SceneChange::Renamed);
+		}
+	}
+
 	void Object::CopyValueTo(ObjectPtr target, CloneUtility & cloneUtility) const
 	{
 		cloneUtility.Clone(this->m_objectHideFlags, target->m_objectHideFlags); // FishEngine::HideFlags
@@ -112,6 +195,12 @@ namespace FishEngine
 
 	void Object::Destroy(GameObjectPtr obj, const float t /*= 0.0f*/)
 	{
+		// spawned by an ObjectPool: back to the pool instead
+		if (t <= 0 && obj->m_pool != nullptr)
+		{
+			obj->m_pool->Despawn(obj);
+			return;
+		}
 		Scene::Destroy(obj, t);
 	}
 
@@ -127,6 +216,11 @@ namespace FishEngine
 
 	void Object::DestroyImmediate(GameObjectPtr obj)
 	{
+		if (obj->m_pool != nullptr)
+		{
+			obj->m_pool->Despawn(obj);
+			return;
+		}
 		Scene::DestroyImmediate(obj);
 	}
 
@@ -7,6 +7,7 @@
 #include "Macro.hpp"
 #include "HideFlags.hpp"
 #include "ReflectClass.hpp"
+#include "ObjectAllocator.hpp"
 #include "private/CloneUtility.hpp"
 
 namespace FishEngine
@@ -49,7 +50,7 @@ namespace FishEngine
 		
 		// The name of the object.
 		virtual inline std::string name() const { return m_name; }
-		inline void setName(const std::string& name) { m_name = name; }
+		void setName(const std::string& name);
 
 		// Should the object be hidden, saved with the scene or modifiable by the user ?
 		inline HideFlags hideFlags() const { return m_objectHideFlags; }
@@ -76,6 +77,11 @@ namespace FishEngine
 		static GameObjectPtr Instantiate(GameObjectPtr const & original);
 		static ComponentPtr Instantiate(ComponentPtr const & original);
 		static PrefabPtr Instantiate(PrefabPtr const & original);
+
+		// count clones of original, the i-th one at positions[i] and rotations[i] (world space) if given.
+		// The hierarchy of original is flattened once (ClonePlan, cached for prefabs) for all clones.
+		static std::vector<GameObjectPtr> Instantiate(GameObjectPtr const & original, int count,
+			std::vector<Vector3> const & positions = {}, std::vector<Quaternion> const & rotations = {});
 		
 		// TODO: make it protected
 		PrefabPtr prefabInternal() const
@@ -97,6 +103,8 @@ namespace FishEngine
 	protected:
 		void CopyValueTo(FishEngine::ObjectPtr target, CloneUtility & cloneUtility) const;
 
+		static PrefabPtr InstantiatePrefab(PrefabPtr const & original, ClonePlan const & plan, CloneUtility & cloneUtility);
+
 		// Should the object be hidden, saved with the scene or modifiable by the user?
 		HideFlags	m_objectHideFlags = HideFlags::None;
 		std::string m_name;
@@ -112,7 +120,7 @@ namespace FishEngine
 	template<class T>
 	inline std::shared_ptr<T> MakeShared()
 	{
-		return std::make_shared<T>();
+		return AllocateShared<T>();
 	}
 
 	template<>
@@ -0,0 +1,199 @@
+#include "ObjectAllocator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace
+{
+	using FishEngine::ObjectAllocator;
+
+	constexpr std::size_t BlockAlignment = alignof(std::max_align_t);
+	constexpr std::size_t ChunkBytes = 16 * 1024;
+	constexpr std::size_t MinBlocksPerChunk = 16;
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	struct Pool
+	{
+		std::size_t	blockSize = 0;
+		std::size_t	blocksPerChunk = 0;
+		std::map<char*, std::size_t>	chunks;		// first byte -> live blocks
+		FreeBlock*	freeList = nullptr;
+		ObjectAllocator::Statistics		statistics;
+
+		std::size_t chunkSize() const
+		{
+			return blockSize * blocksPerChunk;
+		}
+
+		// chunks.end() if p was not allocated in a chunk
+		std::map<char*, std::size_t>::iterator FindChunk(void* p)
+		{
+			auto c = static_cast<char*>(p);
+			auto it = chunks.upper_bound(c);
+			if (it == chunks.begin())
+				return chunks.end();
+			--it;
+			return (c < it->first + chunkSize()) ? it : chunks.end();
+		}
+
+		void AddChunk()
+		{
+			auto chunk = static_cast<char*>(::operator new(chunkSize()));
+			chunks.emplace(chunk, 0);
+			// in address order
+			for (std::size_t i = blocksPerChunk; i-- > 0; )
+			{
+				auto block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+				block->next = freeList;
+				freeList = block;
+			}
+			statistics.reservedBytes += chunkSize();
+			statistics.chunks++;
+		}
+	};
+
+	// never destroyed: objects may be released by other static destructors at exit
+	std::mutex & Mutex()
+	{
+		static auto mutex = new std::mutex;
+		return *mutex;
+	}
+
+	std::map<int, Pool> & Pools()
+	{
+		static auto pools = new std::map<int, Pool>;
+		return *pools;
+	}
+}
+
+namespace FishEngine
+{
+	bool ObjectAllocator::s_enabled = true;
+
+	void* ObjectAllocator::Allocate(int classID, std::size_t size)
+	{
+		std::lock_guard<std::mutex> lock(Mutex());
+		auto & pool = Pools()[classID];
+		if (pool.blockSize == 0)
+		{
+			// the first allocation of the class sets the block size, allocate_shared always asks for the same size
+			pool.blockSize = (std::max<std::size_t>(size, sizeof(FreeBlock)) + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+			pool.blocksPerChunk = std::max(MinBlocksPerChunk, ChunkBytes / pool.blockSize);
+		}
+		pool.statistics.liveCount++;
+		pool.statistics.liveBytes += size;
+		pool.statistics.allocations++;
+
+		if (!s_enabled || size > pool.blockSize)
+			return ::operator new(size);
+
+		if (pool.freeList == nullptr)
+			pool.AddChunk();
+		auto block = pool.freeList;
+		pool.freeList = block->next;
+		pool.FindChunk(block)->second++;
+		return block;
+	}
+
+	void ObjectAllocator::Deallocate(int classID, void* p, std::size_t size)
+	{
+		std::lock_guard<std::mutex> lock(Mutex());
+		auto & pool = Pools()[classID];
+		pool.statistics.liveCount--;
+		pool.statistics.liveBytes -= size;
+
+		auto chunk = pool.FindChunk(p);
+		if (chunk == pool.chunks.end())
+		{
+			::operator delete(p);
+			return;
+		}
+		chunk->second--;
+		auto block = static_cast<FreeBlock*>(p);
+		block->next = pool.freeList;
+		pool.freeList = block;
+	}
+
+	std::size_t ObjectAllocator::ReleaseUnusedChunks()
+	{
+		std::lock_guard<std::mutex> lock(Mutex());
+		std::size_t released = 0;
+		for (auto & item : Pools())
+		{
+			auto & pool = item.second;
+			const bool hasUnused = std::any_of(pool.chunks.begin(), pool.chunks.end(),
+				[](std::pair<char* const, std::size_t> const & chunk) { return chunk.second == 0; });
+			if (!hasUnused)
+				continue;
+
+			// drop the free blocks of the released chunks from the free list
+			FreeBlock* freeList = nullptr;
+			FreeBlock** tail = &freeList;
+			for (auto block = pool.freeList; block != nullptr; block = block->next)
+			{
+				if (pool.FindChunk(block)->second == 0)
+					continue;
+				*tail = block;
+				tail = &block->next;
+			}
+			*tail = nullptr;
+			pool.freeList = freeList;
+
+			for (auto it = pool.chunks.begin(); it != pool.chunks.end(); )
+			{
+				if (it->second != 0)
+				{
+					++it;
+					continue;
+				}
+				::operator delete(it->first);
+				released += pool.chunkSize();
+				pool.statistics.reservedBytes -= pool.chunkSize();
+				pool.statistics.chunks--;
+				it = pool.chunks.erase(it);
+			}
+		}
+		return released;
+	}
+
+	ObjectAllocator::Statistics ObjectAllocator::statistics(int classID)
+	{
+		std::lock_guard<std::mutex> lock(Mutex());
+		auto & pools = Pools();
+		auto it = pools.find(classID);
+		return it == pools.end() ? Statistics() : it->second.statistics;
+	}
+
+	ObjectAllocator::Statistics ObjectAllocator::statistics()
+	{
+		std::lock_guard<std::mutex> lock(Mutex());
+		Statistics total;
+		for (auto const & item : Pools())
+		{
+			auto const & s = item.second.statistics;
+			total.liveCount += s.liveCount;
+			total.liveBytes += s.liveBytes;
+			total.reservedBytes += s.reservedBytes;
+			total.allocations += s.allocations;
+			total.chunks += s.chunks;
+		}
+		return total;
+	}
+
+	std::map<int, ObjectAllocator::Statistics> ObjectAllocator::allStatistics()
+	{
+		std::lock_guard<std::mutex> lock(Mutex());
+		std::map<int, Statistics> result;
+		for (auto const & item : Pools())
+		{
+			result.emplace(item.first, item.second.statistics);
+		}
+		return result;
+	}
+}
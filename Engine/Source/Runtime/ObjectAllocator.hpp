@@ -0,0 +1,118 @@
+#ifndef ObjectAllocator_hpp
+#define ObjectAllocator_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+
+#include <map>
+
+namespace FishEngine
+{
+	// Fixed-size pools for the objects of the scene, one per ClassID. A pool hands out blocks of chunks (a few
+	// dozens of objects each), so the game objects, transforms and components of one class sit next to each
+	// other, and freeing one is a push to a free list instead of a heap free.
+	// The chunks are the arena of the scene: Scene::Clean releases all the chunks left without live object in one
+	// go (ReleaseUnusedChunks). Chunks still referenced (by an asset, the editor...) stay until the next release.
+	// Thread-safe: the last shared_ptr of an object may be released by a job.
+	class FE_EXPORT Meta(NonSerializable) ObjectAllocator
+	{
+	public:
+		ObjectAllocator() = delete;
+
+		// size bytes for an object of class classID (or its shared_ptr control block)
+		static void* Allocate(int classID, std::size_t size);
+		static void Deallocate(int classID, void* p, std::size_t size);
+
+		// Free the chunks without live blocks. Returns the bytes given back to the heap.
+		static std::size_t ReleaseUnusedChunks();
+
+		// false: Allocate uses the heap (still counted in the statistics), to compare with the pools
+		static void setEnabled(bool enabled)
+		{
+			s_enabled = enabled;
+		}
+
+		static bool enabled()
+		{
+			return s_enabled;
+		}
+
+		struct Statistics
+		{
+			std::size_t	liveCount = 0;
+			std::size_t	liveBytes = 0;
+			std::size_t	reservedBytes = 0;	// in chunks
+			std::size_t	allocations = 0;	// since startup
+			std::size_t	chunks = 0;
+		};
+
+		// of class classID
+		static Statistics statistics(int classID);
+
+		// of all classes
+		static Statistics statistics();
+
+		// by ClassID, a copy
+		static std::map<int, Statistics> allStatistics();
+
+	private:
+		static bool s_enabled;
+	};
+
+
+	// Allocator of ObjectAllocator for the objects of class classID, for std::allocate_shared: the object and its
+	// control block are one block of the pool.
+	template<class T>
+	class PoolAllocator
+	{
+	public:
+		typedef T value_type;
+
+		explicit PoolAllocator(int classID) : m_classID(classID)
+		{
+		}
+
+		template<class U>
+		PoolAllocator(PoolAllocator<U> const & other) : m_classID(other.classID())
+		{
+		}
+
+		T* allocate(std::size_t n)
+		{
+			return static_cast<T*>(ObjectAllocator::Allocate(m_classID, n * sizeof(T)));
+		}
+
+		void deallocate(T* p, std::size_t n)
+		{
+			ObjectAllocator::Deallocate(m_classID, p, n * sizeof(T));
+		}
+
+		int classID() const
+		{
+			return m_classID;
+		}
+
+		template<class U>
+		bool operator==(PoolAllocator<U> const & rhs) const
+		{
+			return m_classID == rhs.classID();
+		}
+
+		template<class U>
+		bool operator!=(PoolAllocator<U> const & rhs) const
+		{
+			return m_classID != rhs.classID();
+		}
+
+	private:
+		int m_classID;
+	};
+
+	template<class T, class... Args>
+	inline std::shared_ptr<T> AllocateShared(Args&&... args)
+	{
+		return std::allocate_shared<T>(PoolAllocator<T>(ClassID<T>()), std::forward<Args>(args)...);
+	}
+}
+
+#endif // ObjectAllocator_hpp
@@ -0,0 +1,133 @@
+#include "ObjectPool.hpp"
+
+#include <algorithm>
+
+#include "GameObject.hpp"
+#include "Transform.hpp"
+#include "Prefab.hpp"
+#include "Script.hpp"
+#include "Debug.hpp"
+
+namespace FishEngine
+{
+	ObjectPool::ObjectPool(GameObjectPtr const & original, int prewarmCount)
+		: m_original(original)
+	{
+		Prewarm(prewarmCount);
+	}
+
+	ObjectPool::ObjectPool(PrefabPtr const & original, int prewarmCount)
+		: ObjectPool(original->rootGameObject(), prewarmCount)
+	{
+	}
+
+	ObjectPool::~ObjectPool()
+	{
+		for (auto const & go : m_active)
+		{
+			go->m_pool = nullptr;
+			go->m_poolActiveIndex = -1;
+		}
+		for (auto const & go : m_inactive)
+		{
+			go->m_pool = nullptr;
+		}
+	}
+
+	void ObjectPool::NotifyScripts(GameObjectPtr const & go, bool enabled)
+	{
+		// only the scripts already started: the others get their OnEnable from GameObject::Update
+		for (auto const & c : go->m_components)
+		{
+			if (!c->m_isStartFunctionCalled || !IsScript(c->ClassID()))
+				continue;
+			auto s = std::static_pointer_cast<Script>(c);
+			if (enabled)
+				s->OnEnable();
+			else
+				s->OnDisable();
+		}
+	}
+
+	void ObjectPool::Prewarm(int count)
+	{
+		if (count <= 0)
+			return;
+		auto clones = Object::Instantiate(m_original, count);
+		m_inactive.reserve(m_inactive.size() + clones.size());
+		for (auto & go : clones)
+		{
+			go->m_pool = this;
+			go->SetActive(false);
+			m_inactive.push_back(std::move(go));
+		}
+		m_statistics.instantiated += count;
+	}
+
+	GameObjectPtr ObjectPool::Spawn(Vector3 const & position, Quaternion const & rotation)
+	{
+		m_statistics.spawned++;
+		GameObjectPtr go;
+		while (!m_inactive.empty())
+		{
+			go = std::move(m_inactive.back());
+			m_inactive.pop_back();
+			// destroyed by the Scene while inactive
+			if (go->transform() != nullptr)
+				break;
+			go = nullptr;
+		}
+
+		if (go == nullptr)
+		{
+			go = Object::Instantiate(m_original, 1, {position}, {rotation})[0];
+			go->m_pool = this;
+			m_statistics.instantiated++;
+		}
+		else
+		{
+			go->transform()->setPosition(position);
+			go->transform()->setRotation(rotation);
+			go->SetActive(true);
+			NotifyScripts(go, true);
+			m_statistics.reused++;
+		}
+		go->m_poolActiveIndex = static_cast<int>(m_active.size());
+		m_active.push_back(go);
+		return go;
+	}
+
+	void ObjectPool::Despawn(GameObjectPtr const & instance)
+	{
+		const int index = instance->m_poolActiveIndex;
+		if (instance->m_pool != this || index < 0 || static_cast<std::size_t>(index) >= m_active.size() || m_active[index] != instance)
+		{
+			LogWarning("ObjectPool::Despawn: not an active instance of this pool");
+			return;
+		}
+		RemoveActive(*instance);
+
+		NotifyScripts(instance, false);
+		instance->SetActive(false);
+		m_inactive.push_back(instance);
+	}
+
+	void ObjectPool::RemoveActive(GameObject & instance)
+	{
+		const int index = instance.m_poolActiveIndex;
+		if (static_cast<std::size_t>(index) + 1 != m_active.size())
+		{
+			m_active[index] = std::move(m_active.back());
+			m_active[index]->m_poolActiveIndex = index;
+		}
+		m_active.pop_back();
+		instance.m_poolActiveIndex = -1;
+	}
+
+	void ObjectPool::Remove(GameObject & instance)
+	{
+		if (instance.m_poolActiveIndex >= 0)
+			RemoveActive(instance);
+		instance.m_pool = nullptr;
+	}
+}
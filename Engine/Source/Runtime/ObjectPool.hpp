@@ -0,0 +1,77 @@
+#ifndef ObjectPool_hpp
+#define ObjectPool_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+#include "Vector3.hpp"
+#include "Quaternion.hpp"
+
+namespace FishEngine
+{
+	// Recycles the clones of a game object (or of the root of a prefab) instead of creating and destroying them.
+	// Inactive instances stay in the scene with SetActive(false). Object::Destroy and Object::DestroyImmediate of a
+	// spawned instance Despawn it; an instance destroyed by the Scene directly is dropped from the pool (see Remove).
+	// Main thread only.
+	class FE_EXPORT Meta(NonSerializable) ObjectPool
+	{
+	public:
+		ObjectPool(GameObjectPtr const & original, int prewarmCount = 0);
+		ObjectPool(PrefabPtr const & original, int prewarmCount = 0);
+
+		ObjectPool(ObjectPool const &) = delete;
+		ObjectPool& operator=(ObjectPool const &) = delete;
+
+		// the instances are left in the scene, as normal game objects
+		~ObjectPool();
+
+		// Create count inactive instances, with one bulk Object::Instantiate.
+		void Prewarm(int count);
+
+		// An inactive instance (a new one if none), active at position and rotation (world space).
+		GameObjectPtr Spawn(Vector3 const & position = Vector3::zero, Quaternion const & rotation = Quaternion::identity);
+
+		// Deactivate instance, which must come from Spawn of this pool.
+		void Despawn(GameObjectPtr const & instance);
+
+		std::size_t activeCount() const
+		{
+			return m_active.size();
+		}
+
+		std::size_t inactiveCount() const
+		{
+			return m_inactive.size();
+		}
+
+		struct Statistics
+		{
+			int		instantiated = 0;	// clones created
+			int		spawned = 0;		// Spawn calls
+			int		reused = 0;			// Spawn calls served by an inactive instance
+		};
+
+		Statistics const & statistics() const
+		{
+			return m_statistics;
+		}
+
+	private:
+		friend class Scene;
+
+		// OnEnable or OnDisable of the scripts of go
+		static void NotifyScripts(GameObjectPtr const & go, bool enabled);
+
+		// swap with the last active instance, O(1)
+		void RemoveActive(GameObject & instance);
+
+		// instance was destroyed by the Scene. The inactive ones are skipped by Spawn.
+		void Remove(GameObject & instance);
+
+		GameObjectPtr					m_original;
+		std::vector<GameObjectPtr>		m_active;
+		std::vector<GameObjectPtr>		m_inactive;
+		Statistics						m_statistics;
+	};
+}
+
+#endif // ObjectPool_hpp
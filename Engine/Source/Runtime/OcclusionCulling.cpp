@@ -0,0 +1,456 @@
+#include "OcclusionCulling.hpp"
+#include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
+#include "RenderBuffer.hpp"
+#include "Material.hpp"
+#include "Mesh.hpp"
+#include "Graphics.hpp"
+#include "JobSystem.hpp"
+#include "Mathf.hpp"
+#include "Vector4.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+namespace FishEngine
+{
+	bool											OcclusionCulling::s_enabled = true;
+	bool											OcclusionCulling::s_showDepthOverlay = false;
+	Matrix4x4										OcclusionCulling::s_viewProjection;
+	float											OcclusionCulling::s_near = 0.3f;
+	float											OcclusionCulling::s_far = 1000.0f;
+	std::vector<OcclusionCulling::Occluder>			OcclusionCulling::s_occluders;
+	std::vector<OcclusionCulling::ScreenTriangle>	OcclusionCulling::s_triangles;
+	std::vector<uint32_t>							OcclusionCulling::s_tileTriangles[TileCountX * TileCountY];
+	std::vector<float>								OcclusionCulling::s_depth(Width * Height, 1.0f);
+	float											OcclusionCulling::s_tileMaxDepth[TileCountX * TileCountY];
+	ColorBufferPtr									OcclusionCulling::s_overlayTexture;
+	OcclusionCulling::Statistics					OcclusionCulling::s_statistics;
+
+	namespace
+	{
+		// Project the corners of bounds, ndcMin and ndcMax: NDC bounds with depth in [0, 1].
+		// false if a corner is behind the near plane, the box then has no sensible screen rectangle.
+		bool ProjectBounds(Matrix4x4 const & viewProjection, Bounds const & bounds, Vector3 & ndcMin, Vector3 & ndcMax)
+		{
+			auto center = bounds.center();
+			auto extents = bounds.extents();
+			ndcMin = Vector3(Mathf::Infinity, Mathf::Infinity, Mathf::Infinity);
+			ndcMax = -ndcMin;
+			for (int c = 0; c < 8; ++c)
+			{
+				Vector4 corner(
+					c & 1 ? center.x + extents.x : center.x - extents.x,
+					c & 2 ? center.y + extents.y : center.y - extents.y,
+					c & 4 ? center.z + extents.z : center.z - extents.z,
+					1);
+				auto p = viewProjection * corner;
+				if (p.z < -p.w)
+					return false;
+				Vector3 ndc(p.x / p.w, p.y / p.w, p.z / p.w * 0.5f + 0.5f);
+				ndcMin = Vector3::Min(ndcMin, ndc);
+				ndcMax = Vector3::Max(ndcMax, ndc);
+			}
+			return true;
+		}
+
+		struct ClipTriangle
+		{
+			Vector4 v[3];
+		};
+
+		// Clip a triangle against the near plane (z >= -w), at most two triangles.
+		void ClipNear(Vector4 const & a, Vector4 const & b, Vector4 const & c, std::vector<ClipTriangle> & out)
+		{
+			Vector4 const * in[3] = { &a, &b, &c };
+			float d[3];
+			int insideCount = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				d[i] = in[i]->z + in[i]->w;
+				if (d[i] >= 0)
+					insideCount++;
+			}
+			if (insideCount == 3)
+			{
+				out.push_back({ { a, b, c } });
+				return;
+			}
+			if (insideCount == 0)
+				return;
+
+			Vector4 polygon[4];
+			int count = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				int j = (i + 1) % 3;
+				if (d[i] >= 0)
+					polygon[count++] = *in[i];
+				if ((d[i] >= 0) != (d[j] >= 0))
+				{
+					float t = d[i] / (d[i] - d[j]);
+					polygon[count++] = *in[i] + (*in[j] - *in[i]) * t;
+				}
+			}
+			for (int i = 1; i + 1 < count; ++i)
+			{
+				out.push_back({ { polygon[0], polygon[i], polygon[i + 1] } });
+			}
+		}
+	}
+
+	OccluderMeshPtr OcclusionCulling::BuildOccluderMesh(std::vector<Vector3> const & vertices, std::vector<uint32_t> const & indices)
+	{
+		const std::size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return nullptr;
+
+		// keep the largest triangles
+		std::vector<float> areas(triangleCount);
+		for (std::size_t i = 0; i < triangleCount; ++i)
+		{
+			auto const & a = vertices[indices[i * 3]];
+			auto const & b = vertices[indices[i * 3 + 1]];
+			auto const & c = vertices[indices[i * 3 + 2]];
+			areas[i] = Vector3::Cross(b - a, c - a).magnitude();
+		}
+		std::vector<uint32_t> order(triangleCount);
+		std::iota(order.begin(), order.end(), 0);
+		const std::size_t keptCount = std::min<std::size_t>(triangleCount, MaxOccluderMeshTriangles);
+		std::partial_sort(order.begin(), order.begin() + keptCount, order.end(), [&areas](uint32_t lhs, uint32_t rhs) {
+			return areas[lhs] > areas[rhs];
+		});
+
+		auto mesh = std::make_shared<OccluderMesh>();
+		std::vector<uint32_t> remap(vertices.size(), 0xFFFFFFFF);
+		mesh->indices.reserve(keptCount * 3);
+		for (std::size_t i = 0; i < keptCount; ++i)
+		{
+			if (areas[order[i]] <= 0)
+				break;
+			for (int k = 0; k < 3; ++k)
+			{
+				auto index = indices[order[i] * 3 + k];
+				if (remap[index] == 0xFFFFFFFF)
+				{
+					remap[index] = static_cast<uint32_t>(mesh->vertices.size());
+					mesh->vertices.push_back(vertices[index]);
+				}
+				mesh->indices.push_back(remap[index]);
+			}
+		}
+		if (mesh->indices.empty())
+			return nullptr;
+		return mesh;
+	}
+
+	void OcclusionCulling::BeginFrame(Matrix4x4 const & viewProjection, float near, float far)
+	{
+		s_viewProjection = viewProjection;
+		s_near = near;
+		s_far = far;
+		s_occluders.clear();
+		std::fill(s_depth.begin(), s_depth.end(), 1.0f);
+		std::fill(std::begin(s_tileMaxDepth), std::end(s_tileMaxDepth), 1.0f);
+		s_statistics = Statistics();
+	}
+
+	void OcclusionCulling::AddOccluder(OccluderMeshPtr const & mesh, Matrix4x4 const & localToWorld, Bounds const & bounds)
+	{
+		if (mesh == nullptr)
+			return;
+		s_statistics.occluderCandidates++;
+
+		float screenSize = 2.0f;	// camera inside or close to the occluder: as big as the screen
+		Vector3 ndcMin, ndcMax;
+		if (ProjectBounds(s_viewProjection, bounds, ndcMin, ndcMax))
+		{
+			if (ndcMax.x < -1 || ndcMin.x > 1 || ndcMax.y < -1 || ndcMin.y > 1 || ndcMin.z > 1)
+				return;
+			screenSize = 0.5f * std::max(ndcMax.x - ndcMin.x, ndcMax.y - ndcMin.y);
+			if (screenSize < MinOccluderScreenSize)
+				return;
+		}
+		s_occluders.push_back({ mesh, localToWorld, screenSize });
+	}
+
+	void OcclusionCulling::SetupTriangles(Occluder const & occluder, std::vector<ScreenTriangle> & outTriangles)
+	{
+		auto const & mesh = *occluder.mesh;
+		const Matrix4x4 mvp = s_viewProjection * occluder.localToWorld;
+
+		std::vector<Vector4> clipVertices(mesh.vertices.size());
+		for (std::size_t i = 0; i < mesh.vertices.size(); ++i)
+		{
+			auto const & v = mesh.vertices[i];
+			clipVertices[i] = mvp * Vector4(v.x, v.y, v.z, 1);
+		}
+
+		std::vector<ClipTriangle> triangles;
+		triangles.reserve(mesh.indices.size() / 3);
+		for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			auto const & a = clipVertices[mesh.indices[i]];
+			auto const & b = clipVertices[mesh.indices[i + 1]];
+			auto const & c = clipVertices[mesh.indices[i + 2]];
+			// outside one side of the frustum
+			if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+				(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w))
+				continue;
+			ClipNear(a, b, c, triangles);
+		}
+
+		// four triangles at a time, struct of arrays
+		constexpr int Lanes = 4;
+		for (std::size_t first = 0; first < triangles.size(); first += Lanes)
+		{
+			float x[3][Lanes], y[3][Lanes], z[3][Lanes];
+			for (int l = 0; l < Lanes; ++l)
+			{
+				auto const & t = triangles[std::min(first + l, triangles.size() - 1)];
+				for (int k = 0; k < 3; ++k)
+				{
+					const float invW = 1.0f / t.v[k].w;
+					x[k][l] = (t.v[k].x * invW * 0.5f + 0.5f) * Width;
+					y[k][l] = (t.v[k].y * invW * 0.5f + 0.5f) * Height;
+					z[k][l] = t.v[k].z * invW * 0.5f + 0.5f;
+				}
+			}
+
+			float area[Lanes], sign[Lanes], invArea[Lanes];
+			for (int l = 0; l < Lanes; ++l)
+			{
+				area[l] = (x[1][l] - x[0][l]) * (y[2][l] - y[0][l]) - (x[2][l] - x[0][l]) * (y[1][l] - y[0][l]);
+				sign[l] = area[l] < 0 ? -1.0f : 1.0f;
+				invArea[l] = area[l] != 0 ? 1.0f / area[l] : 0.0f;
+			}
+
+			// edge k goes from vertex k to vertex k+1, inside is on the left of counter-clockwise edges
+			float edgeA[3][Lanes], edgeB[3][Lanes], edgeC[3][Lanes];
+			for (int k = 0; k < 3; ++k)
+			{
+				const int n = (k + 1) % 3;
+				for (int l = 0; l < Lanes; ++l)
+				{
+					edgeA[k][l] = (y[k][l] - y[n][l]) * sign[l];
+					edgeB[k][l] = (x[n][l] - x[k][l]) * sign[l];
+					edgeC[k][l] = -(edgeA[k][l] * x[k][l] + edgeB[k][l] * y[k][l]);
+				}
+			}
+
+			float depthA[Lanes], depthB[Lanes], depthC[Lanes];
+			float minX[Lanes], minY[Lanes], maxX[Lanes], maxY[Lanes], minZ[Lanes];
+			for (int l = 0; l < Lanes; ++l)
+			{
+				depthA[l] = ((z[1][l] - z[0][l]) * (y[2][l] - y[0][l]) - (z[2][l] - z[0][l]) * (y[1][l] - y[0][l])) * invArea[l];
+				depthB[l] = ((z[2][l] - z[0][l]) * (x[1][l] - x[0][l]) - (z[1][l] - z[0][l]) * (x[2][l] - x[0][l])) * invArea[l];
+				depthC[l] = z[0][l] - depthA[l] * x[0][l] - depthB[l] * y[0][l];
+				minX[l] = std::min(x[0][l], std::min(x[1][l], x[2][l]));
+				maxX[l] = std::max(x[0][l], std::max(x[1][l], x[2][l]));
+				minY[l] = std::min(y[0][l], std::min(y[1][l], y[2][l]));
+				maxY[l] = std::max(y[0][l], std::max(y[1][l], y[2][l]));
+				minZ[l] = std::min(z[0][l], std::min(z[1][l], z[2][l]));
+			}
+
+			const int count = static_cast<int>(std::min<std::size_t>(Lanes, triangles.size() - first));
+			for (int l = 0; l < count; ++l)
+			{
+				if (area[l] == 0 || minZ[l] > 1)
+					continue;
+				// pixels whose center is inside the bounding box
+				ScreenTriangle t;
+				t.minX = std::max(0, static_cast<int>(std::ceil(minX[l] - 0.5f)));
+				t.maxX = std::min(Width - 1, static_cast<int>(std::floor(maxX[l] - 0.5f)));
+				t.minY = std::max(0, static_cast<int>(std::ceil(minY[l] - 0.5f)));
+				t.maxY = std::min(Height - 1, static_cast<int>(std::floor(maxY[l] - 0.5f)));
+				if (t.minX > t.maxX || t.minY > t.maxY)
+					continue;
+				for (int k = 0; k < 3; ++k)
+				{
+					t.edgeA[k] = edgeA[k][l];
+					t.edgeB[k] = edgeB[k][l];
+					t.edgeC[k] = edgeC[k][l];
+				}
+				t.depthA = depthA[l];
+				t.depthB = depthB[l];
+				t.depthC = depthC[l];
+				outTriangles.push_back(t);
+			}
+		}
+	}
+
+	void OcclusionCulling::Rasterize()
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		// the largest occluders on screen first
+		std::sort(s_occluders.begin(), s_occluders.end(), [](Occluder const & lhs, Occluder const & rhs) {
+			return lhs.screenSize > rhs.screenSize;
+		});
+		if (s_occluders.size() > MaxOccluders)
+			s_occluders.resize(MaxOccluders);
+		s_statistics.occluders = static_cast<int>(s_occluders.size());
+
+		std::vector<std::vector<ScreenTriangle>> occluderTriangles(s_occluders.size());
+		JobSystem::ParallelFor(0, s_occluders.size(), [&occluderTriangles](std::size_t i) {
+			SetupTriangles(s_occluders[i], occluderTriangles[i]);
+		}, 1, "OcclusionCulling.Setup");
+
+		s_triangles.clear();
+		for (std::size_t i = 0; i < s_occluders.size(); ++i)
+		{
+			s_statistics.occluderTriangles += static_cast<int>(s_occluders[i].mesh->indices.size() / 3);
+			s_triangles.insert(s_triangles.end(), occluderTriangles[i].begin(), occluderTriangles[i].end());
+		}
+		s_statistics.rasterizedTriangles = static_cast<int>(s_triangles.size());
+
+		for (auto & bin : s_tileTriangles)
+			bin.clear();
+		for (std::size_t i = 0; i < s_triangles.size(); ++i)
+		{
+			auto const & t = s_triangles[i];
+			for (int ty = t.minY / TileSize; ty <= t.maxY / TileSize; ++ty)
+			{
+				for (int tx = t.minX / TileSize; tx <= t.maxX / TileSize; ++tx)
+				{
+					s_tileTriangles[ty * TileCountX + tx].push_back(static_cast<uint32_t>(i));
+				}
+			}
+		}
+
+		// tiles do not share pixels, no synchronization needed
+		JobSystem::ParallelFor(0, TileCountX * TileCountY, [](std::size_t tile) {
+			RasterizeTile(static_cast<int>(tile));
+		}, 1, "OcclusionCulling.Rasterize");
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		s_statistics.rasterizeTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+	}
+
+	void OcclusionCulling::RasterizeTile(int tile)
+	{
+		const int tileX = (tile % TileCountX) * TileSize;
+		const int tileY = (tile / TileCountX) * TileSize;
+
+		for (auto index : s_tileTriangles[tile])
+		{
+			auto const & t = s_triangles[index];
+			const int minX = std::max(t.minX, tileX);
+			const int maxX = std::min(t.maxX, tileX + TileSize - 1);
+			const int minY = std::max(t.minY, tileY);
+			const int maxY = std::min(t.maxY, tileY + TileSize - 1);
+
+			const float startX = minX + 0.5f;
+			for (int py = minY; py <= maxY; ++py)
+			{
+				const float fy = py + 0.5f;
+				float e0 = t.edgeA[0] * startX + t.edgeB[0] * fy + t.edgeC[0];
+				float e1 = t.edgeA[1] * startX + t.edgeB[1] * fy + t.edgeC[1];
+				float e2 = t.edgeA[2] * startX + t.edgeB[2] * fy + t.edgeC[2];
+				float depth = t.depthA * startX + t.depthB * fy + t.depthC;
+				float * row = &s_depth[py * Width];
+				for (int px = minX; px <= maxX; ++px)
+				{
+					if (e0 >= 0 && e1 >= 0 && e2 >= 0)
+					{
+						// in front of the near plane only where the triangle was clipped, nothing is visible there
+						const float d = std::max(depth, 0.0f);
+						if (d < row[px])
+							row[px] = d;
+					}
+					e0 += t.edgeA[0];
+					e1 += t.edgeA[1];
+					e2 += t.edgeA[2];
+					depth += t.depthA;
+				}
+			}
+		}
+
+		float maxDepth = 0;
+		for (int py = tileY; py < tileY + TileSize; ++py)
+		{
+			for (int px = tileX; px < tileX + TileSize; ++px)
+			{
+				maxDepth = std::max(maxDepth, s_depth[py * Width + px]);
+			}
+		}
+		s_tileMaxDepth[tile] = maxDepth;
+	}
+
+	bool OcclusionCulling::IsVisible(Bounds const & bounds)
+	{
+		s_statistics.tested++;
+		if (s_triangles.empty() || bounds.extents().x < 0)
+			return true;
+
+		Vector3 ndcMin, ndcMax;
+		if (!ProjectBounds(s_viewProjection, bounds, ndcMin, ndcMax))
+			return true;
+		// outside the screen: not for occlusion culling to decide
+		if (ndcMax.x < -1 || ndcMin.x > 1 || ndcMax.y < -1 || ndcMin.y > 1 || ndcMin.z > 1)
+			return true;
+
+		// every pixel the rectangle touches
+		const int minX = Mathf::Clamp(static_cast<int>(std::floor((ndcMin.x * 0.5f + 0.5f) * Width)), 0, Width - 1);
+		const int maxX = Mathf::Clamp(static_cast<int>(std::floor((ndcMax.x * 0.5f + 0.5f) * Width)), 0, Width - 1);
+		const int minY = Mathf::Clamp(static_cast<int>(std::floor((ndcMin.y * 0.5f + 0.5f) * Height)), 0, Height - 1);
+		const int maxY = Mathf::Clamp(static_cast<int>(std::floor((ndcMax.y * 0.5f + 0.5f) * Height)), 0, Height - 1);
+		const float nearestDepth = ndcMin.z;
+
+		for (int ty = minY / TileSize; ty <= maxY / TileSize; ++ty)
+		{
+			for (int tx = minX / TileSize; tx <= maxX / TileSize; ++tx)
+			{
+				// the whole tile is in front of the box
+				if (s_tileMaxDepth[ty * TileCountX + tx] < nearestDepth)
+					continue;
+				const int x0 = std::max(minX, tx * TileSize);
+				const int x1 = std::min(maxX, tx * TileSize + TileSize - 1);
+				const int y0 = std::max(minY, ty * TileSize);
+				const int y1 = std::min(maxY, ty * TileSize + TileSize - 1);
+				for (int py = y0; py <= y1; ++py)
+				{
+					float const * row = &s_depth[py * Width];
+					for (int px = x0; px <= x1; ++px)
+					{
+						if (row[px] >= nearestDepth)
+							return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	void OcclusionCulling::DrawDepthOverlay()
+	{
+		if (s_overlayTexture == nullptr)
+			s_overlayTexture = ColorBuffer::Create(Width, Height, TextureFormat::RGBA32);
+
+		// linear depth, white at the near plane, black where nothing was rasterized
+		std::vector<uint8_t> pixels(Width * Height * 4);
+		for (int i = 0; i < Width * Height; ++i)
+		{
+			const float ndc = s_depth[i] * 2.0f - 1.0f;
+			const float viewDepth = 2.0f * s_near * s_far / (s_far + s_near - ndc * (s_far - s_near));
+			const float value = Mathf::Clamp01(1.0f - (viewDepth - s_near) / (s_far - s_near));
+			const uint8_t gray = s_depth[i] >= 1.0f ? 0 : static_cast<uint8_t>(value * 255.0f);
+			pixels[i * 4] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = gray;
+			pixels[i * 4 + 3] = 255;
+		}
+		GLStateCache::BindTexture(GL_TEXTURE_2D, s_overlayTexture->GetNativeTexturePtr());
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
+
+		constexpr float size = 0.3f;
+		GLStateCache::DepthFunc(GL_ALWAYS);
+		auto quad = Mesh::builtinMesh(PrimitiveType::ScreenAlignedQuad);
+		auto material = Material::builtinMaterial("DrawQuad");
+		material->SetVector4("DrawRectParameters", Vector4(1 - size * 2, -1, size, size));
+		material->setMainTexture(s_overlayTexture);
+		Graphics::DrawMesh(quad, material);
+		GLStateCache::DepthFunc(GL_LESS);
+	}
+}
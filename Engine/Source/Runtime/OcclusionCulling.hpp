@@ -0,0 +1,156 @@
+#ifndef OcclusionCulling_hpp
+#define OcclusionCulling_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+#include "Vector3.hpp"
+#include "Matrix4x4.hpp"
+#include "Bounds.hpp"
+
+#include <vector>
+
+namespace FishEngine
+{
+	// The simplified copy of a mesh used as an occluder: the largest triangles of the mesh, a subset of its surface,
+	// so the occluder never hides more than the mesh itself. Built by Mesh when it is uploaded (the vertices are gone
+	// afterwards), see OcclusionCulling::BuildOccluderMesh.
+	struct OccluderMesh
+	{
+		std::vector<Vector3>	vertices;
+		std::vector<uint32_t>	indices;
+	};
+
+	typedef std::shared_ptr<OccluderMesh> OccluderMeshPtr;
+
+	// Occlusion culling with a software depth buffer.
+	// Every frame the largest occluders on screen are rasterized on the CPU into a Width * Height depth buffer:
+	// triangles are set up in groups of four (struct of arrays, vectorized by the compiler), binned into TileSize
+	// tiles and the tiles are rasterized in parallel by JobSystem workers. IsVisible then tests the screen rectangle
+	// and the nearest depth of a world space bounding box against the buffer.
+	// No GL calls except for the debug overlay, so the culling itself runs headless.
+	//
+	//	OcclusionCulling::BeginFrame(viewProjection, near, far);
+	//	OcclusionCulling::AddOccluder(occluderMesh, localToWorld, worldBounds);	// for each occluder candidate
+	//	OcclusionCulling::Rasterize();
+	//	OcclusionCulling::IsVisible(worldBounds);								// for each renderer
+	class FE_EXPORT Meta(NonSerializable) OcclusionCulling
+	{
+	public:
+		OcclusionCulling() = delete;
+
+		static constexpr int Width = 256;
+		static constexpr int Height = 128;
+		static constexpr int TileSize = 32;
+		static constexpr int TileCountX = Width / TileSize;
+		static constexpr int TileCountY = Height / TileSize;
+
+		// triangles kept by BuildOccluderMesh
+		static constexpr int MaxOccluderMeshTriangles = 512;
+
+		// occluders rasterized per frame, the largest on screen first
+		static constexpr int MaxOccluders = 64;
+
+		// occluders covering less of the screen height than this are skipped
+		static constexpr float MinOccluderScreenSize = 0.1f;
+
+		static bool enabled()
+		{
+			return s_enabled;
+		}
+
+		static void setEnabled(bool value)
+		{
+			s_enabled = value;
+		}
+
+		// Draw the depth buffer in the lower right corner of the screen (see DrawDepthOverlay).
+		static bool showDepthOverlay()
+		{
+			return s_showDepthOverlay;
+		}
+
+		static void setShowDepthOverlay(bool value)
+		{
+			s_showDepthOverlay = value;
+		}
+
+		// null if the mesh has no triangles
+		static OccluderMeshPtr BuildOccluderMesh(std::vector<Vector3> const & vertices, std::vector<uint32_t> const & indices);
+
+		// Clear the depth buffer and the occluders. near and far are only used by the overlay.
+		static void BeginFrame(Matrix4x4 const & viewProjection, float near, float far);
+
+		// bounds: world space bounds of the occluder, to select the largest occluders
+		static void AddOccluder(OccluderMeshPtr const & mesh, Matrix4x4 const & localToWorld, Bounds const & bounds);
+
+		static void Rasterize();
+
+		// false if bounds (world space) is hidden by the occluders.
+		static bool IsVisible(Bounds const & bounds);
+
+		// Count a culled renderer in statistics().
+		static void ReportCulled()
+		{
+			s_statistics.culled++;
+		}
+
+		// Depth buffer, Width * Height, row 0 at the bottom, NDC depth in [0, 1] (1: empty).
+		static std::vector<float> const & depthBuffer()
+		{
+			return s_depth;
+		}
+
+		// Upload the depth buffer (linearized) to a texture and draw it in the current render target.
+		static void DrawDepthOverlay();
+
+		struct Statistics
+		{
+			int		occluderCandidates = 0;		// AddOccluder calls
+			int		occluders = 0;				// rasterized
+			int		occluderTriangles = 0;		// set up
+			int		rasterizedTriangles = 0;	// on screen after setup
+			int		tested = 0;					// IsVisible calls
+			int		culled = 0;					// see ReportCulled
+			float	rasterizeTime = 0;			// in milliseconds, for the last Rasterize
+		};
+
+		static Statistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+	private:
+		struct Occluder
+		{
+			OccluderMeshPtr	mesh;
+			Matrix4x4		localToWorld;
+			float			screenSize;
+		};
+
+		// a triangle after setup, in pixels
+		struct ScreenTriangle
+		{
+			float	edgeA[3], edgeB[3], edgeC[3];	// inside: edgeA * x + edgeB * y + edgeC >= 0 for all three edges
+			float	depthA, depthB, depthC;			// depth = depthA * x + depthB * y + depthC
+			int		minX, minY, maxX, maxY;			// pixel bounds, inclusive
+		};
+
+		static void SetupTriangles(Occluder const & occluder, std::vector<ScreenTriangle> & outTriangles);
+		static void RasterizeTile(int tile);
+
+		static bool							s_enabled;
+		static bool							s_showDepthOverlay;
+		static Matrix4x4					s_viewProjection;
+		static float						s_near;
+		static float						s_far;
+		static std::vector<Occluder>		s_occluders;
+		static std::vector<ScreenTriangle>	s_triangles;
+		static std::vector<uint32_t>		s_tileTriangles[TileCountX * TileCountY];
+		static std::vector<float>			s_depth;
+		static float						s_tileMaxDepth[TileCountX * TileCountY];
+		static ColorBufferPtr				s_overlayTexture;
+		static Statistics					s_statistics;
+	};
+}
+
+#endif // OcclusionCulling_hpp
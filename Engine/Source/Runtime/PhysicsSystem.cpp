@@ -1,5 +1,7 @@
 #include "PhysicsSystem.hpp"
 #include "Transform.hpp"
+#include "Rigidbody.hpp"
+#include "Time.hpp"
 #include "Debug.hpp"
 #include <PhysXSDK/Snippets/SnippetCommon/SnippetPrint.h>
 #include <PhysXSDK/Snippets/SnippetCommon/SnippetPVD.h>
@@ -83,8 +85,29 @@ void FishEngine::PhysicsSystem::Init()
 
 void FishEngine::PhysicsSystem::FixedUpdate()
 {
-	gScene->simulate(1.0f/30.f);
+	Simulate(Time::fixedDeltaTime());
+	FetchResults();
+}
+
+void FishEngine::PhysicsSystem::Simulate(float deltaTime)
+{
+	gScene->simulate(deltaTime);
+}
+
+void FishEngine::PhysicsSystem::FetchResults()
+{
 	gScene->fetchResults(true);
+
+	// the actors of Rigidbodies point back to them
+	static std::vector<PxActor*> actors;
+	actors.resize(gScene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC));
+	gScene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, actors.data(), static_cast<PxU32>(actors.size()));
+	for (auto actor : actors)
+	{
+		auto rigidbody = static_cast<Rigidbody*>(actor->userData);
+		if (rigidbody != nullptr)
+			rigidbody->OnPhysicsStep();
+	}
 }
 
 void FishEngine::PhysicsSystem::Clean()
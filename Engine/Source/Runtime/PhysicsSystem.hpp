@@ -23,7 +23,16 @@ namespace FishEngine
 		
 		static void Init();
 		static void Start();
+
+		// One step of Time::fixedDeltaTime: Simulate then FetchResults.
 		static void FixedUpdate();
+
+		// Start a step, the PhysX threads run it until FetchResults.
+		static void Simulate(float deltaTime);
+
+		// Wait for the step, then record the new poses in the Rigidbodies.
+		static void FetchResults();
+
 		static void Clean();
 	private:
 		
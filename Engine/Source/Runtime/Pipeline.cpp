@@ -1,5 +1,6 @@
 #include "Pipeline.hpp"
 #include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
 #include "Camera.hpp"
 #include "Transform.hpp"
 #include "Time.hpp"
@@ -8,12 +9,17 @@
 #include "RenderTexture.hpp"
 #include "RenderTarget.hpp"
 #include "QualitySettings.hpp"
+#include "JobSystem.hpp"
+#include "ClusteredLighting.hpp"
+#include "Shader.hpp"
 
 #include <cassert>
+#include <cstddef>
 
 namespace FishEngine
 {
 	PerDrawUniforms     Pipeline::s_perDrawUniforms;
+	int                 Pipeline::s_perDrawMaterialIndex = -1;
 	LightingUniforms    Pipeline::s_lightingUniforms;
 
 	FishEngine::RenderTargetPtr Pipeline::s_currentRenderTarget;
@@ -26,14 +32,29 @@ namespace FishEngine
 	unsigned int        Pipeline::s_perDrawUBO = 0;
 	unsigned int        Pipeline::s_lightingUBO = 0;
 	unsigned int        Pipeline::s_bonesUBO = 0;
+	unsigned int        Pipeline::s_perDrawDataBuffer = 0;
+	unsigned int        Pipeline::s_perDrawDataTexture = 0;
 
 	void Pipeline::Init()
 	{
 		glGenBuffers(1, &s_perCameraUBO);
 		assert(s_perCameraUBO > 0);
 		glGenBuffers(1, &s_perDrawUBO);
+		// allocate the full size once, UpdatePerDrawUniforms may update only a part of it
+		GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, s_perDrawUBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(s_perDrawUniforms), nullptr, GL_DYNAMIC_DRAW);
 		glGenBuffers(1, &s_lightingUBO);
 		glGenBuffers(1, &s_bonesUBO);
+
+		glGenBuffers(1, &s_perDrawDataBuffer);
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, s_perDrawDataBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(PerDrawUniforms), nullptr, GL_STREAM_DRAW);
+		glGenTextures(1, &s_perDrawDataTexture);
+		GLStateCache::BindTexture(GL_TEXTURE_BUFFER, s_perDrawDataTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, s_perDrawDataBuffer);
+		GLStateCache::BindTexture(GL_TEXTURE_BUFFER, 0);
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, 0);
+		Shader::SetGlobalBufferTexture("PerDrawData", s_perDrawDataTexture);
 	}
 
 	void Pipeline::BindCamera(const CameraPtr& camera)
@@ -47,6 +68,7 @@ namespace FishEngine
 
 		s_perCameraUniforms.WorldSpaceCameraPos = Vector4(camera->transform()->position(), 1);
 		s_perCameraUniforms.WorldSpaceCameraDir = Vector4(camera->transform()->forward(), 0);
+		s_perCameraUniforms.ClusterParams = ClusteredLighting::ClusterParams(camera);
 
 		float t = Time::time();
 		s_perCameraUniforms.Time = Vector4(t / 20.f, t, t*2.f, t*3.f);
@@ -69,10 +91,10 @@ namespace FishEngine
 		s_perCameraUniforms.ZBufferParams.z = s_perCameraUniforms.ZBufferParams.x / far;
 		s_perCameraUniforms.ZBufferParams.w = s_perCameraUniforms.ZBufferParams.y / far;
 
-		glBindBuffer(GL_UNIFORM_BUFFER, s_perCameraUBO);
+		GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, s_perCameraUBO);
 		//auto size = sizeof(perFrameUniformData);
 		glBufferData(GL_UNIFORM_BUFFER, sizeof(s_perCameraUniforms), (void*)&s_perCameraUniforms, GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_UNIFORM_BUFFER, PerCameraUBOBindingPoint, s_perCameraUBO);
+		GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, PerCameraUBOBindingPoint, s_perCameraUBO);
 		glCheckError();
 	}
 
@@ -138,36 +160,108 @@ namespace FishEngine
 			s_lightingUniforms.LightMatrix[i] = s_lightingUniforms.LightMatrix[i].transpose();
 		}
 
-		glBindBuffer(GL_UNIFORM_BUFFER, s_lightingUBO);
+		GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, s_lightingUBO);
 		//auto size = sizeof(perFrameUniformData);
 		glBufferData(GL_UNIFORM_BUFFER, sizeof(s_lightingUniforms), (void*)&s_lightingUniforms, GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_UNIFORM_BUFFER, LightingUBOBindingPoint, s_lightingUBO);
+		GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, LightingUBOBindingPoint, s_lightingUBO);
+		glCheckError();
+	}
+
+	// (M^T)^-1 = (M^-1)^T and ((VM)^T)^-1 = (M^-1 * V^-1)^T, with M^-1 from worldToLocal
+	inline void ComputePerDrawUniforms(
+		PerCameraUniforms const &	camera,
+		Matrix4x4 const &			localToWorld,
+		Matrix4x4 const &			worldToLocal,
+		float						lodFade,
+		int							materialIndex,
+		PerDrawUniforms &			out)
+	{
+		out.MATRIX_MVP = camera.MATRIX_VP * localToWorld;
+		out.MATRIX_MV = camera.MATRIX_V * localToWorld;
+		out.MATRIX_M = localToWorld;
+		out.MATRIX_IT_MV = (worldToLocal * camera.MATRIX_I_V).transpose();
+		out.MATRIX_IT_M = worldToLocal.transpose();
+		out.LODFade = Vector4(lodFade, 0, 0, 0);
+		out.MaterialIndex[0] = materialIndex;
+		out.MaterialIndex[1] = out.MaterialIndex[2] = out.MaterialIndex[3] = 0;
+	}
+
+	void Pipeline::UpdatePerDrawUniforms(const Matrix4x4& modelMatrix, float lodFade, int materialIndex)
+	{
+		ComputePerDrawUniforms(s_perCameraUniforms, modelMatrix, modelMatrix.inverseAffine(), lodFade, materialIndex, s_perDrawUniforms);
+		UpdatePerDrawUniforms(s_perDrawUniforms);
+	}
+
+	void Pipeline::UpdatePerDrawUniforms(const PerDrawUniforms& uniforms, PerDrawFields fields)
+	{
+		glCheckError();
+		GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, s_perDrawUBO);
+		if (fields == PerDrawFields::ModelMatrix)
+		{
+			glBufferSubData(GL_UNIFORM_BUFFER, offsetof(PerDrawUniforms, MATRIX_M), sizeof(uniforms.MATRIX_M), (void*)&uniforms.MATRIX_M);
+		}
+		else
+		{
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(uniforms), (void*)&uniforms, GL_DYNAMIC_DRAW);
+			s_perDrawMaterialIndex = uniforms.MaterialIndex[0];
+		}
+		GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, PerDrawUBOBindingPoint, s_perDrawUBO);
 		glCheckError();
 	}
 
-	void Pipeline::UpdatePerDrawUniforms(const Matrix4x4& modelMatrix)
+	void Pipeline::UpdatePerDrawBatch(PerDrawUniforms const * uniforms, std::size_t count)
 	{
+		static_assert(sizeof(PerDrawUniforms) == 22 * 16, "PER_DRAW_TEXELS in ShaderVariables.inc");
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, s_perDrawDataBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, count * sizeof(PerDrawUniforms), uniforms, GL_STREAM_DRAW);
 		glCheckError();
-		auto mv = Pipeline::s_perCameraUniforms.MATRIX_V * modelMatrix;
-		s_perDrawUniforms.MATRIX_MVP = Pipeline::s_perCameraUniforms.MATRIX_VP * modelMatrix;
-		s_perDrawUniforms.MATRIX_MV = mv;
-		s_perDrawUniforms.MATRIX_M = modelMatrix;
-		s_perDrawUniforms.MATRIX_IT_MV = mv.transpose().inverse();
-		s_perDrawUniforms.MATRIX_IT_M = modelMatrix.transpose().inverse();
-
-		glBindBuffer(GL_UNIFORM_BUFFER, s_perDrawUBO);
-		//auto size = sizeof(perDrawUniformData);
-		glBufferData(GL_UNIFORM_BUFFER, sizeof(s_perDrawUniforms), (void*)&s_perDrawUniforms, GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_UNIFORM_BUFFER, PerDrawUBOBindingPoint, s_perDrawUBO);
+	}
+
+	void Pipeline::UpdatePerDrawBatch(Matrix4x4 const * modelMatrices, std::size_t count)
+	{
+		GLStateCache::BindBuffer(GL_TEXTURE_BUFFER, s_perDrawDataBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, count * sizeof(Matrix4x4), modelMatrices, GL_STREAM_DRAW);
 		glCheckError();
 	}
 
+	void Pipeline::BuildPerDrawUniforms(std::vector<PerDrawInput> const & draws, std::vector<PerDrawUniforms> & outUniforms)
+	{
+		outUniforms.resize(draws.size());
+
+		// bring the cached matrices up to date here, the workers only read them
+		for (auto const & draw : draws)
+		{
+			if (draw.transform != nullptr)
+				draw.transform->worldToLocalMatrix();
+		}
+
+		auto build = [&draws, &outUniforms](std::size_t i)
+		{
+			auto t = draws[i].transform;
+			if (t == nullptr)
+				ComputePerDrawUniforms(s_perCameraUniforms, Matrix4x4::identity, Matrix4x4::identity, draws[i].lodFade, draws[i].materialIndex, outUniforms[i]);
+			else
+				ComputePerDrawUniforms(s_perCameraUniforms, t->localToWorldMatrix(), t->worldToLocalMatrix(), draws[i].lodFade, draws[i].materialIndex, outUniforms[i]);
+		};
+
+		constexpr std::size_t ParallelThreshold = 256;
+		if (draws.size() < ParallelThreshold)
+		{
+			for (std::size_t i = 0; i < draws.size(); ++i)
+				build(i);
+		}
+		else
+		{
+			JobSystem::ParallelFor(0, draws.size(), build, 64, "Pipeline.PerDrawConstants");
+		}
+	}
+
 	void Pipeline::UpdateBonesUniforms(const std::vector<Matrix4x4>& bones)
 	{
-		glBindBuffer(GL_UNIFORM_BUFFER, s_bonesUBO);
+		GLStateCache::BindBuffer(GL_UNIFORM_BUFFER, s_bonesUBO);
 		//auto size = sizeof(perFrameUniformData);
 		glBufferData(GL_UNIFORM_BUFFER, bones.size() * sizeof(Matrix4x4), (void*)bones.data(), GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_UNIFORM_BUFFER, BonesUBOBindingPoint, s_bonesUBO);
+		GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, BonesUBOBindingPoint, s_bonesUBO);
 		glCheckError();
 	}
 
@@ -179,17 +273,14 @@ namespace FishEngine
 
 	void Pipeline::PopRenderTarget()
 	{
+		if (s_renderTargetStack.empty())
+			return;
+		s_renderTargetStack.pop();
+		// bind the previous render target directly, without going through 0
 		if (!s_renderTargetStack.empty())
-		{
-			s_renderTargetStack.top()->Detach();
-			s_renderTargetStack.pop();
-			glCheckError();
-		}
-		if (!s_renderTargetStack.empty())
-		{
 			s_renderTargetStack.top()->Attach();
-			glCheckError();
-		}
+		else
+			GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
 }
@@ -6,6 +6,7 @@
 #include "ShaderVariables_gen.hpp"
 #include "ReflectClass.hpp"
 #include <stack>
+#include <vector>
 
 namespace FishEngine
 {
@@ -19,10 +20,46 @@ namespace FishEngine
 		static void BindCamera(const CameraPtr& camera);
 		static void BindLight(const LightPtr& light);
 
-		static void UpdatePerDrawUniforms(const Matrix4x4& modelMatrix);
+		static void UpdatePerDrawUniforms(const Matrix4x4& modelMatrix, float lodFade = 0, int materialIndex = -1);
+
+		// Members of PerDrawUniforms read by the shaders of a pass.
+		enum class PerDrawFields
+		{
+			All,
+			ModelMatrix,	// MATRIX_M only, e.g. the shadow caster pass
+		};
+
+		// Upload per-draw uniforms built by BuildPerDrawUniforms, only the members in fields.
+		static void UpdatePerDrawUniforms(const PerDrawUniforms& uniforms, PerDrawFields fields = PerDrawFields::All);
+
+		// Upload the per-draw uniforms of the draws of MeshPool::MultiDraw calls, read by the ShaderKeyword::IndirectDraw
+		// variant of the shaders: uniforms[i] for draw ID i.
+		static void UpdatePerDrawBatch(PerDrawUniforms const * uniforms, std::size_t count);
+
+		// Same for passes that only read MATRIX_M (PER_DRAW_MODEL_MATRIX_ONLY in ShaderVariables.inc).
+		static void UpdatePerDrawBatch(Matrix4x4 const * modelMatrices, std::size_t count);
+
+		struct PerDrawInput
+		{
+			Transform const *	transform;		// null: world space geometry (static batches)
+			float				lodFade;
+			int					materialIndex;	// MaterialTable::IndexOf
+		};
+
+		// Compute the per-draw uniforms of a list of draws (after culling) in one batch,
+		// for the camera of the last BindCamera. Uses the cached Transform matrices, no 4x4 inverse per draw.
+		// Large lists are split across JobSystem workers.
+		static void BuildPerDrawUniforms(std::vector<PerDrawInput> const & draws, std::vector<PerDrawUniforms> & outUniforms);
 
 		static void UpdateBonesUniforms(const std::vector<Matrix4x4>& bones);
 
+		// MaterialIndex.x of the uploaded per-draw uniforms. A draw may use the MaterialTable variant
+		// of its shader only if this is the row of its material.
+		static int perDrawMaterialIndex()
+		{
+			return s_perDrawMaterialIndex;
+		}
+
 		static RenderTargetPtr CurrentRenderTarget()
 		{
 			return s_renderTargetStack.top();
@@ -61,8 +98,11 @@ namespace FishEngine
 		static unsigned int         s_perDrawUBO;
 		static unsigned int         s_lightingUBO;
 		static unsigned int         s_bonesUBO;
+		static unsigned int         s_perDrawDataBuffer;	// UpdatePerDrawBatch, texture buffer "PerDrawData"
+		static unsigned int         s_perDrawDataTexture;
 		static PerCameraUniforms    s_perCameraUniforms;
 		static PerDrawUniforms      s_perDrawUniforms;
+		static int                  s_perDrawMaterialIndex;
 		static LightingUniforms     s_lightingUniforms;
 		//static Bones        s_bonesUniformData;
 
@@ -1,6 +1,7 @@
 #include "RenderBuffer.hpp"
 
 #include <Debug.hpp>
+#include <GLStateCache.hpp>
 #include <cassert>
 
 using namespace FishEngine;
@@ -15,7 +16,7 @@ std::shared_ptr<ColorBuffer> ColorBuffer::Create(const int width, const int heig
 	t->m_height = height;
 	glGenTextures(1, &t->m_GLNativeTexture);
 	assert(t->m_GLNativeTexture > 0);
-	glBindTexture(GL_TEXTURE_2D, t->m_GLNativeTexture);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, t->m_GLNativeTexture);
 	GLenum internal_format, external_format, pixel_type;
 	TextureFormat2GLFormat(format, &internal_format, &external_format, &pixel_type);
 	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, t->m_width, t->m_height, 0, external_format, pixel_type, NULL);
@@ -25,7 +26,7 @@ std::shared_ptr<ColorBuffer> ColorBuffer::Create(const int width, const int heig
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
 	glCheckError();
 	t->m_uploaded = true;
 	return t;
@@ -41,9 +42,9 @@ void ColorBuffer::Resize(const int newWidth, const int newHeight)
 	m_height = newHeight;
 	GLenum internal_format, external_format, pixel_type;
 	TextureFormat2GLFormat(m_format, &internal_format, &external_format, &pixel_type);
-	glBindTexture(GL_TEXTURE_2D, m_GLNativeTexture);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, m_GLNativeTexture);
 	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, m_width, m_height, 0, external_format, pixel_type, NULL);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
 	glCheckError();
 }
 
@@ -55,7 +56,7 @@ std::shared_ptr<DepthBuffer> DepthBuffer::Create(const int width, const int heig
 	t->m_width = width;
 	t->m_height = height;
 	glGenTextures(1, &t->m_GLNativeTexture);
-	glBindTexture(GL_TEXTURE_2D, t->m_GLNativeTexture);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, t->m_GLNativeTexture);
 	//glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, rt->m_width, rt->m_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, t->m_width, t->m_height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -64,7 +65,7 @@ std::shared_ptr<DepthBuffer> DepthBuffer::Create(const int width, const int heig
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
 	glCheckError();
 	t->m_uploaded = true;
 	return t;
@@ -77,12 +78,12 @@ void DepthBuffer::Resize(const int newWidth, const int newHeight)
 		return;
 	m_width = newWidth;
 	m_height = newHeight;
-	glBindTexture(GL_TEXTURE_2D, m_GLNativeTexture);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, m_GLNativeTexture);
 	if (m_useStencil)
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, m_width, m_height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
 	else
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, m_width, m_height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
 	glCheckError();
 }
 
@@ -128,7 +129,7 @@ std::shared_ptr<LayeredDepthBuffer> LayeredDepthBuffer::Create(const int width,
 	t->m_wrapMode = TextureWrapMode::Clamp;
 	
 	glGenTextures(1, &t->m_GLNativeTexture);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, t->m_GLNativeTexture);
+	GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, t->m_GLNativeTexture);
 	if (useStencil)
 		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH24_STENCIL8, t->m_width, t->m_height, depth, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
 	else
@@ -150,7 +151,7 @@ std::shared_ptr<LayeredDepthBuffer> LayeredDepthBuffer::Create(const int width,
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
 	glCheckError();
 	t->m_uploaded = true;
 	return t;
@@ -163,11 +164,11 @@ void FishEngine::LayeredDepthBuffer::Resize(const int newWidth, const int newHei
 		return;
 	m_width = newWidth;
 	m_height = newHeight;
-	glBindTexture(GL_TEXTURE_2D_ARRAY, m_GLNativeTexture);
+	GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, m_GLNativeTexture);
 	if (m_useStencil)
 		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH24_STENCIL8, m_width, m_height, m_depth, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
 	else
 		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, m_width, m_height, m_depth, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	GLStateCache::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
 	glCheckError();
 }
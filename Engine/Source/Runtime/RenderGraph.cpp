@@ -0,0 +1,430 @@
+#include "RenderGraph.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
+#include "Debug.hpp"
+#include "Pipeline.hpp"
+#include "RenderBuffer.hpp"
+#include "RenderTarget.hpp"
+
+namespace
+{
+	// pooled textures not used for this many frames are destroyed
+	constexpr int UnusedFramesBeforeRelease = 8;
+
+	// glInvalidateFramebuffer / glInvalidateTexImage are GL 4.3 (or ARB_invalidate_subdata).
+	// Not available on macOS (GL 4.1), invalidation is only a hint so we skip it there.
+	bool InvalidateSupported()
+	{
+#if FISHENGINE_PLATFORM_WINDOWS
+		static const bool supported = GLEW_VERSION_4_3 || GLEW_ARB_invalidate_subdata;
+		return supported;
+#else
+		return false;
+#endif
+	}
+}
+
+namespace FishEngine
+{
+	std::vector<RenderGraph::PooledTexture>						RenderGraph::s_pool;
+	std::map<std::vector<unsigned int>, RenderTargetPtr>		RenderGraph::s_renderTargets;
+	int															RenderGraph::s_frame = 0;
+
+	std::size_t RenderGraph::TextureDesc::ByteCount() const
+	{
+		if (depth)
+			return std::size_t(width) * height * 4;	// D24S8
+		return ImageByteCount(format, width, height);
+	}
+
+
+	/************************************************************************/
+	/* Builder                                                              */
+	/************************************************************************/
+
+	RenderGraph::Handle RenderGraph::Builder::Create(std::string const & name, TextureDesc const & desc)
+	{
+		Resource resource;
+		resource.name = name;
+		resource.desc = desc;
+		m_graph.m_resources.push_back(resource);
+		return static_cast<Handle>(m_graph.m_resources.size() - 1);
+	}
+
+	void RenderGraph::Builder::Read(Handle handle)
+	{
+		assert(handle >= 0 && handle < m_graph.m_resources.size());
+		m_graph.m_passes[m_pass].reads.push_back(handle);
+	}
+
+	void RenderGraph::Builder::WriteColor(Handle handle)
+	{
+		AddWrite(handle, true);
+		m_graph.m_passes[m_pass].colorAttachments.push_back({ handle, false, Color(), 1.0f });
+	}
+
+	void RenderGraph::Builder::WriteColor(Handle handle, Color const & clearColor)
+	{
+		AddWrite(handle, false);
+		m_graph.m_passes[m_pass].colorAttachments.push_back({ handle, true, clearColor, 1.0f });
+	}
+
+	void RenderGraph::Builder::WriteDepth(Handle handle)
+	{
+		AddWrite(handle, true);
+		m_graph.m_passes[m_pass].depthAttachment = { handle, false, Color(), 1.0f };
+	}
+
+	void RenderGraph::Builder::WriteDepth(Handle handle, float clearDepth)
+	{
+		AddWrite(handle, false);
+		m_graph.m_passes[m_pass].depthAttachment = { handle, true, Color(), clearDepth };
+	}
+
+	void RenderGraph::Builder::Write(Handle handle)
+	{
+		AddWrite(handle, true);
+	}
+
+	void RenderGraph::Builder::SideEffect()
+	{
+		m_graph.m_passes[m_pass].sideEffect = true;
+	}
+
+	void RenderGraph::Builder::AddWrite(Handle handle, bool keepContent)
+	{
+		assert(handle >= 0 && handle < m_graph.m_resources.size());
+		auto & pass = m_graph.m_passes[m_pass];
+		pass.writes.push_back(handle);
+		// the previous content is used, so the passes that wrote it must be kept
+		if (keepContent)
+			pass.reads.push_back(handle);
+	}
+
+
+	/************************************************************************/
+	/* Resources                                                            */
+	/************************************************************************/
+
+	TexturePtr const & RenderGraph::Resources::GetTexture(Handle handle) const
+	{
+		assert(handle >= 0 && handle < m_graph.m_resources.size());
+		return m_graph.m_resources[handle].texture;
+	}
+
+	ColorBufferPtr RenderGraph::Resources::GetColorBuffer(Handle handle) const
+	{
+		return std::dynamic_pointer_cast<ColorBuffer>(GetTexture(handle));
+	}
+
+	DepthBufferPtr RenderGraph::Resources::GetDepthBuffer(Handle handle) const
+	{
+		return std::dynamic_pointer_cast<DepthBuffer>(GetTexture(handle));
+	}
+
+
+	/************************************************************************/
+	/* RenderGraph                                                          */
+	/************************************************************************/
+
+	void RenderGraph::AddPass(std::string const & name, SetupFunction const & setup, ExecuteFunction const & execute)
+	{
+		assert(!m_compiled);
+		Pass pass;
+		pass.name = name;
+		pass.execute = execute;
+		m_passes.push_back(std::move(pass));
+		Builder builder(*this, static_cast<int>(m_passes.size() - 1));
+		setup(builder);
+	}
+
+	RenderGraph::Handle RenderGraph::Import(std::string const & name, TexturePtr const & texture)
+	{
+		assert(texture != nullptr);
+		Resource resource;
+		resource.name = name;
+		resource.desc = TextureDesc(texture->width(), texture->height(), TextureFormat::RGBA32);
+		resource.desc.depth = (std::dynamic_pointer_cast<DepthBuffer>(texture) != nullptr);
+		resource.texture = texture;
+		resource.imported = true;
+		m_resources.push_back(resource);
+		return static_cast<Handle>(m_resources.size() - 1);
+	}
+
+	void RenderGraph::Compile()
+	{
+		assert(!m_compiled);
+		const int passCount = static_cast<int>(m_passes.size());
+
+		// Cull: walk the passes backwards, keeping the ones with side effects, the ones writing imported (persistent)
+		// textures and the ones producing something a kept pass reads.
+		std::set<Handle> needed;
+		for (int i = passCount - 1; i >= 0; --i)
+		{
+			auto & pass = m_passes[i];
+			bool keep = pass.sideEffect;
+			for (auto h : pass.writes)
+			{
+				if (m_resources[h].imported || needed.count(h) > 0)
+				{
+					keep = true;
+					break;
+				}
+			}
+			pass.culled = !keep;
+			if (!keep)
+				continue;
+
+			// a cleared attachment overwrites everything, earlier writers are not needed for it
+			for (auto const & a : pass.colorAttachments)
+			{
+				if (a.clear)
+					needed.erase(a.handle);
+			}
+			if (pass.depthAttachment.handle != InvalidHandle && pass.depthAttachment.clear)
+				needed.erase(pass.depthAttachment.handle);
+			for (auto h : pass.reads)
+				needed.insert(h);
+		}
+
+		// lifetimes
+		for (int i = 0; i < passCount; ++i)
+		{
+			auto const & pass = m_passes[i];
+			if (pass.culled)
+				continue;
+			auto touch = [this, i](Handle h) {
+				auto & r = m_resources[h];
+				if (r.firstPass < 0)
+					r.firstPass = i;
+				r.lastPass = i;
+			};
+			for (auto h : pass.reads)
+				touch(h);
+			for (auto h : pass.writes)
+				touch(h);
+		}
+
+		// Assign pooled textures in pass order. A pooled texture is reused by any transient with the same description
+		// whose lifetime starts after the last pass of its previous user.
+		for (auto & p : s_pool)
+			p.busyUntilPass = -1;
+		for (int i = 0; i < passCount; ++i)
+		{
+			for (auto & r : m_resources)
+			{
+				if (!r.imported && r.firstPass == i)
+				{
+					r.texture = AcquireTexture(r.desc, r.firstPass, r.lastPass);
+					if (r.texture->name().empty())
+						r.texture->setName("RenderGraph-" + r.name);
+				}
+			}
+		}
+
+		m_compiled = true;
+	}
+
+	void RenderGraph::Execute()
+	{
+		assert(m_compiled);
+		Resources resources(*this);
+		for (int i = 0; i < m_passes.size(); ++i)
+		{
+			auto const & pass = m_passes[i];
+			if (pass.culled)
+				continue;
+			bool bound = BindAttachments(pass);
+			pass.execute(resources);
+			Invalidate(pass, i);
+			if (bound)
+				Pipeline::PopRenderTarget();
+		}
+		glCheckError();
+	}
+
+	std::vector<std::string> RenderGraph::CompiledPasses() const
+	{
+		std::vector<std::string> names;
+		for (auto const & pass : m_passes)
+		{
+			if (!pass.culled)
+				names.push_back(pass.name);
+		}
+		return names;
+	}
+
+	std::size_t RenderGraph::PoolByteCount()
+	{
+		std::size_t bytes = 0;
+		for (auto const & p : s_pool)
+			bytes += p.desc.ByteCount();
+		return bytes;
+	}
+
+	void RenderGraph::ReleaseUnusedTextures()
+	{
+		s_frame++;
+		for (auto it = s_pool.begin(); it != s_pool.end(); )
+		{
+			if (s_frame - it->lastUsedFrame <= UnusedFramesBeforeRelease)
+			{
+				++it;
+				continue;
+			}
+
+			// GL may reuse the texture name, so drop the framebuffers built on it
+			unsigned int id = it->texture->GetNativeTexturePtr();
+			for (auto rt = s_renderTargets.begin(); rt != s_renderTargets.end(); )
+			{
+				auto const & key = rt->first;
+				if (std::find(key.begin(), key.end(), id) != key.end())
+					rt = s_renderTargets.erase(rt);
+				else
+					++rt;
+			}
+
+			auto & all = Texture::s_textures;
+			all.erase(std::remove(all.begin(), all.end(), it->texture), all.end());
+			it = s_pool.erase(it);
+		}
+	}
+
+	bool RenderGraph::BindAttachments(Pass const & pass)
+	{
+		if (pass.colorAttachments.empty() && pass.depthAttachment.handle == InvalidHandle)
+			return false;
+
+		std::vector<TexturePtr> colors;
+		for (auto const & a : pass.colorAttachments)
+			colors.push_back(m_resources[a.handle].texture);
+		TexturePtr depth;
+		if (pass.depthAttachment.handle != InvalidHandle)
+			depth = m_resources[pass.depthAttachment.handle].texture;
+
+		Pipeline::PushRenderTarget(FindOrCreateRenderTarget(colors, depth));
+
+		for (int i = 0; i < pass.colorAttachments.size(); ++i)
+		{
+			auto const & a = pass.colorAttachments[i];
+			if (a.clear)
+			{
+				float color[] = { a.clearColor.r, a.clearColor.g, a.clearColor.b, a.clearColor.a };
+				glClearBufferfv(GL_COLOR, i, color);
+			}
+		}
+		if (depth != nullptr && pass.depthAttachment.clear)
+		{
+			// depth clears are masked by glDepthMask, the last draw may have left it off
+			GLStateCache::DepthMask(true);
+			glClearBufferfv(GL_DEPTH, 0, &pass.depthAttachment.clearDepth);
+		}
+		return true;
+	}
+
+	void RenderGraph::Invalidate(Pass const & pass, int passIndex)
+	{
+		if (!InvalidateSupported())
+			return;
+#if FISHENGINE_PLATFORM_WINDOWS
+		// transient attachments are not needed after their last pass: let the driver skip storing them
+		std::vector<GLenum> attachments;
+		for (int i = 0; i < pass.colorAttachments.size(); ++i)
+		{
+			auto const & r = m_resources[pass.colorAttachments[i].handle];
+			if (!r.imported && r.lastPass == passIndex)
+				attachments.push_back(GL_COLOR_ATTACHMENT0 + i);
+		}
+		if (pass.depthAttachment.handle != InvalidHandle)
+		{
+			auto const & r = m_resources[pass.depthAttachment.handle];
+			if (!r.imported && r.lastPass == passIndex)
+			{
+				attachments.push_back(GL_DEPTH_ATTACHMENT);
+				attachments.push_back(GL_STENCIL_ATTACHMENT);
+			}
+		}
+		if (!attachments.empty())
+			glInvalidateFramebuffer(GL_FRAMEBUFFER, static_cast<GLsizei>(attachments.size()), attachments.data());
+
+		// transient textures only sampled in their last pass
+		for (auto h : pass.reads)
+		{
+			auto const & r = m_resources[h];
+			if (r.imported || r.lastPass != passIndex)
+				continue;
+			bool attached = (h == pass.depthAttachment.handle);
+			for (auto const & a : pass.colorAttachments)
+				attached = attached || (a.handle == h);
+			if (!attached)
+				glInvalidateTexImage(r.texture->GetNativeTexturePtr(), 0);
+		}
+		glCheckError();
+#endif
+	}
+
+	TexturePtr RenderGraph::AcquireTexture(TextureDesc const & desc, int firstPass, int lastPass)
+	{
+		for (auto & p : s_pool)
+		{
+			if (p.desc == desc && p.busyUntilPass < firstPass)
+			{
+				p.busyUntilPass = lastPass;
+				p.lastUsedFrame = s_frame;
+				return p.texture;
+			}
+		}
+
+		PooledTexture p;
+		p.desc = desc;
+		if (desc.depth)
+			p.texture = DepthBuffer::Create(desc.width, desc.height);
+		else
+			p.texture = ColorBuffer::Create(desc.width, desc.height, desc.format);
+		p.lastUsedFrame = s_frame;
+		p.busyUntilPass = lastPass;
+		s_pool.push_back(p);
+		return p.texture;
+	}
+
+	RenderTargetPtr RenderGraph::FindOrCreateRenderTarget(std::vector<TexturePtr> const & colors, TexturePtr const & depth)
+	{
+		std::vector<unsigned int> key;
+		for (auto const & c : colors)
+			key.push_back(c->GetNativeTexturePtr());
+		key.push_back(depth == nullptr ? 0 : depth->GetNativeTexturePtr());
+
+		auto it = s_renderTargets.find(key);
+		if (it != s_renderTargets.end())
+			return it->second;
+
+		auto color = [&colors](int i) {
+			auto c = std::dynamic_pointer_cast<ColorBuffer>(colors[i]);
+			assert(c != nullptr);
+			return c;
+		};
+		auto depthBuffer = std::dynamic_pointer_cast<DepthBuffer>(depth);
+		assert(depth == nullptr || depthBuffer != nullptr);
+
+		auto rt = std::make_shared<RenderTarget>();
+		if (colors.size() == 1 && depth == nullptr)
+			rt->SetColorBufferOnly(color(0));
+		else if (colors.size() == 1)
+			rt->Set(color(0), depthBuffer);
+		else if (colors.size() == 3 && depth != nullptr)
+			rt->Set(color(0), color(1), color(2), depthBuffer);
+		else if (colors.empty())
+			rt->SetDepthBufferOnly(depthBuffer);
+		else
+		{
+			LogError(Format("RenderGraph: unsupported attachments, %1% color buffers", colors.size()));
+			abort();
+		}
+		s_renderTargets[key] = rt;
+		return rt;
+	}
+}
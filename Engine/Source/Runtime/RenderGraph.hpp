@@ -0,0 +1,191 @@
+#ifndef RenderGraph_hpp
+#define RenderGraph_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+#include "TextureProperty.hpp"
+#include "Color.hpp"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace FishEngine
+{
+	// Frame render graph.
+	// Passes declare the textures they create, read and write; Compile culls the passes whose results are never used,
+	// computes the lifetime of every transient texture and assigns pooled textures to them, reusing a pooled texture
+	// for every transient with the same description whose lifetime does not overlap (aliasing).
+	// Execute binds the attachments of each pass, clears or invalidates them as declared, and runs the passes in order.
+	//
+	//	RenderGraph graph;
+	//	RenderGraph::Handle color;
+	//	graph.AddPass("Scene", [&](RenderGraph::Builder & builder) {
+	//		color = builder.Create("SceneColor", RenderGraph::TextureDesc(w, h, TextureFormat::RGBA32));
+	//		builder.WriteColor(color, Color::black);
+	//	}, [&](RenderGraph::Resources const & resources) {
+	//		...draw...
+	//	});
+	//	graph.Compile();
+	//	graph.Execute();
+	class FE_EXPORT Meta(NonSerializable) RenderGraph
+	{
+	public:
+		typedef int Handle;
+		static constexpr Handle InvalidHandle = -1;
+
+		struct TextureDesc
+		{
+			int				width = 0;
+			int				height = 0;
+			TextureFormat	format = TextureFormat::RGBA32;
+			bool			depth = false;		// depth-stencil buffer, format is ignored
+
+			TextureDesc() = default;
+			TextureDesc(int width, int height, TextureFormat format) : width(width), height(height), format(format) {}
+
+			static TextureDesc Depth(int width, int height)
+			{
+				TextureDesc desc(width, height, TextureFormat::RGBA32);
+				desc.depth = true;
+				return desc;
+			}
+
+			bool operator==(TextureDesc const & rhs) const
+			{
+				return width == rhs.width && height == rhs.height && depth == rhs.depth && (depth || format == rhs.format);
+			}
+
+			// approximate size in video memory
+			std::size_t ByteCount() const;
+		};
+
+		class Builder
+		{
+		public:
+			// A transient texture, only valid during this frame.
+			Handle Create(std::string const & name, TextureDesc const & desc);
+
+			// Sample handle as a texture in this pass.
+			void Read(Handle handle);
+
+			// Render to handle as color attachment (in declaration order). The previous content is kept.
+			void WriteColor(Handle handle);
+
+			// Render to handle as color attachment, cleared to clearColor first.
+			void WriteColor(Handle handle, Color const & clearColor);
+
+			// Render to handle as depth attachment.
+			void WriteDepth(Handle handle);
+			void WriteDepth(Handle handle, float clearDepth);
+
+			// Modified by the pass without being an attachment (e.g. the pass binds its own render target).
+			void Write(Handle handle);
+
+			// The pass has effects outside the graph (e.g. draws into the current framebuffer) and is never culled.
+			void SideEffect();
+
+		private:
+			friend class RenderGraph;
+			Builder(RenderGraph & graph, int pass) : m_graph(graph), m_pass(pass) {}
+			void AddWrite(Handle handle, bool keepContent);
+
+			RenderGraph &	m_graph;
+			int				m_pass;
+		};
+
+		class Resources
+		{
+		public:
+			TexturePtr const & GetTexture(Handle handle) const;
+			ColorBufferPtr GetColorBuffer(Handle handle) const;
+			DepthBufferPtr GetDepthBuffer(Handle handle) const;
+
+		private:
+			friend class RenderGraph;
+			Resources(RenderGraph const & graph) : m_graph(graph) {}
+			RenderGraph const & m_graph;
+		};
+
+		typedef std::function<void(Builder &)>				SetupFunction;
+		typedef std::function<void(Resources const &)>		ExecuteFunction;
+
+		RenderGraph() = default;
+		RenderGraph(RenderGraph const &) = delete;
+		RenderGraph & operator=(RenderGraph const &) = delete;
+
+		// setup is called immediately, execute by Execute if the pass is not culled.
+		void AddPass(std::string const & name, SetupFunction const & setup, ExecuteFunction const & execute);
+
+		// A texture owned outside the graph (persistent across frames).
+		Handle Import(std::string const & name, TexturePtr const & texture);
+
+		void Compile();
+
+		void Execute();
+
+		// Names of the passes Execute runs, in order (valid after Compile).
+		std::vector<std::string> CompiledPasses() const;
+
+		// Size of all textures in the transient pool.
+		static std::size_t PoolByteCount();
+
+		// Destroy pooled textures that have not been used for a few frames. Call once per frame.
+		static void ReleaseUnusedTextures();
+
+	private:
+		struct Attachment
+		{
+			Handle	handle;
+			bool	clear;
+			Color	clearColor;
+			float	clearDepth;
+		};
+
+		struct Pass
+		{
+			std::string				name;
+			ExecuteFunction			execute;
+			std::vector<Handle>		reads;
+			std::vector<Handle>		writes;
+			std::vector<Attachment>	colorAttachments;
+			Attachment				depthAttachment = { InvalidHandle, false, Color(), 1.0f };
+			bool					sideEffect = false;
+			bool					culled = false;
+		};
+
+		struct Resource
+		{
+			std::string		name;
+			TextureDesc		desc;
+			TexturePtr		texture;			// imported texture, or the pooled texture assigned by Compile
+			bool			imported = false;
+			int				firstPass = -1;		// lifetime in pass indices, set by Compile
+			int				lastPass = -1;
+		};
+
+		struct PooledTexture
+		{
+			TextureDesc		desc;
+			TexturePtr		texture;
+			int				lastUsedFrame = 0;
+			int				busyUntilPass = -1;	// aliasing within the frame being compiled
+		};
+
+		bool BindAttachments(Pass const & pass);
+		void Invalidate(Pass const & pass, int passIndex);
+		static TexturePtr AcquireTexture(TextureDesc const & desc, int firstPass, int lastPass);
+		static RenderTargetPtr FindOrCreateRenderTarget(std::vector<TexturePtr> const & colors, TexturePtr const & depth);
+
+		std::vector<Pass>		m_passes;
+		std::vector<Resource>	m_resources;
+		bool					m_compiled = false;
+
+		static std::vector<PooledTexture>						s_pool;
+		static std::map<std::vector<unsigned int>, RenderTargetPtr>	s_renderTargets;	// by GL textures of the attachments
+		static int												s_frame;
+	};
+}
+
+#endif // RenderGraph_hpp
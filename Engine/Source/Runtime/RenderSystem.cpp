@@ -1,9 +1,13 @@
 #include "RenderSystem.hpp"
 
+#include <algorithm>
+#include <map>
+
 #include <boost/lexical_cast.hpp>
 
 #include "Pipeline.hpp"
 #include "Shader.hpp"
+#include "Rendering/RenderQueue.hpp"
 #include "Material.hpp"
 //#include "ModelImporter.hpp"
 #include "Mesh.hpp"
@@ -20,6 +24,14 @@
 #include "RenderTarget.hpp"
 #include "Timer.hpp"
 #include "MeshFilter.hpp"
+#include "LODGroup.hpp"
+#include "ClusteredLighting.hpp"
+#include "GLStateCache.hpp"
+#include "MaterialTable.hpp"
+#include "MeshPool.hpp"
+#include "OcclusionCulling.hpp"
+#include "HiZCulling.hpp"
+#include "StaticBatchingUtility.hpp"
 
 using namespace FishEngine;
 
@@ -30,28 +42,182 @@ struct RenderObject
 	MaterialPtr		material;
 	MeshPtr			mesh;
 	int				subMeshID = -1;
+	float			lodFade = 0;	// see LODFade in ShaderVariables.inc
+
+	// a run of visible parts of a static batch: subMeshCount sub-meshes from subMeshID, in world space (renderer is null)
+	int				subMeshCount = 1;
+	Bounds			staticBatchBounds;
 
-	RenderObject(int renderQueue, RendererPtr renderer, MaterialPtr material, MeshPtr mesh, int subMeshID = -1)
-		: renderQueue(renderQueue), renderer(renderer), material(material), mesh(mesh), subMeshID(subMeshID)
+	RenderObject(int renderQueue, RendererPtr renderer, MaterialPtr material, MeshPtr mesh, int subMeshID = -1, float lodFade = 0)
+		: renderQueue(renderQueue), renderer(renderer), material(material), mesh(mesh), subMeshID(subMeshID), lodFade(lodFade)
 	{
 
 	}
 };
 
-namespace FishEngine
+// per-draw uniforms of a render queue, in the same order
+static void BuildPerDrawUniforms(std::deque<RenderObject> const & queue, std::vector<PerDrawUniforms> & outUniforms)
 {
-	//FishEngine::GBuffer RenderSystem::m_GBuffer;
-	FishEngine::ColorBufferPtr      RenderSystem::m_GBuffer[3];
-	FishEngine::DepthBufferPtr      RenderSystem::m_mainDepthBuffer;
-	FishEngine::RenderTargetPtr     RenderSystem::m_deferredRenderTarget;
+	std::vector<Pipeline::PerDrawInput> draws;
+	draws.reserve(queue.size());
+	for (auto const & ro : queue)
+	{
+		draws.push_back({ ro.renderer != nullptr ? ro.renderer->transform().get() : nullptr, ro.lodFade, MaterialTable::IndexOf(ro.material) });
+	}
+	Pipeline::BuildPerDrawUniforms(draws, outUniforms);
+}
+
+// Only fully opaque renderers hide what is behind them: no transparent or alpha tested (cutout) material.
+static bool IsOpaque(MeshRendererPtr const & renderer)
+{
+	auto const & materials = renderer->materials();
+	if (materials.empty())
+		return false;
+	for (auto const & material : materials)
+	{
+		if (material == nullptr || material->shader() == nullptr || material->shader()->IsTransparent())
+			return false;
+		if (material->renderQueue() >= static_cast<int>(Rendering::RenderQueue::AlphaTest))
+			return false;
+	}
+	return true;
+}
+
+// Rasterize the static meshes of the scene as occluders, OcclusionCulling keeps the largest on screen.
+// Skinned meshes deform at run time, they are not occluders.
+static void RasterizeOccluders(CameraPtr const & camera)
+{
+	OcclusionCulling::BeginFrame(camera->projectionMatrix() * camera->worldToCameraMatrix(), camera->nearClipPlane(), camera->farClipPlane());
+	// from the root game objects: the children of an instantiated prefab are not in Scene::GameObjects()
+	std::deque<GameObjectPtr> todo;
+	for (auto const & go : Scene::GameObjects())
+	{
+		if (go->transform()->parent() == nullptr)
+			todo.push_back(go);
+	}
+	while (!todo.empty())
+	{
+		auto go = todo.front();
+		todo.pop_front();
+		if (!go->activeInHierarchy())
+			continue;
+		for (auto && child : go->transform()->children())
+		{
+			todo.push_back(child->gameObject());
+		}
+
+		auto renderer = go->GetComponent<MeshRenderer>();
+		auto meshFilter = go->GetComponent<MeshFilter>();
+		if (renderer == nullptr || !renderer->enabled() || meshFilter == nullptr || meshFilter->mesh() == nullptr)
+			continue;
+		auto const & mesh = meshFilter->mesh();
+		if (mesh->m_skinned || !IsOpaque(renderer))
+			continue;
+		auto const & occluderMesh = mesh->occluderMesh();
+		if (occluderMesh != nullptr)
+			OcclusionCulling::AddOccluder(occluderMesh, go->transform()->localToWorldMatrix(), renderer->bounds());
+	}
+	OcclusionCulling::Rasterize();
+}
+
+// Draws of a render queue merged into MeshPool multi-draws, by state (material) and pool.
+// The other draws (skinned meshes, shaders without IndirectDraw variant) are drawn one by one.
+struct MultiDrawQueue
+{
+	std::vector<MeshPool::Batch>		batches;
+	std::vector<MeshPool::DrawCommand>	commands;
+	std::vector<PerDrawUniforms>		perDraw;		// by draw ID
+	std::vector<std::size_t>			queueIndices;	// by draw ID, index of the draw in the render queue
+	std::vector<std::size_t>			singleDraws;	// indices in the render queue
+
+	// the commands were culled by HiZCulling, batches are drawn from HiZCulling::commandBuffer() at indirectFirst
+	bool								indirect = false;
+	std::size_t							indirectFirst = 0;
+};
+
+static void BuildMultiDrawQueue(std::deque<RenderObject> const & queue, std::vector<PerDrawUniforms> const & perDraw, MultiDrawQueue & out)
+{
+	std::vector<MeshPool::Draw> draws;
+	std::vector<std::size_t> drawQueueIndices;
+	out.singleDraws.clear();
+	for (std::size_t i = 0; i < queue.size(); ++i)
+	{
+		auto const & ro = queue[i];
+		ro.mesh->UploadMeshData();
+		if (ro.mesh->pooled() && ro.material->shader()->SupportsIndirectDraw() && draws.size() < MeshPool::MaxDrawIDs)
+		{
+			draws.push_back({ ro.mesh.get(), ro.subMeshID, ro.subMeshCount, ro.material.get() });
+			drawQueueIndices.push_back(i);
+		}
+		else
+		{
+			out.singleDraws.push_back(i);
+		}
+	}
+
+	std::vector<uint32_t> order;
+	MeshPool::BuildMultiDraws(draws, out.batches, out.commands, order);
+	out.perDraw.resize(order.size());
+	out.queueIndices.resize(order.size());
+	for (std::size_t i = 0; i < order.size(); ++i)
+	{
+		out.queueIndices[i] = drawQueueIndices[order[i]];
+		out.perDraw[i] = perDraw[out.queueIndices[i]];
+	}
+}
+
+// Cull the commands of the multi-draw queues on the GPU, in one dispatch.
+static void CullMultiDrawQueues(std::initializer_list<std::pair<std::deque<RenderObject> const *, MultiDrawQueue *>> queues)
+{
+	std::vector<Bounds> bounds;
+	std::vector<MeshPool::DrawCommand> commands;
+	for (auto const & q : queues)
+	{
+		auto & multiDraws = *q.second;
+		multiDraws.indirect = true;
+		multiDraws.indirectFirst = commands.size();
+		for (std::size_t i = 0; i < multiDraws.commands.size(); ++i)
+		{
+			auto const & ro = (*q.first)[multiDraws.queueIndices[i]];
+			commands.push_back(multiDraws.commands[i]);
+			bounds.push_back(ro.renderer != nullptr ? ro.renderer->bounds() : ro.staticBatchBounds);
+		}
+	}
+	HiZCulling::Cull(bounds, commands);
+}
+
+static void DrawMultiDrawQueue(std::deque<RenderObject> const & queue, std::vector<PerDrawUniforms> const & perDraw, MultiDrawQueue const & multiDraws)
+{
+	if (!multiDraws.commands.empty())
+	{
+		Pipeline::UpdatePerDrawBatch(multiDraws.perDraw.data(), multiDraws.perDraw.size());
+		for (auto const & batch : multiDraws.batches)
+		{
+			auto const & material = queue[multiDraws.queueIndices[batch.first]].material;
+			if (multiDraws.indirect)
+				Graphics::DrawMeshesIndirect(batch.pool, HiZCulling::commandBuffer(), multiDraws.indirectFirst + batch.first, batch.count, material);
+			else
+				Graphics::DrawMeshes(batch.pool, &multiDraws.commands[batch.first], batch.count, material);
+		}
+	}
 
-	FishEngine::ColorBufferPtr      RenderSystem::m_screenShadowMap;
-	FishEngine::RenderTargetPtr     RenderSystem::m_screenShadowMapRenderTarget;
+	for (auto i : multiDraws.singleDraws)
+	{
+		auto & ro = queue[i];
+		//ro.renderer->PreRender();
+		Pipeline::UpdatePerDrawUniforms(perDraw[i]);
+		for (int subMesh = ro.subMeshID; subMesh < ro.subMeshID + ro.subMeshCount; ++subMesh)
+			Graphics::DrawMesh(ro.mesh, ro.material, subMesh);
+	}
+}
 
-	FishEngine::ColorBufferPtr      RenderSystem::m_mainColorBuffer;
-	FishEngine::RenderTargetPtr     RenderSystem::m_mainRenderTarget;
+namespace FishEngine
+{
+	FishEngine::DepthBufferPtr      RenderSystem::m_mainDepthBuffer;
+	FishEngine::RenderTargetPtr     RenderSystem::s_mainDepthRenderTarget;
+	std::vector<RenderSystem::PostProcess> RenderSystem::s_postProcesses;
 
-	FishEngine::RenderTargetPtr     RenderSystem::m_colorOnlyRenderTarget;
+	RenderSystem::RenderStatistics  RenderSystem::s_statistics;
 
 	//FishEngine::ColorBufferPtr      RenderSystem::m_blurredScreenShadowMap;
 	//FishEngine::RenderTargetPtr     RenderSystem::m_blurScreenShadowMapRenderTarget1;
@@ -71,6 +237,7 @@ namespace FishEngine
 			abort();
 		}
 #endif
+		EnableGLDebugOutput();
 	}
 
 	void RenderSystem::Init()
@@ -82,11 +249,13 @@ namespace FishEngine
 		//Mesh::Init();
 		Gizmos::Init();
 		Scene::Init();
+		ClusteredLighting::Init();
+		MaterialTable::Init();
 		glFrontFace(GL_CW);
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
-		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+		GLStateCache::Enable(GL_DEPTH_TEST);
+		GLStateCache::Enable(GL_CULL_FACE);
+		GLStateCache::Enable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 		//glEnable(GL_LINE_SMOOTH);
 
 		const int w = Screen::width();
@@ -94,46 +263,31 @@ namespace FishEngine
 
 		m_mainDepthBuffer = DepthBuffer::Create(w, h);
 		m_mainDepthBuffer->setName("MainDepthBuffer");
-		for (int i = 0; i < 3; ++i)
-		{
-			m_GBuffer[i] = ColorBuffer::Create(w, h);
-			m_GBuffer[i]->setName("GBuffer-RT" + boost::lexical_cast<std::string>(i));
-		}
-		m_deferredRenderTarget = std::make_shared<RenderTarget>();
-		m_deferredRenderTarget->Set(m_GBuffer[0], m_GBuffer[1], m_GBuffer[2], m_mainDepthBuffer);
-
-		m_screenShadowMap = ColorBuffer::Create(w, h, TextureFormat::R8);
-		m_screenShadowMap->setName("ScreenShadowMap");
-		m_screenShadowMapRenderTarget = std::make_shared<RenderTarget>();
-		m_screenShadowMapRenderTarget->SetColorBufferOnly(m_screenShadowMap);
-
-		m_mainColorBuffer = ColorBuffer::Create(w, h);
-		m_mainColorBuffer->setName("MainColorBuffer");
-		m_mainRenderTarget = std::make_shared<RenderTarget>();
-		m_mainRenderTarget->Set(m_mainColorBuffer, m_mainDepthBuffer);
-
-		m_colorOnlyRenderTarget = std::make_shared<RenderTarget>();
-		m_colorOnlyRenderTarget->SetColorBufferOnly(m_mainColorBuffer);
-
-		//m_blurredScreenShadowMap = ColorBuffer::Create(w, h, TextureFormat::R8);
-		//m_blurredScreenShadowMap->setFilterMode(FilterMode::Bilinear);
-		//m_blurScreenShadowMapRenderTarget1 = std::make_shared<RenderTarget>();
-		//m_blurScreenShadowMapRenderTarget2 = std::make_shared<RenderTarget>();
-		//m_blurScreenShadowMapRenderTarget1->SetColorBufferOnly(m_blurredScreenShadowMap);
-		//m_blurScreenShadowMapRenderTarget2->SetColorBufferOnly(m_screenShadowMap);
+		s_mainDepthRenderTarget = std::make_shared<RenderTarget>();
+		s_mainDepthRenderTarget->SetDepthBufferOnly(m_mainDepthBuffer);
+	}
+
+	void RenderSystem::AddPostProcess(PostProcess const & postProcess)
+	{
+		s_postProcesses.push_back(postProcess);
 	}
 
 	void RenderSystem::Render()
 	{
 		glCheckError();
-		float white[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-		float black[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		RenderGraph::ReleaseUnusedTextures();
 		float error_color[] = { 1.0f, 1.0f, 0.0f, 1.0f };
 		glClearBufferfv(GL_COLOR, 0, error_color);
+		GLStateCache::DepthMask(true);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+		// gizmos of the last frame that nobody flushed (no scene view)
+		Gizmos::Clear();
+
 		auto camera = Camera::main();
 		Pipeline::BindCamera(camera);
+		ClusteredLighting::Build(camera);
+		MaterialTable::Build();
 
 		/************************************************************************/
 		/* Render Queue                                                         */
@@ -148,7 +302,38 @@ namespace FishEngine
 
 		std::deque<SkinnedMeshRendererPtr> skinnedMeshRenderers;	// for animation
 
+		// visible parts of the static batches, drawn in runs of consecutive parts after the traversal
+		std::map<StaticBatch const *, std::vector<int>> visibleStaticBatchParts;
+
 		bool deferred_enabled = false;
+		auto selectQueue = [&](MaterialPtr const & material) -> std::deque<RenderObject> *
+		{
+			// TODO: find correct render queue and submeshID
+			if (material->shader()->IsTransparent())
+				return &forwardRenderQueueTransparent;
+			if (material->shader()->IsDeferred())
+			{
+				// Deferred
+				deferred_enabled = true;
+				return &deferredRenderQueue;
+			}
+			return &forwardRenderQueueGeometry;
+		};
+
+		s_statistics = RenderStatistics();
+
+		// the GPU culls the multi-draws against the depth of the previous frame, the CPU culls the other draws
+		const bool gpuOcclusionCulling = HiZCulling::active();
+		const bool occlusionCulling = OcclusionCulling::enabled();
+		if (occlusionCulling)
+			RasterizeOccluders(camera);
+
+		// drawn from a MeshPool multi-draw of an opaque queue (see BuildMultiDrawQueue), culled by HiZCulling
+		auto culledOnGPU = [gpuOcclusionCulling](MaterialPtr const & material, MeshPtr const & mesh)
+		{
+			auto const & shader = material->shader();
+			return gpuOcclusionCulling && !shader->IsTransparent() && shader->SupportsIndirectDraw() && mesh->pooled();
+		};
 
 		std::deque<GameObjectPtr> todo;
 		for (auto& go : Scene::m_gameObjects)
@@ -171,23 +356,73 @@ namespace FishEngine
 				continue;
 
 			MeshPtr mesh;
+			MeshPtr fadingMesh;		// LOD being cross-faded out
+			float lodFade = 0;
+			std::vector<StaticBatchPart> const * staticBatchParts = nullptr;
+			bool occluded = false;	// by the CPU occluders
 			if (renderer->ClassID() == ClassID<MeshRenderer>())
 			{
 				auto meshFilter = go->GetComponent<MeshFilter>();
 				if (meshFilter == nullptr)
 					continue;
 				mesh = meshFilter->mesh();
+
+				// skinned meshes are not tested, their bounds do not follow the animation
+				occluded = occlusionCulling && !OcclusionCulling::IsVisible(renderer->bounds());
+				if (occluded && !gpuOcclusionCulling)
+				{
+					OcclusionCulling::ReportCulled();
+					continue;
+				}
+
+				auto meshRenderer = As<MeshRenderer>(renderer);
+				if (meshRenderer->isPartOfStaticBatch())
+					staticBatchParts = &meshRenderer->staticBatchParts();
+
+				auto lodGroup = go->GetComponent<LODGroup>();
+				if (mesh != nullptr && lodGroup != nullptr && lodGroup->lodCount() > 0)
+				{
+					s_statistics.trianglesWithoutLOD += mesh->triangleCount();
+					if (!lodGroup->SelectLOD(camera, renderer->bounds()))
+						continue;
+					mesh = lodGroup->currentMesh();
+					fadingMesh = lodGroup->fadingMesh();
+					if (fadingMesh != nullptr)
+					{
+						// lodFade = 0 means no fading, so never start at exactly 0
+						lodFade = Mathf::Max(lodGroup->crossFade(), 1e-3f);
+						s_statistics.triangles += fadingMesh->triangleCount();
+					}
+					if (mesh != nullptr)
+						s_statistics.triangles += mesh->triangleCount();
+				}
+				else if (mesh != nullptr)
+				{
+					s_statistics.triangles += mesh->triangleCount();
+					s_statistics.trianglesWithoutLOD += mesh->triangleCount();
+				}
 			}
 			else
 			{
 				auto r = As<SkinnedMeshRenderer>(renderer);
 				mesh = r->sharedMesh();
 				skinnedMeshRenderers.push_back(r);
+				if (mesh != nullptr)
+				{
+					s_statistics.triangles += mesh->triangleCount();
+					s_statistics.trianglesWithoutLOD += mesh->triangleCount();
+				}
 			}
 
-			if (mesh == nullptr)
+			if (mesh == nullptr && fadingMesh == nullptr)
 				continue;
 
+			// with HiZCulling, a draw hidden by the CPU occluders is still queued when the GPU culls it
+			auto keep = [&](MaterialPtr const & material, MeshPtr const & drawMesh)
+			{
+				return !occluded || culledOnGPU(material, drawMesh);
+			};
+			bool culled = occluded;
 			auto & materials = renderer->materials();
 			for (int i = 0; i < materials.size(); ++i)
 			{
@@ -197,25 +432,53 @@ namespace FishEngine
 					continue;
 				}
 
-				// TODO: find correct render queue and submeshID
-
-				if (material->shader()->IsTransparent())
+				if (staticBatchParts != nullptr && static_cast<std::size_t>(i) < staticBatchParts->size() && (*staticBatchParts)[i].batch != nullptr)
 				{
-					forwardRenderQueueTransparent.emplace_back(0, renderer, material, mesh, i);
+					auto const & part = (*staticBatchParts)[i];
+					if (!keep(part.batch->material, part.batch->mesh))
+						continue;
+					visibleStaticBatchParts[part.batch.get()].push_back(part.subMeshIndex);
+					culled = false;
 					continue;
 				}
-				else if (material->shader()->IsDeferred())
+
+				auto queue = selectQueue(material);
+				if (mesh != nullptr && keep(material, mesh))
+				{
+					queue->emplace_back(0, renderer, material, mesh, i, lodFade);
+					culled = false;
+				}
+				if (fadingMesh != nullptr && keep(material, fadingMesh))
 				{
-					// Deferred
-					deferred_enabled = true;
-					deferredRenderQueue.emplace_back(0, renderer, material, mesh, i);
-					continue;
+					queue->emplace_back(0, renderer, material, fadingMesh, i, -lodFade);
+					culled = false;
 				}
-				else
+			}
+			if (culled)
+				OcclusionCulling::ReportCulled();
+		}
+
+		// one draw per run of consecutive visible parts, with the bounds of the run for HiZCulling
+		for (auto & pair : visibleStaticBatchParts)
+		{
+			auto const & batch = *pair.first;
+			auto & parts = pair.second;
+			std::sort(parts.begin(), parts.end());
+			auto queue = selectQueue(batch.material);
+			for (std::size_t first = 0; first < parts.size(); )
+			{
+				std::size_t last = first + 1;
+				Bounds bounds = batch.partBounds[parts[first]];
+				while (last < parts.size() && parts[last] == parts[last - 1] + 1)
 				{
-					forwardRenderQueueGeometry.emplace_back(0, renderer, material, mesh, i);
+					bounds.Encapsulate(batch.partBounds[parts[last]]);
+					last++;
 				}
-				
+				queue->emplace_back(0, nullptr, batch.material, batch.mesh, parts[first]);
+				queue->back().subMeshCount = static_cast<int>(last - first);
+				queue->back().staticBatchBounds = bounds;
+				s_statistics.staticBatchDraws++;
+				first = last;
 			}
 		}
 
@@ -225,161 +488,221 @@ namespace FishEngine
 		}
 		skinnedMeshRenderers.clear();
 
+		std::vector<PerDrawUniforms> deferredPerDraw;
+		std::vector<PerDrawUniforms> forwardGeometryPerDraw;
+		std::vector<PerDrawUniforms> forwardTransparentPerDraw;
+		BuildPerDrawUniforms(deferredRenderQueue, deferredPerDraw);
+		BuildPerDrawUniforms(forwardRenderQueueGeometry, forwardGeometryPerDraw);
+		BuildPerDrawUniforms(forwardRenderQueueTransparent, forwardTransparentPerDraw);
+
+		// opaque queues: unordered, merge the draws of each material
+		MultiDrawQueue deferredMultiDraws;
+		MultiDrawQueue forwardGeometryMultiDraws;
+		BuildMultiDrawQueue(deferredRenderQueue, deferredPerDraw, deferredMultiDraws);
+		BuildMultiDrawQueue(forwardRenderQueueGeometry, forwardGeometryPerDraw, forwardGeometryMultiDraws);
+		if (gpuOcclusionCulling)
+			CullMultiDrawQueues({ { &deferredRenderQueue, &deferredMultiDraws }, { &forwardRenderQueueGeometry, &forwardGeometryMultiDraws } });
+		const auto meshPoolStatistics = MeshPool::statistics();
+
 
 		/************************************************************************/
-		/* Shadow                                                               */
+		/* Frame Graph                                                          */
 		/************************************************************************/
-		Scene::RenderShadow(Light::mainLight());
-		auto v = Camera::main()->viewport();
+		auto v = camera->viewport();
 		const int w = Screen::width();
 		const int h = Screen::height();
-		glViewport(GLint(v.x*w), GLint(v.y*h), GLsizei(v.z*w), GLsizei(v.w*h));
+		auto setViewport = [v, w, h]() {
+			glViewport(GLint(v.x*w), GLint(v.y*h), GLsizei(v.z*w), GLsizei(v.w*h));
+		};
+		const Color errorColor(1, 1, 0, 1);
+
+		auto light = Light::mainLight();
+		LayeredDepthBufferPtr shadowMap;
+		if (light != nullptr)
+		{
+			shadowMap = light->m_shadowMap;
+		}
+		else
+		{
+			shadowMap = RenderSettings::defaultShadowMap();
+		}
 
+		RenderGraph graph;
+		auto sceneDepth = graph.Import("MainDepthBuffer", m_mainDepthBuffer);
+		auto shadowMapHandle = graph.Import("CascadedShadowMap", shadowMap);
+		RenderGraph::Handle sceneColor = RenderGraph::InvalidHandle;
 
 		/************************************************************************/
-		/* Scene                                                                */
+		/* Shadow                                                               */
 		/************************************************************************/
-
-		// 1 color buffer
-		// depth buffer
-		Pipeline::PushRenderTarget(m_mainRenderTarget);
-		glClearBufferfv(GL_COLOR, 0, error_color);
-		glClearBufferfv(GL_DEPTH, 0, white);
+		graph.AddPass("Shadow", [&](RenderGraph::Builder & builder) {
+			builder.Write(shadowMapHandle);
+		}, [&](RenderGraph::Resources const &) {
+			Scene::RenderShadow(light);
+			setViewport();
+		});
 
 		/************************************************************************/
 		/* Deferred Rendering                                                   */
 		/************************************************************************/
 		if (deferred_enabled)
 		{
-			// 3 color buffer: G-BUffer
-			// depth buffer
-			Pipeline::PushRenderTarget(m_deferredRenderTarget);
-			glClearBufferfv(GL_COLOR, 0, black);
-			glClearBufferfv(GL_COLOR, 1, error_color);
-			glClearBufferfv(GL_COLOR, 2, error_color);
-			glClearBufferfv(GL_DEPTH, 0, white);
+			RenderGraph::Handle gbuffer[3];
+			graph.AddPass("GBuffer", [&](RenderGraph::Builder & builder) {
+				// 3 color buffer: G-BUffer
+				// depth buffer
+				for (int i = 0; i < 3; ++i)
+				{
+					gbuffer[i] = builder.Create("GBuffer-RT" + boost::lexical_cast<std::string>(i), RenderGraph::TextureDesc(w, h, TextureFormat::RGBA32));
+				}
+				builder.WriteColor(gbuffer[0], Color::black);
+				builder.WriteColor(gbuffer[1], errorColor);
+				builder.WriteColor(gbuffer[2], errorColor);
+				builder.WriteDepth(sceneDepth, 1.0f);
+			}, [&](RenderGraph::Resources const &) {
+				DrawMultiDrawQueue(deferredRenderQueue, deferredPerDraw, deferredMultiDraws);
+			});
+
+			graph.AddPass("DeferredLighting", [&](RenderGraph::Builder & builder) {
+				sceneColor = builder.Create("SceneColor", RenderGraph::TextureDesc(w, h, TextureFormat::RGBA32));
+				builder.WriteColor(sceneColor, errorColor);
+				for (auto g : gbuffer)
+					builder.Read(g);
+				builder.Read(sceneDepth);
+			}, [&](RenderGraph::Resources const & resources) {
+				GLStateCache::DepthFunc(GL_ALWAYS);
+				GLStateCache::DepthMask(GL_FALSE);
+				auto quad = Mesh::builtinMesh(PrimitiveType::ScreenAlignedQuad);
+				auto mtl = Material::builtinMaterial("Deferred");
+				mtl->SetTexture("DBufferATexture", resources.GetTexture(gbuffer[0]));
+				mtl->SetTexture("DBufferBTexture", resources.GetTexture(gbuffer[1]));
+				mtl->SetTexture("DBufferCTexture", resources.GetTexture(gbuffer[2]));
+				mtl->SetTexture("SceneDepthTexture", resources.GetTexture(sceneDepth));
+				Graphics::DrawMesh(quad, mtl);
+				GLStateCache::DepthMask(GL_TRUE);
+				GLStateCache::DepthFunc(GL_LESS);
+			});
+		}
 
-			for (auto & ro : deferredRenderQueue)
+		/************************************************************************/
+		/* Forward                                                              */
+		/************************************************************************/
+		graph.AddPass("ForwardOpaque", [&](RenderGraph::Builder & builder) {
+			// 1 color buffer
+			// depth buffer
+			if (sceneColor == RenderGraph::InvalidHandle)
 			{
-				//ro.renderer->PreRender();
-				auto model = ro.renderer->transform()->localToWorldMatrix();
-				Pipeline::UpdatePerDrawUniforms(model);
-				Graphics::DrawMesh(ro.mesh, ro.material, ro.subMeshID);
+				sceneColor = builder.Create("SceneColor", RenderGraph::TextureDesc(w, h, TextureFormat::RGBA32));
+				builder.WriteColor(sceneColor, errorColor);
+				builder.WriteDepth(sceneDepth, 1.0f);
 			}
-
-			Pipeline::PopRenderTarget();
-
-			Pipeline::PushRenderTarget(m_colorOnlyRenderTarget);
-			glDepthFunc(GL_ALWAYS);
-			glDepthMask(GL_FALSE);
-			auto quad = Mesh::builtinMesh(PrimitiveType::ScreenAlignedQuad);
-			auto mtl = Material::builtinMaterial("Deferred");
-			mtl->SetTexture("DBufferATexture", m_GBuffer[0]);
-			mtl->SetTexture("DBufferBTexture", m_GBuffer[1]);
-			mtl->SetTexture("DBufferCTexture", m_GBuffer[2]);
-			mtl->SetTexture("SceneDepthTexture", m_mainDepthBuffer);
-			Graphics::DrawMesh(quad, mtl);
-			glDepthMask(GL_TRUE);
-			glDepthFunc(GL_LESS);
-			Pipeline::PopRenderTarget();
-		}
+			else
+			{
+				builder.WriteColor(sceneColor);
+				builder.WriteDepth(sceneDepth);
+			}
+		}, [&](RenderGraph::Resources const &) {
+			DrawMultiDrawQueue(forwardRenderQueueGeometry, forwardGeometryPerDraw, forwardGeometryMultiDraws);
+		});
 
 		/************************************************************************/
-		/* Forward                                                              */
+		/* Post Process                                                         */
 		/************************************************************************/
-		for (auto & ro : forwardRenderQueueGeometry)
+		for (auto const & postProcess : s_postProcesses)
 		{
-			//ro.renderer->PreRender();
-			auto model = ro.renderer->transform()->localToWorldMatrix();
-			Pipeline::UpdatePerDrawUniforms(model);
-			Graphics::DrawMesh(ro.mesh, ro.material, ro.subMeshID);
+			sceneColor = postProcess(graph, sceneColor, sceneDepth);
 		}
 
-		Pipeline::PopRenderTarget(); // m_mainRenderTarget
-
-#if 1
 		/************************************************************************/
 		/* Screen Space Shadow                                                  */
 		/************************************************************************/
-		// 1 color buffer
-		// no depth buffer
-		Pipeline::PushRenderTarget(m_screenShadowMapRenderTarget);
-		{
-			glDepthFunc(GL_ALWAYS);
-			glDepthMask(GL_FALSE);
-			auto light = Light::mainLight();
-			LayeredDepthBufferPtr shadowMap;
-			if (light != nullptr)
-			{
-				shadowMap = light->m_shadowMap;
-			}
-			else
-			{
-				shadowMap = RenderSettings::defaultShadowMap();
-			}
-			glClearBufferfv(GL_COLOR, 0, white);
+		RenderGraph::Handle screenShadow;
+		graph.AddPass("ScreenSpaceShadow", [&](RenderGraph::Builder & builder) {
+			// 1 color buffer
+			// no depth buffer
+			screenShadow = builder.Create("ScreenShadowMap", RenderGraph::TextureDesc(w, h, TextureFormat::R8));
+			builder.WriteColor(screenShadow, Color::white);
+			builder.Read(shadowMapHandle);
+			builder.Read(sceneDepth);
+		}, [&](RenderGraph::Resources const & resources) {
+			GLStateCache::DepthFunc(GL_ALWAYS);
+			GLStateCache::DepthMask(GL_FALSE);
 			auto quad = Mesh::builtinMesh(PrimitiveType::ScreenAlignedQuad);
 			auto mtl = Material::builtinMaterial("GatherScreenSpaceShadow");
 			mtl->SetTexture("CascadedShadowMap", shadowMap);
 			float shadowMapSize = static_cast<float>( shadowMap->width() );
 			float shadowMapTexelSize = 1.0f / shadowMapSize;
 			mtl->SetVector4("_ShadowMapTexture_TexelSize", Vector4(shadowMapTexelSize, shadowMapTexelSize, shadowMapSize, shadowMapSize));
-			mtl->SetTexture("SceneDepthTexture", m_mainDepthBuffer);
+			mtl->SetTexture("SceneDepthTexture", resources.GetTexture(sceneDepth));
 			Graphics::DrawMesh(quad, mtl);
-			glDepthMask(GL_TRUE);
-			glDepthFunc(GL_LESS);
-		}
-		Pipeline::PopRenderTarget();
-		
-		// add shadow
-		glDepthFunc(GL_ALWAYS);
-		glDepthMask(GL_FALSE);
-		//Pipeline::PushRenderTarget(m_addShadowRenderTarget);
-		//glClearBufferfv(GL_COLOR, 0, black);
-		auto quad = Mesh::builtinMesh(PrimitiveType::ScreenAlignedQuad);
-		auto mtl = Material::builtinMaterial("PostProcessShadow");
-		mtl->setMainTexture(m_mainColorBuffer);
-		mtl->SetTexture("ScreenShadow", m_screenShadowMap);
-		Graphics::DrawMesh(quad, mtl);
-		//Pipeline::PopRenderTarget();
-		glDepthMask(GL_TRUE);
-		glDepthFunc(GL_LESS);
-#else
-		m_mainRenderTarget->AttachForRead();
-		glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-#endif
+			GLStateCache::DepthMask(GL_TRUE);
+			GLStateCache::DepthFunc(GL_LESS);
+		});
 
-		//glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-		//m_mainRenderTarget->Attach();
-		//auto w = m_mainDepthBuffer->width();
-		//auto h = m_mainDepthBuffer->height();
-		m_mainRenderTarget->AttachForRead();
-		glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-		//m_mainRenderTarget->Detach();
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		/************************************************************************/
+		/* Composite: scene color * shadow, into the current framebuffer       */
+		/************************************************************************/
+		graph.AddPass("Composite", [&](RenderGraph::Builder & builder) {
+			builder.Read(sceneColor);
+			builder.Read(screenShadow);
+			builder.Read(sceneDepth);
+			builder.SideEffect();
+		}, [&](RenderGraph::Resources const & resources) {
+			// add shadow
+			GLStateCache::DepthFunc(GL_ALWAYS);
+			GLStateCache::DepthMask(GL_FALSE);
+			auto quad = Mesh::builtinMesh(PrimitiveType::ScreenAlignedQuad);
+			auto mtl = Material::builtinMaterial("PostProcessShadow");
+			mtl->setMainTexture(resources.GetTexture(sceneColor));
+			mtl->SetTexture("ScreenShadow", resources.GetTexture(screenShadow));
+			Graphics::DrawMesh(quad, mtl);
+			GLStateCache::DepthMask(GL_TRUE);
+			GLStateCache::DepthFunc(GL_LESS);
+
+			s_mainDepthRenderTarget->AttachForRead();
+			glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		});
 
 		/************************************************************************/
 		/* Skybox                                                               */
 		/************************************************************************/
-		Matrix4x4 model;
-		model.SetTRS(Camera::main()->transform()->position(), Quaternion::identity, Vector3::one * 2000);
-		//Matrix4x4 model = Matrix4x4::Scale(1000);
-		Graphics::DrawMesh(Mesh::builtinMesh(PrimitiveType::Sphere), model, RenderSettings::skybox());
-
+		graph.AddPass("Skybox", [&](RenderGraph::Builder & builder) {
+			builder.SideEffect();
+		}, [&](RenderGraph::Resources const &) {
+			Matrix4x4 model;
+			model.SetTRS(camera->transform()->position(), Quaternion::identity, Vector3::one * 2000);
+			//Matrix4x4 model = Matrix4x4::Scale(1000);
+			Graphics::DrawMesh(Mesh::builtinMesh(PrimitiveType::Sphere), model, RenderSettings::skybox());
+		});
 
 		/************************************************************************/
 		/* Transparent                                                          */
 		/************************************************************************/
-		for (auto & ro : forwardRenderQueueTransparent)
-		{
-			//ro.renderer->PreRender();
-			auto model = ro.renderer->transform()->localToWorldMatrix();
-			Pipeline::UpdatePerDrawUniforms(model);
-			Graphics::DrawMesh(ro.mesh, ro.material, ro.subMeshID);
-		}
+		graph.AddPass("Transparent", [&](RenderGraph::Builder & builder) {
+			builder.SideEffect();
+		}, [&](RenderGraph::Resources const &) {
+			for (std::size_t i = 0; i < forwardRenderQueueTransparent.size(); ++i)
+			{
+				auto & ro = forwardRenderQueueTransparent[i];
+				//ro.renderer->PreRender();
+				Pipeline::UpdatePerDrawUniforms(forwardTransparentPerDraw[i]);
+				Graphics::DrawMesh(ro.mesh, ro.material, ro.subMeshID);
+			}
+		});
+
+		graph.Compile();
+		graph.Execute();
+		HiZCulling::BuildHiZ(m_mainDepthBuffer, camera->projectionMatrix() * camera->worldToCameraMatrix());
+		s_statistics.multiDraws = MeshPool::statistics().multiDraws - meshPoolStatistics.multiDraws;
+		s_statistics.multiDrawCommands = MeshPool::statistics().multiDrawCommands - meshPoolStatistics.multiDrawCommands;
+		s_statistics.renderTargetBytes = RenderGraph::PoolByteCount() + RenderGraph::TextureDesc::Depth(w, h).ByteCount();
+
+		if (occlusionCulling && OcclusionCulling::showDepthOverlay())
+			OcclusionCulling::DrawDepthOverlay();
 
 #if 0
-		glDepthFunc(GL_ALWAYS);
+		GLStateCache::DepthFunc(GL_ALWAYS);
 		auto display_csm_mtl = Material::builtinMaterial("DisplayCSM");
 		constexpr float size = 0.25f;
 		auto quad = Mesh::builtinMesh(PrimitiveType::ScreenAlignedQuad);
@@ -391,7 +714,7 @@ namespace FishEngine
 			display_csm_mtl->setMainTexture(Light::mainLight()->m_shadowMap);
 			Graphics::DrawMesh(quad, display_csm_mtl);
 		}
-		glDepthFunc(GL_LESS);
+		GLStateCache::DepthFunc(GL_LESS);
 #endif
 
 		//if (m_isWireFrameMode)
@@ -416,12 +739,8 @@ namespace FishEngine
 
 	void RenderSystem::ResizeBufferSize(const int width, const int height)
 	{
+		// transient render targets follow Screen::width/height, the frame graph pool drops the old sizes by itself
 		m_mainDepthBuffer->Resize(width, height);
-		m_mainColorBuffer->Resize(width, height);
-		for (auto& gb : m_GBuffer)
-			gb->Resize(width, height);
-		m_screenShadowMap->Resize(width, height);
-		//m_blurredScreenShadowMap->Resize(width, height);
 	}
 
 } // namespace FishEngine
@@ -2,6 +2,10 @@
 #define RenderSystem_hpp
 
 #include "RenderTexture.hpp"
+#include "RenderGraph.hpp"
+
+#include <functional>
+#include <vector>
 
 namespace FishEngine
 {
@@ -20,21 +24,34 @@ namespace FishEngine
 
 		static void ResizeBufferSize(const int width, const int height);
 
-		static ColorBufferPtr   m_GBuffer[3];
-		static DepthBufferPtr   m_mainDepthBuffer;
-		static RenderTargetPtr  m_deferredRenderTarget;
+		// A post effect: reads sceneColor (and sceneDepth) in its own passes and returns the new scene color.
+		// Called while the frame graph of Render is built, after the opaque geometry and before the final composite.
+		typedef std::function<RenderGraph::Handle(RenderGraph & graph, RenderGraph::Handle sceneColor, RenderGraph::Handle sceneDepth)> PostProcess;
 
-		static ColorBufferPtr   m_screenShadowMap;
-		static RenderTargetPtr  m_screenShadowMapRenderTarget;
+		static void AddPostProcess(PostProcess const & postProcess);
 
-		static ColorBufferPtr   m_mainColorBuffer;
-		static RenderTargetPtr  m_mainRenderTarget;
+		struct RenderStatistics
+		{
+			uint32_t	triangles = 0;				// triangles submitted by the last Render()
+			uint32_t	trianglesWithoutLOD = 0;	// triangles the last Render() would have submitted without LODGroup
+			std::size_t	renderTargetBytes = 0;		// main depth buffer + transient render targets of the frame graph
+			uint32_t	multiDraws = 0;				// MeshPool::MultiDraw calls of the last Render(), shadows included
+			uint32_t	multiDrawCommands = 0;		// draws merged into them
+			uint32_t	staticBatchDraws = 0;		// runs of visible StaticBatchingUtility parts drawn by the last Render()
+		};
 
-		static RenderTargetPtr  m_colorOnlyRenderTarget;
+		static RenderStatistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+		// persistent, read by the editor after Render() (e.g. selection outline)
+		static DepthBufferPtr   m_mainDepthBuffer;
 
-		//static ColorBufferPtr   m_blurredScreenShadowMap;
-		//static RenderTargetPtr  m_blurScreenShadowMapRenderTarget1;
-		//static RenderTargetPtr  m_blurScreenShadowMapRenderTarget2;
+	private:
+		static RenderTargetPtr  s_mainDepthRenderTarget;	// depth only, to blit m_mainDepthBuffer
+		static std::vector<PostProcess> s_postProcesses;
+		static RenderStatistics s_statistics;
 	};
 }
 
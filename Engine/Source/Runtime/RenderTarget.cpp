@@ -1,5 +1,6 @@
 #include "RenderTarget.hpp"
 #include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
 #include "Texture.hpp"
 #include "Debug.hpp"
 #include "RenderBuffer.hpp"
@@ -7,6 +8,14 @@
 
 namespace FishEngine
 {
+	RenderTarget::~RenderTarget()
+	{
+		if (m_fbo != 0)
+		{
+			GLStateCache::OnDeleteFramebuffer(m_fbo);
+			glDeleteFramebuffers(1, &m_fbo);
+		}
+	}
 
 	void RenderTarget::SetColorBufferOnly(ColorBufferPtr colorBuffer)
 	{
@@ -20,6 +29,15 @@ namespace FishEngine
 	{
 		m_activeColorBufferCount = 0;
 		m_depthBuffer = depthBuffer;
+		m_depthLayer = -1;
+		Init();
+	}
+
+	void RenderTarget::SetDepthBufferLayer(DepthBufferPtr depthBuffer, int layer)
+	{
+		m_activeColorBufferCount = 0;
+		m_depthBuffer = depthBuffer;
+		m_depthLayer = layer;
 		Init();
 	}
 
@@ -45,31 +63,37 @@ namespace FishEngine
 
 	void RenderTarget::Attach()
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_fbo);
 	}
 
 	void RenderTarget::AttachForRead()
 	{
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+		GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
 	}
 
 	void RenderTarget::Detach()
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
 	void RenderTarget::Init()
 	{
+		if (m_fbo != 0)
+		{
+			GLStateCache::OnDeleteFramebuffer(m_fbo);
+			glDeleteFramebuffers(1, &m_fbo);
+		}
 		glGenFramebuffers(1, &m_fbo);
 		assert(m_fbo > 0);
-		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_fbo);
 
 		if (m_useDepthBuffer)
 		{
-			if (m_depthBuffer->m_useStencil)
-				glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, m_depthBuffer->GetNativeTexturePtr(), 0);
+			auto attachment = m_depthBuffer->m_useStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+			if (m_depthLayer >= 0)
+				glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, m_depthBuffer->GetNativeTexturePtr(), 0, m_depthLayer);
 			else
-				glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthBuffer->GetNativeTexturePtr(), 0);
+				glFramebufferTexture(GL_FRAMEBUFFER, attachment, m_depthBuffer->GetNativeTexturePtr(), 0);
 		}
 
 		if (m_activeColorBufferCount > 0)
@@ -108,7 +132,7 @@ namespace FishEngine
 #undef TEMP_CASE
 		}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
 
 		glCheckError();
 	}
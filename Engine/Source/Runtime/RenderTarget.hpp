@@ -10,9 +10,14 @@ namespace FishEngine
 	{
 	public:
 		RenderTarget() = default;
+		RenderTarget(RenderTarget const &) = delete;
+		RenderTarget & operator=(RenderTarget const &) = delete;
+		~RenderTarget();
 
 		void SetColorBufferOnly(ColorBufferPtr colorBuffer);
 		void SetDepthBufferOnly(DepthBufferPtr depthBuffer);
+		// one layer of a LayeredDepthBuffer, depth only
+		void SetDepthBufferLayer(DepthBufferPtr depthBuffer, int layer);
 		void Set(ColorBufferPtr colorBuffer, DepthBufferPtr depthBuffer);
 		void Set(ColorBufferPtr colorBuffer1, ColorBufferPtr colorBuffer2, ColorBufferPtr colorBuffer3, DepthBufferPtr depthBuffer);
 
@@ -30,6 +35,7 @@ namespace FishEngine
 		uint32_t        m_activeColorBufferCount = 1;
 		ColorBufferPtr  m_colorBuffers[3];
 		DepthBufferPtr  m_depthBuffer;
+		int             m_depthLayer = -1;	// -1: all layers
 		unsigned int    m_fbo = 0;
 
 		void Init();
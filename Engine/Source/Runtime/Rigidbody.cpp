@@ -5,6 +5,7 @@
 #include "Transform.hpp"
 #include "PhysicsSystem.hpp"
 #include "Collider.hpp"
+#include "GameLoop.hpp"
 
 using namespace FishEngine;
 using namespace physx;
@@ -43,6 +44,9 @@ void FishEngine::Rigidbody::Start()
 	const Vector3 p = t->position();
 	const auto& q = t->rotation();
 	m_physxRigidDynamic->setGlobalPose(PxTransform(p.x, p.y, p.z, PxQuat(q.x, q.y, q.z, q.w)));
+	m_physxRigidDynamic->userData = this;
+	m_previousPosition = m_position = p;
+	m_previousRotation = m_rotation = q;
 	PxRigidBodyExt::updateMassAndInertia(*m_physxRigidDynamic, 10.0f);
 	m_physxRigidDynamic->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, !m_useGravity);
 	gScene->addActor(*m_physxRigidDynamic);
@@ -50,15 +54,26 @@ void FishEngine::Rigidbody::Start()
 
 void FishEngine::Rigidbody::Update()
 {
-	//m_physxRigidDynamic->user
+	if (!IsInitialized())
+		return;
+	const float t = GameLoop::interpolation() ? GameLoop::interpolationFactor() : 1.0f;
+	transform()->setPosition(Vector3::Lerp(m_previousPosition, m_position, t));
+	transform()->setLocalRotation(Quaternion::Slerp(m_previousRotation, m_rotation, t));
+}
+
+void Rigidbody::OnPhysicsStep()
+{
 	const auto& t = m_physxRigidDynamic->getGlobalPose();
-	//const auto& pt = t.actor2World;
-	transform()->setPosition(t.p.x, t.p.y, t.p.z);
-	transform()->setLocalRotation(Quaternion(t.q.x, t.q.y, t.q.z, t.q.w));
+	m_previousPosition = m_position;
+	m_previousRotation = m_rotation;
+	m_position.Set(t.p.x, t.p.y, t.p.z);
+	m_rotation = Quaternion(t.q.x, t.q.y, t.q.z, t.q.w);
 }
 
 void Rigidbody::OnDestroy()
 {
+	if (m_physxRigidDynamic != nullptr)
+		m_physxRigidDynamic->userData = nullptr;
 	m_physxRigidDynamic = nullptr;
 }
 
@@ -4,6 +4,7 @@
 #include "FishEngine.hpp"
 #include "Component.hpp"
 #include "Vector3.hpp"
+#include "Quaternion.hpp"
 #include "ReflectClass.hpp"
 
 namespace physx
@@ -21,6 +22,8 @@ namespace FishEngine
 		Rigidbody() = default;
 		
 		virtual void Start() override;
+
+		// Move the transform between the poses of the last two physics steps, see GameLoop::interpolationFactor.
 		virtual void Update() override;
 		virtual void OnDestroy() override;
 	  
@@ -38,8 +41,12 @@ namespace FishEngine
 		
 		bool IsInitialized() const;
 		void Initialize(physx::PxShape* shape);
+
+		// called by PhysicsSystem::FetchResults
+		void OnPhysicsStep();
 		
 		friend class FishEditor::Inspector;
+		friend class PhysicsSystem;
 		float m_mass = 2;
 		float m_drag = 0;
 		float m_angularDrag = 0.05f;
@@ -50,6 +57,16 @@ namespace FishEngine
 		
 		Meta(NonSerializable)
 		physx::PxRigidDynamic* m_physxRigidDynamic = nullptr;
+
+		// world space poses after the last two physics steps
+		Meta(NonSerializable)
+		Vector3 m_previousPosition;
+		Meta(NonSerializable)
+		Quaternion m_previousRotation;
+		Meta(NonSerializable)
+		Vector3 m_position;
+		Meta(NonSerializable)
+		Quaternion m_rotation;
 	};
 }
 
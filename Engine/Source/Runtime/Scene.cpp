@@ -1,4 +1,8 @@
 #include "Scene.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
 #include "GameObject.hpp"
 #include "Camera.hpp"
 #include "RenderSystem.hpp"
@@ -7,6 +11,7 @@
 #include "Light.hpp"
 #include "Mesh.hpp"
 #include "MeshFilter.hpp"
+#include "LODGroup.hpp"
 #include "Pipeline.hpp"
 #include "SkinnedMeshRenderer.hpp"
 #include "Frustum.hpp"
@@ -20,6 +25,155 @@
 
 #include "GLEnvironment.hpp"
 #include "Graphics.hpp"
+#include "GLStateCache.hpp"
+#include "RenderTarget.hpp"
+#include "StaticBatchingUtility.hpp"
+#include "ComponentPool.hpp"
+#include "ObjectAllocator.hpp"
+#include "ObjectPool.hpp"
+#include "TagManager.hpp"
+#include "Debug.hpp"
+
+namespace
+{
+	using namespace FishEngine;
+
+	constexpr uint32_t AllCascades = 0xF;
+
+	// The cascades (bit i: cascade i) whose light volume intersects bounds.
+	// Casters between the light and a cascade still cast into it: with GL_DEPTH_CLAMP the volume extends toward the
+	// light, only the far plane culls.
+	uint32_t CascadeMask(Bounds const & bounds, Matrix4x4 const (&lightMatrices)[4])
+	{
+		auto center = bounds.center();
+		auto extents = bounds.extents();
+		if (extents.x < 0)	// invalid bounds
+			return AllCascades;
+
+		uint32_t mask = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			Vector3 minP(Mathf::Infinity, Mathf::Infinity, Mathf::Infinity);
+			Vector3 maxP = -minP;
+			for (int c = 0; c < 8; ++c)
+			{
+				Vector3 corner(
+					c & 1 ? center.x + extents.x : center.x - extents.x,
+					c & 2 ? center.y + extents.y : center.y - extents.y,
+					c & 4 ? center.z + extents.z : center.z - extents.z);
+				auto p = lightMatrices[i].MultiplyPoint(corner);
+				minP = Vector3::Min(minP, p);
+				maxP = Vector3::Max(maxP, p);
+			}
+			if (maxP.x < -1 || minP.x > 1 || maxP.y < -1 || minP.y > 1 || minP.z > 1)
+				continue;
+			mask |= 1u << i;
+		}
+		return mask;
+	}
+
+	inline void HashCombine(std::size_t & seed, std::size_t value)
+	{
+		seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+
+	inline void HashBytes(std::size_t & seed, void const * data, std::size_t size)
+	{
+		auto bytes = static_cast<unsigned char const *>(data);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			HashCombine(seed, bytes[i]);
+		}
+	}
+
+	// The shadow casters of a frame, each with the cascades it is drawn into.
+	class ShadowCasterList
+	{
+	public:
+		void Add(MeshPtr const & mesh, Matrix4x4 const & modelMatrix, uint32_t cascadeMask, bool multiDraw)
+		{
+			if (multiDraw && mesh->pooled() && m_draws.size() < MeshPool::MaxDrawIDs)
+			{
+				m_draws.push_back({ mesh.get(), -1, 1, nullptr });
+				m_drawModelMatrices.push_back(modelMatrix);
+				m_drawCascadeMasks.push_back(cascadeMask);
+			}
+			else
+			{
+				m_meshes.push_back(mesh);
+				m_modelMatrices.push_back(modelMatrix);
+				m_cascadeMasks.push_back(cascadeMask);
+			}
+		}
+
+		bool empty() const
+		{
+			return m_draws.empty() && m_meshes.empty();
+		}
+
+		// Build the MultiDraws and upload their model matrices, once for all the cascades.
+		void Prepare()
+		{
+			if (m_draws.empty())
+				return;
+			std::vector<uint32_t> order;
+			MeshPool::BuildMultiDraws(m_draws, m_batches, m_commands, order);
+			std::vector<Matrix4x4> modelMatrices(order.size());
+			m_commandCascadeMasks.resize(order.size());
+			for (std::size_t i = 0; i < order.size(); ++i)
+			{
+				modelMatrices[i] = m_drawModelMatrices[order[i]];
+				m_commandCascadeMasks[i] = m_drawCascadeMasks[order[i]];
+			}
+			Pipeline::UpdatePerDrawBatch(modelMatrices.data(), modelMatrices.size());
+		}
+
+		// Draw the casters of cascade into the bound render target (one layer of the shadow map).
+		void Draw(int cascade, MaterialPtr const & material)
+		{
+			const uint32_t bit = 1u << cascade;
+			material->SetFloat("CascadeIndex", static_cast<float>(cascade));
+
+			PerDrawUniforms perDraw;
+			for (std::size_t i = 0; i < m_meshes.size(); ++i)
+			{
+				if ((m_cascadeMasks[i] & bit) == 0)
+					continue;
+				perDraw.MATRIX_M = m_modelMatrices[i];
+				Pipeline::UpdatePerDrawUniforms(perDraw, Pipeline::PerDrawFields::ModelMatrix);
+				Graphics::DrawMesh(m_meshes[i], material);
+			}
+
+			// the commands keep their draw ID, so the per-draw data uploaded by Prepare serves every cascade
+			for (auto const & batch : m_batches)
+			{
+				m_cascadeCommands.clear();
+				for (std::size_t i = batch.first; i < batch.first + batch.count; ++i)
+				{
+					if (m_commandCascadeMasks[i] & bit)
+						m_cascadeCommands.push_back(m_commands[i]);
+				}
+				if (!m_cascadeCommands.empty())
+					Graphics::DrawMeshes(batch.pool, m_cascadeCommands.data(), m_cascadeCommands.size(), material);
+			}
+		}
+
+	private:
+		// drawn one by one
+		std::vector<MeshPtr>					m_meshes;
+		std::vector<Matrix4x4>					m_modelMatrices;
+		std::vector<uint32_t>					m_cascadeMasks;
+
+		// pooled, drawn with MultiDraws
+		std::vector<MeshPool::Draw>				m_draws;
+		std::vector<Matrix4x4>					m_drawModelMatrices;
+		std::vector<uint32_t>					m_drawCascadeMasks;
+		std::vector<MeshPool::Batch>			m_batches;
+		std::vector<MeshPool::DrawCommand>		m_commands;
+		std::vector<uint32_t>					m_commandCascadeMasks;
+		std::vector<MeshPool::DrawCommand>		m_cascadeCommands;
+	};
+}
 
 namespace FishEngine
 {
@@ -27,6 +181,12 @@ namespace FishEngine
 	std::vector<GameObjectPtr>    Scene::m_gameObjectsToBeDestroyed;
 	std::vector<ComponentPtr>     Scene::m_componentsToBeDestroyed;
 	Bounds                      Scene::m_bounds;
+	std::vector<std::pair<int, SceneChangeListener>>	Scene::s_changeListeners;
+	std::vector<SceneChange>	Scene::s_changes;
+	std::map<int, std::size_t>	Scene::s_changeIndices;
+	std::unordered_map<std::string, std::vector<GameObjectPtr>>	Scene::s_nameIndex;
+	std::unordered_map<int, std::vector<GameObjectPtr>>			Scene::s_tagIndex;
+	std::array<std::vector<GameObjectPtr>, 32>					Scene::s_layerIndex;
 	//SceneOctree                 Scene::m_octree(Bounds(), 16);
 
 	GameObjectPtr Scene::CreateGameObject(const std::string& name)
@@ -35,10 +195,143 @@ namespace FishEngine
 		auto go = GameObject::Create();
 		go->setName(name);
 		go->transform()->m_gameObject = go;
-		m_gameObjects.push_back(go);
+		Link(go);
+		NotifyChange(go, SceneChange::Created);
 		return go;
 	}
 
+	void Scene::AddGameObject(GameObjectPtr const & go)
+	{
+		Link(go);
+		NotifyChange(go, SceneChange::Created);
+	}
+
+	void Scene::Link(GameObjectPtr const & go)
+	{
+		if (go->m_isInScene)
+			return;
+		go->m_sceneIterator = m_gameObjects.insert(m_gameObjects.end(), go);
+		go->m_isInScene = true;
+		AddToIndices(go);
+	}
+
+	void Scene::Unlink(GameObject & go)
+	{
+		if (!go.m_isInScene)
+			return;
+		RemoveFromIndices(go);
+		go.m_isInScene = false;
+		m_gameObjects.erase(go.m_sceneIterator);	// may release the last strong ref of go
+	}
+
+	enum IndexPosition
+	{
+		NamePosition = 0,
+		TagPosition,
+		LayerPosition,
+	};
+
+	void Scene::AddToIndices(GameObjectPtr const & go)
+	{
+		auto add = [&go](std::vector<GameObjectPtr> & bucket, int which)
+		{
+			go->m_indexPositions[which] = static_cast<int>(bucket.size());
+			bucket.push_back(go);
+		};
+		go->m_indexedName = go->m_name;
+		go->m_indexedTag = go->m_tagIndex;
+		go->m_indexedLayer = go->m_layer;
+		add(s_nameIndex[go->m_indexedName], NamePosition);
+		add(s_tagIndex[go->m_indexedTag], TagPosition);
+		if (go->m_indexedLayer >= 0 && go->m_indexedLayer < 32)
+			add(s_layerIndex[go->m_indexedLayer], LayerPosition);
+	}
+
+	void Scene::RemoveFromIndices(GameObject & go)
+	{
+		// swap with the last one
+		auto remove = [&go](std::vector<GameObjectPtr> & bucket, int which)
+		{
+			const int position = go.m_indexPositions[which];
+			auto & last = bucket.back();
+			last->m_indexPositions[which] = position;
+			bucket[position] = std::move(last);
+			bucket.pop_back();
+		};
+		auto name = s_nameIndex.find(go.m_indexedName);
+		remove(name->second, NamePosition);
+		if (name->second.empty())
+			s_nameIndex.erase(name);
+		remove(s_tagIndex[go.m_indexedTag], TagPosition);
+		if (go.m_indexedLayer >= 0 && go.m_indexedLayer < 32)
+			remove(s_layerIndex[go.m_indexedLayer], LayerPosition);
+	}
+
+	void Scene::UpdateIndices(GameObject & go)
+	{
+		if (!go.m_isInScene)
+			return;
+		if (go.m_indexedName == go.m_name && go.m_indexedTag == go.m_tagIndex && go.m_indexedLayer == go.m_layer)
+			return;
+		auto strongRef = *go.m_sceneIterator;
+		RemoveFromIndices(go);
+		AddToIndices(strongRef);
+	}
+
+	int Scene::AddChangeListener(SceneChangeListener listener)
+	{
+		static int nextID = 0;
+		s_changeListeners.emplace_back(++nextID, std::move(listener));
+		return nextID;
+	}
+
+	void Scene::RemoveChangeListener(int id)
+	{
+		s_changeListeners.erase(std::remove_if(s_changeListeners.begin(), s_changeListeners.end(), [id](std::pair<int, SceneChangeListener> const & l) {
+			return l.first == id;
+		}), s_changeListeners.end());
+		if (s_changeListeners.empty())
+		{
+			s_changes.clear();
+			s_changeIndices.clear();
+		}
+	}
+
+	void Scene::NotifyChange(GameObjectPtr const & gameObject, int flags)
+	{
+		if (s_changeListeners.empty() || gameObject == nullptr)
+			return;
+		const int id = gameObject->GetInstanceID();
+		auto it = s_changeIndices.find(id);
+		if (it == s_changeIndices.end())
+		{
+			s_changeIndices.emplace(id, s_changes.size());
+			s_changes.push_back(SceneChange{ id, gameObject, flags });
+		}
+		else
+		{
+			auto & change = s_changes[it->second];
+			// destroyed then created again (SceneSnapshot::Restore): still there
+			if (flags & SceneChange::Created)
+				change.flags &= ~SceneChange::Destroyed;
+			change.flags |= flags;
+		}
+	}
+
+	void Scene::DispatchChanges()
+	{
+		if (s_changes.empty())
+			return;
+		// listeners may change the scene, those changes go to the next dispatch
+		std::vector<SceneChange> changes;
+		changes.swap(s_changes);
+		s_changeIndices.clear();
+		for (auto const & l : s_changeListeners)
+		{
+			l.second(changes);
+		}
+	}
+
 	GameObjectPtr Scene::CreateCamera()
 	{
 		auto camera_go = Scene::CreateGameObject("Camera");
@@ -57,30 +350,42 @@ namespace FishEngine
 
 	}
 
+	void Scene::Clean()
+	{
+		m_componentsToBeDestroyed.clear();
+		m_gameObjectsToBeDestroyed.clear();
+		DestroyImmediate(std::vector<GameObjectPtr>(m_gameObjects.begin(), m_gameObjects.end()));
+
+		// the arena of the scene, only the chunks still referenced (by an asset, the editor...) stay
+		const auto released = ObjectAllocator::ReleaseUnusedChunks();
+		LogInfo(Format("Scene::Clean: %1% KB released, %2% objects still alive", released / 1024, ObjectAllocator::statistics().liveCount));
+	}
+
 	void Scene::Start()
 	{
 		for (auto& go : m_gameObjects) {
 			if (go->activeInHierarchy())
 				go->Start();
 		}
+		if (StaticBatchingUtility::enabled())
+			StaticBatchingUtility::CombineScene();
 		UpdateBounds();
 	}
 
 	void Scene::Update()
 	{
-		// Destroy components
-		for (auto & c : m_componentsToBeDestroyed)
+		// Destroy components, OnDestroy may Destroy others: they go to the next frame
+		std::vector<ComponentPtr> componentsToBeDestroyed;
+		componentsToBeDestroyed.swap(m_componentsToBeDestroyed);
+		for (auto & c : componentsToBeDestroyed)
 		{
-			c->gameObject()->RemoveComponent(c);
+			DestroyImmediate(c);
 		}
-		m_componentsToBeDestroyed.clear();
 
-		// Destroy game objects
-		for (auto& g : m_gameObjectsToBeDestroyed)
-		{
-			DestroyImmediate(g);
-		}
-		m_gameObjectsToBeDestroyed.clear(); // release (the last) strong refs, game objects should be destroyed automatically.
+		// Destroy game objects, OnDestroy may Destroy others: they go to the next frame
+		std::vector<GameObjectPtr> gameObjectsToBeDestroyed;
+		gameObjectsToBeDestroyed.swap(m_gameObjectsToBeDestroyed);
+		DestroyImmediate(gameObjectsToBeDestroyed);
 
 		for (auto& go : m_gameObjects)
 		{
@@ -91,6 +396,16 @@ namespace FishEngine
 		//UpdateBounds();
 	}
 
+	void Scene::FixedUpdate()
+	{
+		// only scripts have a FixedUpdate (rigidbodies are stepped by PhysicsSystem), Start is called by the first Update
+		ComponentPool::ForEach<Script>([](Script* s)
+		{
+			if (s->m_isStartFunctionCalled && s->gameObject()->activeInHierarchy())
+				s->FixedUpdate();
+		});
+	}
+
 	void Scene::RenderShadow(LightPtr const & light)
 	{
 		if (light == nullptr)
@@ -251,19 +566,21 @@ namespace FishEngine
 		Pipeline::BindLight(light);
 
 		auto shadowMap = light->m_shadowMap;
-		Pipeline::PushRenderTarget(light->m_renderTarget);
-
-		glViewport(0, 0, shadowMap->width(), shadowMap->height());
-		glClear(GL_DEPTH_BUFFER_BIT);
-
-		glEnable(GL_DEPTH_CLAMP);
 
-		//auto shader = shadow_map_material->shader();
-		//shader->Use();
-		//shader->BindUniformMat4("TestMat", Matrix4x4::identity);
+		Matrix4x4 lightMatrices[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			lightMatrices[i] = light->m_projectMatrixForShadowMap[i] * light->m_viewMatrixForShadowMap[i];
+		}
 
 #if 1
 		auto gameObjects = m_gameObjects;
+
+		// casters with a pooled mesh are drawn with one MultiDraw per MeshPool and cascade
+		const bool multiDraw = shadow_map_material->shader()->SupportsIndirectDraw();
+		ShadowCasterList staticCasters;
+		ShadowCasterList dynamicCasters;
+		std::size_t staticCastersKey = 0;
 		
 		while (!gameObjects.empty())
 		{
@@ -283,7 +600,8 @@ namespace FishEngine
 				continue;
 
 			MeshPtr mesh;
-			if (renderer->ClassID() == ClassID<SkinnedMeshRenderer>())
+			const bool skinned = renderer->ClassID() == ClassID<SkinnedMeshRenderer>();
+			if (skinned)
 			{
 				mesh = As<SkinnedMeshRenderer>(renderer)->sharedMesh();
 			}
@@ -292,56 +610,104 @@ namespace FishEngine
 				auto meshFilter = go->GetComponent<MeshFilter>();
 				if (meshFilter != nullptr)
 					mesh = meshFilter->mesh();
+
+				// LOD selected by RenderSystem::Render for the main camera
+				auto lodGroup = go->GetComponent<LODGroup>();
+				if (mesh != nullptr && lodGroup != nullptr && lodGroup->lodCount() > 0)
+				{
+					mesh = lodGroup->currentMesh();
+					if (mesh == nullptr)
+						mesh = lodGroup->fadingMesh();
+				}
 			}
 
 			if (mesh == nullptr)
 				continue;
 
+			// the bounds of a skinned mesh do not follow the animation
+			uint32_t cascadeMask = skinned ? AllCascades : CascadeMask(renderer->bounds(), lightMatrices);
+			if (cascadeMask == 0)
+				continue;
+
 			//renderer->PreRender();
-			auto model = renderer->transform()->localToWorldMatrix();
-			Pipeline::UpdatePerDrawUniforms(model);
-			Graphics::DrawMesh(mesh, shadow_map_material);
-
-			//auto mesh_renderer = go->GetComponent<MeshRenderer>();
-			//if (mesh_renderer != nullptr)
-			//{
-			//	if (mesh_renderer->shadowCastingMode() != ShadowCastingMode::Off)
-			//	{
-			//		auto meshFilter = go->GetComponent<MeshFilter>();
-			//		if (meshFilter != nullptr)
-			//		{
-			//			mesh = meshFilter->mesh();
-			//		}
-			//	}
-			//}
-			//else
-			//{
-			//	auto renderer = go->GetComponent<SkinnedMeshRenderer>();
-			//	if (renderer != nullptr && renderer->shadowCastingMode() != ShadowCastingMode::Off)
-			//	{
-			//		mesh = renderer->sharedMesh();
-			//		if (renderer->m_avatar != nullptr)
-			//		{
-			//			shadow_map_material->EnableKeyword(ShaderKeyword::SkinnedAnimation);
-			//			is_skinned = true;
-			//			Pipeline::UpdateBonesUniforms(renderer->matrixPalette());
-			//		}
-			//	}
-			//}
-			//
-			//if (!is_skinned)
-			//{
-			//	shadow_map_material->DisableKeyword(ShaderKeyword::SkinnedAnimation);
-			//}
-
-			//if (mesh != nullptr)
-			//{
-			//	Pipeline::UpdatePerDrawUniforms(go->transform()->localToWorldMatrix());
-			//	//shader->BindUniformMat4("ObjectToWorld", go->transform()->localToWorldMatrix());
-			//	shader->CheckStatus();
-			//	mesh->Render();
-			//}
+			// the shadow caster shader only reads MATRIX_M
+			auto const & modelMatrix = renderer->transform()->localToWorldMatrix();
+			mesh->UploadMeshData();
+			if (go->isStatic() && !skinned)
+			{
+				HashCombine(staticCastersKey, reinterpret_cast<std::size_t>(mesh.get()));
+				HashBytes(staticCastersKey, &modelMatrix, sizeof(modelMatrix));
+				staticCasters.Add(mesh, modelMatrix, cascadeMask, multiDraw);
+			}
+			else
+			{
+				dynamicCasters.Add(mesh, modelMatrix, cascadeMask, multiDraw);
+			}
 		}
+
+		GLStateCache::Enable(GL_DEPTH_CLAMP);
+		glViewport(0, 0, shadowMap->width(), shadowMap->height());
+
+		// 1. redraw the cascades of the static shadow map whose casters or matrix changed
+		if (!staticCasters.empty())
+		{
+			light->CreateStaticShadowMap();
+			bool uploaded = false;
+			for (int i = 0; i < 4; ++i)
+			{
+				std::size_t key = staticCastersKey;
+				HashBytes(key, &lightMatrices[i], sizeof(Matrix4x4));
+				HashBytes(key, &light->m_shadowBias, sizeof(float));
+				HashBytes(key, &light->m_shadowNormalBias, sizeof(float));
+				HashCombine(key, static_cast<std::size_t>(shadowMap->width()));
+				if (key == 0)
+					key = 1;	// 0: invalid
+				if (light->m_staticShadowMapKeys[i] == key)
+					continue;
+				light->m_staticShadowMapKeys[i] = key;
+
+				if (!uploaded)
+				{
+					staticCasters.Prepare();
+					uploaded = true;
+				}
+				Pipeline::PushRenderTarget(light->m_staticCascadeRenderTargets[i]);
+				glClear(GL_DEPTH_BUFFER_BIT);
+				staticCasters.Draw(i, shadow_map_material);
+				Pipeline::PopRenderTarget();
+			}
+		}
+
+		// 2. start each cascade from the static shadow map, or cleared without static casters
+		for (int i = 0; i < 4; ++i)
+		{
+			Pipeline::PushRenderTarget(light->m_cascadeRenderTargets[i]);
+			if (!staticCasters.empty())
+			{
+				light->m_staticCascadeRenderTargets[i]->AttachForRead();
+				glBlitFramebuffer(0, 0, shadowMap->width(), shadowMap->height(), 0, 0, shadowMap->width(), shadowMap->height(), GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+				GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+			}
+			else
+			{
+				glClear(GL_DEPTH_BUFFER_BIT);
+			}
+			Pipeline::PopRenderTarget();
+		}
+
+		// 3. the dynamic casters on top
+		if (!dynamicCasters.empty())
+		{
+			dynamicCasters.Prepare();
+			for (int i = 0; i < 4; ++i)
+			{
+				Pipeline::PushRenderTarget(light->m_cascadeRenderTargets[i]);
+				dynamicCasters.Draw(i, shadow_map_material);
+				Pipeline::PopRenderTarget();
+			}
+		}
+
+		GLStateCache::Disable(GL_DEPTH_CLAMP);
 		
 #else
 		for (auto& go : m_gameObjects)
@@ -391,8 +757,6 @@ namespace FishEngine
 			}
 		}
 #endif
-		glDisable(GL_DEPTH_CLAMP);
-		Pipeline::PopRenderTarget();
 #undef DEBUG_SHADOW
 	}
 
@@ -415,35 +779,167 @@ namespace FishEngine
 
 	void Scene::DestroyImmediate(GameObjectPtr g)
 	{
-		auto t = g->transform();
-		// remove children
-		while (!t->m_children.empty())
+		DestroyImmediate(std::vector<GameObjectPtr>{g});
+	}
+
+	void Scene::DestroyImmediate(std::vector<GameObjectPtr> const & gameObjects)
+	{
+		// step 1. the subtrees, parents first, every game object once
+		std::vector<GameObjectPtr> destroyed;
+		std::unordered_set<GameObject*> collected;
+		for (auto const & root : gameObjects)
 		{
-			auto c = t->m_children.back();
-			t->m_children.pop_back();
-			DestroyImmediate(c->gameObject());
+			if (root == nullptr || root->m_transform == nullptr || !collected.insert(root.get()).second)
+				continue;
+			std::size_t i = destroyed.size();
+			destroyed.push_back(root);
+			for (; i < destroyed.size(); ++i)
+			{
+				for (auto const & child : destroyed[i]->m_transform->m_children)
+				{
+					auto go = child->gameObject();
+					if (go != nullptr && collected.insert(go.get()).second)
+						destroyed.push_back(std::move(go));
+				}
+			}
+		}
+		if (destroyed.empty())
+			return;
+
+		// step 2. callbacks, the hierarchy is still intact.
+		// OnDestroy may DestroyImmediate game objects of the batch: they are done (m_transform is null) and skipped
+		for (auto const & go : destroyed)
+		{
+			if (go->m_transform == nullptr)
+				continue;
+			for (auto const & c : go->m_components)
+			{
+				c->OnDestroy();
+			}
+			NotifyChange(go, SceneChange::Destroyed);
+		}
+
+		// step 3. detach. Only the topmost game objects leave their parent, the children lists of the others go away
+		// with them instead of one remove per child
+		for (auto const & go : destroyed)
+		{
+			auto const & t = go->m_transform;
+			if (t == nullptr)
+				continue;
+			auto parent = t->parent();
+			if (parent != nullptr && collected.find(parent->gameObject().get()) == collected.end())
+				t->SetParent(nullptr);
+		}
+		for (auto const & go : destroyed)
+		{
+			auto const & t = go->m_transform;
+			if (t == nullptr)
+				continue;
+			t->m_children.clear();
+			t->m_parent.reset();
+			t->m_gameObjectStrongRef = nullptr;
+			for (auto const & c : go->m_components)
+			{
+				ComponentPool::Remove(c.get());
+			}
+			Unlink(*go);
+			// destroyed without Object::Destroy: its pool must not hand it out again
+			if (go->m_pool != nullptr)
+				go->m_pool->Remove(*go);
+		}
+
+		// step 4. release: the last strong refs are in destroyed (unless referenced elsewhere)
+		for (auto const & go : destroyed)
+		{
+			go->m_transform = nullptr;
 		}
-		t->SetParent(nullptr);  // remove from parent
-		t->m_gameObjectStrongRef = nullptr;
-		g->m_transform = nullptr;
-		m_gameObjects.remove(g);
 	}
 
 	void Scene::DestroyImmediate(ComponentPtr c)
 	{
-		c->gameObject()->RemoveComponent(c);
+		auto go = c->gameObject();
+		// already destroyed, by itself or with its game object
+		if (go == nullptr || go->m_transform == nullptr
+			|| std::find(go->m_components.begin(), go->m_components.end(), c) == go->m_components.end())
+			return;
+		c->OnDestroy();
+		go->RemoveComponent(c);
 	}
 
 	GameObjectPtr Scene::Find(const std::string& name)
 	{
-		for (auto& go : m_gameObjects)
+		auto it = s_nameIndex.find(name);
+		return it == s_nameIndex.end() ? nullptr : it->second.front();
+	}
+
+	GameObjectPtr Scene::FindWithTag(std::string const & tag)
+	{
+		auto const & gameObjects = FindGameObjectsWithTag(tag);
+		return gameObjects.empty() ? nullptr : gameObjects.front();
+	}
+
+	std::vector<GameObjectPtr> const & Scene::FindGameObjectsWithTag(std::string const & tag)
+	{
+		static const std::vector<GameObjectPtr> empty;
+		const int tagIndex = TagManager::TagToIndex(tag);
+		if (tagIndex < 0)
+		{
+			LogError("Tag: " + tag + " is not defined.");
+			return empty;
+		}
+		auto it = s_tagIndex.find(tagIndex);
+		return it == s_tagIndex.end() ? empty : it->second;
+	}
+
+	std::vector<GameObjectPtr> const & Scene::FindGameObjectsInLayer(int layer)
+	{
+		static const std::vector<GameObjectPtr> empty;
+		if (layer < 0 || layer > 31)
+			return empty;
+		return s_layerIndex[layer];
+	}
+
+	std::vector<GameObjectPtr> Scene::FindGameObjectsInLayers(int layerMask)
+	{
+		std::vector<GameObjectPtr> result;
+		for (int layer = 0; layer < 32; ++layer)
 		{
-			if (go->name() == name)
+			if ((static_cast<unsigned>(layerMask) >> layer) & 1u)
+				result.insert(result.end(), s_layerIndex[layer].begin(), s_layerIndex[layer].end());
+		}
+		return result;
+	}
+	
+	std::vector<ComponentPtr> Scene::FindObjectsOfType(int classID)
+	{
+		std::vector<ComponentPtr> result;
+		for (auto const & pool : ComponentPool::s_pools)
+		{
+			if (!IsDerivedFrom(pool.first, classID))
+				continue;
+			for (auto component : pool.second)
 			{
-				return go;
+				auto go = component->gameObject();
+				if (go == nullptr || go->m_transform == nullptr)
+					continue;
+				auto root = go->m_transform;
+				while (root->parent() != nullptr)
+				{
+					root = root->parent();
+				}
+				if (!root->gameObject()->m_isInScene)
+					continue;
+				for (auto const & c : go->m_components)
+				{
+					if (c.get() == component)
+					{
+						result.push_back(c);
+						break;
+					}
+				}
 			}
 		}
-		return nullptr;
+		return result;
 	}
 	
 	void Scene::UpdateBounds()
@@ -3,7 +3,11 @@
 
 #include "FishEngine.hpp"
 #include "Bounds.hpp"
+#include <array>
 #include <utility>
+#include <functional>
+#include <vector>
+#include <unordered_map>
 
 namespace FishEngine
 {
@@ -115,6 +119,25 @@ namespace FishEngine
 	typedef OctNode<std::weak_ptr<GameObject>> SceneOctreeNode;
 
 #endif
+
+	// The changes of one game object since the last Scene::DispatchChanges.
+	struct SceneChange
+	{
+		enum Flags
+		{
+			Created		= 1 << 0,	// added to the scene
+			Destroyed	= 1 << 1,
+			Reparented	= 1 << 2,
+			Renamed		= 1 << 3,
+			Activated	= 1 << 4,	// activeSelf changed
+		};
+
+		int							instanceID;
+		std::weak_ptr<GameObject>	gameObject;		// expired once destroyed
+		int							flags;
+	};
+
+	typedef std::function<void(std::vector<SceneChange> const &)> SceneChangeListener;
 	
 	class FE_EXPORT Scene
 	{
@@ -129,14 +152,55 @@ namespace FishEngine
 		static void Init();
 		static void Start();
 		static void Update();
+		static void FixedUpdate();
+		// unload: destroy all the game objects and release their memory
 		static void Clean();
 		
 		static void RenderShadow(LightPtr const& light);
 		static void OnDrawGizmos();
 
+		// The queries below use indices kept up to date on create, destroy, setName, setTag and setLayer: O(1) and
+		// not a scan of the scene. Only the game objects of GameObjects() are indexed.
+
+		// a game object named name, nullptr if none
 		static GameObjectPtr Find(const std::string& name);
 
+		// a game object tagged tag, nullptr if none
+		static GameObjectPtr FindWithTag(std::string const & tag);
+
+		// the game objects tagged tag, in no particular order
+		static std::vector<GameObjectPtr> const & FindGameObjectsWithTag(std::string const & tag);
+
+		// the game objects of layer (in [0, 31]), in no particular order
+		static std::vector<GameObjectPtr> const & FindGameObjectsInLayer(int layer);
+
+		// the game objects of the layers of layerMask (see LayerMask::GetMask)
+		static std::vector<GameObjectPtr> FindGameObjectsInLayers(int layerMask);
+
+		// the components of class T or of a class derived from T, through ComponentPool. Only the components of the
+		// hierarchies in the scene, not those of prefabs.
+		template<class T>
+		static std::vector<std::shared_ptr<T>> FindObjectsOfType()
+		{
+			std::vector<std::shared_ptr<T>> result;
+			for (auto const & c : FindObjectsOfType(FishEngine::ClassID<T>()))
+			{
+				result.push_back(std::static_pointer_cast<T>(c));
+			}
+			return result;
+		}
+
+		// see FindObjectsOfType<T>
+		static std::vector<ComponentPtr> FindObjectsOfType(int classID);
+
+		// Update the indices after the name, tag or layer of go changed.
+		static void UpdateIndices(GameObject & go);
+
 		static void DestroyImmediate(GameObjectPtr g);
+
+		// Destroy gameObjects and their children in one pass: OnDestroy of all their components, then only the
+		// topmost ones leave their (surviving) parent, then the memory is released. Destroyed ones are skipped.
+		static void DestroyImmediate(std::vector<GameObjectPtr> const & gameObjects);
 		static void DestroyImmediate(ComponentPtr c);
 
 		static void Destroy(GameObjectPtr obj,    const float t = 0.0f);
@@ -157,13 +221,23 @@ namespace FishEngine
 			return m_gameObjects;
 		}
 
-		static void AddGameObject(GameObjectPtr const & go)
-		{
-			m_gameObjects.push_back(go);
-		}
+		static void AddGameObject(GameObjectPtr const & go);
+
+		// Listen to the changes of the game objects: DispatchChanges calls listener with the changes since the last
+		// dispatch, coalesced into one SceneChange per game object, in the order of their first change.
+		// Returns the id to remove the listener with.
+		static int AddChangeListener(SceneChangeListener listener);
+		static void RemoveChangeListener(int id);
+
+		// Called once per frame by the editor.
+		static void DispatchChanges();
+
+		// Record a change of gameObject (flags: SceneChange::Flags), main thread only. Not recorded without listeners.
+		static void NotifyChange(GameObjectPtr const & gameObject, int flags);
 
 	private:
 		friend class RenderSystem;
+		friend class SceneSnapshot;
 		friend class FishEditor::Inspector;
 		//friend class FishEditor::EditorRenderSystem;
 
@@ -174,7 +248,24 @@ namespace FishEngine
 		static Bounds                   m_bounds;
 		//static SceneOctree              m_octree;
 
+		static std::vector<std::pair<int, SceneChangeListener>>	s_changeListeners;
+		static std::vector<SceneChange>	s_changes;
+		static std::map<int, std::size_t>	s_changeIndices;	// instance id -> index in s_changes
+
+		// GameObject::m_indexedName, m_indexedTag and m_indexedLayer -> game objects;
+		// GameObject::m_indexPositions: positions in these vectors
+		static std::unordered_map<std::string, std::vector<GameObjectPtr>>	s_nameIndex;
+		static std::unordered_map<int, std::vector<GameObjectPtr>>			s_tagIndex;
+		static std::array<std::vector<GameObjectPtr>, 32>					s_layerIndex;
+
+		static void AddToIndices(GameObjectPtr const & go);
+		static void RemoveFromIndices(GameObject & go);
+
 		static void UpdateBounds();
+
+		// in m_gameObjects, O(1) with GameObject::m_sceneIterator
+		static void Link(GameObjectPtr const & go);
+		static void Unlink(GameObject & go);
 	};
 }
 
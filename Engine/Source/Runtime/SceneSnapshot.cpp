@@ -0,0 +1,200 @@
+#include "SceneSnapshot.hpp"
+
+#include <chrono>
+#include <deque>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <unordered_set>
+
+#include "Scene.hpp"
+#include "GameObject.hpp"
+#include "Transform.hpp"
+#include "Debug.hpp"
+#include "Serialization/archives/BinaryInputArchive.hpp"
+#include "Serialization/archives/BinaryOutputArchive.hpp"
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	float Milliseconds(Clock::duration duration)
+	{
+		return std::chrono::duration<float, std::milli>(duration).count();
+	}
+}
+
+namespace FishEngine
+{
+	std::vector<SceneSnapshot::Record>	SceneSnapshot::s_records;
+	std::string							SceneSnapshot::s_data;
+	std::unordered_map<int, ObjectPtr>	SceneSnapshot::s_objects;
+	SceneSnapshot::Statistics			SceneSnapshot::s_statistics;
+
+	void SceneSnapshot::Write(BinaryOutputArchive & archive, Record const & record)
+	{
+		record.gameObject->Serialize(archive);
+		record.transform->Serialize(archive);
+		for (auto const & c : record.components)
+		{
+			c->Serialize(archive);
+		}
+	}
+
+	void SceneSnapshot::Capture()
+	{
+		const auto start = Clock::now();
+		Clear();
+
+		std::ostringstream stream;
+		BinaryOutputArchive archive(stream);
+		std::unordered_set<GameObject*> recorded;
+		auto add = [&](GameObjectPtr const & go, bool linked)
+		{
+			if (go == nullptr || !recorded.insert(go.get()).second)
+				return;
+			Record record;
+			record.gameObject = go;
+			record.transform = go->m_transform;
+			record.components = go->m_components;
+			record.ownedByTransform = (go->m_transform->m_gameObjectStrongRef != nullptr);
+			record.linked = linked;
+			record.offset = archive.size();
+			Write(archive, record);
+			record.size = archive.size() - record.offset;
+			s_records.push_back(std::move(record));
+		};
+		s_records.reserve(Scene::m_gameObjects.size());
+		for (auto const & go : Scene::m_gameObjects)
+		{
+			add(go, true);
+		}
+		for (std::size_t i = 0; i < s_records.size(); ++i)
+		{
+			// copied: s_records may grow
+			auto transform = s_records[i].transform;
+			for (auto const & child : transform->m_children)
+			{
+				add(child->gameObject(), false);
+			}
+		}
+		s_data = stream.str();
+		s_objects = archive.objects();
+
+		s_statistics.gameObjects = static_cast<int>(s_records.size());
+		s_statistics.bytes = s_data.size();
+		s_statistics.captureTime = Milliseconds(Clock::now() - start);
+	}
+
+	void SceneSnapshot::Restore()
+	{
+		if (!captured())
+			return;
+		const auto start = Clock::now();
+
+		// game objects created in play mode
+		std::unordered_set<int> captured;
+		captured.reserve(s_records.size());
+		for (auto const & record : s_records)
+		{
+			captured.insert(record.gameObject->GetInstanceID());
+		}
+		std::vector<GameObjectPtr> created;
+		std::deque<GameObjectPtr> todo(Scene::m_gameObjects.begin(), Scene::m_gameObjects.end());
+		for (auto const & record : s_records)
+		{
+			if (record.gameObject->m_transform != nullptr)
+				todo.push_back(record.gameObject);
+		}
+		std::unordered_set<GameObject*> visited;
+		while (!todo.empty())
+		{
+			auto go = todo.front();
+			todo.pop_front();
+			if (!visited.insert(go.get()).second)
+				continue;
+			if (captured.find(go->GetInstanceID()) == captured.end())
+			{
+				created.push_back(go);	// with its children
+				continue;
+			}
+			for (auto const & child : go->m_transform->m_children)
+			{
+				todo.push_back(child->gameObject());
+			}
+		}
+		Scene::DestroyImmediate(created);
+
+		// the current state, in the layout of the snapshot
+		std::ostringstream stream;
+		BinaryOutputArchive archive(stream);
+		std::vector<std::size_t> offsets;
+		offsets.reserve(s_records.size() + 1);
+		for (auto const & record : s_records)
+		{
+			offsets.push_back(archive.size());
+			Write(archive, record);
+		}
+		offsets.push_back(archive.size());
+		const std::string current = stream.str();
+
+		std::istringstream input(s_data);
+		BinaryInputArchive inputArchive(input, s_objects);
+		int restored = 0;
+		for (std::size_t i = 0; i < s_records.size(); ++i)
+		{
+			auto const & record = s_records[i];
+			const std::size_t size = offsets[i + 1] - offsets[i];
+			if (size == record.size && std::memcmp(current.data() + offsets[i], s_data.data() + record.offset, size) == 0)
+				continue;
+
+			auto const & go = record.gameObject;
+			const bool destroyed = (go->m_transform == nullptr);
+
+			// components added in play mode
+			auto components = go->m_components;
+			for (auto const & c : components)
+			{
+				if (std::find(record.components.begin(), record.components.end(), c) == record.components.end())
+					go->RemoveComponent(c);
+			}
+
+			input.seekg(record.offset);
+			go->Deserialize(inputArchive);
+			record.transform->Deserialize(inputArchive);
+			for (auto const & c : record.components)
+			{
+				c->Deserialize(inputArchive);
+			}
+			go->OnComponentsChanged();
+			if (record.ownedByTransform)
+				record.transform->m_gameObjectStrongRef = go;
+			record.transform->MakeDirty();
+			Scene::NotifyChange(go, destroyed ? SceneChange::Created : (SceneChange::Reparented | SceneChange::Renamed | SceneChange::Activated));
+			restored++;
+		}
+
+		// the destroyed game objects are back, in their original order
+		for (auto const & record : s_records)
+		{
+			Scene::Unlink(*record.gameObject);
+		}
+		for (auto const & record : s_records)
+		{
+			if (record.linked)
+				Scene::Link(record.gameObject);
+		}
+
+		s_statistics.restoredGameObjects = restored;
+		s_statistics.restoreTime = Milliseconds(Clock::now() - start);
+		LogInfo(Format("SceneSnapshot: %1% of %2% game objects restored in %3% ms", restored, s_records.size(), s_statistics.restoreTime));
+		Clear();
+	}
+
+	void SceneSnapshot::Clear()
+	{
+		s_records.clear();
+		s_data.clear();
+		s_objects.clear();
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef SceneSnapshot_hpp
+#define SceneSnapshot_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+
+#include <unordered_map>
+
+namespace FishEngine
+{
+	class BinaryOutputArchive;
+
+	// In-memory image of the scene, taken when entering play mode and restored when leaving it: the game objects of
+	// Scene::GameObjects() and their hierarchies (the children of an instantiated prefab are not in GameObjects()).
+	// The game objects, transforms and components are written by their generated Serialize functions into one
+	// binary buffer (BinaryOutputArchive). The snapshot keeps them alive, so Restore does not create objects again:
+	// it destroys the game objects created in play mode, writes the current state in the same layout and only
+	// Deserializes the game objects whose bytes differ (moved, renamed, destroyed, components added or removed...).
+	class FE_EXPORT Meta(NonSerializable) SceneSnapshot
+	{
+	public:
+		SceneSnapshot() = delete;
+
+		static void Capture();
+
+		// no-op if nothing was captured. The snapshot is released.
+		static void Restore();
+
+		static void Clear();
+
+		static bool captured()
+		{
+			return !s_records.empty();
+		}
+
+		struct Statistics
+		{
+			int			gameObjects = 0;
+			std::size_t	bytes = 0;
+			float		captureTime = 0;		// ms
+			int			restoredGameObjects = 0;	// by the last Restore
+			float		restoreTime = 0;		// ms
+		};
+
+		static Statistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+	private:
+		struct Record
+		{
+			GameObjectPtr				gameObject;
+			TransformPtr				transform;
+			std::vector<ComponentPtr>	components;
+			bool						ownedByTransform;	// Transform::m_gameObjectStrongRef
+			bool						linked;				// in Scene::GameObjects()
+			std::size_t					offset;
+			std::size_t					size;
+		};
+
+		static void Write(BinaryOutputArchive & archive, Record const & record);
+
+		// the game objects of Scene::GameObjects() in its order, then the children not in it, parents first
+		static std::vector<Record>					s_records;
+		static std::string							s_data;
+		static std::unordered_map<int, ObjectPtr>	s_objects;	// referenced by s_data
+		static Statistics							s_statistics;
+	};
+}
+
+#endif // SceneSnapshot_hpp
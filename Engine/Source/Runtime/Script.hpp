@@ -50,7 +50,7 @@ namespace FishEngine
 		/********** Physics **********/
 
 		//
-		virtual void FixedUpdate() {}
+		virtual void FixedUpdate() override {}
 
 
 		/********** Input events **********/
@@ -0,0 +1,28 @@
+#include "BinaryInputArchive.hpp"
+
+#include "../../Object.hpp"
+
+namespace FishEngine
+{
+	void BinaryInputArchive::Deserialize(std::string & t)
+	{
+		t.resize(LoadSize());
+		if (!t.empty())
+			LoadBinary(&t[0], t.size());
+	}
+
+	void BinaryInputArchive::DeserializeObject(ObjectPtr & obj)
+	{
+		int instanceID = 0;
+		LoadBinary(&instanceID, sizeof(instanceID));
+		auto it = m_objects.find(instanceID);
+		obj = (it == m_objects.end()) ? nullptr : it->second;
+	}
+
+	void BinaryInputArchive::DeserializeWeakObject(std::weak_ptr<Object> & obj)
+	{
+		ObjectPtr temp;
+		DeserializeObject(temp);
+		obj = temp;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../../Archive.hpp"
+
+#include <unordered_map>
+
+namespace FishEngine
+{
+	// Reads what BinaryOutputArchive wrote. Object references are resolved through objects (the objects() of the
+	// output archive), unknown instance ids read as nullptr.
+	class FE_EXPORT Meta(NonSerializable) BinaryInputArchive : public InputArchive
+	{
+	public:
+		BinaryInputArchive(std::istream & is, std::unordered_map<int, ObjectPtr> const & objects)
+			: InputArchive(is), m_objects(objects)
+		{
+		}
+
+		BinaryInputArchive(BinaryInputArchive const &) = delete;
+		BinaryInputArchive& operator = (BinaryInputArchive const &) = delete;
+
+		virtual ~BinaryInputArchive() = default;
+
+		void LoadBinary(void * data, std::size_t size)
+		{
+			auto const readSize = static_cast<std::size_t>(m_istream.rdbuf()->sgetn(reinterpret_cast<char*>(data), size));
+			if (readSize != size)
+			{
+				abort();
+			}
+		}
+
+		virtual void BeginClass() override {}
+		virtual void EndClass() override {}
+
+	protected:
+		virtual void Deserialize(short & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(unsigned short & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(int & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(unsigned int & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(long & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(unsigned long & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(long long & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(unsigned long long & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(float & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(double & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(bool & t) override { LoadBinary(&t, sizeof(t)); }
+		virtual void Deserialize(std::string & t) override;
+
+		virtual void DeserializeObject(ObjectPtr & obj) override;
+		virtual void DeserializeWeakObject(std::weak_ptr<Object> & obj) override;
+
+		virtual std::size_t BeginMap() override { return LoadSize(); }
+		virtual void BeforeMapKey() override {}
+		virtual void AfterMapKey() override {}
+		virtual void AfterMapValue() override {}
+		virtual void EndMap() override {}
+
+		virtual std::size_t BeginSequence() override { return LoadSize(); }
+		virtual void BeforeASequenceItem() override {}
+		virtual void AfterASequenceItem() override {}
+		virtual void EndSequence() override {}
+
+		virtual void EndNVP() override {}
+		virtual void NameOfNVP(const char* name) override {}
+		virtual void MiddleOfNVP() override {}
+
+	private:
+		std::size_t LoadSize()
+		{
+			uint32_t size = 0;
+			LoadBinary(&size, sizeof(size));
+			return size;
+		}
+
+		std::unordered_map<int, ObjectPtr> const & m_objects;
+	};
+}
@@ -1,12 +1,44 @@
 #include "BinaryOutputArchive.hpp"
 
+#include <cstring>
+
 #include "../../Object.hpp"
 
 namespace FishEngine
 {
-	BinaryOutputArchive & FishEngine::BinaryOutputArchive::operator<<(ObjectPtr const & object)
+	void BinaryOutputArchive::Serialize(std::string const & t)
+	{
+		SaveSize(t.size());
+		SaveBinary(t.data(), t.size());
+	}
+
+	void BinaryOutputArchive::Serialize(const char* t)
+	{
+		const std::size_t size = std::strlen(t);
+		SaveSize(size);
+		SaveBinary(t, size);
+	}
+
+	void BinaryOutputArchive::Serialize(std::nullptr_t const &)
+	{
+		const int instanceID = 0;
+		SaveBinary(&instanceID, sizeof(instanceID));
+	}
+
+	void BinaryOutputArchive::SerializeObject(ObjectPtr const & obj)
+	{
+		if (obj == nullptr)
+		{
+			Serialize(nullptr);
+			return;
+		}
+		const int instanceID = obj->GetInstanceID();
+		m_objects.emplace(instanceID, obj);
+		SaveBinary(&instanceID, sizeof(instanceID));
+	}
+
+	void BinaryOutputArchive::SerializeWeakObject(std::weak_ptr<Object> const & obj)
 	{
-		object->Serialize(*this);
-		return *this;
+		SerializeObject(obj.lock());
 	}
 }
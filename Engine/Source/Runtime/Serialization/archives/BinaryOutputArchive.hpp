@@ -1,30 +1,33 @@
 #pragma once
 
 #include "../../Archive.hpp"
-#include "../NameValuePair.hpp"
+
+#include <unordered_map>
 
 namespace FishEngine
 {
-	class BinaryOutputArchive;
-
-	template <>
-	constexpr int ArchiveID<BinaryOutputArchive>()
-	{
-		return 2;
-	}
-
-	class BinaryOutputArchive : public OutputArchive
+	// Compact binary form of the generated Serialize functions: raw values, sizes of strings and containers, no names.
+	// Object references are written as instance ids, so the archive is only valid in the running process. The
+	// referenced objects are collected in objects(), to be handed to the BinaryInputArchive reading it back.
+	class FE_EXPORT Meta(NonSerializable) BinaryOutputArchive : public OutputArchive
 	{
 	public:
 		BinaryOutputArchive(std::ostream & ostream) : m_ostream(ostream) {}
 		BinaryOutputArchive(BinaryOutputArchive const &) = delete;
 		BinaryOutputArchive& operator = (BinaryOutputArchive const &) = delete;
 
-		~BinaryOutputArchive() = default;
+		virtual ~BinaryOutputArchive() = default;
+
+		// bytes written so far
+		std::size_t size() const
+		{
+			return m_size;
+		}
 
-		virtual int ArchiveID()
+		// instance id -> object, of every reference written so far
+		std::unordered_map<int, ObjectPtr> const & objects() const
 		{
-			return FishEngine::ArchiveID<BinaryOutputArchive>();
+			return m_objects;
 		}
 
 		void SaveBinary(const void * data, std::size_t size)
@@ -35,64 +38,51 @@ namespace FishEngine
 				//throw Exception("Failed to write " + std::to_string(size) + " bytes to output stream! Wrote " + std::to_string(writtenSize));
 				abort();
 			}
+			m_size += size;
 		}
 
-		template<typename T, std::enable_if_t<std::is_enum<T>::value, int> = 0>
-		BinaryOutputArchive & operator << (T t)
+		virtual void BeginMap(std::size_t mapSize) override
 		{
-			SaveBinary(std::addressof(t), sizeof(t));
-			return *this;
+			SaveSize(mapSize);
 		}
 
-		BinaryOutputArchive & operator << (std::string const & str)
+		virtual void BeginSequence(std::size_t sequenceSize) override
 		{
-			SaveBinary(str.data(), str.size());
-			return *this;
+			SaveSize(sequenceSize);
 		}
 
-		template<class T>
-		BinaryOutputArchive & operator << (NameValuePair<T> const & t)
-		{
-			(*this) << t.value;
-			return *this;
-		}
+	protected:
+		virtual void Serialize(short t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(unsigned short t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(int t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(unsigned int t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(long t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(unsigned long t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(long long t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(unsigned long long t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(float t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(double t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(bool t) override { SaveBinary(&t, sizeof(t)); }
+		virtual void Serialize(std::string const & t) override;
+		virtual void Serialize(const char* t) override;
+		virtual void Serialize(std::nullptr_t const & t) override;
 
-		//! Serialization for std::vectors of arithmetic (but not bool) using binary serialization
-		template<typename T, typename std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, int> = 0>
-		BinaryOutputArchive & operator << (const std::vector<T> & v)
-		{
-			(*this) << v.size();
-			SaveBinary(v.data(), v.size() * sizeof(T));
-			return *this;
-		}
+		virtual void SerializeObject(ObjectPtr const & obj) override;
+		virtual void SerializeWeakObject(std::weak_ptr<Object> const & obj) override;
 
-		//! Serialization for non-arithmetic vector types
-		template<typename T, typename std::enable_if_t<!std::is_arithmetic<T>::value, int> = 0>
-		BinaryOutputArchive & operator << (const std::vector<T> & v)
-		{
-			(*this) << v.size();
-			for (auto && x : v)
-			{
-				(*this) << x;
-			}
-			return *this;
-		}
+		virtual void SerializeNameOfNVP(const char* name) override {}
+		virtual void MiddleOfNVP() override {}
+		virtual void EndNVP() override {}
 
-		template<class T, class B>
-		BinaryOutputArchive & operator << (std::map<T, B> const & v)
+	private:
+		void SaveSize(std::size_t size)
 		{
-			//(*this) << make_size_tag(v.size());
-			(*this) << v.size();
-			for (auto& p : v)
-			{
-				(*this) << p.first << p.second;
-			}
+			const uint32_t s = static_cast<uint32_t>(size);
+			SaveBinary(&s, sizeof(s));
 		}
 
-		//template<typename T, typename std::enable_if_t<std::is_base_of<Object, T>::value, int> = 0>
-		BinaryOutputArchive & operator << (ObjectPtr const & object);
-
-	private:
-		std::ostream & m_ostream;
+		std::ostream &							m_ostream;
+		std::size_t								m_size = 0;
+		std::unordered_map<int, ObjectPtr>		m_objects;
 	};
 }
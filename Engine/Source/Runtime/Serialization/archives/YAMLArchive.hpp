@@ -122,12 +122,12 @@ namespace FishEngine
 		virtual void Deserialize(bool & t) override { Convert(CurrentNode(), t); }
 		virtual void Deserialize(std::string & t) override { Convert(CurrentNode(), t); }
 
-		virtual void DeserializeObject(FishEngine::ObjectPtr const & obj) override
+		virtual void DeserializeObject(FishEngine::ObjectPtr & obj) override
 		{
 
 		}
 
-		virtual void DeserializeWeakObject(std::weak_ptr<FishEngine::Object> const & obj) override
+		virtual void DeserializeWeakObject(std::weak_ptr<FishEngine::Object> & obj) override
 		{
 
 		}
@@ -151,6 +151,14 @@ namespace FishEngine
 
 		}
 
+	public:
+		virtual bool HasNVP(const char* name) override
+		{
+			// const: operator[] would add the key otherwise
+			YAML::Node const & currentNode = CurrentNode();
+			return currentNode.IsMap() && currentNode[name];
+		}
+
 	protected:
 
 		static void Convert(YAML::Node const & node, std::string & t)
@@ -15,11 +15,14 @@
 #include "Debug.hpp"
 #include "Pipeline.hpp"
 #include "ShaderCompiler.hpp"
+#include "MaterialTable.hpp"
+#include "HiZCulling.hpp"
 
 //#include EnumHeader(CullFace)
 #include "generate/Enum_Cullface.hpp"
 
 #include "Rendering/RenderQueue.hpp"
+#include "GLStateCache.hpp"
 
 using namespace std;
 using namespace FishEngine;
@@ -188,7 +191,8 @@ const char* GLenumToString(GLenum e)
 
 bool UniformIsTexture(GLenum type)
 {
-	return (type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_2D_ARRAY_SHADOW);
+	return (type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_2D_ARRAY_SHADOW
+		|| type == GL_SAMPLER_BUFFER || type == GL_INT_SAMPLER_BUFFER || type == GL_UNSIGNED_INT_SAMPLER_BUFFER);
 }
 
 
@@ -204,6 +208,7 @@ namespace FishEngine
 		{
 			for (auto& e : m_keywordToGLPrograms)
 			{
+				GLStateCache::OnDeleteProgram(e.second);
 				glDeleteProgram(e.second);
 			}
 		}
@@ -256,6 +261,13 @@ namespace FishEngine
 			return program;
 		}
 
+		std::vector<UniformInfo> const & uniforms(ShaderKeywords keywords)
+		{
+			auto it = m_keywordToGLPrograms.find(keywords);
+			GLuint program = (it != m_keywordToGLPrograms.end()) ? it->second : CompileAndLink(keywords);
+			return m_GLProgramToUniforms[program];
+		}
+
 		const std::string& shaderTextRaw() const
 		{
 			return m_shaderTextRaw;
@@ -280,6 +292,14 @@ namespace FishEngine
 			std::string text = "#version 410 core\n";
 			m_lineCount = 1;
 
+			const bool materialTable = (keywords & static_cast<ShaderKeywords>(ShaderKeyword::MaterialTable)) != 0;
+			if (materialTable && MaterialTable::mode() == MaterialTable::Mode::Bindless)
+			{
+				// extensions must come before any other statement
+				text += "#extension GL_ARB_bindless_texture : require\n";
+				m_lineCount++;
+			}
+
 			auto add_macro_definition = [&text, this](const string& d)
 			{
 				text += "#define " + d + "\n";
@@ -311,6 +331,16 @@ namespace FishEngine
 			{
 				add_macro_definition("_AMBIENT_IBL");
 			}
+			if (materialTable)
+			{
+				add_macro_definition("_MATERIAL_TABLE");
+				if (MaterialTable::mode() == MaterialTable::Mode::Bindless)
+					add_macro_definition("_BINDLESS_TEXTURE");
+			}
+			if (keywords & static_cast<ShaderKeywords>(ShaderKeyword::IndirectDraw))
+			{
+				add_macro_definition("_INDIRECT_DRAW");
+			}
 
 			text += m_shaderTextRaw;
 
@@ -385,7 +415,9 @@ namespace FishEngine
 					u.location = loc;
 					if (UniformIsTexture(type))
 					{
+						// texture units are fixed per program, set them once here rather than on every Use
 						u.textureBindPoint = texture_count;
+						glProgramUniform1i(program, loc, texture_count);
 						texture_count++;
 					}
 					else {
@@ -407,6 +439,7 @@ namespace FishEngine
 {
 
 	std::map<std::string, ShaderPtr> Shader::m_builtinShaders;
+	std::map<std::string, std::pair<unsigned int, unsigned int>> Shader::s_globalTextures;
 
 	Shader::Shader()
 	{
@@ -446,6 +479,25 @@ namespace FishEngine
 			}
 			m_savedProperties = compiler.m_savedProperties;
 
+			// MATERIAL_TEXTURE(slot, name, uv), see MaterialTable.inc
+			m_materialTextures.clear();
+			static const std::regex materialTexture(R"(MATERIAL_TEXTURE\(\s*(\d+)\s*,\s*(\w+))");
+			for (auto it = std::sregex_iterator(parsed_shader_text.begin(), parsed_shader_text.end(), materialTexture); it != std::sregex_iterator(); ++it)
+			{
+				auto slot = boost::lexical_cast<std::size_t>((*it)[1].str());
+				if (slot >= MaterialTable::MaxTextureSlots)
+				{
+					LogWarning(Format("MATERIAL_TEXTURE slot %1% out of range in %2%", slot, path.string()));
+					continue;
+				}
+				if (m_materialTextures.size() <= slot)
+					m_materialTextures.resize(slot + 1);
+				m_materialTextures[slot] = (*it)[2].str();
+			}
+
+			// "@IndirectDraw on": the _INDIRECT_DRAW variant loads the per-draw uniforms of DrawID, see ShaderVariables.inc
+			m_indirectDraw = GetValueOrDefault<string, string>(settings, "indirectdraw", "off") == "on";
+
 			m_impl->set(parsed_shader_text);
 			//m_impl->CompileAndLink(m_keywords);
 			//m_GLNativeProgram = m_impl->glslProgram(m_keywords, m_uniforms);
@@ -520,13 +572,14 @@ namespace FishEngine
 	{
 	}
 
-	void Shader::Use() noexcept
+	void Shader::Use(ShaderKeywords variantKeywords) noexcept
 	{
-		if (m_GLNativeProgram == 0)
+		const ShaderKeywords keywords = m_keywords | variantKeywords;
+		if (m_GLNativeProgram == 0 || keywords != m_activeKeywords)
 		{
 			try {
-				m_impl->CompileAndLink(m_keywords);
-				m_GLNativeProgram = m_impl->glslProgram(m_keywords, m_uniforms);
+				m_GLNativeProgram = m_impl->glslProgram(keywords, m_uniforms);
+				m_activeKeywords = keywords;
 			}
 			catch (const std::exception & e)
 			{
@@ -537,13 +590,21 @@ namespace FishEngine
 		//if (m_GLNativeProgram == 0)
 		//	abort();
 		//assert(m_GLNativeProgram != 0);
-		glUseProgram(m_GLNativeProgram);
-		for (auto& u : m_uniforms)
+		GLStateCache::UseProgram(m_GLNativeProgram);
+	}
+
+	const std::vector<UniformInfo>& Shader::propertyUniforms()
+	{
+		// never compiled yet: keep the lazy compilation of Use
+		if (m_GLNativeProgram == 0 || m_activeKeywords == m_keywords)
+			return m_uniforms;
+		try {
+			return m_impl->uniforms(m_keywords);
+		}
+		catch (const std::exception & e)
 		{
-			if (u.textureBindPoint >= 0)
-			{
-				glProgramUniform1i(m_GLNativeProgram, u.location, u.textureBindPoint);
-			}
+			PrintErrorMessage(e.what());
+			return m_uniforms;
 		}
 	}
 
@@ -671,10 +732,30 @@ namespace FishEngine
 		BindTextures(dict);
 	}
 
+	void Shader::SetGlobalBufferTexture(const std::string& name, unsigned int texture)
+	{
+		SetGlobalTexture(name, GL_TEXTURE_BUFFER, texture);
+	}
+
+	void Shader::SetGlobalTexture(const std::string& name, unsigned int target, unsigned int texture)
+	{
+		s_globalTextures[name] = std::make_pair(target, texture);
+	}
+
 	void Shader::BindTextures(const std::map<std::string, TexturePtr>& textures)
 	{
 		for (auto& u : m_uniforms)
 		{
+			if (u.type == GL_SAMPLER_BUFFER || u.type == GL_INT_SAMPLER_BUFFER || u.type == GL_UNSIGNED_INT_SAMPLER_BUFFER)
+			{
+				auto it = s_globalTextures.find(u.name);
+				if (it != s_globalTextures.end())
+				{
+					GLStateCache::BindTexture(u.textureBindPoint, it->second.first, it->second.second);
+					u.binded = true;
+				}
+				continue;
+			}
 			if (!(u.type == GL_SAMPLER_2D || u.type == GL_SAMPLER_CUBE || u.type == GL_SAMPLER_2D_ARRAY || u.type == GL_SAMPLER_2D_ARRAY_SHADOW))
 				continue;
 			auto it = textures.find(u.name);
@@ -686,11 +767,17 @@ namespace FishEngine
 				else if (u.type == GL_SAMPLER_2D_ARRAY || u.type == GL_SAMPLER_2D_ARRAY_SHADOW)
 					type = GL_TEXTURE_2D_ARRAY;
 				//BindUniformTexture(u.name.c_str(), it->second->GLTexuture(), texture_id, type);
-				glActiveTexture(GLenum(GL_TEXTURE0 + u.textureBindPoint));
-				glCheckError();
-				glBindTexture(type, it->second->GetNativeTexturePtr());
+				GLStateCache::BindTexture(u.textureBindPoint, type, it->second->GetNativeTexturePtr());
 				u.binded = true;
-				glCheckError();
+			}
+			else
+			{
+				auto global = s_globalTextures.find(u.name);
+				if (global != s_globalTextures.end())
+				{
+					GLStateCache::BindTexture(u.textureBindPoint, global->second.first, global->second.second);
+					u.binded = true;
+				}
 			}
 //            else
 //            {
@@ -732,21 +819,21 @@ namespace FishEngine
 	{
 		if (m_cullface == Cullface::Off)
 		{
-			glDisable(GL_CULL_FACE);
+			GLStateCache::Disable(GL_CULL_FACE);
 		}
 		else
 		{
-			glCullFace((GLenum)m_cullface);
+			GLStateCache::CullFace((GLenum)m_cullface);
 		}
-		glDepthMask(m_ZWrite);
+		GLStateCache::DepthMask(m_ZWrite);
 		if (m_blend)
 		{
-			glEnable(GL_BLEND);
+			GLStateCache::Enable(GL_BLEND);
 			if (m_blendFactorCount == 2)
 			{
 				auto f1 = ShaderBlendFactorToGL(m_blendFactors[0]);
 				auto f2 = ShaderBlendFactorToGL(m_blendFactors[1]);
-				glBlendFunc(f1, f2);
+				GLStateCache::BlendFunc(f1, f2);
 			}
 			else
 			{
@@ -755,19 +842,19 @@ namespace FishEngine
 				auto f3 = ShaderBlendFactorToGL(m_blendFactors[2]);
 				auto f4 = ShaderBlendFactorToGL(m_blendFactors[3]);
 				//glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-				glBlendFuncSeparate(f1, f2, f3, f4);
+				GLStateCache::BlendFuncSeparate(f1, f2, f3, f4);
 			}
 		}
 	}
 
 	void Shader::PostRender() const
 	{
-		glDepthMask(GL_TRUE);
+		GLStateCache::DepthMask(GL_TRUE);
 		if (m_cullface == Cullface::Off)
-			glEnable(GL_CULL_FACE);
-		glCullFace(GL_BACK);
+			GLStateCache::Enable(GL_CULL_FACE);
+		GLStateCache::CullFace(GL_BACK);
 		if (m_blend)
-			glDisable(GL_BLEND);
+			GLStateCache::Disable(GL_BLEND);
 	}
 
 	void Shader::CheckStatus() const
@@ -810,12 +897,14 @@ namespace FishEngine
 	{
 		m_keywords |= keyword;
 		m_GLNativeProgram = m_impl->glslProgram(m_keywords, m_uniforms);
+		m_activeKeywords = m_keywords;
 	}
 
 	void Shader::DisableLocalKeywords(ShaderKeywords keyword)
 	{
 		m_keywords &= ~keyword;
 		m_GLNativeProgram = m_impl->glslProgram(m_keywords, m_uniforms);
+		m_activeKeywords = m_keywords;
 	}
 
 	int Shader::renderQueue()
@@ -859,9 +948,13 @@ namespace FishEngine
 		m_builtinShaders["SkyboxCubed"] = Shader::CreateFromFile(root_dir / "Skybox-Cubed.shader");
 		m_builtinShaders["SkyboxProcedural"] = Shader::CreateFromFile(root_dir / "Skybox-Procedural.shader");
 		m_builtinShaders["SolidColor-Internal"] = Shader::CreateFromFile(root_dir / "Editor/SolidColor.shader");
+		m_builtinShaders["Gizmos-Internal"] = Shader::CreateFromFile(root_dir / "Editor/Gizmos.shader");
 		m_builtinShaders["SkyboxProcedural"]->setName("SkyboxProcedural");
 		m_builtinShaders["SkyboxCubed"]->setName("SkyboxCubed");
 		m_builtinShaders["SolidColor-Internal"]->setName("SolidColor-Internal");
+		m_builtinShaders["Gizmos-Internal"]->setName("Gizmos-Internal");
+
+		HiZCulling::Init(rootDir);
 	}
 
 }
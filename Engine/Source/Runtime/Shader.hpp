@@ -33,7 +33,8 @@ namespace FishEngine
 
 		static ShaderPtr CreateFromFile(const Path& path);
 
-		void Use() noexcept;
+		// variantKeywords: keywords of this draw only (e.g. ShaderKeyword::MaterialTable), on top of the local keywords.
+		void Use(ShaderKeywords variantKeywords = 0) noexcept;
 
 		bool HasUniform(const std::string& name);
 
@@ -53,6 +54,12 @@ namespace FishEngine
 		void BindTexture(const std::string& name, TexturePtr texture);
 		void BindTextures(const std::map<std::string, TexturePtr>& textures);
 
+		// Texture buffer (GL_TEXTURE_BUFFER) bound to the samplerBuffer uniform called name in every shader.
+		static void SetGlobalBufferTexture(const std::string& name, unsigned int texture);
+
+		// GL texture bound to the sampler uniform called name in every shader, unless the material sets it.
+		static void SetGlobalTexture(const std::string& name, unsigned int target, unsigned int texture);
+
 		void PreRender() const;
 		void PostRender() const;
 
@@ -68,6 +75,16 @@ namespace FishEngine
 			return m_uniforms;
 		}
 
+		// Uniforms of the variant with the local keywords only: the material properties.
+		// uniforms() is the variant of the last Use, the MaterialTable variant has no material texture samplers.
+		const std::vector<UniformInfo>& propertyUniforms();
+
+		// Material textures sampled with MATERIAL_TEXTURE(slot, name, uv), the name of each slot.
+		const std::vector<std::string>& materialTextures() const
+		{
+			return m_materialTextures;
+		}
+
 
 		static const std::map<std::string, ShaderPtr>& allShaders()
 		{
@@ -85,6 +102,12 @@ namespace FishEngine
 			return m_deferred;
 		}
 
+		// Has a ShaderKeyword::IndirectDraw variant: the draws may be merged into a MeshPool::MultiDraw.
+		bool SupportsIndirectDraw() const
+		{
+			return m_indirectDraw;
+		}
+
 		bool IsKeywordEnabled(ShaderKeyword keyword)
 		{
 			return (m_keywords & static_cast<ShaderKeywords>(keyword)) != 0;
@@ -134,7 +157,20 @@ namespace FishEngine
 
 		ShaderKeywords m_keywords = static_cast<ShaderKeywords>(ShaderKeyword::None);
 
+		// keywords of m_GLNativeProgram, m_keywords | the variant keywords of the last Use
+		Meta(NonSerializable)
+		ShaderKeywords m_activeKeywords = static_cast<ShaderKeywords>(ShaderKeyword::None);
+
+		Meta(NonSerializable)
+		std::vector<std::string> m_materialTextures;
+
+		Meta(NonSerializable)
+		bool m_indirectDraw = false;
+
 		static std::map<std::string, ShaderPtr> m_builtinShaders;
+
+		// name -> (target, GL texture)
+		static std::map<std::string, std::pair<unsigned int, unsigned int>> s_globalTextures;
 	};
 }
 
@@ -282,7 +282,8 @@ namespace FishEngine
 		auto shaderText = ReadFile(path);
 		if (path.extension() == ".surf")
 		{
-			shaderText = "#include <SurfaceShaderCommon.inc>\n#ifdef SURFACE_SHADER\n" +
+			// the vertex shader of SurfaceShaderCommon.inc loads the per-draw uniforms of DrawID
+			shaderText = "@IndirectDraw on\n#include <SurfaceShaderCommon.inc>\n#ifdef SURFACE_SHADER\n" +
 				shaderText + "\n#endif\n";
 		}
 
@@ -41,7 +41,9 @@ namespace FishEngine
 		None = 0,
 		//SkinnedAnimation = 1,
 		AmbientIBL = 2,
-		All = AmbientIBL // | SkinnedAnimation,
+		MaterialTable = 4,	// per-draw variant, material textures from MaterialTable
+		IndirectDraw = 8,	// per-draw variant, per-draw uniforms of a MeshPool::MultiDraw
+		All = AmbientIBL | MaterialTable | IndirectDraw // | SkinnedAnimation,
 	};
 
 	typedef std::uint32_t ShaderKeywords;
@@ -9,6 +9,7 @@ constexpr int UVIndex = 2;
 constexpr int TangentIndex = 3;
 constexpr int BoneIndexIndex = 4;
 constexpr int BoneWeightIndex = 5;
+constexpr int DrawIDIndex = 6;		// MeshPool::MultiDraw
 
 struct PerCameraUniforms
 {
@@ -50,6 +51,12 @@ struct PerCameraUniforms
 
 	vec4 WorldSpaceCameraPos;		// .w is not used
 	vec4 WorldSpaceCameraDir;		// forward direction of the camera in world space
+
+	// see ClusteredLighting::ClusterParams
+	// x = clusters per pixel horizontally
+	// y = clusters per pixel vertically
+	// z, w = scale and bias of the depth slice, slice = log(depth) * z + w
+	vec4 ClusterParams;
 };
 
 
@@ -60,6 +67,8 @@ struct PerDrawUniforms
 	mat4 MATRIX_IT_MV;
 	mat4 MATRIX_M;		// ObjectToWorld
 	mat4 MATRIX_IT_M;   // WorldToObject
+	vec4 LODFade;		// x: cross-fade factor of the LOD, (0, 1] fading in, [-1, 0) fading out, 0 no fading
+	int MaterialIndex[4];	// ivec4, x: row of the material in the MaterialTable, -1 if its textures are bound per draw
 };
 
 // layout(std140, row_major) uniform PerFrameUniforms
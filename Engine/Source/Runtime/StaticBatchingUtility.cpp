@@ -0,0 +1,332 @@
+#include "StaticBatchingUtility.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+#include "Debug.hpp"
+#include "Mathf.hpp"
+#include "GameObject.hpp"
+#include "Transform.hpp"
+#include "Scene.hpp"
+#include "Mesh.hpp"
+#include "MeshFilter.hpp"
+#include "MeshRenderer.hpp"
+#include "Material.hpp"
+#include "Shader.hpp"
+#include "Rendering/RenderQueue.hpp"
+#include "LODGroup.hpp"
+
+namespace
+{
+	using namespace FishEngine;
+
+	// the CPU copy of a source mesh
+	struct SourceMesh
+	{
+		std::vector<Vector3>	vertices;
+		std::vector<Vector3>	normals;
+		std::vector<Vector3>	tangents;
+		std::vector<Vector2>	uv;
+		std::vector<uint32_t>	triangles;
+	};
+
+	// a (renderer, material) to combine
+	struct Piece
+	{
+		MeshRendererPtr		renderer;
+		int					materialIndex;
+		SourceMesh const *	source;
+		uint32_t			firstIndex;		// index range of the sub-mesh in source
+		uint32_t			indexCount;
+		uint32_t			vertexCount;	// referenced by the range
+		Bounds				bounds;			// world space
+		uint32_t			mortonCode;
+	};
+
+	// the pieces of a material and vertex layout
+	struct Group
+	{
+		MaterialPtr			material;
+		VertexCompression	compression;
+		std::vector<Piece>	pieces;
+		Bounds				bounds;
+	};
+
+	// 10 bits of x spread to every third bit
+	uint32_t Part1By2(uint32_t x)
+	{
+		x &= 0x3FF;
+		x = (x | (x << 16)) & 0x030000FF;
+		x = (x | (x << 8)) & 0x0300F00F;
+		x = (x | (x << 4)) & 0x030C30C3;
+		x = (x | (x << 2)) & 0x09249249;
+		return x;
+	}
+
+	// position of p in space along a Z-order curve: close pieces get close parts, so the visible parts of a batch
+	// form long runs
+	uint32_t MortonCode(Vector3 const & p, Bounds const & space)
+	{
+		auto quantize = [](float value, float min, float size) -> uint32_t
+		{
+			if (size <= 0)
+				return 0;
+			return static_cast<uint32_t>(Mathf::Clamp((value - min) / size, 0.f, 1.f) * 1023.f);
+		};
+		const auto min = space.min();
+		const auto size = space.size();
+		return Part1By2(quantize(p.x, min.x, size.x)) | (Part1By2(quantize(p.y, min.y, size.y)) << 1) | (Part1By2(quantize(p.z, min.z, size.z)) << 2);
+	}
+
+	// Batches are drawn as runs of the opaque queues. Transparent materials would lose the order of their draws, and
+	// alpha tested ones their render queue.
+	bool IsBatchable(MaterialPtr const & material)
+	{
+		auto const & shader = material->shader();
+		return shader != nullptr && !shader->IsTransparent()
+			&& material->renderQueue() < static_cast<int>(Rendering::RenderQueue::AlphaTest);
+	}
+
+	uint32_t CountVertices(SourceMesh const & source, uint32_t firstIndex, uint32_t indexCount)
+	{
+		std::vector<bool> used(source.vertices.size(), false);
+		uint32_t count = 0;
+		for (uint32_t i = firstIndex; i < firstIndex + indexCount; ++i)
+		{
+			if (!used[source.triangles[i]])
+			{
+				used[source.triangles[i]] = true;
+				count++;
+			}
+		}
+		return count;
+	}
+}
+
+namespace FishEngine
+{
+	bool							StaticBatchingUtility::s_enabled = true;
+	uint32_t						StaticBatchingUtility::s_maxBatchVertices = 0xFFFF;
+	std::vector<std::weak_ptr<MeshRenderer>>	StaticBatchingUtility::s_batchedRenderers;
+	StaticBatchingUtility::Statistics	StaticBatchingUtility::s_statistics;
+
+	void StaticBatchingUtility::Combine(GameObjectPtr const & staticBatchRoot)
+	{
+		Combine(std::vector<GameObjectPtr>{ staticBatchRoot });
+	}
+
+	void StaticBatchingUtility::CombineScene()
+	{
+		// Scene::GameObjects() may hold children too, Combine walks them from their root
+		std::vector<GameObjectPtr> roots;
+		for (auto const & go : Scene::GameObjects())
+		{
+			if (go->transform()->parent() == nullptr)
+				roots.push_back(go);
+		}
+		Combine(roots);
+	}
+
+	void StaticBatchingUtility::Clear()
+	{
+		for (auto & r : s_batchedRenderers)
+		{
+			auto renderer = r.lock();
+			if (renderer != nullptr)
+				renderer->m_staticBatchParts.clear();
+		}
+		s_batchedRenderers.clear();
+		s_statistics = Statistics();
+	}
+
+	void StaticBatchingUtility::Combine(std::vector<GameObjectPtr> const & roots)
+	{
+		std::map<Mesh const *, SourceMesh> sources;
+		std::vector<Group> groups;
+		std::map<std::pair<Material const *, VertexCompression>, std::size_t> groupIndices;
+
+		std::deque<GameObjectPtr> todo(roots.begin(), roots.end());
+		while (!todo.empty())
+		{
+			auto go = todo.front();
+			todo.pop_front();
+			for (auto && child : go->transform()->children())
+			{
+				todo.push_back(child->gameObject());
+			}
+
+			if (!go->isStatic())
+				continue;
+			auto renderer = go->GetComponent<MeshRenderer>();
+			auto meshFilter = go->GetComponent<MeshFilter>();
+			if (renderer == nullptr || renderer->isPartOfStaticBatch() || meshFilter == nullptr || meshFilter->mesh() == nullptr)
+				continue;
+			// LODGroup switches meshes at run time
+			if (go->GetComponent<LODGroup>() != nullptr)
+				continue;
+			auto const & mesh = meshFilter->mesh();
+			if (mesh->m_skinned)
+				continue;
+
+			auto it = sources.find(mesh.get());
+			if (it == sources.end())
+			{
+				SourceMesh source;
+				if (!mesh->ReadMeshData(source.vertices, source.normals, source.tangents, source.uv, source.triangles))
+					continue;
+				it = sources.emplace(mesh.get(), std::move(source)).first;
+			}
+
+			auto const & materials = renderer->materials();
+			for (int i = 0; i < static_cast<int>(materials.size()); ++i)
+			{
+				auto const & material = materials[i];
+				if (material == nullptr || !IsBatchable(material))
+					continue;
+
+				// the range drawn by RenderSystem for this material
+				Piece piece;
+				piece.renderer = renderer;
+				piece.materialIndex = i;
+				piece.source = &it->second;
+				mesh->GetSubMeshRange(i, piece.firstIndex, piece.indexCount);
+				if (piece.indexCount == 0 || piece.firstIndex + piece.indexCount > piece.source->triangles.size())
+					continue;
+				piece.vertexCount = CountVertices(*piece.source, piece.firstIndex, piece.indexCount);
+				if (piece.vertexCount > s_maxBatchVertices)
+					continue;
+				piece.bounds = renderer->bounds();
+
+				auto key = std::make_pair(material.get(), mesh->vertexCompression());
+				auto groupIt = groupIndices.find(key);
+				if (groupIt == groupIndices.end())
+				{
+					groupIt = groupIndices.emplace(key, groups.size()).first;
+					groups.emplace_back();
+					groups.back().material = material;
+					groups.back().compression = key.second;
+				}
+				auto & group = groups[groupIt->second];
+				group.bounds.Encapsulate(piece.bounds);
+				group.pieces.push_back(std::move(piece));
+			}
+		}
+
+		int combinedParts = 0;
+		const int batchCount = s_statistics.batches;
+		for (auto & group : groups)
+		{
+			// a single piece gains nothing
+			if (group.pieces.size() < 2)
+				continue;
+
+			for (auto & piece : group.pieces)
+			{
+				piece.mortonCode = MortonCode(piece.bounds.center(), group.bounds);
+			}
+			std::stable_sort(group.pieces.begin(), group.pieces.end(), [](Piece const & a, Piece const & b) {
+				return a.mortonCode < b.mortonCode;
+			});
+
+			// split into batches of at most s_maxBatchVertices
+			std::size_t first = 0;
+			while (first < group.pieces.size())
+			{
+				std::size_t last = first;
+				uint32_t vertexCount = 0;
+				while (last < group.pieces.size() && vertexCount + group.pieces[last].vertexCount <= s_maxBatchVertices)
+				{
+					vertexCount += group.pieces[last].vertexCount;
+					last++;
+				}
+				if (last - first < 2)
+				{
+					first = last;
+					continue;
+				}
+
+				std::vector<Vector3> vertices, normals, tangents;
+				std::vector<Vector2> uv;
+				std::vector<uint32_t> triangles;
+				std::vector<uint32_t> subMeshIndexOffset;
+				vertices.reserve(vertexCount);
+				normals.reserve(vertexCount);
+				tangents.reserve(vertexCount);
+				uv.reserve(vertexCount);
+
+				auto batch = std::make_shared<StaticBatch>();
+				batch->material = group.material;
+				for (std::size_t p = first; p < last; ++p)
+				{
+					auto const & piece = group.pieces[p];
+					auto const & source = *piece.source;
+					auto transform = piece.renderer->transform();
+					const auto localToWorld = transform->localToWorldMatrix();
+					const auto normalMatrix = transform->worldToLocalMatrix().transpose();
+					// a mirroring transform flips the winding of the triangles
+					const bool flip = localToWorld.determinant() < 0;
+					const bool hasNormals = source.normals.size() == source.vertices.size();
+					const bool hasTangents = source.tangents.size() == source.vertices.size();
+					const bool hasUV = source.uv.size() == source.vertices.size();
+
+					subMeshIndexOffset.push_back(static_cast<uint32_t>(triangles.size()));
+					std::vector<uint32_t> remap(source.vertices.size(), UINT32_MAX);
+					auto vertexIndex = [&](uint32_t v) -> uint32_t
+					{
+						if (remap[v] == UINT32_MAX)
+						{
+							remap[v] = static_cast<uint32_t>(vertices.size());
+							vertices.push_back(localToWorld.MultiplyPoint(source.vertices[v]));
+							normals.push_back(hasNormals ? normalMatrix.MultiplyVector(source.normals[v]).normalized() : Vector3::zero);
+							tangents.push_back(hasTangents ? localToWorld.MultiplyVector(source.tangents[v]).normalized() : Vector3::zero);
+							uv.push_back(hasUV ? source.uv[v] : Vector2::zero);
+						}
+						return remap[v];
+					};
+					for (uint32_t i = piece.firstIndex; i + 2 < piece.firstIndex + piece.indexCount; i += 3)
+					{
+						const uint32_t a = vertexIndex(source.triangles[i]);
+						const uint32_t b = vertexIndex(source.triangles[i + 1]);
+						const uint32_t c = vertexIndex(source.triangles[i + 2]);
+						triangles.push_back(a);
+						triangles.push_back(flip ? c : b);
+						triangles.push_back(flip ? b : c);
+					}
+					batch->partBounds.push_back(piece.bounds);
+				}
+
+				auto mesh = std::make_shared<Mesh>(std::move(vertices), std::move(normals), std::move(uv), std::move(tangents), std::move(triangles));
+				mesh->setName("Combined Mesh (" + group.material->name() + ")");
+				mesh->setVertexCompression(group.compression);
+				mesh->m_subMeshCount = static_cast<int>(subMeshIndexOffset.size());
+				mesh->m_subMeshIndexOffset = std::move(subMeshIndexOffset);
+				mesh->UploadMeshData();
+				batch->mesh = mesh;
+
+				for (std::size_t p = first; p < last; ++p)
+				{
+					auto const & piece = group.pieces[p];
+					auto & parts = piece.renderer->m_staticBatchParts;
+					if (parts.empty())
+						s_batchedRenderers.push_back(piece.renderer);
+					parts.resize(piece.renderer->materials().size());
+					parts[piece.materialIndex].batch = batch;
+					parts[piece.materialIndex].subMeshIndex = static_cast<int>(p - first);
+				}
+
+				s_statistics.batches++;
+				s_statistics.parts += static_cast<int>(last - first);
+				s_statistics.vertices += mesh->vertexCount();
+				s_statistics.bytes += mesh->vertexCount() * mesh->vertexStride() + mesh->triangleCount() * 3 * mesh->indexSize();
+				combinedParts += static_cast<int>(last - first);
+				first = last;
+			}
+		}
+
+		if (combinedParts > 0)
+		{
+			LogInfo(Format("StaticBatchingUtility: %1% renderers combined into %2% batches", combinedParts, s_statistics.batches - batchCount));
+		}
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef StaticBatchingUtility_hpp
+#define StaticBatchingUtility_hpp
+
+#include "FishEngine.hpp"
+#include "ReflectClass.hpp"
+#include "Bounds.hpp"
+
+#include <vector>
+
+namespace FishEngine
+{
+	// Static renderers of one material combined into one mesh, in world space. Every (renderer, material) combined
+	// is one sub-mesh of the mesh, a part: the visible parts are drawn with one MeshPool draw per run of consecutive
+	// parts, so culling still drops the hidden ones.
+	struct StaticBatch
+	{
+		MeshPtr				mesh;
+		MaterialPtr			material;
+		std::vector<Bounds>	partBounds;		// world space, by sub-mesh
+	};
+
+	typedef std::shared_ptr<StaticBatch> StaticBatchPtr;
+
+	// the sub-mesh of a renderer in a static batch, see MeshRenderer::staticBatchParts
+	struct StaticBatchPart
+	{
+		StaticBatchPtr	batch;				// null: not batched
+		int				subMeshIndex = -1;
+	};
+
+	// Combine the static (GameObject::isStatic) MeshRenderers of the scene into StaticBatch meshes, per material and
+	// vertex layout, pre-transformed to world space. Called by Scene::Start, renderers with a LODGroup and
+	// transparent or alpha tested materials are skipped.
+	// The source meshes are read back from their MeshPool if they are no longer readable. Batched game objects must
+	// not move afterwards: they are drawn from the combined meshes until Clear.
+	class FE_EXPORT Meta(NonSerializable) StaticBatchingUtility
+	{
+	public:
+		StaticBatchingUtility() = delete;
+
+		static bool enabled()
+		{
+			return s_enabled;
+		}
+
+		static void setEnabled(bool value)
+		{
+			s_enabled = value;
+		}
+
+		// Vertices of a batch: larger batches are split, renderers larger than this are not batched.
+		// The default keeps 16-bit indices.
+		static uint32_t maxBatchVertices()
+		{
+			return s_maxBatchVertices;
+		}
+
+		static void setMaxBatchVertices(uint32_t value)
+		{
+			s_maxBatchVertices = value;
+		}
+
+		// Combine the static renderers in the hierarchy of staticBatchRoot, those already batched are left as is.
+		static void Combine(GameObjectPtr const & staticBatchRoot);
+
+		// Combine the static renderers of the scene.
+		static void CombineScene();
+
+		// Release the batches, the renderers are drawn from their own meshes again.
+		static void Clear();
+
+		struct Statistics
+		{
+			int			batches = 0;
+			int			parts = 0;			// batched (renderer, material)
+			uint32_t	vertices = 0;		// of all batches
+			std::size_t	bytes = 0;			// GPU memory of all batches
+		};
+
+		static Statistics const & statistics()
+		{
+			return s_statistics;
+		}
+
+	private:
+		static void Combine(std::vector<GameObjectPtr> const & roots);
+
+		static bool								s_enabled;
+		static uint32_t							s_maxBatchVertices;
+		static std::vector<std::weak_ptr<MeshRenderer>>	s_batchedRenderers;
+		static Statistics						s_statistics;
+	};
+}
+
+#endif // StaticBatchingUtility_hpp
@@ -1,5 +1,7 @@
 #include "Texture.hpp"
 #include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
+#include "MaterialTable.hpp"
 #include "Debug.hpp"
 #include "Mathf.hpp"
 
@@ -11,13 +13,15 @@ namespace FishEngine
 	{
 		assert(m_GLNativeTexture != 0);
 		const auto& sampler = TextureSampler::GetSampler(m_filterMode, m_wrapMode);
-		glBindSampler(m_GLNativeTexture, sampler.m_nativeGLSampler);
+		GLStateCache::BindSampler(m_GLNativeTexture, sampler.m_nativeGLSampler);
 	}
 
 	std::vector<TexturePtr> Texture::s_textures;
 
 	Texture::~Texture()
 	{
+		GLStateCache::OnDeleteTexture(m_GLNativeTexture);
+		MaterialTable::OnDeleteTexture(m_GLNativeTexture);
 		glDeleteTextures(1, &m_GLNativeTexture);
 	}
 
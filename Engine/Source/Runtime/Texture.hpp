@@ -117,6 +117,7 @@ namespace FishEngine
 
 	private:
 		friend class FishEditor::TextureImporter;
+		friend class RenderGraph;
 	};
 }
 
@@ -1,5 +1,6 @@
 #include "Texture2D.hpp"
 #include "GLEnvironment.hpp"
+#include "GLStateCache.hpp"
 #include "Debug.hpp"
 #include "Mathf.hpp"
 
@@ -46,28 +47,55 @@ namespace FishEngine
 
 		glGenTextures(1, &m_GLNativeTexture);
 		glCheckError();
-		glBindTexture(GL_TEXTURE_2D, m_GLNativeTexture);
+		GLStateCache::BindTexture(GL_TEXTURE_2D, m_GLNativeTexture);
 		glCheckError();
-#if 1
-		GLsizei max_mipmap_level_count = Mathf::FloorToInt(std::log2f((float)std::max(m_width, m_height))) + 1;
-		glCheckError();
-		glTexStorage2D(GL_TEXTURE_2D, max_mipmap_level_count, internal_format, m_width, m_height);
-		glCheckError();
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, format, type, m_data.data());
-#else
-		glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, data);
-#endif
-		glCheckError();
-		glGenerateMipmap(GL_TEXTURE_2D);
+		if (m_mipmapCount > 0)
+		{
+			// mip levels (and block compression) were built at import time, upload as is
+			glTexStorage2D(GL_TEXTURE_2D, m_mipmapCount, internal_format, m_width, m_height);
+			glCheckError();
+			const bool compressed = IsBlockCompressed(m_format);
+			std::size_t offset = 0;
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);	// levels are tightly packed, small R8 levels are not 4-byte aligned
+			for (uint32_t level = 0; level < m_mipmapCount; ++level)
+			{
+				const int w = std::max(1, static_cast<int>(m_width >> level));
+				const int h = std::max(1, static_cast<int>(m_height >> level));
+				const int size = ImageByteCount(m_format, w, h);
+				if (offset + size > m_data.size())
+				{
+					LogError("Texture2D: not enough pixel data for all mip levels");
+					abort();
+				}
+				if (compressed)
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h, internal_format, size, m_data.data() + offset);
+				else
+					glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h, format, type, m_data.data() + offset);
+				offset += size;
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_mipmapCount - 1);
+		}
+		else
+		{
+			GLsizei max_mipmap_level_count = Mathf::FloorToInt(std::log2f((float)std::max(m_width, m_height))) + 1;
+			glCheckError();
+			glTexStorage2D(GL_TEXTURE_2D, max_mipmap_level_count, internal_format, m_width, m_height);
+			glCheckError();
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, format, type, m_data.data());
+			glCheckError();
+			glGenerateMipmap(GL_TEXTURE_2D);
+			m_mipmapCount = max_mipmap_level_count;
+		}
 		glCheckError();
 		// Parameters
 		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
 		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_mipmapCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 		glCheckError();
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glCheckError();
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLStateCache::BindTexture(GL_TEXTURE_2D, 0);
 		m_uploaded = true;
 		m_data.clear();
 		m_data.shrink_to_fit();
@@ -41,6 +41,8 @@ namespace FishEngine
 		friend class FishEditor::TextureImporter;
 		friend class FishEditor::DDSImporter;
 
+		// Pixels of all the mip levels in m_data, level 0 first, tightly packed.
+		// If m_mipmapCount is 0, m_data only holds level 0 and the mip levels are generated by the GPU.
 		Meta(NonSerializable)
 		std::vector<std::uint8_t> m_data;
 		
@@ -48,7 +50,7 @@ namespace FishEngine
 		TextureFormat m_format;
 
 		// How many mipmap levels are in this texture (Read Only).
-		uint32_t m_mipmapCount;
+		uint32_t m_mipmapCount = 0;
 
 		
 	};
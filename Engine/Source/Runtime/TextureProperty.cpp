@@ -1,6 +1,14 @@
 #include "TextureProperty.hpp"
 #include <cassert>
 
+// S3TC is an extension in core profile headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 namespace FishEngine
 {
 
@@ -37,6 +45,26 @@ namespace FishEngine
 		}
 	}
 
+	bool IsBlockCompressed(TextureFormat format)
+	{
+		return format == TextureFormat::DXT1 || format == TextureFormat::DXT5
+			|| format == TextureFormat::BC4 || format == TextureFormat::BC5;
+	}
+
+	int ImageByteCount(TextureFormat format, int width, int height)
+	{
+		if (IsBlockCompressed(format))
+		{
+			const int blocks = ((width + 3) / 4) * ((height + 3) / 4);
+			const int blockBytes = (format == TextureFormat::DXT1 || format == TextureFormat::BC4) ? 8 : 16;
+			return blocks * blockBytes;
+		}
+		int bpp = BytePerPixel(format);
+		if (bpp <= 0)
+			return -1;
+		return width * height * bpp;
+	}
+
 	void TextureFormat2GLFormat(
 		TextureFormat format,
 		GLenum* out_internalFormat,
@@ -85,6 +113,27 @@ namespace FishEngine
 			*out_externalFormat = GL_RED;
 			*out_pixelType = GL_UNSIGNED_BYTE;
 			break;
+		// compressed: only the internal format is used by glCompressedTexSubImage2D
+		case TextureFormat::DXT1:
+			*out_internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			*out_externalFormat = GL_RGB;
+			*out_pixelType = GL_UNSIGNED_BYTE;
+			break;
+		case TextureFormat::DXT5:
+			*out_internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			*out_externalFormat = GL_RGBA;
+			*out_pixelType = GL_UNSIGNED_BYTE;
+			break;
+		case TextureFormat::BC4:
+			*out_internalFormat = GL_COMPRESSED_RED_RGTC1;
+			*out_externalFormat = GL_RED;
+			*out_pixelType = GL_UNSIGNED_BYTE;
+			break;
+		case TextureFormat::BC5:
+			*out_internalFormat = GL_COMPRESSED_RG_RGTC2;
+			*out_externalFormat = GL_RG;
+			*out_pixelType = GL_UNSIGNED_BYTE;
+			break;
 		default:
 			//Debug::LogError("Unknown texture format");
 			abort();
@@ -111,6 +111,13 @@ namespace FishEngine
 	// return -1 for compression format
 	int BytePerPixel(TextureFormat format);
 
+	// DXT1 (BC1), DXT5 (BC3), BC4 and BC5: 4x4 pixel blocks of 8 or 16 bytes
+	bool IsBlockCompressed(TextureFormat format);
+
+	// size in bytes of a width x height image (one mip level)
+	// return -1 for unsupported format
+	int ImageByteCount(TextureFormat format, int width, int height);
+
 	void TextureFormat2GLFormat(
 		TextureFormat format,
 		GLenum* out_internalFormat,
@@ -3,7 +3,7 @@
 namespace FishEngine
 {
 	float Time::m_deltaTime = 1;
-	float Time::m_fixedDeltaTime = 1;
+	float Time::m_fixedDeltaTime = 0.02f;
 	float Time::m_time = 1;
 	float Time::m_timeScale = 1;
 }
@@ -23,6 +23,10 @@ namespace FishEngine
 			return m_fixedDeltaTime;
 		}
 
+		static void setFixedDeltaTime(float value) {
+			m_fixedDeltaTime = value;
+		}
+
 		// The time at the beginning of this frame (Read Only). This is the time in seconds since the start of the game.
 		static float time() {
 			return m_time;
@@ -33,6 +37,10 @@ namespace FishEngine
 			return m_timeScale;
 		}
 
+		static void setTimeScale(float value) {
+			m_timeScale = value;
+		}
+
 	private:
 		friend class RenderSystem;
 		friend class GameLoop;
@@ -1,6 +1,7 @@
 #include "Transform.hpp"
 #include "GameObject.hpp"
 #include "Debug.hpp"
+#include "Scene.hpp"
 #include "Common.hpp"
 
 namespace FishEngine
@@ -28,7 +29,7 @@ namespace FishEngine
 		if (!m_parent.expired()) {
 			m_localToWorldMatrix = m_parent.lock()->localToWorldMatrix() * m_localToWorldMatrix;
 		}
-		m_worldToLocalMatrix = m_localToWorldMatrix.inverse();
+		m_worldToLocalMatrix = m_localToWorldMatrix.inverseAffine();
 #else
 		// TODO this version is not right, take a look to see where the bug is.
 		// maybe in the TRS
@@ -226,6 +227,8 @@ namespace FishEngine
 		}
 		//UpdateMatrix();
 		MakeDirty();
+		// null in ~Transform
+		Scene::NotifyChange(gameObject(), SceneChange::Reparented);
 	}
 
 	//std::shared_ptr<Transform>
@@ -353,6 +353,7 @@ namespace FishEngine
 		friend class FishEditor::Inspector;
 		friend class GameObject;
 		friend class Scene;
+		friend class SceneSnapshot;
 
 		Vector3						m_localPosition;
 		Vector3						m_localScale;
@@ -54,6 +54,7 @@ namespace FishEngine
 		{ ClassID<FishEngine::Cubemap>(), ClassID<FishEngine::Texture>() },
 		{ ClassID<FishEngine::GameObject>(), ClassID<FishEngine::Object>() },
 		{ ClassID<FishEngine::Light>(), ClassID<FishEngine::Behaviour>() },
+		{ ClassID<FishEngine::LODGroup>(), ClassID<FishEngine::Component>() },
 		{ ClassID<FishEngine::Material>(), ClassID<FishEngine::Object>() },
 		{ ClassID<FishEngine::Mesh>(), ClassID<FishEngine::Object>() },
 		{ ClassID<FishEngine::MeshFilter>(), ClassID<FishEngine::Component>() },
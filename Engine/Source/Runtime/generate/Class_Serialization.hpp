@@ -983,7 +983,7 @@ namespace FishEngine
 	void Save ( Archive& archive, GameObject const & value )
 	{
 		archive << BaseClassWrapper<Object>(value);
-		archive << make_nvp("m_components", value.m_components); // std::list<ComponentPtr>
+		archive << make_nvp("m_components", value.m_components); // std::vector<ComponentPtr>
 		archive << make_nvp("m_activeSelf", value.m_activeSelf); // bool
 		archive << make_nvp("m_layer", value.m_layer); // int
 		archive << make_nvp("m_tagIndex", value.m_tagIndex); // int
@@ -994,7 +994,7 @@ namespace FishEngine
 	void Load ( Archive& archive, GameObject & value )
 	{
 		archive >> BaseClassWrapper<Object>(value);
-		archive >> make_nvp("m_components", value.m_components); // std::list<ComponentPtr>
+		archive >> make_nvp("m_components", value.m_components); // std::vector<ComponentPtr>
 		archive >> make_nvp("m_activeSelf", value.m_activeSelf); // bool
 		archive >> make_nvp("m_layer", value.m_layer); // int
 		archive >> make_nvp("m_tagIndex", value.m_tagIndex); // int
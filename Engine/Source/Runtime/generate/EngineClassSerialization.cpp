@@ -32,6 +32,7 @@
 #include "../AudioListener.hpp" 
 #include "../SkinnedMeshRenderer.hpp" 
 #include "../MeshFilter.hpp" 
+#include "../LODGroup.hpp" 
 #include "../Animation.hpp" 
 #include "../CameraController.hpp" 
 #include "../AudioSystem.hpp" 
@@ -331,6 +332,45 @@ namespace FishEngine
 	}
 
 
+
+	// FishEngine::LODGroup
+	void FishEngine::LODGroup::Serialize ( FishEngine::OutputArchive & archive ) const
+	{
+		//archive.BeginClass();
+		FishEngine::Component::Serialize(archive);
+		archive << FishEngine::make_nvp("m_meshes", m_meshes); // std::vector<MeshPtr>
+		archive << FishEngine::make_nvp("m_screenRelativeTransitionHeights", m_screenRelativeTransitionHeights); // std::vector<float>
+		archive << FishEngine::make_nvp("m_animateCrossFading", m_animateCrossFading); // bool
+		//archive.EndClass();
+	}
+
+	void FishEngine::LODGroup::Deserialize ( FishEngine::InputArchive & archive )
+	{
+		//archive.BeginClass(4);
+		FishEngine::Component::Deserialize(archive);
+		archive >> FishEngine::make_nvp("m_meshes", m_meshes); // std::vector<MeshPtr>
+		archive >> FishEngine::make_nvp("m_screenRelativeTransitionHeights", m_screenRelativeTransitionHeights); // std::vector<float>
+		archive >> FishEngine::make_nvp("m_animateCrossFading", m_animateCrossFading); // bool
+		//archive.EndClass();
+	}
+
+	FishEngine::ComponentPtr FishEngine::LODGroup::Clone(FishEngine::CloneUtility & cloneUtility) const
+	{
+		auto ret = FishEngine::MakeShared<FishEngine::LODGroup>();
+		cloneUtility.m_clonedObject[this->GetInstanceID()] = ret;
+		this->CopyValueTo(ret, cloneUtility);
+		return ret;
+	}
+
+	void FishEngine::LODGroup::CopyValueTo(std::shared_ptr<FishEngine::LODGroup> target, FishEngine::CloneUtility & cloneUtility) const
+	{
+		FishEngine::Component::CopyValueTo(target, cloneUtility);
+		cloneUtility.Clone(this->m_meshes, target->m_meshes); // std::vector<MeshPtr>
+		cloneUtility.Clone(this->m_screenRelativeTransitionHeights, target->m_screenRelativeTransitionHeights); // std::vector<float>
+		cloneUtility.Clone(this->m_animateCrossFading, target->m_animateCrossFading); // bool
+	}
+
+
 	// FishEngine::BoxCollider
 	void FishEngine::BoxCollider::Serialize ( FishEngine::OutputArchive & archive ) const
 	{
@@ -1428,8 +1468,9 @@ namespace FishEngine
 	{
 		//archive.BeginClass();
 		FishEngine::Object::Serialize(archive);
-		archive << FishEngine::make_nvp("m_components", m_components); // std::list<ComponentPtr>
+		archive << FishEngine::make_nvp("m_components", m_components); // std::vector<ComponentPtr>
 		archive << FishEngine::make_nvp("m_activeSelf", m_activeSelf); // bool
+		archive << FishEngine::make_nvp("m_isStatic", m_isStatic); // bool
 		archive << FishEngine::make_nvp("m_layer", m_layer); // int
 		archive << FishEngine::make_nvp("m_tagIndex", m_tagIndex); // int
 		archive << FishEngine::make_nvp("m_transform", m_transform); // TransformPtr
@@ -1440,8 +1481,10 @@ namespace FishEngine
 	{
 		//archive.BeginClass(2);
 		FishEngine::Object::Deserialize(archive);
-		archive >> FishEngine::make_nvp("m_components", m_components); // std::list<ComponentPtr>
+		archive >> FishEngine::make_nvp("m_components", m_components); // std::vector<ComponentPtr>
 		archive >> FishEngine::make_nvp("m_activeSelf", m_activeSelf); // bool
+		if (archive.HasNVP("m_isStatic"))
+			archive >> FishEngine::make_nvp("m_isStatic", m_isStatic); // bool
 		archive >> FishEngine::make_nvp("m_layer", m_layer); // int
 		archive >> FishEngine::make_nvp("m_tagIndex", m_tagIndex); // int
 		archive >> FishEngine::make_nvp("m_transform", m_transform); // TransformPtr
@@ -13,13 +13,15 @@ namespace FishEngine
 
 // enum count
 template<>
-constexpr int EnumCount<FishEngine::ShaderKeyword>() { return 3; }
+constexpr int EnumCount<FishEngine::ShaderKeyword>() { return 5; }
 
 // string array
 static const char* ShaderKeywordStrings[] =
 {
     "None",
 	"AmbientIBL",
+	"MaterialTable",
+	"IndirectDraw",
 	"All"
 };
 
@@ -37,7 +39,9 @@ inline FishEngine::ShaderKeyword ToEnum<FishEngine::ShaderKeyword>(const int ind
     switch (index) {
     case 0: return FishEngine::ShaderKeyword::None; break;
 	case 1: return FishEngine::ShaderKeyword::AmbientIBL; break;
-	case 2: return FishEngine::ShaderKeyword::All; break;
+	case 2: return FishEngine::ShaderKeyword::MaterialTable; break;
+	case 3: return FishEngine::ShaderKeyword::IndirectDraw; break;
+	case 4: return FishEngine::ShaderKeyword::All; break;
 	
     default: abort(); break;
     }
@@ -50,7 +54,9 @@ inline int EnumToIndex<FishEngine::ShaderKeyword>(FishEngine::ShaderKeyword e)
     switch (e) {
     case FishEngine::ShaderKeyword::None: return 0; break;
 	case FishEngine::ShaderKeyword::AmbientIBL: return 1; break;
-	case FishEngine::ShaderKeyword::All: return 2; break;
+	case FishEngine::ShaderKeyword::MaterialTable: return 2; break;
+	case FishEngine::ShaderKeyword::IndirectDraw: return 3; break;
+	case FishEngine::ShaderKeyword::All: return 4; break;
 	
     default: abort(); break;
     }
@@ -62,6 +68,8 @@ inline FishEngine::ShaderKeyword ToEnum<FishEngine::ShaderKeyword>(const std::st
 {
     if (s == "None") return FishEngine::ShaderKeyword::None;
 	if (s == "AmbientIBL") return FishEngine::ShaderKeyword::AmbientIBL;
+	if (s == "MaterialTable") return FishEngine::ShaderKeyword::MaterialTable;
+	if (s == "IndirectDraw") return FishEngine::ShaderKeyword::IndirectDraw;
 	if (s == "All") return FishEngine::ShaderKeyword::All;
 	
     abort();
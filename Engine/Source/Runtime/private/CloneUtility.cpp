@@ -9,6 +9,56 @@
 
 namespace FishEngine
 {
+	void ClonePlan::Build(GameObjectPtr const & root)
+	{
+		nodes.clear();
+		slots.clear();
+		slotCount = 0;
+		fixups.clear();
+		fixupsRecorded = false;
+		nodes.push_back(Node{ root, -1, 0, 0, 0 });
+		for (std::size_t i = 0; i < nodes.size(); ++i)
+		{
+			auto go = nodes[i].source.lock();
+			auto const & transform = go->transform();
+			nodes[i].slot = slotCount;
+			nodes[i].componentCount = go->Components().size();
+			nodes[i].childCount = transform->children().size();
+			slots[go->GetInstanceID()] = slotCount++;
+			slots[transform->GetInstanceID()] = slotCount++;
+			for (auto const & c : go->Components())
+			{
+				slots[c->GetInstanceID()] = slotCount++;
+			}
+			for (auto const & child : transform->children())
+			{
+				nodes.push_back(Node{ child->gameObject(), static_cast<int>(i), 0, 0, 0 });
+			}
+		}
+	}
+
+	bool ClonePlan::IsUpToDate() const
+	{
+		for (auto const & node : nodes)
+		{
+			auto source = node.source.lock();
+			if (source == nullptr)
+				return false;
+			auto const & transform = source->transform();
+			if (transform == nullptr	// destroyed
+				|| source->Components().size() != node.componentCount
+				|| transform->children().size() != node.childCount)
+				return false;
+			if (node.parent >= 0)
+			{
+				auto parent = nodes[node.parent].source.lock();
+				if (parent == nullptr || transform->parent() != parent->transform())
+					return false;
+			}
+		}
+		return true;
+	}
+
 	void CloneUtility::Clone(std::weak_ptr<Transform> const & source, std::weak_ptr<Transform> & dest)
 	{
 		if (source.expired())
@@ -18,10 +68,10 @@ namespace FishEngine
 		}
 
 		auto sourceTransform = source.lock();
-		auto it = m_clonedObject.find(sourceTransform->GetInstanceID());
-		if (it != m_clonedObject.end()) // already cloned
+		auto cloned = m_clonedObject.Find(sourceTransform->GetInstanceID());
+		if (cloned != nullptr) // already cloned
 		{
-			dest = As<Transform>(it->second);
+			dest = As<Transform>(cloned);
 		}
 		else
 		{
@@ -37,10 +87,10 @@ namespace FishEngine
 			return;
 		}
 
-		auto it = m_clonedObject.find(source->GetInstanceID());
-		if (it != m_clonedObject.end()) // already cloned
+		auto cloned = m_clonedObject.Find(source->GetInstanceID());
+		if (cloned != nullptr) // already cloned
 		{
-			dest = As<Transform>(it->second);
+			dest = As<Transform>(cloned);
 		}
 		else
 		{
@@ -57,10 +107,10 @@ namespace FishEngine
 		}
 		auto go = source.lock();
 		int sourceInstanceID = go->GetInstanceID();
-		auto it = m_clonedObject.find(sourceInstanceID);
-		if (it != m_clonedObject.end())
+		auto cloned = m_clonedObject.Find(sourceInstanceID);
+		if (cloned != nullptr)
 		{
-			dest = std::dynamic_pointer_cast<GameObject>( it->second );
+			dest = std::dynamic_pointer_cast<GameObject>( cloned );
 		}
 		else
 		{
@@ -76,10 +126,10 @@ namespace FishEngine
 			return;
 		}
 		int sourceInstanceID = source->GetInstanceID();
-		auto it = m_clonedObject.find(sourceInstanceID);
-		if (it != m_clonedObject.end())
+		auto cloned = m_clonedObject.Find(sourceInstanceID);
+		if (cloned != nullptr)
 		{
-			dest = std::dynamic_pointer_cast<GameObject>(it->second);
+			dest = std::dynamic_pointer_cast<GameObject>(cloned);
 		}
 		else
 		{
@@ -95,10 +145,10 @@ namespace FishEngine
 			return;
 		}
 
-		auto it = m_clonedObject.find(source->GetInstanceID());
-		if (it != m_clonedObject.end()) // already cloned
+		auto cloned = m_clonedObject.Find(source->GetInstanceID());
+		if (cloned != nullptr) // already cloned
 		{
-			dest = As<Prefab>(it->second);
+			dest = As<Prefab>(cloned);
 		}
 		else
 		{
@@ -4,9 +4,147 @@
 #include <type_traits>
 #include <string>
 #include <memory>
+#include <map>
+#include <vector>
+#include <unordered_map>
 
 namespace FishEngine
 {
+	// The hierarchy of a game object flattened for cloning: the game objects in breadth first order (parents before
+	// children) and one slot per game object, transform and component. Built once per original by
+	// Object::Instantiate and reused by every clone of it. The game objects are held weakly: a cached plan does not keep
+	// a destroyed prefab alive.
+	struct Meta(NonSerializable) ClonePlan
+	{
+		struct Node
+		{
+			std::weak_ptr<GameObject>	source;
+			int				parent;			// index in nodes, -1 for the root
+			int				slot;			// of the game object, the transform is slot + 1
+			std::size_t		componentCount;
+			std::size_t		childCount;
+		};
+
+		// a reference resolved while cloning: a slot of the hierarchy, or -1 for an object outside of it
+		struct Fixup
+		{
+			int				instanceID;		// of the source object, checks that the sources did not change
+			int				slot;
+		};
+
+		std::vector<Node>				nodes;
+		std::unordered_map<int, int>	slots;		// instance id -> slot
+		int								slotCount = 0;
+
+		// The look ups of CloneTable in the order of a clone, recorded by the first clone with this plan (each object
+		// registers its clone, then its fields resolve their references, always in the same order). The next clones
+		// index m_slots with them instead of hashing instance ids.
+		mutable std::vector<Fixup>		fixups;
+		mutable bool					fixupsRecorded = false;
+
+		void Build(GameObjectPtr const & root);
+
+		// false if a game object of the hierarchy got or lost a component or a child since Build, or was moved or
+		// destroyed
+		bool IsUpToDate() const;
+
+		// the root game object was destroyed
+		bool expired() const
+		{
+			return nodes.empty() || nodes[0].source.expired();
+		}
+	};
+
+	// instance id of a source object -> its clone.
+	// The objects of the plan, if any, have a slot of a vector, the others go to a map.
+	class Meta(NonSerializable) CloneTable
+	{
+	public:
+		// Start a clone with plan: its fix-ups are replayed, or recorded if there are none yet.
+		void Reset(ClonePlan const * plan)
+		{
+			m_plan = plan;
+			m_slots.assign(plan == nullptr ? 0 : plan->slotCount, nullptr);
+			m_others.clear();
+			m_cursor = 0;
+			m_replaying = plan != nullptr && plan->fixupsRecorded;
+			m_recording = plan != nullptr && !plan->fixupsRecorded;
+			if (m_recording)
+				plan->fixups.clear();
+		}
+
+		// The clone is complete: the recorded fix-ups are kept, those which no longer match are recorded again by the
+		// next clone.
+		void EndClone()
+		{
+			if (m_plan == nullptr)
+				return;
+			if (m_recording)
+				m_plan->fixupsRecorded = true;
+			else if (m_replaying && m_cursor != m_plan->fixups.size())
+				m_plan->fixupsRecorded = false;
+			m_recording = m_replaying = false;
+		}
+
+		ObjectPtr & operator[](int instanceID)
+		{
+			const int slot = Resolve(instanceID);
+			return slot >= 0 ? m_slots[slot] : m_others[instanceID];
+		}
+
+		// nullptr if not cloned
+		ObjectPtr Find(int instanceID)
+		{
+			const int slot = Resolve(instanceID);
+			if (slot >= 0)
+				return m_slots[slot];
+			if (m_others.empty())
+				return nullptr;
+			auto it = m_others.find(instanceID);
+			return it == m_others.end() ? nullptr : it->second;
+		}
+
+		// by slot of the plan
+		ObjectPtr const & slot(int index) const
+		{
+			return m_slots[index];
+		}
+
+		ObjectPtr & slot(int index)
+		{
+			return m_slots[index];
+		}
+
+	private:
+		// slot of instanceID in the plan, -1 if not in it
+		int Resolve(int instanceID)
+		{
+			if (m_plan == nullptr)
+				return -1;
+			auto & fixups = m_plan->fixups;
+			if (m_replaying)
+			{
+				if (m_cursor < fixups.size() && fixups[m_cursor].instanceID == instanceID)
+					return fixups[m_cursor++].slot;
+				// a reference of the sources changed since the fix-ups were recorded
+				m_replaying = false;
+				m_plan->fixupsRecorded = false;
+			}
+			auto it = m_plan->slots.find(instanceID);
+			const int slot = (it == m_plan->slots.end()) ? -1 : it->second;
+			if (m_recording)
+				fixups.push_back({ instanceID, slot });
+			return slot;
+		}
+
+		ClonePlan const *			m_plan = nullptr;
+		std::vector<ObjectPtr>		m_slots;
+		std::map<int, ObjectPtr>	m_others;
+		std::size_t					m_cursor = 0;		// in m_plan->fixups
+		bool						m_replaying = false;
+		bool						m_recording = false;
+	};
+
 	class Meta(NonSerializable) CloneUtility
 	{
 	public:
@@ -64,6 +202,6 @@ namespace FishEngine
 	//private:
 
 		// instanceID of old object -> cloned object
-		std::map<int, ObjectPtr> m_clonedObject;
+		CloneTable m_clonedObject;
 	};
 }
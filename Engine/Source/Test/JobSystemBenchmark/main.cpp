@@ -0,0 +1,101 @@
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#include <JobSystem.hpp>
+
+using namespace std;
+using namespace FishEngine;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// empty jobs scheduled from the main thread: cost of Schedule + steal + Execute
+void Throughput(int jobCount)
+{
+	auto counter = std::make_shared<JobCounter>();
+	auto start = Clock::now();
+	for (int i = 0; i < jobCount; ++i)
+	{
+		JobSystem::Schedule([]() {}, counter);
+	}
+	JobSystem::Wait(counter);
+	const double time = Seconds(start);
+	cout << "  " << jobCount << " empty jobs: " << time * 1000 << " ms, "
+		<< static_cast<int64_t>(jobCount / time) << " jobs/s" << endl;
+}
+
+// a chain of dependent jobs: cost of ScheduleAfter
+void Dependencies(int jobCount)
+{
+	auto start = Clock::now();
+	JobHandle previous = nullptr;
+	int value = 0;
+	for (int i = 0; i < jobCount; ++i)
+	{
+		previous = JobSystem::ScheduleAfter(previous, [&value]() { value++; });
+	}
+	JobSystem::Wait(previous);
+	const double time = Seconds(start);
+	cout << "  chain of " << jobCount << " jobs: " << time * 1000 << " ms"
+		<< (value == jobCount ? "" : " WRONG ORDER") << endl;
+}
+
+double ParallelFor(vector<float> & data, int grainSize)
+{
+	auto start = Clock::now();
+	JobSystem::ParallelFor(0, data.size(), [&data](std::size_t i) {
+		float x = data[i];
+		for (int k = 0; k < 16; ++k)
+			x = std::sqrt(x * x + 1.0f);
+		data[i] = x;
+	}, grainSize, "Benchmark.ParallelFor");
+	return Seconds(start);
+}
+
+int main()
+{
+	const int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	constexpr std::size_t Elements = 1000000;
+	constexpr int Repeat = 10;
+	vector<float> data(Elements, 1.0f);
+
+	double singleThreadTime = 0;
+	for (int threads = 1; threads <= hardwareThreads; threads *= 2)
+	{
+		cout << threads << " thread(s)" << endl;
+		// workers + the main thread
+		if (threads > 1)
+			JobSystem::Init(threads - 1);
+		JobSystem::setProfiling(true);
+		JobSystem::ResetProfile();
+
+		Throughput(100000);
+		Dependencies(10000);
+
+		for (int grainSize : { 0, 64, 4096 })
+		{
+			double best = 1e10;
+			for (int r = 0; r < Repeat; ++r)
+				best = std::min(best, ParallelFor(data, grainSize));
+			if (threads == 1 && grainSize == 0)
+				singleThreadTime = best;
+			cout << "  parallel_for over " << Elements << " elements, grain " << (grainSize == 0 ? string("adaptive") : to_string(grainSize))
+				<< ": " << best * 1000 << " ms, speedup " << singleThreadTime / best << endl;
+		}
+
+		for (auto const & p : JobSystem::profile())
+		{
+			cout << "  profile " << p.tag << ": " << p.jobs << " jobs, " << p.totalTime << " ms, max " << p.maxTime << " ms" << endl;
+		}
+		JobSystem::Clean();
+	}
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <vector>
+#include <iostream>
+
+#include <Scene.hpp>
+#include <GameObject.hpp>
+#include <Transform.hpp>
+#include <ObjectAllocator.hpp>
+
+using namespace std;
+using namespace FishEngine;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// count game objects under root, each one the child of the one branching game objects before it:
+// branching 1 is a chain, branching >= count a flat list of children
+GameObjectPtr CreateHierarchy(int count, int branching)
+{
+	vector<GameObjectPtr> gameObjects;
+	gameObjects.reserve(count);
+	gameObjects.push_back(Scene::CreateGameObject("Root"));
+	for (int i = 1; i < count; ++i)
+	{
+		auto go = Scene::CreateGameObject("GameObject");
+		go->transform()->SetParent(gameObjects[(i - 1) / branching]->transform(), false);
+		gameObjects.push_back(go);
+	}
+	return gameObjects[0];
+}
+
+void DestroyHierarchy(char const * name, int count, int branching)
+{
+	auto root = CreateHierarchy(count, branching);
+	// other game objects in the scene, which the destroyed ones used to be searched among
+	auto others = CreateHierarchy(count, 4);
+
+	auto start = Clock::now();
+	Scene::DestroyImmediate(root);
+	root = nullptr;
+	const double time = Milliseconds(start);
+	cout << "  " << name << " of " << count << ": " << time << " ms, "
+		<< Scene::GameObjects().size() << " game objects left" << endl;
+	Scene::DestroyImmediate(others);
+}
+
+// Destroy of count root game objects, destroyed together at the end of the frame
+void DestroyDeferred(int count)
+{
+	vector<GameObjectPtr> gameObjects;
+	for (int i = 0; i < count; ++i)
+	{
+		gameObjects.push_back(Scene::CreateGameObject("GameObject"));
+	}
+	for (auto & go : gameObjects)
+	{
+		Scene::Destroy(go);
+	}
+	gameObjects.clear();
+
+	auto start = Clock::now();
+	Scene::Update();
+	cout << "  " << count << " deferred Destroy: " << Milliseconds(start) << " ms, "
+		<< Scene::GameObjects().size() << " game objects left" << endl;
+}
+
+int main()
+{
+	for (int count : { 1000, 5000, 20000 })
+	{
+		cout << count << " game objects" << endl;
+		DestroyHierarchy("chain", count, 1);
+		DestroyHierarchy("flat hierarchy", count, count);
+		DestroyHierarchy("tree (4 children each)", count, 4);
+		DestroyDeferred(count);
+
+		auto stats = ObjectAllocator::statistics();
+		cout << "  live objects: " << stats.liveCount << ", reserved: " << stats.reservedBytes / 1024 << " KB" << endl;
+	}
+	Scene::Clean();
+	return 0;
+}
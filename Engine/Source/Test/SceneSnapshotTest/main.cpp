@@ -0,0 +1,102 @@
+#include <iostream>
+
+#include <Scene.hpp>
+#include <GameObject.hpp>
+#include <Transform.hpp>
+#include <Prefab.hpp>
+#include <SceneSnapshot.hpp>
+
+using namespace std;
+using namespace FishEngine;
+
+int failures = 0;
+
+void Check(bool condition, char const * what)
+{
+	if (!condition)
+	{
+		cout << "  failed: " << what << endl;
+		failures++;
+	}
+}
+
+// a prefab root with one child, outside of the scene like an imported model
+PrefabPtr CreatePrefab()
+{
+	auto prefab = std::make_shared<Prefab>();
+	prefab->setIsPrefabParent(true);
+	auto root = GameObject::Create();
+	root->setName("Prefab");
+	auto child = GameObject::Create();
+	child->setName("Child");
+	child->transform()->SetParent(root->transform(), false);
+	child->transform()->setLocalPosition(1, 2, 3);
+	for (auto const & go : { root, child })
+	{
+		go->setPrefabInternal(prefab);
+		go->transform()->setPrefabInternal(prefab);
+	}
+	prefab->setRootGameObject(root);
+	return prefab;
+}
+
+// the children of an instantiated prefab are not in Scene::GameObjects(): they are restored with their root
+void RestoreInstantiatedChild()
+{
+	cout << "restore a child of an instantiated prefab" << endl;
+	auto prefab = CreatePrefab();
+	auto instance = Object::Instantiate(prefab->rootGameObject());
+	Check(instance->transform()->children().size() == 1, "instance has one child");
+	auto child = instance->transform()->children().front()->gameObject();
+
+	SceneSnapshot::Capture();
+	Check(SceneSnapshot::statistics().gameObjects == 2, "root and child captured");
+
+	// play mode: change the child, then destroy it
+	child->transform()->setLocalPosition(10, 20, 30);
+	child->setName("Changed");
+	Scene::DestroyImmediate(child);
+	Check(child->transform() == nullptr, "child destroyed");
+	Check(instance->transform()->children().empty(), "child detached");
+
+	SceneSnapshot::Restore();
+	Check(child->transform() != nullptr, "child restored");
+	Check(instance->transform()->children().size() == 1, "root has its child again");
+	if (child->transform() != nullptr)
+	{
+		Check(child->transform()->parent() == instance->transform(), "child under its root");
+		Check(child->transform()->localPosition() == Vector3(1, 2, 3), "child position restored");
+	}
+	Check(child->name() == "Child", "child name restored");
+	Check(Scene::GameObjects().size() == 1, "only the root in Scene::GameObjects()");
+
+	Scene::DestroyImmediate(instance);
+}
+
+// a child added in play mode is destroyed by Restore
+void DestroyCreatedChild()
+{
+	cout << "destroy a child created in play mode" << endl;
+	auto prefab = CreatePrefab();
+	auto instance = Object::Instantiate(prefab->rootGameObject());
+
+	SceneSnapshot::Capture();
+	auto created = GameObject::Create();
+	created->transform()->SetParent(instance->transform(), false);
+	Check(instance->transform()->children().size() == 2, "child added");
+
+	SceneSnapshot::Restore();
+	Check(created->transform() == nullptr, "created child destroyed");
+	Check(instance->transform()->children().size() == 1, "only the captured child left");
+
+	Scene::DestroyImmediate(instance);
+}
+
+int main()
+{
+	RestoreInstantiatedChild();
+	DestroyCreatedChild();
+	Scene::Clean();
+	cout << (failures == 0 ? "OK" : "FAILED") << endl;
+	return failures == 0 ? 0 : 1;
+}
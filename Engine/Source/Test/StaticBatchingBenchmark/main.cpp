@@ -0,0 +1,113 @@
+#include <chrono>
+#include <vector>
+#include <iostream>
+
+#include <GLEnvironment.hpp>
+#include <glfw/glfw3.h>
+
+#include <Scene.hpp>
+#include <GameObject.hpp>
+#include <Transform.hpp>
+#include <Mesh.hpp>
+#include <MeshFilter.hpp>
+#include <MeshRenderer.hpp>
+#include <Material.hpp>
+#include <Shader.hpp>
+#include <StaticBatchingUtility.hpp>
+
+using namespace std;
+using namespace FishEngine;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// a readable quad
+MeshPtr CreateQuad()
+{
+	std::vector<Vector3> vertices{ { -1, -1, 0 }, { 1, -1, 0 }, { 1, 1, 0 }, { -1, 1, 0 } };
+	std::vector<Vector3> normals(4, Vector3(0, 0, 1));
+	std::vector<Vector2> uv{ { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	std::vector<Vector3> tangents(4, Vector3(1, 0, 0));
+	std::vector<uint32_t> triangles{ 0, 1, 2, 0, 2, 3 };
+	return std::make_shared<Mesh>(std::move(vertices), std::move(normals), std::move(uv), std::move(tangents), std::move(triangles));
+}
+
+// count static renderers, each one the child of the one branching game objects before it (see SceneDestroyBenchmark):
+// branching >= count is a flat list of root game objects
+vector<GameObjectPtr> CreateRenderers(int count, int branching, MeshPtr const & mesh, MaterialPtr const & material)
+{
+	vector<GameObjectPtr> gameObjects;
+	gameObjects.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		auto go = Scene::CreateGameObject("GameObject");
+		go->setIsStatic(true);
+		go->transform()->setLocalPosition(static_cast<float>(i % 100), static_cast<float>(i / 100), 0);
+		go->AddComponent<MeshFilter>()->SetMesh(mesh);
+		go->AddComponent<MeshRenderer>()->SetMaterial(material);
+		if (i > 0 && branching < count)
+			go->transform()->SetParent(gameObjects[(i - 1) / branching]->transform(), true);
+		gameObjects.push_back(go);
+	}
+	return gameObjects;
+}
+
+// every renderer must be combined exactly once, also when its game object is a child
+bool BatchScene(char const * name, int count, int branching, MeshPtr const & mesh, MaterialPtr const & material)
+{
+	auto gameObjects = CreateRenderers(count, branching, mesh, material);
+
+	auto start = Clock::now();
+	StaticBatchingUtility::CombineScene();
+	const double time = Milliseconds(start);
+	auto const & stats = StaticBatchingUtility::statistics();
+	cout << "  " << name << " of " << count << ": " << time << " ms, " << stats.batches << " batches, "
+		<< stats.parts << " parts, " << stats.vertices << " vertices" << endl;
+	const bool ok = stats.parts == count && stats.vertices == static_cast<uint32_t>(count) * 4;
+	if (!ok)
+		cout << "  error: " << count << " renderers combined into " << stats.parts << " parts" << endl;
+
+	StaticBatchingUtility::Clear();
+	Scene::DestroyImmediate(gameObjects);
+	return ok;
+}
+
+int main()
+{
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	auto window = glfwCreateWindow(1, 1, "StaticBatchingBenchmark", nullptr, nullptr);
+	glfwMakeContextCurrent(window);
+#if FISHENGINE_PLATFORM_WINDOWS
+	glewExperimental = GL_TRUE;
+	glewInit();
+#endif
+
+	auto mesh = CreateQuad();
+	// an opaque shader, never compiled: only the render queue is read when batching
+	auto material = Material::CreateMaterial();
+	material->setName("Material");
+	material->setShader(std::make_shared<Shader>());
+
+	bool ok = true;
+	for (int count : { 1000, 5000 })
+	{
+		cout << count << " static renderers" << endl;
+		ok &= BatchScene("flat", count, count, mesh, material);
+		ok &= BatchScene("chain", count, 1, mesh, material);
+		ok &= BatchScene("tree (4 children each)", count, 4, mesh, material);
+	}
+
+	Scene::Clean();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return ok ? 0 : 1;
+}
@@ -41,7 +41,12 @@ namespace ${scope}
 		${c['parent']}::Deserialize(archive);
 	% endif
 	% for member in c['members']:
+		% if member.get('Optional', False):
+		if (archive.HasNVP("${member['name']}"))
+			archive >> FishEngine::make_nvp("${member['name']}", ${member['name']}); // ${member['type']}
+		% else:
 		archive >> FishEngine::make_nvp("${member['name']}", ${member['name']}); // ${member['type']}
+		% endif
 	% endfor
 		//archive.EndClass();
 	}
@@ -87,7 +92,12 @@ namespace ${scope}
 	{
 		archive.BeginClass();
 	% for member in c['members']:
+		% if member.get('Optional', False):
+		if (archive.HasNVP("${member['name']}"))
+			archive >> FishEngine::make_nvp("${member['name']}", value.${member['name']}); // ${member['type']}
+		% else:
 		archive >> FishEngine::make_nvp("${member['name']}", value.${member['name']}); // ${member['type']}
+		% endif
 	% endfor
 		archive.EndClass();
 		return archive;
@@ -56,6 +56,7 @@ all_attributes = (
     'HideInInspector',
     'Serializable',
     'NonSerializable',
+    'Optional',
     'ExecuteInEditMode',
     'AddComponentMenu',
     'RequireComponent',
@@ -165,6 +166,7 @@ def internal_parse_class(node):
             member_type = child.type.spelling
             NonSerializable = False
             HideInInspector = False
+            Optional = False
             for c in child.get_children():
                 if c.kind == clang.cindex.CursorKind.ANNOTATE_ATTR:
                     #print('\t', child.type.spelling, child.spelling)
@@ -174,9 +176,11 @@ def internal_parse_class(node):
                         NonSerializable = True
                     elif c.spelling == 'HideInInspector':
                         HideInInspector = True
+                    elif c.spelling == 'Optional':
+                        Optional = True
             #if not NonSerializable:
             CamelCaseToReadable
-            member = {'name': child.spelling, 'pretty_name': CamelCaseToReadable(child.spelling), 'type': member_type, 'NonSerializable': NonSerializable, 'HideInInspector': HideInInspector}
+            member = {'name': child.spelling, 'pretty_name': CamelCaseToReadable(child.spelling), 'type': member_type, 'NonSerializable': NonSerializable, 'HideInInspector': HideInInspector, 'Optional': Optional}
             #internal_append_to_list_of_a_map(classes[node.spelling], 'member', member)
             members.append(member)
             # else: